@@ -0,0 +1,114 @@
+#ifndef __OS__COMMON__TRACE_H
+#define __OS__COMMON__TRACE_H
+
+
+#include <common/types.h>
+
+
+//levels, anything above TRACE_LEVEL is compiled out,
+//build with -DTRACE_LEVEL=0 to drop tracing entirely
+#define TRACE_ERROR 1
+#define TRACE_INFO 2
+#define TRACE_DEBUG 3
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_INFO
+#endif
+
+//categories, same idea as the level but per subsystem
+#define TRACE_ATA 0x01
+#define TRACE_OFS 0x02
+#define TRACE_CLI 0x04
+#define TRACE_GUI 0x08
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES 0xff
+#endif
+
+
+//events, names are in trace.cc
+#define TRACE_ATA_READ 0
+#define TRACE_ATA_WRITE 1
+#define TRACE_OFS_READ_LBA 2
+#define TRACE_OFS_WRITE_LBA 3
+#define TRACE_OFS_FRAGMENT 4
+#define TRACE_OFS_MOUNT 5
+#define TRACE_CLI_COMMAND 6
+#define TRACE_EVENT_COUNT 7
+
+//power of 2, oldest events get overwritten
+#define TRACE_RING_SIZE 4096
+
+//channel 0 reload when there's no time stamp counter, 1 kHz
+#define TRACE_PIT_RELOAD 1193
+
+
+#define TRACE_RECORD(level, category, phase, event, arg0, arg1) \
+	do { \
+		if ((level) <= TRACE_LEVEL && ((category) & TRACE_CATEGORIES)) { \
+			os::common::Trace::Record((category), (phase), (event), (arg0), (arg1)); \
+		} \
+	} while (0)
+
+#define TRACE_BEGIN(level, category, event, arg0, arg1) TRACE_RECORD(level, category, 'B', event, arg0, arg1)
+#define TRACE_END(level, category, event, arg0, arg1) TRACE_RECORD(level, category, 'E', event, arg0, arg1)
+#define TRACE_INSTANT(level, category, event, arg0, arg1) TRACE_RECORD(level, category, 'i', event, arg0, arg1)
+
+
+namespace os {
+
+	namespace common {
+
+		//one slot in the ring, nothing is formatted until a dump
+		struct TraceEvent {
+
+			uint64_t time;
+			uint16_t event;
+			uint8_t category;
+			uint8_t phase;
+			uint32_t arg0;
+			uint32_t arg1;
+			uint32_t reserved;
+
+		} __attribute__((packed));
+
+
+		class Trace {
+
+			public:
+				static TraceEvent ring[TRACE_RING_SIZE];
+				static uint32_t head;
+				static uint32_t count;
+
+				//Now units in a millisecond, set by Init
+				static uint32_t unitsPerMs;
+
+				//false on a 486 and anything else without rdtsc,
+				//time comes from counting timer interrupts instead
+				static bool tsc;
+				static volatile uint32_t ticks;
+			public:
+				//finds the clock and calibrates it, before this
+				//Now is always 0
+				static void Init();
+				static uint64_t Now();
+
+				//from the timer interrupt, only used without a tsc
+				static inline void Tick() { ticks++; }
+
+				static void Record(uint8_t category, uint8_t phase, uint16_t event, uint32_t arg0, uint32_t arg1);
+				static void Clear();
+
+				//first 8 characters of a name as two args,
+				//events flagged as text print them back out
+				static uint32_t Pack(char* name, uint8_t offset);
+
+				//chrome trace json (chrome://tracing, perfetto),
+				//returns bytes written not counting the terminator
+				static uint32_t Dump(char* out, uint32_t size);
+		};
+	}
+}
+
+
+#endif
@@ -37,6 +37,11 @@ namespace os {
 				void Write28(common::uint32_t sector, common::uint8_t* data, int count, int offset);
 				void Flush();
 
+				//transfer several consecutive sectors with one command,
+				//a sectorCount of 256 is the most a 28 bit command can do
+				void Read28Multi(common::uint32_t sector, common::uint8_t* data, common::uint16_t sectorCount);
+				void Write28Multi(common::uint32_t sector, common::uint8_t* data, common::uint16_t sectorCount);
+
 				
 				
 				
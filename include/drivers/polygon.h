@@ -0,0 +1,77 @@
+#ifndef __OS__DRIVERS__POLYGON_H
+#define __OS__DRIVERS__POLYGON_H
+
+
+#include <common/types.h>
+#include <drivers/span.h>
+
+
+//FillPolygon takes the point count as a uint8
+#define POLYGON_MAX_POINTS 256
+
+
+namespace os {
+
+	namespace drivers {
+
+		//one side of a polygon, x is 16.16 at the scanline the
+		//fill is on and step is how far it moves each row down
+		struct PolygonEdge {
+
+			common::int32_t x;
+			common::int32_t step;
+			common::int16_t top;
+			common::int16_t bottom;
+		};
+
+
+		//scanline fill for the 13h buffer, a pixel is in when its
+		//corner is between a left and right crossing so a shape
+		//with whole number corners covers exactly what it encloses
+		class Polygon {
+
+			public:
+				//even-odd inside of the points, clipped to the screen,
+				//coordinates are read as int16 so a polygon hanging
+				//off the top or left still fills, the box that was
+				//drawn into comes back for the dirty rows
+				static bool Fill(common::uint8_t* pixels,
+						common::uint16_t x[], common::uint16_t y[],
+						common::uint8_t count, common::uint8_t color,
+						common::int32_t* left, common::int32_t* top,
+						common::int32_t* right, common::int32_t* bottom);
+
+			private:
+				//edges sorted by top, and the ones crossing the row
+				static PolygonEdge edges[POLYGON_MAX_POINTS];
+				static PolygonEdge* active[POLYGON_MAX_POINTS];
+
+				static bool MakeEdge(PolygonEdge* edge,
+						common::int32_t x0, common::int32_t y0,
+						common::int32_t x1, common::int32_t y1,
+						common::int32_t from);
+
+				static bool Monotone(common::uint16_t y[], common::uint8_t count);
+
+				static void FillMonotone(common::uint8_t* pixels,
+						common::uint16_t x[], common::uint16_t y[],
+						common::uint8_t count, common::uint8_t color);
+
+				static void FillEdgeTable(common::uint8_t* pixels,
+						common::uint16_t x[], common::uint16_t y[],
+						common::uint8_t count, common::uint8_t color);
+
+				static void FillSpan(common::uint8_t* row, common::int32_t y,
+						common::int32_t a, common::int32_t b, common::uint8_t color);
+
+				//what got filled, reset for every polygon
+				static common::int32_t minX;
+				static common::int32_t maxX;
+				static common::int32_t minY;
+				static common::int32_t maxY;
+		};
+	}
+}
+
+
+#endif
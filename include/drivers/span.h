@@ -0,0 +1,128 @@
+#ifndef __OS__DRIVERS__SPAN_H
+#define __OS__DRIVERS__SPAN_H
+
+
+#include <common/types.h>
+
+
+//below this many pixels a plain loop beats rep stos/movs
+#define SPAN_SHORT 16
+
+
+namespace os {
+
+	namespace drivers {
+
+		//row kernels for the 13h primitives, callers clip first
+		//so nothing in here checks bounds, color 0 is transparent
+		//for the masked copies same as FillBuffer always did
+		class Span {
+
+			public:
+				static inline void Fill(common::uint8_t* dst, common::uint8_t color, common::uint32_t count) {
+
+#ifdef __EMSCRIPTEN__
+					__builtin_memset(dst, color, count);
+#else
+					//short runs like the sides of a rectangle aren't
+					//worth starting a string instruction for
+					if (count < SPAN_SHORT) {
+
+						for (; count > 0; count--) { *(dst++) = color; }
+						return;
+					}
+
+					//bytes until dst is word aligned, then whole words
+					while (count > 0 && ((unsigned long)dst & 3)) { *(dst++) = color; count--; }
+
+					common::uint32_t words = count >> 2;
+					common::uint32_t value = color * 0x01010101;
+
+					asm volatile("rep stosl" : "+D"(dst), "+c"(words) : "a"(value) : "memory");
+
+					for (count &= 3; count > 0; count--) { *(dst++) = color; }
+#endif
+				}
+
+
+				static inline void Copy(common::uint8_t* dst, common::uint8_t* src, common::uint32_t count) {
+
+#ifdef __EMSCRIPTEN__
+					__builtin_memcpy(dst, src, count);
+#else
+					if (count < SPAN_SHORT) {
+
+						for (; count > 0; count--) { *(dst++) = *(src++); }
+						return;
+					}
+
+					while (count > 0 && ((unsigned long)dst & 3)) { *(dst++) = *(src++); count--; }
+
+					common::uint32_t words = count >> 2;
+
+					asm volatile("rep movsl" : "+D"(dst), "+S"(src), "+c"(words) : : "memory");
+
+					for (count &= 3; count > 0; count--) { *(dst++) = *(src++); }
+#endif
+				}
+
+
+				//skips the zero pixels, a word at a time on hardware
+				//since sprites are mostly all opaque or all clear runs
+				static inline void CopyMasked(common::uint8_t* dst, common::uint8_t* src, common::uint32_t count) {
+
+#ifndef __EMSCRIPTEN__
+					for (; count >= 4; count -= 4, dst += 4, src += 4) {
+
+						common::uint32_t four = *(common::uint32_t*)src;
+
+						if (four == 0) { continue; }
+						if (!HasZero(four)) { *(common::uint32_t*)dst = four; continue; }
+
+						if (src[0]) { dst[0] = src[0]; }
+						if (src[1]) { dst[1] = src[1]; }
+						if (src[2]) { dst[2] = src[2]; }
+						if (src[3]) { dst[3] = src[3]; }
+					}
+#endif
+					for (; count > 0; count--, dst++, src++) {
+
+						if (*src) { *dst = *src; }
+					}
+				}
+
+
+				//same but src is the rightmost pixel and is read backwards
+				static inline void CopyMaskedMirror(common::uint8_t* dst, common::uint8_t* src, common::uint32_t count) {
+
+#ifndef __EMSCRIPTEN__
+					for (; count >= 4; count -= 4, dst += 4, src -= 4) {
+
+						common::uint32_t four = __builtin_bswap32(*(common::uint32_t*)(src - 3));
+
+						if (four == 0) { continue; }
+						if (!HasZero(four)) { *(common::uint32_t*)dst = four; continue; }
+
+						if (src[0])  { dst[0] = src[0]; }
+						if (src[-1]) { dst[1] = src[-1]; }
+						if (src[-2]) { dst[2] = src[-2]; }
+						if (src[-3]) { dst[3] = src[-3]; }
+					}
+#endif
+					for (; count > 0; count--, dst++, src--) {
+
+						if (*src) { *dst = *src; }
+					}
+				}
+
+			private:
+				static inline bool HasZero(common::uint32_t four) {
+
+					return ((four - 0x01010101) & ~four & 0x80808080) != 0;
+				}
+		};
+	}
+}
+
+
+#endif
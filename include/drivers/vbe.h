@@ -0,0 +1,117 @@
+#ifndef __OS__DRIVERS__VBE_H
+#define __OS__DRIVERS__VBE_H
+
+#include <common/types.h>
+#include <hardwarecommunication/port.h>
+#include <hardwarecommunication/pci.h>
+#include <drivers/vga.h>
+
+
+//mode set up in place of 13h, 640x480 or 800x600 at 8 or 32
+//bits per pixel, build with -DVBE_WIDTH=800 -DVBE_HEIGHT=600 etc
+//
+//only used when built with -DVBE_ENABLE, the picture is still 320x200
+//just scaled up and a 32 bit present is 4x the bytes 13h moves, too
+//much for a 486, so the default is plain 13h and 8 bits when enabled
+#ifndef VBE_WIDTH
+#define VBE_WIDTH 640
+#endif
+
+#ifndef VBE_HEIGHT
+#define VBE_HEIGHT 480
+#endif
+
+#ifndef VBE_BPP
+#define VBE_BPP 8
+#endif
+
+
+//bochs dispi registers, same on qemu std-vga and virtio-vga
+#define VBE_DISPI_INDEX_ID 0x0
+#define VBE_DISPI_INDEX_XRES 0x1
+#define VBE_DISPI_INDEX_YRES 0x2
+#define VBE_DISPI_INDEX_BPP 0x3
+#define VBE_DISPI_INDEX_ENABLE 0x4
+#define VBE_DISPI_INDEX_BANK 0x5
+#define VBE_DISPI_INDEX_VIRT_WIDTH 0x6
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x7
+#define VBE_DISPI_INDEX_X_OFFSET 0x8
+#define VBE_DISPI_INDEX_Y_OFFSET 0x9
+
+#define VBE_DISPI_ID2 0xb0c2
+#define VBE_DISPI_ID5 0xb0c5
+
+#define VBE_DISPI_DISABLED 0x00
+#define VBE_DISPI_ENABLED 0x01
+#define VBE_DISPI_LFB_ENABLED 0x40
+#define VBE_DISPI_NOCLEARMEM 0x80
+
+//where bochs puts the framebuffer if pci doesn't say
+#define VBE_DISPI_LFB_PHYSICAL_ADDRESS 0xe0000000
+
+
+namespace os {
+
+	namespace drivers {
+
+		//linear framebuffer modes through the bochs vbe interface,
+		//the gui still draws into the 320x200 back buffer and it's
+		//scaled up into whichever page isn't on screen, then the
+		//y offset flips to it, without the interface it's just vga
+		class BochsVBE : public VideoGraphicsArray {
+
+			public:
+			hardwarecommunication::Port16Bit indexPort;
+			hardwarecommunication::Port16Bit dataPort;
+
+			bool present;
+			bool active;
+
+			common::uint8_t* linearFrameBuffer;
+			common::uint16_t screenWidth;
+			common::uint16_t screenHeight;
+			common::uint8_t bytesPerPixel;
+			common::uint32_t pitch;
+
+			//integer scale and where the 320x200 picture sits
+			common::uint8_t scale;
+			common::uint16_t originX;
+			common::uint16_t originY;
+
+			//page on screen, single page when vram is too small
+			common::uint8_t page;
+			bool flipping;
+
+			//32 bit colors for the 8 bit back buffer
+			common::uint32_t palette[256];
+
+			//one scaled row is built here and then copied out
+			//scale times, so video memory is only ever written
+			common::uint32_t line[VBE_WIDTH];
+
+			//what changed in the last frame, the hidden page
+			//is two frames old so it needs both
+			common::int16_t lastLeft[HEIGHT_13H];
+			common::int16_t lastRight[HEIGHT_13H];
+
+			public:
+				BochsVBE(hardwarecommunication::PeripheralComponentInterconnectController* pci);
+				~BochsVBE();
+
+				void WriteRegister(common::uint16_t index, common::uint16_t value);
+				common::uint16_t ReadRegister(common::uint16_t index);
+
+				virtual bool SetMode(common::uint32_t width, common::uint32_t height, common::uint32_t colordepth);
+				virtual void WriteColor(common::uint8_t index, common::uint8_t r, common::uint8_t g, common::uint8_t b);
+
+				virtual void DrawToScreen();
+			private:
+				common::uint8_t* FindFrameBuffer(hardwarecommunication::PeripheralComponentInterconnectController* pci);
+				void InvalidatePages();
+				void PresentRow(common::uint8_t* dst, common::uint16_t y, common::uint16_t left, common::uint16_t right);
+		};
+	}
+}
+
+
+#endif
@@ -5,7 +5,12 @@
 #include <hardwarecommunication/port.h>
 #include <hardwarecommunication/interrupts.h>
 #include <drivers/driver.h>
+#include <drivers/span.h>
+#include <drivers/polygon.h>
 #include <gui/font.h>
+#include <gui/glyphs.h>
+#include <gui/sprite.h>
+#include <gui/colortable.h>
 #include <gui/pixelart.h>
 #include <math.h>
 
@@ -14,12 +19,33 @@
 #define WIDTH_13H 320
 #define HEIGHT_13H 200
 
+//most rectangles handed to the canvas per frame,
+//past this the rest get folded into the last one
+#define VGA_DIRTY_RECTS 16
+
+//bits per channel in colors, what the dac takes on hardware
+#ifdef __EMSCRIPTEN__
+#define VGA_COLOR_BITS 8
+#else
+#define VGA_COLOR_BITS 6
+#endif
+
 
 
 namespace os {
 
 	namespace drivers {
 
+		struct VGARect {
+
+			common::uint16_t x;
+			common::uint16_t y;
+			common::uint16_t w;
+			common::uint16_t h;
+
+		} __attribute__((packed));
+
+
 		class VideoGraphicsArray {
 
 			public:		
@@ -51,7 +77,29 @@ namespace os {
 			common::uint8_t* FrameBufferSegment;
 
 			//back buffer
-			common::uint8_t pixels[64000];
+			common::uint8_t pixels[64000] __attribute__((aligned(4)));
+
+			//what the screen shows right now, DrawToScreen
+			//only sends what differs from it
+			common::uint8_t front[64000] __attribute__((aligned(4)));
+			bool frontValid;
+
+			//dirty region as the leftmost and rightmost
+			//pixel drawn on each row since the last frame
+			common::int16_t dirtyLeft[HEIGHT_13H];
+			common::int16_t dirtyRight[HEIGHT_13H];
+
+			VGARect dirtyRects[VGA_DIRTY_RECTS];
+			common::uint8_t dirtyRectCount;
+
+			//palette before any darkening, 6 bits per channel
+			//on hardware and 8 bits on the web
+			common::uint8_t colors[256][3];
+
+			//light2dark applied darkness times, composed once per
+			//level so MakeDark only rewrites the palette through it
+			common::uint8_t darkness;
+			common::uint8_t shade[256];
 
 			public:
 				VideoGraphicsArray();
@@ -60,6 +108,20 @@ namespace os {
 				virtual bool SupportsMode(common::uint32_t width, common::uint32_t height, common::uint32_t colordepth);
 				virtual bool SetMode(common::uint32_t width, common::uint32_t height, common::uint32_t colordepth);
 				virtual void PaletteUpdate(common::uint8_t index, common::uint8_t r, common::uint8_t g, common::uint8_t b);	
+				
+				//what an index really shows, after darkening
+				virtual void WriteColor(common::uint8_t index, common::uint8_t r, common::uint8_t g, common::uint8_t b);
+
+				//default 256 colors, then every index written through shade
+				void LoadPalette();
+				void WritePalette();
+
+				//intersect with the screen, false when nothing is left
+				bool ClipRect(common::int32_t* x, common::int32_t* y, common::int32_t* w, common::int32_t* h);
+
+				void MarkDirty(common::int32_t x, common::int32_t y, common::int32_t w, common::int32_t h);
+				void MarkAllDirty();
+				void ClearDirty();
 
 				void PutPixel(common::int32_t x, common::int32_t y, common::uint8_t colorIndex);
 				void PutPixelRaw(common::int32_t x, common::int32_t y, common::uint8_t colorIndex);
@@ -75,6 +137,9 @@ namespace os {
 				virtual void FillBuffer(common::int16_t x, common::int16_t y,
 							common::int16_t w, common::int16_t h,
 							common::uint8_t* buf, bool mirror);
+
+				virtual void DrawSprite(common::int32_t x, common::int32_t y,
+							gui::Sprite* sprite, bool mirror);
 				
 				virtual void FillRectangle(common::int32_t x, common::int32_t y, 
 							   common::int32_t w, common::int32_t h, 
@@ -103,6 +168,7 @@ namespace os {
 				virtual void FillPolygon(common::uint16_t x[], common::uint16_t y[], 
 							 common::uint8_t edgeNum, common::uint8_t color);
 				
+				//0xrrggbb pixels in, palette indices out in the same buffer
 				void FSdither(common::uint32_t* buf, common::uint16_t w, common::uint16_t h);
 				
 				void ErrorScreen();
@@ -110,7 +176,9 @@ namespace os {
 				virtual void MakeDark(common::uint8_t darkness);
 				virtual void MakeWave(common::uint8_t waveLength);
 				
-				void DrawToScreen();
+				//changed spans of the dirty rows, front gets updated
+				bool ChangedSpan(common::uint16_t y, common::uint16_t* left, common::uint16_t* right);
+				virtual void DrawToScreen();
 		};	
 		
 		
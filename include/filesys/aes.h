@@ -0,0 +1,41 @@
+#ifndef __OS__FILESYS__AES_H
+#define __OS__FILESYS__AES_H
+
+
+#include <common/types.h>
+
+
+#define AES_BLOCK_SIZE 16
+#define AES_ROUNDS 10
+
+
+namespace os {
+
+	namespace filesystem {
+
+		//aes-128, t-table in software or aes-ni when cpuid has it
+		class AES128 {
+
+			public:
+				//fips-197 byte order, same layout aes-ni loads
+				common::uint8_t roundKeys[(AES_ROUNDS + 1) * AES_BLOCK_SIZE];
+				bool hardware;
+			public:
+				AES128();
+				~AES128();
+
+				static bool HardwareSupport();
+
+				void SetKey(common::uint8_t key[16]);
+				void EncryptBlock(common::uint8_t in[16], common::uint8_t out[16]);
+
+				//ctr mode, counter block is nonce then big endian counter,
+				//counter is the index of the first 16 byte block in data
+				void CTR(common::uint8_t nonce[8], common::uint64_t counter,
+						common::uint8_t* data, common::uint32_t size);
+		};
+	}
+}
+
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __OS__FILESYS__LZ_H
+#define __OS__FILESYS__LZ_H
+
+
+#include <common/types.h>
+
+
+//lz4 style block format, blocks don't reference each other
+//so any block can be decoded on its own
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_LOG 10
+#define LZ_HASH_SIZE (1 << LZ_HASH_LOG)
+
+//last match has to start this far from the end,
+//and the last few bytes are always literals
+#define LZ_MATCH_LIMIT 12
+#define LZ_LAST_LITERALS 5
+
+
+namespace os {
+
+	namespace filesystem {
+
+		//returns compressed size, 0 if it doesn't fit in capacity,
+		//hashTable needs LZ_HASH_SIZE entries and blocks up to 64KB
+		common::uint32_t LZCompressBlock(common::uint8_t* src, common::uint32_t size,
+						common::uint8_t* dst, common::uint32_t capacity,
+						common::uint16_t* hashTable);
+
+		//returns decompressed size, 0 if the block is corrupt
+		common::uint32_t LZDecompressBlock(common::uint8_t* src, common::uint32_t size,
+						common::uint8_t* dst, common::uint32_t capacity);
+	}
+}
+
+
+#endif
@@ -6,6 +6,8 @@
 #include <memorymanagement.h>
 #include <list.h>
 #include <math.h>
+#include <filesys/lz.h>
+#include <filesys/aes.h>
 
 
 /*
@@ -22,6 +24,79 @@
 #define OFS_BLOCK_SIZE 2048
 
 
+//superblock lives where the old count sector was,
+//packed directory starts where the old location table was
+#define superblockSector tableStartSector
+#define dirStartSector fileStartSector
+#define dirSectorCount 384
+
+//metadata journal, header sector followed by the log
+#define journalStartSector (dirStartSector + dirSectorCount)
+#define journalSectorCount 64
+
+#define OFS_VERSION 1
+#define OFS_DIR_ENTRY_SIZE 64
+#define OFS_DIR_ENTRIES_PER_SECTOR (512 / OFS_DIR_ENTRY_SIZE)
+
+//a whole transaction has to fit in the log behind its descriptor,
+//only the directory and tag index rebuilds ever get bigger
+#define OFS_JOURNAL_MAX_TX (journalSectorCount - 2)
+#define OFS_JOURNAL_MAX_PENDING 64
+
+//tag -> location index fills the rest of the metadata area
+#define tagIndexStartSector (journalStartSector + journalSectorCount)
+#define tagIndexSectorCount ((tableStartSector + 512) - tagIndexStartSector)
+
+#define OFS_TAG_ENTRY_SIZE 40
+#define OFS_TAG_ENTRIES_PER_SECTOR (512 / OFS_TAG_ENTRY_SIZE)
+#define OFS_TAG_INDEX_MAX (tagIndexSectorCount * OFS_TAG_ENTRIES_PER_SECTOR)
+
+//file flags, header bytes 2 to 4 and directory entry
+#define OFS_FLAG_COMPRESSED 0x0001
+#define OFS_FLAG_ENCRYPTED 0x0002
+#define OFS_FLAG_DIRECTORY 0x0004
+
+//location of the parent directory, header bytes 44 to 48,
+//entries in the root have no parent
+#define OFS_PARENT_OFFSET 44
+#define OFS_ROOT 0
+
+//name -> file and location -> file hashes, memory only
+#define OFS_DIR_HASH_SIZE 1024
+#define OFS_MAX_DEPTH 32
+
+//ctr nonce and key check value for encrypted files,
+//the nonce is the location then a generation that
+//goes up every time the file is encrypted
+#define OFS_NONCE_OFFSET 100
+#define OFS_KEYCHECK_OFFSET 108
+
+//blocks written under the current nonce, header bytes 48 to 52,
+//only blocks past the block table go by this
+#define OFS_NONCE_BLOCKS_OFFSET 48
+
+//image header, header bytes 116 to 124
+#define OFS_IMAGE_OFFSET 116
+#define OFS_IMAGE_MAGIC 0x13
+
+//files that can be unlocked at the same time
+#define OFS_MAX_KEYS 8
+
+//compressed size of each block, header bytes 128 to 256,
+//0 means the block is stored raw
+#define OFS_BLOCK_TABLE_OFFSET 128
+#define OFS_COMPRESSED_BLOCKS 64
+
+//encrypted files keep how many times each block was written there
+//instead, so a rewrite gets counters of its own, and the compressed
+//size goes in front of the block's data
+#define OFS_BLOCK_COMPRESSED 0x8000
+#define OFS_BLOCK_GENERATION_MAX 0x7fff
+
+#define OFS_MAX_OPEN_FILES 16
+#define OFS_READAHEAD_BLOCKS 4
+
+
 namespace os {
 
 	namespace filesystem {
@@ -35,12 +110,153 @@ namespace os {
 		} __attribute__((packed));
 
 
+		//on disk at superblockSector
+		struct OFS_Superblock {
+
+			common::uint8_t magic[8];
+			common::uint16_t version;
+			common::uint16_t entrySize;
+			common::uint32_t fileCount;
+			common::uint32_t dirStart;
+			common::uint32_t dirSectors;
+			common::uint32_t currentOpenSector;
+			common::uint32_t journalStart;
+			common::uint32_t journalSectors;
+			common::uint32_t tagStart;
+			common::uint32_t tagSectors;
+			common::uint32_t tagCount;
+			common::uint8_t reserved[464];
+
+		} __attribute__((packed));
+
+
+		//one file in the packed directory, 8 per sector
+		struct OFS_DirEntry {
+
+			char name[40];
+			common::uint32_t location;
+			common::uint32_t size;
+			common::uint32_t flags;
+			common::uint32_t parent;
+			common::uint8_t reserved[8];
+
+		} __attribute__((packed));
+
+
+		//one (tag, file) pair, 12 per sector,
+		//slot is which of the 8 header tags it came from
+		struct OFS_TagEntry {
+
+			char tag[32];
+			common::uint32_t location;
+			common::uint8_t slot;
+			common::uint8_t reserved[3];
+
+		} __attribute__((packed));
+
+
+		//first sector of the journal,
+		//log entries before sequence are already checkpointed
+		struct OFS_JournalHeader {
+
+			common::uint8_t magic[8];
+			common::uint32_t sequence;
+			common::uint8_t reserved[500];
+
+		} __attribute__((packed));
+
+
+		//starts every transaction in the log, followed by
+		//count sectors of metadata that belong at sectors[]
+		struct OFS_JournalDescriptor {
+
+			common::uint8_t magic[8];
+			common::uint32_t sequence;
+			common::uint32_t count;
+			common::uint32_t checksum;
+			common::uint32_t sectors[OFS_JOURNAL_MAX_TX];
+			common::uint8_t reserved[492 - (OFS_JOURNAL_MAX_TX * 4)];
+
+		} __attribute__((packed));
+
+
+		//metadata sector held in memory until checkpoint
+		struct OFS_JournalBlock {
+
+			common::uint32_t sector;
+			common::uint8_t data[512];
+
+		} __attribute__((packed));
+
+
+		//open file, location and fragment map are
+		//resolved once so reads skip the name lookup
+		struct OFS_FileHandle {
+
+			bool open;
+			common::uint32_t location;
+			common::uint32_t size;
+			common::uint32_t position;
+
+			//header bytes 64 to 98
+			common::uint8_t fragments[34];
+
+			bool compressed;
+			common::uint16_t blockSizes[OFS_COMPRESSED_BLOCKS];
+
+			//sequential access gets read ahead
+			common::uint32_t lastBlock;
+			common::uint8_t* cache;
+			common::uint32_t cacheFirstBlock;
+			common::uint32_t cacheBlocks;
+		};
+
+
+		//images are stored as tiles of whole rows, one
+		//tile per block so each one is a single transfer
+		struct OFS_ImageHeader {
+
+			common::uint8_t magic;
+			common::uint8_t rowsPerTile;
+			common::uint16_t width;
+			common::uint16_t height;
+			common::uint16_t reserved;
+
+		} __attribute__((packed));
+
+
+		//key for an unlocked encrypted file
+		struct OFS_FileKey {
+
+			bool used;
+			common::uint32_t location;
+			common::uint8_t nonce[8];
+			AES128 aes;
+
+			//copy of the header's block table generations,
+			//past the table a block below this can't be rewritten
+			common::uint16_t generations[OFS_COMPRESSED_BLOCKS];
+			common::uint32_t blocks;
+		};
+
+
 		class File {
 
 			public:
 				common::uint32_t Location;
 				common::uint32_t Size;
+				common::uint32_t Flags;
+				common::uint32_t Parent;
 				char Name[33];
+
+				//index in table->files, which directory sector it's in
+				common::uint32_t Slot;
+
+				//hash chains and directory children
+				File* NextName;
+				File* NextLocation;
+				File* FirstChild;
+				File* NextSibling;
 			public:
 				File(common::uint32_t location, common::uint32_t size, char name[33]);
 				~File();
@@ -53,12 +269,85 @@ namespace os {
 				drivers::AdvancedTechnologyAttachment* ata0m;
 				OFS_Table* table;
 				MemoryManager* memoryManager;
+				OFS_Superblock superblock;
+
+				//journal state
+				OFS_JournalBlock* txBlocks;
+				common::uint32_t txCount;
+				common::uint32_t txDepth;
+				OFS_JournalBlock* pendingBlocks;
+				common::uint32_t pendingCount;
+				common::uint8_t* journalBuffer;
+				common::uint32_t journalHead;
+				common::uint32_t journalSequence;
+
+				OFS_FileHandle handles[OFS_MAX_OPEN_FILES];
+
+				//tag index, same sector layout as on disk
+				common::uint8_t* tagIndex;
+				common::uint32_t tagCount;
+
+				//block codec scratch space
+				common::uint16_t* lzTable;
+				common::uint8_t* lzBuffer;
+
+				OFS_FileKey keys[OFS_MAX_KEYS];
+
+				//directory tree
+				File** nameHash;
+				File** locationHash;
+				File* rootFirstChild;
+				common::uint32_t workingDirectory;
 			public:
 				FileSystem(drivers::AdvancedTechnologyAttachment* ata0m, 
 						MemoryManager* memoryManager, OFS_Table* table);
 				~FileSystem();
 
 
+				//mount
+				void LoadFileTable();
+				bool ReadSuperblock();
+				void WriteSuperblock(bool indexed = true);
+				common::uint32_t LoadDirectory();
+				void WriteDirectorySector(common::uint32_t sectorNum);
+				void LoadTagIndex();
+				void BuildTagIndex();
+				void WriteTagSector(common::uint32_t sectorNum);
+				OFS_TagEntry* GetTagEntry(common::uint32_t index);
+
+				//metadata journal
+				void BeginTransaction();
+				void CommitTransaction();
+				void WriteTransaction();
+				void Checkpoint();
+				void ReplayJournal();
+				void WriteMetadata(common::uint32_t sector, common::uint8_t* data);
+				void ReadMetadata(common::uint32_t sector, common::uint8_t* data, int count);
+				void RevokeMetadata(common::uint32_t sector, common::uint32_t count);
+
+				//old location table layout, only used to migrate
+				common::uint32_t LoadLegacyTable();
+				common::uint32_t GetLegacyFileCount();
+				common::uint32_t GetLegacyFileName(common::uint16_t fileNum, char fileName[33]);
+
+				File* GetFile(char* name);
+				File* GetFileFromLocation(common::uint32_t location);
+				common::int32_t GetFileIndex(common::uint32_t location);
+
+				//paths are names split by '/', relative ones start
+				//at the working directory
+				void IndexDirectory();
+				void LinkFile(File* file);
+				void UnlinkFile(File* file);
+				File* LookupFile(common::uint32_t parent, char* name);
+				bool ResolvePath(char* path, common::uint32_t* parent, char leaf[33]);
+				common::uint32_t GetParent(common::uint32_t directory);
+				bool NewDirectory(char* path);
+				bool ChangeDirectory(char* path);
+				common::uint32_t GetDirectoryFiles(common::uint32_t directory, File** files, common::uint32_t maxFiles);
+				void GetPath(common::uint32_t directory, char* path, common::uint32_t size);
+
+
 				common::uint32_t GetFileSector(char* name);
 				common::uint32_t GetFileSectorTable(char* name);
 				common::uint32_t GetFragmentFromLBA(common::uint32_t location, common::uint8_t lba);
@@ -80,10 +369,30 @@ namespace os {
 		
 				common::uint32_t GetFileTag(char* file, common::uint8_t tagNum, char tag[33]);
 				common::uint32_t GetTagFile(char* tagName, common::uint32_t location, common::uint8_t* tagNum);
+				common::uint32_t GetTagFiles(char* tagName, common::uint32_t* locations, common::uint32_t maxLocations);
 
+				common::uint32_t NewEntry(common::uint32_t parent, char* name,
+							common::uint32_t size, common::uint32_t flags);
 				bool NewFile(char* name, common::uint8_t* file, common::uint32_t size);
 				bool DeleteFile(char* name);
 
+				//stream api, returns handle or -1
+				common::int32_t Open(char* name);
+				common::uint32_t Read(common::int32_t handle, common::uint8_t* buffer, common::uint32_t count);
+				bool Seek(common::int32_t handle, common::uint32_t position);
+				void Close(common::int32_t handle);
+
+				common::uint32_t GetBlockSector(OFS_FileHandle* handle, common::uint32_t lba);
+				common::uint32_t ReadBlocks(OFS_FileHandle* handle, common::uint32_t lba, 
+							common::uint8_t* buffer, common::uint32_t maxBlocks);
+				void InvalidateHandles(common::uint32_t location);
+				void LoadHandleExtents(OFS_FileHandle* handle);
+
+				bool SetCompression(char* name, bool compress);
+				void SetFileFlags(common::uint32_t location, common::uint32_t flags);
+				bool ReadCompressedBlock(common::uint32_t location, common::uint32_t lba, common::uint32_t sector, 
+							common::uint16_t compressedSize, common::uint8_t* buffer);
+
 				bool WriteLBA(char* name, common::uint8_t* file, 
 						  	common::uint32_t lba);
 				bool ReadLBA(char* name, common::uint8_t* file,	
@@ -91,23 +400,39 @@ namespace os {
 		
 				bool NewTag(char* tagName, common::uint32_t location);
 				bool DeleteTag(common::uint32_t location, common::uint8_t tagNum);
+				bool AddTagEntry(char* tagName, common::uint32_t location, common::uint8_t slot);
+				void RemoveTagEntry(common::uint32_t index);
+				void RemoveFileTags(common::uint32_t location);
 		
 				void Compress(char* name, common::uint8_t* buffer, common::uint32_t bufsize);
 				void Decompress(char* name, common::uint8_t* buffer, common::uint32_t bufsize);
 
 				
 				
-				void EncryptBlock(common::uint8_t data[16], common::uint8_t key[16]);
-				void DecryptBlock(common::uint8_t data[16], common::uint8_t key[16]);
-				
 				void CryptFile(char* name, common::uint8_t key[16], bool encrypt);
 
+				//encrypted files decrypt block by block while unlocked
+				bool UnlockFile(char* name, common::uint8_t key[16]);
+				void LockFile(common::uint32_t location);
+				OFS_FileKey* GetFileKey(common::uint32_t location);
+				bool FileLocked(File* file);
+				void CryptBlock(common::uint32_t location, common::uint32_t lba, 
+						common::uint8_t* data, common::uint32_t size);
+
 				
 				
 				common::uint32_t GetImageResolution(char* name);
 
+				//tiles land straight in dest, rows are destWidth apart
+				bool ReadImage(char* name, common::uint8_t* dest, 
+						common::uint16_t destWidth, common::uint16_t destHeight, 
+						common::uint16_t* retWidth, common::uint16_t* retHeight);
+
+				//rows packed at the returned width, cut down to
+				//fit a destWidth by destHeight buffer
 				bool Read13H(char* name, common::uint8_t* buffer, 
-						common::uint16_t* retWidth, common::uint8_t* retHeight, 
+						common::uint16_t destWidth, common::uint16_t destHeight,
+						common::uint16_t* retWidth, common::uint16_t* retHeight, 
 						bool compress);
 				bool Write13H(char* name, common::uint8_t* buffer, 
 						common::uint16_t width, common::uint16_t height, 
@@ -0,0 +1,65 @@
+#ifndef __OS__GUI__COLORTABLE_H
+#define __OS__GUI__COLORTABLE_H
+
+#include <common/types.h>
+
+
+//5 bits a channel, 32x32x32 cells of one palette index each
+#define QUANT_BITS 5
+#define QUANT_SIZE (1 << (QUANT_BITS * 3))
+
+//the ega part of the palette, same colors Web2EGA picks from
+#define QUANT_COLORS 64
+
+//widest row the dither keeps error for, covers every vbe mode
+#define IMAGE_MAX_WIDTH 1024
+
+
+namespace os {
+
+	namespace gui {
+
+		//rgb to palette lookup, built from the palette the vga
+		//driver has loaded so quantizing is one table read
+		//instead of comparing channels against thresholds
+		class ColorTable {
+
+			public:
+				static common::uint8_t table[QUANT_SIZE];
+
+				//the palette entries as 8 bit rgb, the dither
+				//measures its error against these not the cells
+				static common::uint8_t rgb[QUANT_COLORS][3];
+
+				//set when the palette changes under the table
+				static bool stale;
+
+				//colors is the vga palette at colorBits per channel
+				static void Build(common::uint8_t colors[][3], common::uint8_t colorBits);
+
+				static inline common::uint8_t Map(common::uint8_t r, common::uint8_t g, common::uint8_t b) {
+
+					return table[((r >> (8 - QUANT_BITS)) << (QUANT_BITS * 2))
+						   | ((g >> (8 - QUANT_BITS)) << QUANT_BITS)
+						   | (b >> (8 - QUANT_BITS))];
+				}
+
+
+				//floyd steinberg a row at a time, pixels are 0xrrggbb
+				//and out gets palette indices, rows go in the order
+				//the error should travel down in
+				static void DitherBegin(common::uint16_t width);
+				static void DitherRow(common::uint32_t* pixels, common::uint8_t* out);
+
+			private:
+				//error for this row and the next in 16ths, with a
+				//spare pixel each side so the edges need no checks
+				static common::int16_t error[2][(IMAGE_MAX_WIDTH + 2) * 3];
+				static common::uint8_t current;
+				static common::uint16_t width;
+		};
+	}
+}
+
+
+#endif
@@ -4,6 +4,7 @@
 #include <gui/widget.h>
 #include <gui/window.h>
 #include <gui/sim.h>
+#include <gui/frame.h>
 #include <drivers/driver.h>
 #include <drivers/mouse.h>
 #include <drivers/cmos.h>
@@ -73,6 +74,11 @@ namespace os {
 				CompositeWidget* CreateChild(common::uint8_t appType, char* name, App* app);
 				void FreeChild(Window* window);
 
+				//paced by FrameScheduler, steps the game and
+				//draws and presents when there's something new
+				void Frame();
+				void Update();
+
 				void Draw(common::GraphicsContext* gc);
 				void DrawTaskBar(common::GraphicsContext* gc);
 				void DrawNoMouse(common::GraphicsContext* gc);
@@ -0,0 +1,89 @@
+#ifndef __OS__GUI__FRAME_H
+#define __OS__GUI__FRAME_H
+
+#include <common/types.h>
+#include <common/graphicscontext.h>
+
+
+//frames a second shown at most, changed with 'fps (int)'
+#define FRAME_RATE 60
+#define FRAME_RATE_MAX 240
+
+//game steps a second, what the simulator was tuned at
+//back when it slept 15ms between frames
+#define FRAME_UPDATE_RATE 60
+
+//most steps caught up before a frame, past this the game
+//slows down instead of never getting to draw
+#define FRAME_MAX_UPDATES 4
+
+//frames a second with nothing known to have changed, picks
+//up whatever got drawn into a window from somewhere else
+#define FRAME_IDLE_RATE 10
+
+//per stage timing, in the order a frame runs them
+#define FRAME_UPDATE 0
+#define FRAME_COMPOSE 1
+#define FRAME_PRESENT 2
+#define FRAME_STAGES 3
+
+
+namespace os {
+
+	namespace gui {
+
+		//paces the gui to a fixed rate off the Trace clock,
+		//the game runs in fixed steps on its own clock so load only
+		//costs frames and not speed, and a frame where nothing moved
+		//is never composed at all
+		class FrameScheduler {
+
+			public:
+				static common::uint32_t rate;
+				static common::uint32_t updateRate;
+				static bool overlay;
+
+				//set by input and anything else that changes
+				//what's on screen, cleared when a frame is drawn
+				static volatile bool stale;
+
+				//over the last second, times in microseconds
+				static common::uint32_t fps;
+				static common::uint32_t skipped;
+				static common::uint32_t stageTime[FRAME_STAGES];
+
+			private:
+				static common::uint64_t nextFrame;
+				static common::uint64_t updateTime;
+				static common::uint64_t lastShown;
+				static common::uint64_t lap;
+
+				static common::uint64_t windowStart;
+				static common::uint32_t frames;
+				static common::uint32_t skips;
+				static common::uint32_t stageSum[FRAME_STAGES];
+				static common::uint32_t stageCount[FRAME_STAGES];
+
+				//units in 1/count of a second
+				static common::uint32_t Period(common::uint32_t count);
+
+			public:
+				//waits for the frame's slot, returns how many
+				//game steps are due before it's drawn
+				static common::uint8_t Begin();
+
+				//whether this frame gets drawn, changed is for
+				//whatever the caller knows moved on its own
+				static bool Ready(bool changed);
+
+				//time since the last lap goes to stage
+				static void Lap(common::uint8_t stage);
+				static void End();
+
+				static void DrawOverlay(common::GraphicsContext* gc);
+		};
+	}
+}
+
+
+#endif
@@ -5,6 +5,7 @@
 #include <common/graphicscontext.h>
 #include <drivers/vga.h>
 #include <gui/pixelart.h>
+#include <gui/layer.h>
 
 
 namespace os {
@@ -34,6 +35,9 @@ namespace os {
 				PlatformerData data;
 				common::uint16_t playerX = 0;
 				common::uint16_t playerY = 0;
+
+				//sky and ground, 0 draws them every frame
+				Layer* background = 0;
 			public:
 				Platformer();
 				~Platformer();
@@ -0,0 +1,69 @@
+#ifndef __OS__GUI__GLYPHS_H
+#define __OS__GUI__GLYPHS_H
+
+#include <common/types.h>
+#include <gui/font.h>
+
+
+//every charset entry plus font_full at the end
+#define GLYPH_COUNT ((sizeof(os::gui::charset) / sizeof(os::gui::charset[0])) + 1)
+#define GLYPH_FULL (GLYPH_COUNT - 1)
+
+//the font only ever sets the low 8 bits of a column
+#define GLYPH_ROWS 8
+
+
+namespace os {
+
+	namespace gui {
+
+		//one font glyph turned sideways into rows, left has 0xff
+		//in each byte for columns 0-3 and right is column 4, so
+		//a row is drawn with one masked word and one byte store
+		struct GlyphRows {
+
+			common::uint32_t left[GLYPH_ROWS];
+			common::uint8_t right[GLYPH_ROWS];
+
+			//first and last row with anything in it
+			common::uint8_t top;
+			common::uint8_t bottom;
+		} __attribute__((packed));
+
+
+		//font glyphs expanded once at boot instead of
+		//unpacking the column bits for every pixel drawn
+		class Glyphs {
+
+			public:
+				static GlyphRows rows[GLYPH_COUNT];
+
+				static void Build();
+
+				//chars outside the charset get font_full, same as PutChar
+				static inline common::uint16_t Index(char ch) {
+
+					common::uint16_t index = (common::uint8_t)ch - 32;
+					return index < GLYPH_COUNT - 1 ? index : GLYPH_FULL;
+				}
+
+				//rows of buf are stride apart, nothing outside the
+				//clip rectangle is touched, all in buf coordinates
+				static void Draw(common::uint8_t* buf, common::int32_t stride,
+						common::int32_t x, common::int32_t y,
+						common::uint16_t glyph, common::uint8_t color,
+						common::int32_t clipX, common::int32_t clipY,
+						common::int32_t clipW, common::int32_t clipH);
+
+				//a whole string on one line, font_width apart
+				static void DrawString(common::uint8_t* buf, common::int32_t stride,
+						common::int32_t x, common::int32_t y,
+						char* str, common::uint8_t color,
+						common::int32_t clipX, common::int32_t clipY,
+						common::int32_t clipW, common::int32_t clipH);
+		};
+	}
+}
+
+
+#endif
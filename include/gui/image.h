@@ -0,0 +1,35 @@
+#ifndef __OS__GUI__IMAGE_H
+#define __OS__GUI__IMAGE_H
+
+#include <common/types.h>
+#include <drivers/vga.h>
+#include <filesys/ofs.h>
+
+
+//the header is read in one go, ppm comments past this aren't
+#define IMAGE_HEADER_SIZE 512
+
+
+namespace os {
+
+	namespace gui {
+
+		//uncompressed 24/32 bit bmp or binary ppm stored in ofs,
+		//read a row at a time so the photo never has to fit in
+		//memory, boxed down to fit and dithered to the palette
+		class ImageImport {
+
+			public:
+				//dest rows are destWidth apart, the image keeps its
+				//aspect and is only ever made smaller, the size it
+				//came out at is returned
+				static bool Decode(filesystem::FileSystem* filesystem, drivers::VideoGraphicsArray* vga,
+						char* name, common::uint8_t* dest,
+						common::uint16_t destWidth, common::uint16_t destHeight,
+						common::uint16_t* retWidth, common::uint16_t* retHeight);
+		};
+	}
+}
+
+
+#endif
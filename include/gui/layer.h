@@ -0,0 +1,47 @@
+#ifndef __OS__GUI__LAYER_H
+#define __OS__GUI__LAYER_H
+
+#include <common/types.h>
+#include <common/graphicscontext.h>
+
+
+//who drew what's in a layer, the low bits are left
+//for whatever state the drawing depended on
+#define LAYER_ROOM       0x01000000
+#define LAYER_PLATFORMER 0x02000000
+#define LAYER_SHOOTER    0x03000000
+
+
+namespace os {
+
+	namespace gui {
+
+		//the static part of a scene drawn once and kept, every
+		//frame after starts from one copy of it and only draws
+		//what moves, the key says what it was drawn for and any
+		//other key finds it stale
+		class Layer {
+
+			public:
+				common::uint8_t pixels[64000] __attribute__((aligned(4)));
+				common::uint32_t key;
+				bool valid;
+
+			public:
+				Layer();
+				~Layer();
+
+				//puts the layer in the back buffer, false when it
+				//was drawn for something else and has to be redone
+				bool Restore(common::GraphicsContext* gc, common::uint32_t key);
+
+				//keeps what's in the back buffer as the layer for key
+				void Capture(common::GraphicsContext* gc, common::uint32_t key);
+
+				void Invalidate();
+		};
+	}
+}
+
+
+#endif
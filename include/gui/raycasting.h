@@ -5,9 +5,28 @@
 #include <common/types.h>
 #include <drivers/vga.h>
 #include <gui/widget.h>
+#include <gui/layer.h>
 #include <math.h>
 
 
+//everything is 16.16 fixed point so a frame never touches the fpu
+#define RAY_SHIFT 16
+#define RAY_ONE (1 << RAY_SHIFT)
+#define RAY_FIX(v) ((common::int32_t)((v) * RAY_ONE))
+
+//steps in a full turn of the camera
+#define RAY_ANGLES 1024
+
+#define RAY_TEX_SHIFT 6
+#define RAY_TEX_SIZE (1 << RAY_TEX_SHIFT)
+
+//closest a wall is drawn from, keeps its height sane
+#define RAY_NEAR (RAY_ONE / 64)
+
+//past the far side of the map, long sides stop here
+#define RAY_FAR (RAY_ONE * 256)
+
+
 namespace os {
 
 	namespace gui {
@@ -15,13 +34,9 @@ namespace os {
 		class RaycastSpace {
 	
 			public:
-				const double w = 320.0;
-				const double h = 200.0;
-				int texW = 64.0;
-				int texH = 64.0;
-			
-				//common::uint8_t textures[8][texW*texH];
-				common::uint8_t textures[8][64*64];
+				//column major, a wall stripe is one run of texels
+				//textures[i][RAY_TEX_SIZE*x+y]
+				common::uint8_t textures[8][RAY_TEX_SIZE*RAY_TEX_SIZE];
 
 
 
@@ -29,22 +44,64 @@ namespace os {
 				common::uint16_t spaceW = 24;
 				common::uint16_t spaceH = 24;
 		
-				double posX = 22.0;
-				double posY = 11.5;
-				double dirX = -1.0;
-				double dirY = 0.0;
-				double planeX = 0.0;
-				double planeY = 0.66;
+				common::int32_t posX = RAY_FIX(22.0);
+				common::int32_t posY = RAY_FIX(11.5);
+				common::int32_t dirX = -RAY_ONE;
+				common::int32_t dirY = 0;
+				common::int32_t planeX = 0;
+				common::int32_t planeY = RAY_FIX(0.66);
+
+				//dir and plane come from this, facing -x to start
+				common::uint16_t angle = RAY_ANGLES / 2;
 
 
 				bool keyDown = false;
 				bool mouseDown = false;
+
+				//floor and ceiling kept while the camera holds
+				//still, 0 draws them every frame
+				Layer* background = 0;
+
+			private:
+				//per column ray and how far it goes between grid
+				//lines, only redone when the camera turns
+				common::int32_t rayDirX[WIDTH_13H];
+				common::int32_t rayDirY[WIDTH_13H];
+				common::int32_t deltaDistX[WIDTH_13H];
+				common::int32_t deltaDistY[WIDTH_13H];
+				common::int32_t tableAngle;
+
+				//floor distance for each row below the horizon
+				common::int32_t rowDistance[HEIGHT_13H / 2];
+
+				//camera the floor in the layer was drawn from
+				common::int32_t layerX;
+				common::int32_t layerY;
+				common::uint16_t layerAngle;
+
 			public:
 				RaycastSpace();
 				~RaycastSpace();
 
-				void ComputeSpace(common::GraphicsContext* gc, char keylog[16], common::uint8_t logIndex, 
-						common::int32_t mouseX);
+				void SetCamera(common::int32_t x, common::int32_t y, common::uint16_t angle);
+
+				void DrawSpace(common::GraphicsContext* gc);
+
+				//one game step of walking and turning
+				void MoveCamera(char keylog[16], common::uint8_t logIndex, common::int32_t mouseX);
+
+			private:
+				static inline common::int32_t Mul(common::int32_t a, common::int32_t b) {
+
+					return (common::int32_t)(((common::int64_t)a * b) >> RAY_SHIFT);
+				}
+				static inline common::int32_t Sin(common::uint16_t a) { return math::Fixed<RAY_SHIFT>::Sin(a * (ANGLE_TURN / RAY_ANGLES)).raw; }
+				static inline common::int32_t Cos(common::uint16_t a) { return math::Fixed<RAY_SHIFT>::Cos(a * (ANGLE_TURN / RAY_ANGLES)).raw; }
+
+				void BuildColumns();
+				void DrawFloor(common::uint8_t* pixels);
+				void DrawWalls(common::uint8_t* pixels);
+				bool Blocked(common::int32_t x, common::int32_t y);
 		};
 
 		//int worldMap[mapWidth][mapHeight]=
@@ -4,6 +4,7 @@
 #include <common/types.h>
 #include <common/graphicscontext.h>
 #include <gui/pixelart.h>
+#include <gui/layer.h>
 #include <gui/games/platformer.h>
 #include <gui/games/shooter.h>
 #include <drivers/vga.h>
@@ -42,6 +43,10 @@ namespace os {
 				Platformer platformer;
 				Shooter shooter;
 
+				//static part of the room or a game, shared
+				//since only one of them is up at a time
+				Layer background;
+
 
 				struct math::point walkPixels[320];
 				common::uint16_t stepsNum;
@@ -91,10 +96,12 @@ namespace os {
 				
 				void Dream(common::GraphicsContext* gc);
 				void Fly(common::GraphicsContext* gc, common::uint16_t osakaSpriteNum);
+				void Rise();
 				void Walk();
 				void TimeAndDate(char* timeString);
 				void ComputeGameState();
 
+				void DrawRoomStatic(common::GraphicsContext* gc);
 				void DrawRoom(common::GraphicsContext* gc);
 		};
 				
@@ -0,0 +1,61 @@
+#ifndef __OS__GUI__SPRITE_H
+#define __OS__GUI__SPRITE_H
+
+#include <common/types.h>
+
+
+//room for every sprite in both directions, the room
+//scene and the games take about 60k of it
+#ifndef SPRITE_POOL_SIZE
+#define SPRITE_POOL_SIZE (96*1024)
+#endif
+
+//run lengths and skips are one byte each
+#define SPRITE_MAX_WIDTH 255
+
+
+namespace os {
+
+	namespace gui {
+
+		//pixel art with color 0 as transparent, run length encoded
+		//when it's constructed so drawing it is only whole opaque
+		//runs, the mirrored image is encoded as well so neither
+		//direction has to test anything per pixel
+		//
+		//each row is a run count then for every run how many clear
+		//pixels to skip, how many opaque ones follow and those pixels,
+		//the rows are found through an offset table at the start
+		class Sprite {
+
+			public:
+				common::uint8_t* source;
+				common::uint16_t w;
+				common::uint16_t h;
+
+				//normal and mirrored, 0 if it didn't fit in the
+				//pool and the source has to be drawn the old way
+				common::uint8_t* runs[2];
+
+			public:
+				Sprite(common::uint8_t* source, common::uint16_t w, common::uint16_t h);
+				~Sprite();
+
+				//buf is WIDTH_13H wide, nothing outside the clip
+				//rectangle is touched, all in buf coordinates
+				void Draw(common::uint8_t* buf, common::int32_t x, common::int32_t y, bool mirror,
+						common::int32_t clipX, common::int32_t clipY,
+						common::int32_t clipW, common::int32_t clipH);
+
+			private:
+				static common::uint8_t pool[SPRITE_POOL_SIZE];
+				static common::uint32_t poolUsed;
+
+				common::uint8_t* Encode(bool mirror);
+				static void CopyRun(common::uint8_t* dst, common::uint8_t* src, common::uint32_t count);
+		};
+	}
+}
+
+
+#endif
@@ -5,12 +5,17 @@
 #include <common/graphicscontext.h>
 #include <drivers/keyboard.h>
 #include <gui/pixelart.h>
+#include <gui/glyphs.h>
 #include <list.h>
 
 
 #define TEXT_MAX_WIDTH 53
 #define TEXT_MAX_HEIGHT 22
 
+//most pieces a rectangle gets cut into by the windows above it,
+//past this the rest is drawn anyway and just gets drawn over
+#define COMPOSITE_RECTS 32
+
 
 namespace os {
 		
@@ -18,6 +23,26 @@ namespace os {
 
 	namespace gui {
 
+		struct CompositeRect {
+
+			common::int32_t x;
+			common::int32_t y;
+			common::int32_t w;
+			common::int32_t h;
+		};
+
+
+		//one character of a text window, dirty is 1 once it's been
+		//written and 2 when it was written again before being drawn,
+		//then whatever the first write left has to be cleared too
+		struct TerminalCell {
+
+			common::uint8_t glyph;
+			common::uint8_t color;
+			common::uint8_t dirty;
+		} __attribute__((packed));
+
+
 		class Widget : public os::drivers::KeyboardEventHandler {
 
 			public:
@@ -26,7 +51,10 @@ namespace os {
 				common::int32_t w;
 				common::int32_t h;
 				
+				//rows of buf are bufWidth apart
 				common::uint8_t* buf;
+				common::int32_t bufWidth;
+				common::int32_t bufHeight;
 			public:
 				Widget(common::int32_t x, common::int32_t y, 
 					common::int32_t w, common::int32_t h);
@@ -52,9 +80,6 @@ namespace os {
 
 				List* buttons;
 				
-				//graphical buffer for windows and shit
-				common::uint8_t windowBuffer[64000];
-
 				//data for storing position
 				//of window and text etc.
 				common::int32_t xo;
@@ -69,6 +94,19 @@ namespace os {
 				//check if scrolling
 				bool textScroll = false;
 
+				//text is kept as cells and only turned into pixels
+				//when the window is drawn, cell row y is the ring
+				//row (textHead + y) % TEXT_MAX_HEIGHT so scrolling a
+				//line is just moving the head along
+				TerminalCell textCells[TEXT_MAX_HEIGHT][TEXT_MAX_WIDTH];
+				common::uint8_t textHead;
+				bool textRowDirty[TEXT_MAX_HEIGHT];
+
+				//lines scrolled since the buffer was last drawn,
+				//the pixels are moved up all of them in one go
+				common::uint16_t textScrolled;
+				bool textPending;
+
 				//other stuff we need
 				char* name;
 				common::uint8_t color;
@@ -115,10 +153,29 @@ namespace os {
 				virtual bool Minimize();
 				virtual void Resize(common::int32_t oldx, common::int32_t oldy, 
 						common::int32_t newx, common::int32_t newy);
+
+				//make buf w by h again after the window changed size,
+				//what fits is kept and text cut off by the old size is
+				//drawn again from the cells, with no memory the old one stays
+				bool ResizeSurface();
 				virtual bool MenuButton();
 				virtual void ButtonAction(common::uint8_t button);
 				
 				
+				//parts of a screen rectangle that no window above child
+				//covers, every window when child is 0, returns how many
+				common::uint8_t Uncovered(CompositeWidget* child,
+						common::int32_t x, common::int32_t y,
+						common::int32_t w, common::int32_t h,
+						CompositeRect* out);
+
+				//copy only those parts of a surface with rows stride
+				//apart whose top left corner goes at x,y
+				void BlitUncovered(common::GraphicsContext* gc, CompositeWidget* child,
+						common::int32_t x, common::int32_t y,
+						common::int32_t w, common::int32_t h,
+						common::uint8_t* surface, common::int32_t stride);
+
 				//draw actual window	
 				virtual void Draw(common::GraphicsContext* gc);
 				virtual void MenuDraw(common::GraphicsContext* gc);
@@ -144,6 +201,15 @@ namespace os {
 				//words and shit
 				void PutChar(char ch);
 				void Print(char* str);
+				void PutText(char* str, common::int32_t x, common::int32_t y, common::uint8_t color);
+
+				//rasterize cells written since the last time, anything
+				//drawing into or reading buf after printing calls it
+				void FlushText();
+			private:
+				void TextCell(common::uint8_t glyph, common::uint8_t color);
+				void TextScroll();
+			public:
 			
 				//input
 				virtual void OnMouseDown(common::int32_t x, common::int32_t y, common::uint8_t button);
@@ -5,6 +5,24 @@
 #include <common/types.h>
 
 
+//binary angles, a full turn is exactly what a uint16 holds
+//so angles wrap for free and the quadrant is the top 2 bits
+#define ANGLE_TURN 0x10000
+#define ANGLE_QUARTER (ANGLE_TURN / 4)
+
+//entries in the quarter sine table, the rest of an angle's
+//bits interpolate between two of them
+#define SINE_BITS 8
+#define SINE_STEPS (1 << SINE_BITS)
+
+//2.30 is what the tables and cordic hand back
+#define TRIG_SHIFT 30
+#define TRIG_ONE (1 << TRIG_SHIFT)
+
+//cordic iterations, one bit of result each
+#define CORDIC_STEPS 30
+
+
 namespace os {
 
 	namespace math {
@@ -29,14 +47,194 @@ namespace os {
 
 
 		//trig
-		const double pi = 3.14159265358979323846;
+		constexpr double pi = 3.14159265358979323846;
 		
 		double fmod(double a, double b);
 		
+		//range reduced to a quarter turn and then a polynomial,
+		//within an ulp of libm while |x| < 2^20 and no worse than
+		//fmod after that, for callers that have to stay in floats
 		double sin(double x);
 		double cos(double x);
 
 
+		//series only ever run by the compiler to fill tables,
+		//at runtime these would be far slower than sin above
+		constexpr double SeriesSin(double x) {
+
+			double term = x;
+			double sum = x;
+
+			for (int n = 1; n < 20; n++) {
+
+				term *= -(x * x) / ((2 * n) * (2 * n + 1));
+				sum += term;
+			}
+			return sum;
+		}
+
+		//converges for |x| <= 1/2
+		constexpr double SeriesAtan(double x) {
+
+			double term = x;
+			double sum = x;
+
+			for (int n = 1; n < 60; n++) {
+
+				term *= -(x * x);
+				sum += term / (2 * n + 1);
+			}
+			return sum;
+		}
+
+
+		//first quadrant of sine in 2.30, one more entry than
+		//steps so interpolating the last one needs no check
+		struct SineTable {
+
+			common::int32_t value[SINE_STEPS + 1];
+
+			constexpr SineTable() : value() {
+
+				for (int i = 0; i <= SINE_STEPS; i++) {
+
+					double v = SeriesSin((pi / 2.0) * i / SINE_STEPS) * TRIG_ONE;
+					value[i] = (common::int32_t)(v + 0.5);
+				}
+			}
+		};
+
+		inline constexpr SineTable sineTable;
+
+
+		//sine of a binary angle in 2.30, the table steps are
+		//close enough that linear interpolation stays within
+		//5e-6 of the real curve, exact on every 64th angle
+		static inline common::int32_t SinFixed(common::uint16_t angle) {
+
+			common::uint16_t quarter = angle & (ANGLE_QUARTER - 1);
+
+			//second and fourth quadrants run the table backwards
+			if (angle & ANGLE_QUARTER) { quarter = ANGLE_QUARTER - quarter; }
+
+			common::uint32_t index = quarter >> (14 - SINE_BITS);
+			common::int32_t frac = quarter & ((1 << (14 - SINE_BITS)) - 1);
+
+			common::int32_t low = sineTable.value[index];
+			common::int32_t value = low;
+
+			if (frac) { value += ((sineTable.value[index + 1] - low) * frac) >> (14 - SINE_BITS); }
+
+			return (angle & (ANGLE_TURN / 2)) ? -value : value;
+		}
+
+		static inline common::int32_t CosFixed(common::uint16_t angle) { return SinFixed(angle + ANGLE_QUARTER); }
+
+
+		//rotation mode cordic, slower than the table but within
+		//2e-8 instead of 5e-6, for when an angle has to be exact
+		void SinCosCordic(common::uint16_t angle, common::int32_t* sine, common::int32_t* cosine);
+
+		//vectoring mode cordic, the angle of y/x and length of
+		//(x,y) without a division or square root, the angle is
+		//within a step and the length within 1 + 1e-7 of itself
+		common::uint16_t Atan2(common::int32_t y, common::int32_t x);
+		common::uint32_t Hypot(common::int32_t x, common::int32_t y);
+
+		//whole radians to a binary angle, the fraction of a turn
+		//comes from a 64 bit 1/2pi so even huge counts are exact
+		common::uint16_t AngleFromRadians(common::uint32_t radians);
+
+
+		//floor of the square root, one result bit per step
+		common::uint16_t isqrt(common::uint32_t x);
+		common::uint32_t isqrt64(common::uint64_t x);
+
+
+		//(n / d) where n is 64 bits and the answer fits in 32,
+		//a plain 64 bit divide would pull in libgcc's __divdi3
+		static inline common::int32_t Div64(common::int64_t n, common::int32_t d) {
+
+			common::uint64_t un = n < 0 ? -(common::uint64_t)n : n;
+			common::uint64_t ud = d < 0 ? -(common::int64_t)d : d;
+
+			//idiv faults if the quotient doesn't fit, saturate instead
+			if (d == 0 || (un >> 31) >= ud) { return ((n < 0) != (d < 0)) ? (common::int32_t)0x80000000 : 0x7fffffff; }
+
+#ifdef __EMSCRIPTEN__
+			return (common::int32_t)(n / d);
+#else
+			common::int32_t quotient;
+			common::int32_t remainder;
+
+			asm("idivl %4" : "=a"(quotient), "=d"(remainder)
+				       : "a"((common::uint32_t)n), "d"((common::int32_t)(n >> 32)), "rm"(d));
+			return quotient;
+#endif
+		}
+
+
+		//signed fixed point with Frac fraction bits in an int32,
+		//products and quotients go through 64 bits then back
+		template<common::uint8_t Frac>
+		struct Fixed {
+
+			static_assert(Frac >= 1 && Frac <= TRIG_SHIFT, "fraction bits have to fit an int32");
+
+			common::int32_t raw;
+
+			constexpr Fixed() : raw(0) {}
+
+			static constexpr Fixed Raw(common::int32_t raw) { Fixed f; f.raw = raw; return f; }
+			static constexpr Fixed Int(common::int32_t v) { return Raw(v * (1 << Frac)); }
+
+			//for constants, at runtime this is fpu work
+			static constexpr Fixed Real(double v) { return Raw((common::int32_t)(v * (1 << Frac) + (v < 0 ? -0.5 : 0.5))); }
+
+			//2.30 from the trig routines down to Frac, rounded
+			static constexpr Fixed FromTrig(common::int32_t v) {
+
+				if constexpr (Frac == TRIG_SHIFT) { return Raw(v); }
+				else { return Raw((v + (1 << (TRIG_SHIFT - 1 - Frac))) >> (TRIG_SHIFT - Frac)); }
+			}
+
+
+			constexpr common::int32_t Floor() const { return raw >> Frac; }
+			constexpr common::int32_t Round() const { return (raw + (1 << (Frac - 1))) >> Frac; }
+			constexpr common::int32_t Fraction() const { return raw & ((1 << Frac) - 1); }
+
+			constexpr Fixed operator+(Fixed b) const { return Raw(raw + b.raw); }
+			constexpr Fixed operator-(Fixed b) const { return Raw(raw - b.raw); }
+			constexpr Fixed operator-() const { return Raw(-raw); }
+			constexpr Fixed operator*(Fixed b) const { return Raw((common::int32_t)(((common::int64_t)raw * b.raw) >> Frac)); }
+			constexpr Fixed operator*(common::int32_t b) const { return Raw(raw * b); }
+			Fixed operator/(Fixed b) const { return Raw(Div64((common::int64_t)raw * (1 << Frac), b.raw)); }
+			Fixed operator/(common::int32_t b) const { return Raw(raw / b); }
+
+			Fixed& operator+=(Fixed b) { raw += b.raw; return *this; }
+			Fixed& operator-=(Fixed b) { raw -= b.raw; return *this; }
+			Fixed& operator*=(Fixed b) { *this = *this * b; return *this; }
+
+			constexpr bool operator==(Fixed b) const { return raw == b.raw; }
+			constexpr bool operator!=(Fixed b) const { return raw != b.raw; }
+			constexpr bool operator<(Fixed b) const { return raw < b.raw; }
+			constexpr bool operator>(Fixed b) const { return raw > b.raw; }
+			constexpr bool operator<=(Fixed b) const { return raw <= b.raw; }
+			constexpr bool operator>=(Fixed b) const { return raw >= b.raw; }
+
+
+			static inline Fixed Sin(common::uint16_t angle) { return FromTrig(SinFixed(angle)); }
+			static inline Fixed Cos(common::uint16_t angle) { return FromTrig(CosFixed(angle)); }
+
+			//negative numbers come back as zero
+			static inline Fixed Sqrt(Fixed x) {
+
+				if (x.raw <= 0) { return Fixed(); }
+				return Raw(isqrt64((common::uint64_t)x.raw << Frac));
+			}
+		};
+
+
 		//functions for making shapes
 		void LineFillLow(common::int32_t x0, common::int32_t y0,
 				   common::int32_t x1, common::int32_t y1,
@@ -67,6 +265,9 @@ namespace os {
 			float horizontalOffset;
 			float K1;
 
+			//rows give x, y and z from the point's i, j and k
+			float rotation[3][3];
+
 			float x;
 			float y;
 			float z;
@@ -81,6 +282,7 @@ namespace os {
 		float calculateX(int i, int j, int k, Cube* data);
 		float calculateY(int i, int j, int k, Cube* data);
 		float calculateZ(int i, int j, int k, Cube* data);
+		void calculateRotation(Cube* data);
 		void calculateForSurface(float cubeX, float cubeY, float cubeZ, 
 				int ch,  Cube* data);
 		void calculateCube(float incrementSpeed, Cube* data);
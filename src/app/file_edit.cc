@@ -105,14 +105,7 @@ void Journal::SaveOutput(char* fileName, CompositeWidget* widget, FileSystem* fi
 	bool fileExistsOnDisk = filesystem->FileIf(fileSector);
 	
 	// Check if file exists in in-memory table
-	bool fileExistsInTable = false;
-	for (int i = 0; i < filesystem->table->fileCount; i++) {
-		File* file = (File*)(filesystem->table->files->Read(i));
-		if (file && strcmp(fileName, file->Name)) {
-			fileExistsInTable = true;
-			break;
-		}
-	}
+	bool fileExistsInTable = filesystem->GetFile(fileName) != nullptr;
 	
 	if (fileExistsOnDisk) {
 		// File exists on disk, write to it
@@ -125,8 +118,10 @@ void Journal::SaveOutput(char* fileName, CompositeWidget* widget, FileSystem* fi
 		if (!fileExistsInTable) {
 			File* newFile = (File*)(filesystem->memoryManager->malloc(sizeof(File)));
 			new (newFile) File(fileSector, OFS_BLOCK_SIZE, fileName);
+			newFile->Slot = filesystem->table->fileCount;
 			filesystem->table->files->Push(newFile);
 			filesystem->table->fileCount++;
+			filesystem->LinkFile(newFile);
 		}
 	} else {
 		// File doesn't exist, create new one
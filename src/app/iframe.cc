@@ -96,7 +96,7 @@ void IframeApp::ComputeAppState(GraphicsContext* gc, CompositeWidget* widget) {
 	}
 	
 	// Capture iframe and render to window buffer
-	// Note: widget->buf and widget->windowBuffer point to the same memory
+	// Note: widget->buf is the window's own surface, bufWidth x bufHeight
 	// The window content area starts at (x+1, y+10) with size (w-1, h-10)
 	// But the buffer is relative to (0,0) of the widget, so we write at (1, 10) relative to widget
 	// Also update widget coordinates for iframe positioning
@@ -119,11 +119,12 @@ void IframeApp::ComputeAppState(GraphicsContext* gc, CompositeWidget* widget) {
 				}
 			}
 			// Write to the content area of the window (skip header)
-			Module.captureIframeToBuffer($0, 1, 10, $3 - 1, $4 - 10, $5);
+			Module.captureIframeToBuffer($0, 1, 10, $3 - 1, $4 - 10, $5, $6, $7);
 		} else {
 			console.error('[IframeApp C++] captureIframeToBuffer not found!');
 		}
-	}, this->iframeId, widget->x, widget->y, widget->w, widget->h, (uintptr_t)widget->buf);
+	}, this->iframeId, widget->x, widget->y, widget->w, widget->h, (uintptr_t)widget->buf,
+	   widget->bufWidth, widget->bufHeight);
 #else
 	// Non-web version: just draw a placeholder
 	gc->FillRectangle(widget->x, widget->y, widget->w, widget->h, 0x07);
@@ -102,8 +102,7 @@ void KasugaPaint::SaveOutput(char* file, CompositeWidget* widget, FileSystem* fi
 	for (uint8_t y = 0; y < this->height; y++) {
 		for (uint16_t x = 0; x < this->width; x++) {
 		
-			uint32_t index = this->width*y+x;
-			tmp[index] = widget->ReadPixel(index);
+			tmp[this->width*y+x] = widget->ReadPixel(WIDTH_13H*y+x);
 		}
 	}
 	filesystem->Write13H(file, tmp, this->width, this->height, this->compress);
@@ -115,31 +114,14 @@ void KasugaPaint::ReadInput(char* file, CompositeWidget* widget, FileSystem* fil
 
 	if (filesystem->FileIf(filesystem->GetFileSector(file)) == false) { return; }
 
-	uint8_t tmp[64000];
-
 	uint16_t inputw = 320;
-	uint8_t inputh = 200;
-
-	//filesystem->Read13H(file, tmp, &inputw, &inputh, false);
-	uint8_t* ptr = nullptr;
+	uint16_t inputh = 200;
 
-	if (filesystem->GetTagFile("compressed", filesystem->GetFileSector(file), ptr)) {
-	
-		filesystem->Read13H(file, tmp, &inputw, &inputh, true);
-	} else {
-		filesystem->Read13H(file, tmp, &inputw, &inputh, false);
-	}
+	//tiles land straight in the canvas, only as much as the window holds
+	filesystem->ReadImage(file, widget->buf, widget->bufWidth, widget->bufHeight, &inputw, &inputh);
 
 	this->width = inputw;
 	this->height = inputh;
-
-
-	for (uint32_t y = 0; y < this->height; y++) {
-		for (uint32_t x = 0; x < this->width; x++) {
-
-			widget->WritePixel(x, y, tmp[this->width*y+x]);
-		}
-	}
 }
 
 
@@ -285,12 +267,12 @@ void KasugaPaint::LightBrush(int32_t oldx, int32_t oldy,
 
 void KasugaPaint::Bucket(int32_t x, int32_t y, CompositeWidget* widget) {
 
-	uint8_t color = widget->buf[320*y+x];
+	uint8_t color = widget->ReadPixel(WIDTH_13H*y+x);
 	uint16_t xo = x;
 	uint8_t yo = y;
 		
-	for (y = yo; widget->buf[320*y+xo] != color; y++) {
-		for (x = xo; widget->buf[320*y+x] != color; x++) {
+	for (y = yo; widget->ReadPixel(WIDTH_13H*y+xo) != color; y++) {
+		for (x = xo; widget->ReadPixel(WIDTH_13H*y+x) != color; x++) {
 	
 			widget->PutPixel(x, y, paintColor);
 		}
@@ -1,5 +1,8 @@
 #include <cli.h>
 #include <script.h>
+#include <common/trace.h>
+#include <gui/image.h>
+#include <gui/frame.h>
 #include <new>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -386,56 +389,71 @@ void ofs(char* args, CommandLine* cli) {
 
 void files(char* args, CommandLine* cli) {
 
-	char name[33];
+	char name[256];
 	char tag[33];
-	uint32_t fileNum = cli->filesystem->GetFileCount();
-	uint8_t tagNum = 0;
+	char tagName[33];
 
+	//"files -t (tag)", plain "files (tag)" still works
 	bool filterTags = args[0] != '\0';
+	int argStart = (argcount(args) > 1 && args[0] == '-' && args[1] == 't' && args[2] == ' ') ? 3 : 0;
+	
+	int k = 0;
+	for (k; k < 32 && args[argStart+k] != '\0' && args[argStart+k] != ' '; k++) { tagName[k] = args[argStart+k]; }
+	tagName[k] = '\0';
 	
 	uint32_t fileCount = 0;
 	uint16_t previousColor = setTextColor(false);
 
-	//list all files
-	//go through each file entry and print
-	// Use the in-memory table instead of GetFileCount to avoid garbage files
+	//tag queries only touch the index in memory,
+	//otherwise list the working directory
 	uint32_t actualFileNum = cli->filesystem->table->fileCount;
+	uint32_t* locations = nullptr;
+	File** dirFiles = nullptr;
+
+	if (filterTags) {
+	
+		locations = (uint32_t*)(cli->mm->malloc(sizeof(uint32_t) * OFS_TAG_INDEX_MAX));
+		actualFileNum = cli->filesystem->GetTagFiles(tagName, locations, OFS_TAG_INDEX_MAX);
+	} else {
+		dirFiles = (File**)(cli->mm->malloc(sizeof(File*) * (actualFileNum + 1)));
+		actualFileNum = cli->filesystem->GetDirectoryFiles(cli->filesystem->workingDirectory, dirFiles, actualFileNum);
+	}
+
 	for (int i = 0; i < actualFileNum; i++) {
 		
-		// Get file from in-memory table (already validated during initialization)
-		File* file = (File*)(cli->filesystem->table->files->Read(i));
+		File* file = filterTags ? cli->filesystem->GetFileFromLocation(locations[i]) : dirFiles[i];
 		if (!file) continue;
 		
-		// Copy file name
-		for (int j = 0; j < 33; j++) {
-			name[j] = file->Name[j];
+		//tagged files can be anywhere so they get full paths
+		if (filterTags) {
+		
+			cli->filesystem->GetPath(file->Location, name, 256);
+		} else {
+			for (int j = 0; j < 33; j++) { name[j] = file->Name[j]; }
 		}
 		
 		uint32_t location = file->Location;
-		bool skip = false;
-
-		//list files with given tag(s)
-		//if none given then print all files
-		if (filterTags) { skip = cli->filesystem->GetTagFile(args, location, &tagNum) != location; }		
 
 		//print information
-		if (!skip) {
-			
-			cli->PrintCommand(int2str(location));
-			cli->PrintCommand("    ");
-			cli->PrintCommand(name, 0x09);
-			cli->PrintCommand("    ");
-	
-			for (int j = 0; j < 8; j++) {
+		cli->PrintCommand(int2str(location));
+		cli->PrintCommand("    ");
+		cli->PrintCommand(name, 0x09);
 		
-				cli->filesystem->GetFileTag(name, j, tag);
-				cli->PrintCommand(tag, 0x0a);
-				cli->PrintCommand(" ");
-			}
-			cli->PrintCommand("\n", previousColor);
-			fileCount++;
+		if (file->Flags & OFS_FLAG_DIRECTORY) { cli->PrintCommand("/", 0x09); }
+		cli->PrintCommand("    ");
+
+		for (int j = 0; j < 8; j++) {
+	
+			cli->filesystem->GetFileTag(name, j, tag);
+			cli->PrintCommand(tag, 0x0a);
+			cli->PrintCommand(" ");
 		}
+		cli->PrintCommand("\n", previousColor);
+		fileCount++;
 	}
+	if (locations) { cli->mm->free(locations); }
+	if (dirFiles) { cli->mm->free(dirFiles); }
+
 	//print file count and give
 	//return value of file count
 	char* strNum = int2str(fileCount);
@@ -451,60 +469,28 @@ void files(char* args, CommandLine* cli) {
 
 void catFile(char* args, CommandLine* cli) {
 
-	EM_ASM_({
-		console.log('[CATFILE] Called with args:', UTF8ToString($0));
-	}, args);
-	
-	uint32_t fileSize = cli->filesystem->GetFileSize(args);
-	EM_ASM_({
-		console.log('[CATFILE] GetFileSize returned:', $0);
-	}, fileSize);
-	
-	uint32_t LBAsize = fileSize / OFS_BLOCK_SIZE;
-	EM_ASM_({
-		console.log('[CATFILE] LBAsize calculated:', $0, '(fileSize:', $1, ', OFS_BLOCK_SIZE:', $2, ')');
-	}, LBAsize, fileSize, OFS_BLOCK_SIZE);
-	
 	uint8_t data[OFS_BLOCK_SIZE];
+	int32_t handle = cli->filesystem->Open(args);
+	uint32_t bytesRead = cli->filesystem->Read(handle, data, OFS_BLOCK_SIZE);
 
-	if (LBAsize == 0) {
-		EM_ASM_({
-			console.log('[CATFILE] LBAsize is 0, printing "Nothing here..."');
-		});
+	if (bytesRead == 0) {
 		cli->PrintCommand("Nothing here...");
 	} else {
-		EM_ASM_({
-			console.log('[CATFILE] LBAsize: ', $0, ', starting to read file');
-		}, LBAsize);
-		for (int i = 0; i < LBAsize; i++) {
-			EM_ASM_({
-				console.log('[CATFILE] Reading LBA:', $0);
-			}, i);
-			
-			bool readSuccess = cli->filesystem->ReadLBA(args, data, i);
-			EM_ASM_({
-				console.log('[CATFILE] ReadLBA returned:', $0);
-				if ($0) {
-					console.log('[CATFILE] First 10 bytes of data:', HEAPU8[$1], HEAPU8[$1+1], HEAPU8[$1+2], HEAPU8[$1+3], HEAPU8[$1+4], HEAPU8[$1+5], HEAPU8[$1+6], HEAPU8[$1+7], HEAPU8[$1+8], HEAPU8[$1+9]);
-				}
-			}, readSuccess, (uintptr_t)data);
+		//handle reads ahead so this doesn't wait on disk every block
+		while (bytesRead > 0) {
 	
 			//print data from file
-			for (uint16_t j = 0; j < OFS_BLOCK_SIZE; j++) {
+			for (uint16_t j = 0; j < bytesRead; j++) {
 		
 				char* str = " ";
 				str[0] = (char)(data[j]);
 				cli->PrintCommand(str);
 			}
+			bytesRead = cli->filesystem->Read(handle, data, OFS_BLOCK_SIZE);
 		}
-		EM_ASM_({
-			console.log('[CATFILE] Finished reading all LBAs');
-		});
 	}
+	cli->filesystem->Close(handle);
 	cli->PrintCommand("\n");
-	EM_ASM_({
-		console.log('[CATFILE] Function completed');
-	});
 }
 
 
@@ -597,6 +583,116 @@ void deleteFile(char* args, CommandLine* cli) {
 
 
 
+void makeDirectory(char* args, CommandLine* cli) {
+
+	bool created = cli->filesystem->NewDirectory(args);
+
+	cli->PrintCommand("'");
+	cli->PrintCommand(args);
+
+	if (created) {  cli->PrintCommand("' was created.\n");
+	} else {	cli->PrintCommand("' already exists or its parent doesn't.\n"); }
+	
+	cli->returnVal = created;
+}
+
+
+void changeDirectory(char* args, CommandLine* cli) {
+
+	char* root = "/";
+	char* path = args[0] == '\0' ? root : args;
+
+	if (cli->filesystem->ChangeDirectory(path) == false) {
+
+		cli->PrintCommand("'");
+		cli->PrintCommand(args);
+		cli->PrintCommand("' isn't a directory.\n");
+		cli->returnVal = 0;
+		return;
+	}
+	cli->returnVal = 1;
+}
+
+
+void printDirectory(char* args, CommandLine* cli) {
+
+	char path[256];
+	cli->filesystem->GetPath(cli->filesystem->workingDirectory, path, 256);
+
+	cli->PrintCommand(path);
+	cli->PrintCommand("\n");
+	cli->returnVal = cli->filesystem->workingDirectory;
+}
+
+
+
+//trace		events in the ring
+//trace -c		clear the ring
+//trace (file)	save the ring as chrome trace json
+void trace(char* args, CommandLine* cli) {
+
+	if (args[0] == '\0') {
+
+		cli->PrintCommand(int2str(Trace::count));
+		cli->PrintCommand(" events in the trace buffer.\n");
+		cli->returnVal = Trace::count;
+		return;
+	}
+	if (args[0] == '-' && args[1] == 'c' && args[2] == '\0') {
+
+		Trace::Clear();
+		cli->PrintCommand("Trace buffer cleared.\n");
+		return;
+	}
+	if (cli->filesystem->GetFile(args) != nullptr) {
+
+		cli->PrintCommand("File already exists.\n");
+		return;
+	}
+
+
+	//json is around 130 bytes an event, files are whole blocks
+	uint32_t size = (Trace::count + 1) * 160 + 64;
+	size = ((size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE) * OFS_BLOCK_SIZE;
+
+	char* json = (char*)(cli->mm->malloc(size));
+	if (json == nullptr) { cli->PrintCommand("Not enough memory.\n"); return; }
+
+	uint32_t length = Trace::Dump(json, size);
+	for (uint32_t i = length; i < size; i++) { json[i] = 0x00; }
+
+	uint32_t blocks = (length + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE;
+	bool ok = cli->filesystem->NewFile(args, (uint8_t*)json, OFS_BLOCK_SIZE);
+
+	for (uint32_t lba = 1; lba < blocks && ok; lba++) {
+
+		ok = cli->filesystem->WriteLBA(args, (uint8_t*)json + (lba * OFS_BLOCK_SIZE), lba);
+	}
+	cli->mm->free(json);
+
+	if (ok) {
+		cli->PrintCommand(int2str(length));
+		cli->PrintCommand(" bytes of trace saved.\n");
+	} else {
+		cli->PrintCommand("Trace couldn't be saved.\n");
+	}
+	cli->returnVal = ok;
+}
+
+
+void sync(char* args, CommandLine* cli) {
+
+	//move journaled metadata to its home sectors
+	uint32_t pending = cli->filesystem->pendingCount;
+	cli->filesystem->Checkpoint();
+
+	cli->PrintCommand(int2str(pending));
+	cli->PrintCommand(" metadata sectors checkpointed.\n");
+	cli->returnVal = pending;
+}
+
+
+
 void copy(char* args, CommandLine* cli) {
 
 	if (argcount(args) < 2) {
@@ -661,36 +757,89 @@ void detag(char* args, CommandLine* cli) {
 	}
 }
 
-void encrypt(char* args, CommandLine* cli) {
+//toggle transparent block compression
+void compress(char* args, CommandLine* cli) {
 
 	int i = 0;
-	
+
 	char fileName[33];
-	for (i; i < strlen(argparse(args, 0)); i++) { fileName[i] = args[i];}
+	for (i; i < 32 && args[i] != ' ' && args[i] != '\0'; i++) { fileName[i] = args[i]; }
+	fileName[i] = '\0';
+
+	bool compress = !strcmp("off", argparse(args, 1));
+	bool check = cli->filesystem->SetCompression(fileName, compress);
+
+	if (check == false) {
+
+		cli->PrintCommand("File doesn't exist.\n");
+	} else if (compress) {
+		cli->PrintCommand("File is compressed.\n");
+	} else {
+		cli->PrintCommand("File is uncompressed.\n");
+	}
+	cli->returnVal = check;
+}
+
+
+//file name then key, key is zero padded to 16 bytes
+void cryptArgs(char* args, char fileName[33], uint8_t key[16]) {
+
+	int i = 0;
+	for (i; i < 32 && args[i] != ' ' && args[i] != '\0'; i++) { fileName[i] = args[i]; }
 	fileName[i] = '\0';
 
+	while (args[i] == ' ') { i++; }
+
+	for (int j = 0; j < 16; j++) { key[j] = 0x00; }
+	for (int j = 0; j < 16 && args[i+j] != ' ' && args[i+j] != '\0'; j++) { key[j] = (uint8_t)args[i+j]; }
+}
+
+
+void encrypt(char* args, CommandLine* cli) {
+
+	char fileName[33];
 	uint8_t key[16];
-	for (int j = i+1; j < strlen(argparse(args, 1)); j++) { key[j] = (uint8_t)args[i+j+1]; }
+	cryptArgs(args, fileName, key);
 	
 	cli->filesystem->CryptFile(fileName, key, true);
 }
 
 void decrypt(char* args, CommandLine* cli) {
 	
-	int i = 0;
-	
 	char fileName[33];
-	for (i; i < strlen(argparse(args, 0)); i++) { fileName[i] = args[i];}
-	fileName[i] = '\0';
-	
 	uint8_t key[16];
-	for (int j = i+1; j < strlen(argparse(args, 1)); j++) { key[j] = (uint8_t)args[i+j+1]; }
-	
+	cryptArgs(args, fileName, key);
 	
 	cli->filesystem->CryptFile(fileName, key, false);
 }
 
 
+//read an encrypted file in place until it's locked again
+void unlock(char* args, CommandLine* cli) {
+
+	char fileName[33];
+	uint8_t key[16];
+	cryptArgs(args, fileName, key);
+
+	bool check = cli->filesystem->UnlockFile(fileName, key);
+	for (int i = 0; i < 16; i++) { key[i] = 0x00; }
+
+	if (check) {
+
+		cli->PrintCommand("File unlocked.\n");
+	} else {
+		cli->PrintCommand("Wrong key, or file isn't encrypted.\n");
+	}
+	cli->returnVal = check;
+}
+
+void lock(char* args, CommandLine* cli) {
+
+	cli->filesystem->LockFile(cli->filesystem->GetFileSector(args));
+	cli->PrintCommand("File locked.\n");
+}
+
+
 
 //networking commands
 void ip(char* args, CommandLine* cli) {
@@ -946,6 +1095,29 @@ void targetgui(char* args, CommandLine* cli) {
 	else { cli->PrintCommand("Currently targeting desktop buffer.\n"); }
 }
 
+//no args flips the frame time overlay, a number sets the frame rate
+void fps(char* args, CommandLine* cli) {
+
+	if (args[0] == '\0') {
+
+		FrameScheduler::overlay ^= 1;
+		FrameScheduler::stale = true;
+
+		if (FrameScheduler::overlay) { cli->PrintCommand("Frame overlay on.\n"); }
+		else { cli->PrintCommand("Frame overlay off.\n"); }
+		return;
+	}
+	uint32_t rate = numOrVar(args, cli, 0);
+
+	if (rate < 1 || rate > FRAME_RATE_MAX) {
+
+		cli->PrintCommand("Frame rate has to be between 1 and 240.\n");
+		return;
+	}
+	FrameScheduler::rate = rate;
+	cli->returnVal = rate;
+}
+
 void vgaPalette(char* args, CommandLine* cli) {
 
 	uint8_t vgaIndex = str2int(argparse(args, 0));
@@ -1014,8 +1186,8 @@ void drawpic(char* args, CommandLine* cli) {
 	uint32_t x = numOrVar(args, cli, 1);
 	uint32_t y = numOrVar(args, cli, 2);
 	uint16_t w = 0;
-	uint8_t h = 0;
-	uint8_t buf[64000]; //ew
+	uint16_t h = 0;
+	uint8_t buf[WIDTH_13H*HEIGHT_13H]; //ew
 
 	//if we dont do this, filename cant be recognized
 	//strings are just so fun to play with right?
@@ -1025,15 +1197,8 @@ void drawpic(char* args, CommandLine* cli) {
 	}
 	
 
-	uint8_t* ptr = nullptr;
-	
-	if (cli->filesystem->GetTagFile("compressed", cli->filesystem->GetFileSector(args), ptr)) {
-	
-		//very expensive operations
-		cli->filesystem->Read13H(args, buf, &w, &h, true);
-	} else {
-		cli->filesystem->Read13H(args, buf, &w, &h, false);
-	}
+	//compressed tiles decode on their own
+	cli->filesystem->Read13H(args, buf, WIDTH_13H, HEIGHT_13H, &w, &h, true);
 	
 
 	if (cli->targetWindow) { cli->userWindow->FillBuffer(x, y, w, h, buf); }
@@ -1041,6 +1206,41 @@ void drawpic(char* args, CommandLine* cli) {
 }
 
 
+//bmp or ppm file to an image drawpic can show, shrunk to fit the screen
+void import(char* args, CommandLine* cli) {
+
+	if (argcount(args) < 2) {
+
+		cli->PrintCommand("A picture and an image name are needed.\n");
+		return;
+	}
+
+	int i = 0;
+
+	char fileName[33];
+	for (i; i < 32 && args[i] != ' ' && args[i] != '\0'; i++) { fileName[i] = args[i]; }
+	fileName[i] = '\0';
+
+	char* imageName = argparse(args, 1);
+
+	uint16_t w = 0;
+	uint16_t h = 0;
+	uint8_t* buf = (uint8_t*)(cli->filesystem->memoryManager->malloc(WIDTH_13H*HEIGHT_13H));
+
+	bool check = ImageImport::Decode(cli->filesystem, cli->vga, fileName, buf, WIDTH_13H, HEIGHT_13H, &w, &h);
+
+	if (check) { check = cli->filesystem->Write13H(imageName, buf, w, h, true); }
+	cli->filesystem->memoryManager->free(buf);
+
+	if (check) {
+		cli->PrintCommand("Picture imported.\n");
+	} else {
+		cli->PrintCommand("Picture isn't an uncompressed bmp or ppm.\n");
+	}
+	cli->returnVal = check;
+}
+
+
 //********************************************************AyumuScript*****************************************************************
 
 uint32_t numOrVar(char* args, CommandLine* cli, uint8_t argNum) {
@@ -1507,6 +1707,15 @@ void bit_xor(char* args, CommandLine* cli) {
 }
 
 
+//2.30 times amp, cut toward zero like the double cast was
+static uint32_t TrigScale(int32_t value, uint32_t amp) {
+
+	int64_t product = (int64_t)value * amp;
+	if (product < 0) { return -(int32_t)((-product) >> TRIG_SHIFT); }
+	return (product >> TRIG_SHIFT);
+}
+
+
 void trig_sin(char* args, CommandLine* cli) {
 
 	uint16_t hashVar = hash(argparse(args, 0)) % 1024;
@@ -1514,7 +1723,7 @@ void trig_sin(char* args, CommandLine* cli) {
 	uint32_t amp = numOrVar(args, cli, 1);
 	if (amp < 1) { amp = 1; }
 	
-	uint32_t result = (uint32_t)(sin((double)(num)) * (double)amp);
+	uint32_t result = TrigScale(SinFixed(AngleFromRadians(num)), amp);
 	cli->varTable[hashVar] = result;
 	cli->returnVal = result;
 }
@@ -1526,7 +1735,7 @@ void trig_cos(char* args, CommandLine* cli) {
 	uint32_t amp = numOrVar(args, cli, 1);
 	if (amp < 1) { amp = 1; }
 	
-	uint32_t result = (uint32_t)(cos((double)(num)) * (double)amp);
+	uint32_t result = TrigScale(CosFixed(AngleFromRadians(num)), amp);
 	cli->varTable[hashVar] = result;
 	cli->returnVal = result;
 }
@@ -2396,8 +2605,16 @@ void CommandLine::hash_cli_init() {
 	this->hash_add("size", size);
 	this->hash_add("create", createFile);
 	this->hash_add("delete", deleteFile);
+	this->hash_add("mkdir", makeDirectory);
+	this->hash_add("cd", changeDirectory);
+	this->hash_add("pwd", printDirectory);
+	this->hash_add("sync", sync);
+	this->hash_add("trace", trace);
+	this->hash_add("compress", compress);
 	this->hash_add("encrypt", encrypt);
 	this->hash_add("decrypt", decrypt);
+	this->hash_add("unlock", unlock);
+	this->hash_add("lock", lock);
 #ifdef __EMSCRIPTEN__
 	this->hash_add("download", download);
 #endif
@@ -2420,7 +2637,9 @@ void CommandLine::hash_cli_init() {
 	this->hash_add("drawline", drawline);
 	this->hash_add("drawtext", drawtext);
 	this->hash_add("drawpic", drawpic);
+	this->hash_add("import", import);
 	this->hash_add("vga", vgaPalette);
+	this->hash_add("fps", fps);
 	this->hash_add("version", version);
 
 	
@@ -2676,11 +2895,14 @@ char* CommandLine::command(char* cmd, uint8_t length) {
 
 	//actual command found
 	if (this->cmdTable[result] != nullptr)  {
-		EM_ASM_({
-			console.log('[CLI] Executing command:', UTF8ToString($0), ', args:', UTF8ToString($1));
-		}, command, arguments);	
-	
+
+		uint32_t name0 = Trace::Pack(command, 0);
+		uint32_t name1 = Trace::Pack(command, 4);
+
+		TRACE_BEGIN(TRACE_INFO, TRACE_CLI, TRACE_CLI_COMMAND, name0, name1);
 		(*CommandLine::cmdTable[result])(arguments, this); //execute function from array
+		TRACE_END(TRACE_INFO, TRACE_CLI, TRACE_CLI_COMMAND, name0, name1);
+
 		arguments[0] = '\0';
 	} else {
 		//variable
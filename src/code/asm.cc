@@ -31,7 +31,11 @@ void Compiler::Assemble(char* asmFile, char* outFile) {
 
 
 	uint8_t readData[OFS_BLOCK_SIZE];
-	this->filesystem->ReadLBA(asmFile, readData, 0);
+	for (int i = 0; i < OFS_BLOCK_SIZE; i++) { readData[i] = 0x00; }
+
+	int32_t handle = this->filesystem->Open(asmFile);
+	this->filesystem->Read(handle, readData, OFS_BLOCK_SIZE);
+	this->filesystem->Close(handle);
 	
 
 	//no real binary format for now
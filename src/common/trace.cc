@@ -0,0 +1,341 @@
+#include <common/trace.h>
+#include <hardwarecommunication/port.h>
+#include <memorymanagement.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+using namespace os;
+using namespace os::common;
+
+
+TraceEvent Trace::ring[TRACE_RING_SIZE];
+uint32_t Trace::head = 0;
+uint32_t Trace::count = 0;
+
+uint32_t Trace::unitsPerMs = 0;
+bool Trace::tsc = false;
+volatile uint32_t Trace::ticks = 0;
+static bool initialized = false;
+
+
+struct TraceEventInfo {
+
+	char* name;
+	bool text;
+};
+
+static TraceEventInfo eventInfo[TRACE_EVENT_COUNT] = {
+
+	{ "ata read", false },
+	{ "ata write", false },
+	{ "ofs read lba", false },
+	{ "ofs write lba", false },
+	{ "ofs fragment", false },
+	{ "ofs mount", false },
+	{ "cli command", true },
+};
+
+
+
+#ifndef __EMSCRIPTEN__
+//cpuid exists if the id flag in eflags can be flipped,
+//the tsc is bit 4 of edx in leaf 1
+static bool HasTSC() {
+
+	unsigned long before, after;
+
+	asm volatile("pushf; pop %0; mov %0, %1; xor $0x200000, %1; push %1; popf; pushf; pop %1; push %0; popf"
+			: "=&r"(before), "=&r"(after) : : "cc");
+
+	if (((before ^ after) & 0x200000) == 0) { return false; }
+
+	uint32_t a, b, c, d;
+	asm volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0));
+	if (a < 1) { return false; }
+
+	asm volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1));
+	return (d & 0x10) != 0;
+}
+
+
+static inline uint64_t ReadTSC() {
+
+	uint32_t low, high;
+	asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+	return ((((uint64_t)high) << 32) | low) >> 10;
+}
+#endif
+
+
+void Trace::Init() {
+
+#ifdef __EMSCRIPTEN__
+	unitsPerMs = 1000;
+#else
+	hardwarecommunication::Port8Bit command(0x43);
+
+	tsc = HasTSC();
+
+	if (tsc) {
+
+		//10ms one shot on channel 2 with the speaker off,
+		//interrupts held off so nothing lands in the middle
+		hardwarecommunication::Port8Bit channel2(0x42);
+		hardwarecommunication::Port8Bit gate(0x61);
+
+		unsigned long flags;
+		asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+
+		uint8_t old = gate.Read();
+		gate.Write((old & 0xfd) | 0x01);
+
+		command.Write(0xb0);
+		channel2.Write(11932 & 0xff);
+		channel2.Write(11932 >> 8);
+
+		uint64_t start = ReadTSC();
+		while ((gate.Read() & 0x20) == 0) {}
+		uint64_t end = ReadTSC();
+
+		gate.Write(old);
+		asm volatile("push %0; popf" : : "r"(flags) : "memory", "cc");
+
+		unitsPerMs = (uint32_t)(end - start) / 10;
+		if (unitsPerMs == 0) { unitsPerMs = 1; }
+	} else {
+		//rate generator at 1 kHz, the same count sleep
+		//loads so it never changes the rate under us
+		hardwarecommunication::Port8Bit channel0(0x40);
+
+		command.Write(0x34);
+		channel0.Write(TRACE_PIT_RELOAD & 0xff);
+		channel0.Write(TRACE_PIT_RELOAD >> 8);
+
+		unitsPerMs = 1000;
+	}
+#endif
+	initialized = true;
+}
+
+
+//microseconds on the web and without a tsc, otherwise
+//the time stamp counter in units of 1024 cycles
+uint64_t Trace::Now() {
+
+#ifdef __EMSCRIPTEN__
+	return (uint64_t)(emscripten_get_now() * 1000.0);
+#else
+	if (tsc) { return ReadTSC(); }
+	if (initialized == false) { return 0; }
+
+	//whole milliseconds from the interrupt count and the
+	//part of one from where channel 0 is in its countdown
+	hardwarecommunication::Port8Bit command(0x43);
+	hardwarecommunication::Port8Bit channel0(0x40);
+
+	unsigned long flags;
+	asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+
+	command.Write(0x00);
+	uint32_t left = channel0.Read();
+	left |= channel0.Read() << 8;
+	uint32_t tick = ticks;
+
+	asm volatile("push %0; popf" : : "r"(flags) : "memory", "cc");
+
+	if (left > TRACE_PIT_RELOAD) { left = TRACE_PIT_RELOAD; }
+
+	//a wrap whose interrupt hasn't run yet can read as
+	//a step back, time never goes backwards
+	static uint64_t last = 0;
+	uint64_t time = ((uint64_t)tick * 1000) + (((TRACE_PIT_RELOAD - left) * 1000) / TRACE_PIT_RELOAD);
+
+	if (time < last) { time = last; }
+	last = time;
+
+	return time;
+#endif
+}
+
+
+void Trace::Record(uint8_t category, uint8_t phase, uint16_t event, uint32_t arg0, uint32_t arg1) {
+
+	TraceEvent* slot = &ring[head];
+
+	slot->time = Now();
+	slot->event = event;
+	slot->category = category;
+	slot->phase = phase;
+	slot->arg0 = arg0;
+	slot->arg1 = arg1;
+
+	head = (head + 1) & (TRACE_RING_SIZE - 1);
+	if (count < TRACE_RING_SIZE) { count++; }
+}
+
+
+void Trace::Clear() {
+
+	head = 0;
+	count = 0;
+}
+
+
+uint32_t Trace::Pack(char* name, uint8_t offset) {
+
+	uint32_t packed = 0;
+
+	for (int i = 0; i < offset; i++) { if (name[i] == '\0') { return 0; } }
+
+	for (int i = 0; i < 4; i++) {
+
+		if (name[offset + i] == '\0') { break; }
+		packed |= ((uint32_t)(uint8_t)name[offset + i]) << (i * 8);
+	}
+	return packed;
+}
+
+
+
+//append helpers for Dump, they stop quietly at the end of out
+static void Append(char* out, uint32_t size, uint32_t* length, char* str) {
+
+	for (int i = 0; str[i] != '\0' && *length < size - 1; i++) { out[(*length)++] = str[i]; }
+}
+
+
+static void AppendNumber(char* out, uint32_t size, uint32_t* length, uint32_t num) {
+
+	char digits[11];
+	int i = 10;
+
+	digits[i] = '\0';
+	do {
+		digits[--i] = '0' + (num % 10);
+		num /= 10;
+	} while (num > 0);
+
+	Append(out, size, length, digits + i);
+}
+
+
+static void AppendPacked(char* out, uint32_t size, uint32_t* length, uint32_t packed) {
+
+	char str[5];
+	int n = 0;
+
+	for (int i = 0; i < 4; i++) {
+
+		char c = (packed >> (i * 8)) & 0xff;
+		if (c == '\0') { break; }
+
+		//keep the json valid whatever the name was
+		if (c < ' ' || c == '"' || c == '\\') { c = '?'; }
+		str[n++] = c;
+	}
+	str[n] = '\0';
+
+	Append(out, size, length, str);
+}
+
+
+//chrome wants ts in microseconds, split so it stays in 32 bits
+static uint32_t Microseconds(uint32_t units) {
+
+	uint32_t perMs = Trace::unitsPerMs ? Trace::unitsPerMs : 1000;
+	return ((units / perMs) * 1000) + (((units % perMs) * 1000) / perMs);
+}
+
+
+static char* CategoryName(uint8_t category) {
+
+	switch (category) {
+
+		case TRACE_ATA: return "ata";
+		case TRACE_OFS: return "ofs";
+		case TRACE_CLI: return "cli";
+		case TRACE_GUI: return "gui";
+		default: return "misc";
+	}
+}
+
+
+uint32_t Trace::Dump(char* out, uint32_t size) {
+
+	uint32_t length = 0;
+	if (size == 0) { return 0; }
+
+	//times are relative to the oldest event still in the ring
+	uint32_t first = (head - count) & (TRACE_RING_SIZE - 1);
+	uint64_t start = ring[first].time;
+
+	Append(out, size, &length, "{\"traceEvents\":[\n");
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		TraceEvent* event = &ring[(first + i) & (TRACE_RING_SIZE - 1)];
+		bool text = event->event < TRACE_EVENT_COUNT && eventInfo[event->event].text;
+		char phase[2] = { (char)event->phase, '\0' };
+
+		Append(out, size, &length, "{\"name\":\"");
+		Append(out, size, &length, event->event < TRACE_EVENT_COUNT ? eventInfo[event->event].name : (char*)"unknown");
+		Append(out, size, &length, "\",\"cat\":\"");
+		Append(out, size, &length, CategoryName(event->category));
+		Append(out, size, &length, "\",\"ph\":\"");
+		Append(out, size, &length, phase);
+		Append(out, size, &length, "\",\"ts\":");
+		AppendNumber(out, size, &length, Microseconds((uint32_t)(event->time - start)));
+		Append(out, size, &length, ",\"pid\":1,\"tid\":1");
+
+		if (event->phase == 'i') { Append(out, size, &length, ",\"s\":\"g\""); }
+
+		if (text) {
+
+			Append(out, size, &length, ",\"args\":{\"name\":\"");
+			AppendPacked(out, size, &length, event->arg0);
+			AppendPacked(out, size, &length, event->arg1);
+			Append(out, size, &length, "\"}}");
+		} else {
+			Append(out, size, &length, ",\"args\":{\"a\":");
+			AppendNumber(out, size, &length, event->arg0);
+			Append(out, size, &length, ",\"b\":");
+			AppendNumber(out, size, &length, event->arg1);
+			Append(out, size, &length, "}}");
+		}
+		if (i + 1 < count) { Append(out, size, &length, ","); }
+		Append(out, size, &length, "\n");
+	}
+	Append(out, size, &length, "]}\n");
+
+	out[length] = '\0';
+	return length;
+}
+
+
+
+#ifdef __EMSCRIPTEN__
+//Module._traceDump() from the console, saves the ring as a .json
+extern "C" {
+	EMSCRIPTEN_KEEPALIVE void traceDump() {
+
+		uint32_t size = (Trace::count + 1) * 160 + 64;
+		char* json = (char*)MemoryManager::activeMemoryManager->malloc(size);
+		if (json == nullptr) { return; }
+
+		uint32_t length = Trace::Dump(json, size);
+
+		EM_ASM_({
+			var blob = new Blob([HEAPU8.slice($0, $0 + $1)], { type: 'application/json' });
+			var link = document.createElement('a');
+			link.href = URL.createObjectURL(blob);
+			link.download = 'osakaOS-trace.json';
+			link.click();
+			setTimeout(function() { URL.revokeObjectURL(link.href); }, 1000);
+		}, json, length);
+
+		MemoryManager::activeMemoryManager->free(json);
+	}
+}
+#endif
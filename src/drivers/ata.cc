@@ -1,4 +1,5 @@
 #include <drivers/ata.h>
+#include <common/trace.h>
 
 using namespace os;
 using namespace os::common;
@@ -98,6 +99,7 @@ void AdvancedTechnologyAttachment::Read28(common::uint32_t sector, common::uint8
 		printf("STORAGE UNAVAILABLE\n");
 		return;
 	}
+	TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_READ, sector, 1);
 
 	devicePort.Write((master ? 0xe0 : 0xf0) | ((sector & 0x0f000000) >> 24));
 	errorPort.Write(0x00);
@@ -168,6 +170,7 @@ void AdvancedTechnologyAttachment::Write28(common::uint32_t sector, common::uint
 		printf("STORAGE UNAVAILABLE\n");
 		return;
 	}
+	TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_WRITE, sector, 1);
 
 	devicePort.Write((master ? 0xe0 : 0xf0) | ((sector & 0x0f000000) >> 24));
 	errorPort.Write(0x00);
@@ -228,6 +231,106 @@ void AdvancedTechnologyAttachment::Write28(common::uint32_t sector, common::uint
 
 
 
+void AdvancedTechnologyAttachment::Read28Multi(common::uint32_t sector, common::uint8_t* data, common::uint16_t sectorCount) {
+
+	if ((sector & 0xf0000000) || sectorCount == 0 || sectorCount > 256) {
+
+		printf("STORAGE UNAVAILABLE\n");
+		return;
+	}
+	TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_READ, sector, sectorCount);
+
+	devicePort.Write((master ? 0xe0 : 0xf0) | ((sector & 0x0f000000) >> 24));
+	errorPort.Write(0x00);
+
+	//0 means 256 sectors to the drive
+	sectorCountPort.Write(sectorCount & 0xff);
+
+	lbaLowPort.Write( sector & 0x000000ff);
+	lbaMidPort.Write((sector & 0x0000ff00) >> 8);
+	lbaHiPort.Write(( sector & 0x00ff0000) >> 16);
+
+	commandPort.Write(0x20);
+
+
+	//drive raises DRQ once for every sector in the transfer
+	for (uint16_t s = 0; s < sectorCount; s++) {
+
+		uint8_t status = commandPort.Read();
+		while (((status & 0x80) == 0x80) || ((status & 0x08) != 0x08)) {
+
+			if (status & 0x01) { break; }
+			status = commandPort.Read();
+		}
+
+		if (status & 0x01) {
+
+			printf("ATA ERROR\n");
+			return;
+		}
+
+		uint8_t* sectorData = data + (s * bytesPerSector);
+
+		for (uint16_t i = 0; i < bytesPerSector; i += 2) {
+
+			uint16_t rdata = dataPort.Read();
+			sectorData[i] = rdata & 0x00ff;
+			sectorData[i+1] = (rdata >> 8) & 0x00ff;
+		}
+	}
+}
+
+
+
+void AdvancedTechnologyAttachment::Write28Multi(common::uint32_t sector, common::uint8_t* data, common::uint16_t sectorCount) {
+
+	if ((sector & 0xf0000000) || sectorCount == 0 || sectorCount > 256) {
+
+		printf("STORAGE UNAVAILABLE\n");
+		return;
+	}
+	TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_WRITE, sector, sectorCount);
+
+	devicePort.Write((master ? 0xe0 : 0xf0) | ((sector & 0x0f000000) >> 24));
+	errorPort.Write(0x00);
+	sectorCountPort.Write(sectorCount & 0xff);
+
+	lbaLowPort.Write( sector & 0x000000ff);
+	lbaMidPort.Write((sector & 0x0000ff00) >> 8);
+	lbaHiPort.Write( (sector & 0x00ff0000) >> 16);
+
+	commandPort.Write(0x30);
+
+
+	for (uint16_t s = 0; s < sectorCount; s++) {
+
+		uint8_t status = commandPort.Read();
+		while (((status & 0x80) == 0x80) || ((status & 0x08) != 0x08)) {
+
+			if (status & 0x01) { break; }
+			status = commandPort.Read();
+		}
+
+		if (status & 0x01) {
+
+			printf("ATA ERROR\n");
+			return;
+		}
+
+		uint8_t* sectorData = data + (s * bytesPerSector);
+
+		for (uint16_t i = 0; i < bytesPerSector; i += 2) {
+
+			dataPort.Write(sectorData[i] | (((uint16_t)sectorData[i+1]) << 8));
+		}
+	}
+
+	//one cache flush for the whole transfer
+	this->Flush();
+}
+
+
+
 
 void AdvancedTechnologyAttachment::Flush() {
 	
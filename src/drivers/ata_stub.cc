@@ -1,4 +1,5 @@
 #include <drivers/ata.h>
+#include <common/trace.h>
 #include <string.h>
 #include <stdint.h>
 #ifdef __EMSCRIPTEN__
@@ -17,6 +18,21 @@ using namespace os::common;
 using namespace os::drivers;
 using namespace os::hardwarecommunication;
 
+// The web disk lives in IndexedDB as 64 KB chunks of 128 sectors.
+// The metadata area and every chunk holding a file header load first,
+// the rest stream in behind them or load on first access. A read of
+// a sector that isn't here yet waits for it. Writes land in memory and
+// dirty chunks go out together in one transaction per flush interval.
+#define ATA_CHUNK_SECTORS 128
+#define ATA_MOUNT_SECTORS 1024
+#define ATA_FLUSH_INTERVAL 250
+#define ATA_LOAD_BATCH 16
+#define ATA_READ_WAIT 1
+
+// Filesystem superblock, the directory it points to says
+// which chunks hold file headers
+#define ATA_SUPERBLOCK_SECTOR 512
+
 AdvancedTechnologyAttachment::AdvancedTechnologyAttachment(uint16_t portBase, bool master)
 : dataPort(portBase),
   errorPort(portBase + 0x01),
@@ -32,416 +48,445 @@ AdvancedTechnologyAttachment::AdvancedTechnologyAttachment(uint16_t portBase, bo
     this->master = master;
     
 #ifdef __EMSCRIPTEN__
-    // Initialize IndexedDB storage
     EM_ASM_({
+        // One block store per page, every drive object shares it
+        if (Module._ata) {
+            return;
+        }
         if (typeof indexedDB === 'undefined') {
             console.error('[ATA] IndexedDB not available');
             return;
         }
-        
-        // Open or create database
-        var request = indexedDB.open('osakaOS_disk', 1);
-        
-        request.onerror = function(event) {
-            console.error('[ATA] IndexedDB error:', event.target.error);
+
+        var ata = Module._ata = ({
+            db: null,
+            mounted: false,
+            chunkSectors: $0,
+            mountChunks: Math.ceil($1 / $0),
+            flushInterval: $2,
+            loadBatch: $3,
+            chunks: {},     // resident chunks, index -> Uint8Array
+            stored: {},     // manifest, chunks that exist in IndexedDB
+            written: {},    // sectors written to a chunk that isn't loaded yet
+            unread: {},     // sectors a read gave up on, writes to them lose
+            loading: {},
+            dirty: {},
+            queue: [],
+            flushTimer: null
+        });
+        var chunkBytes = ata.chunkSectors * 512;
+
+        ata.manifest = function() {
+            return ({
+                key: 'manifest',
+                chunkSectors: ata.chunkSectors,
+                chunks: Object.keys(ata.stored).map(Number)
+            });
         };
-        
-        request.onsuccess = function(event) {
-            Module._ata_db = event.target.result;
-            console.log('[ATA] IndexedDB opened successfully');
-            
-            // Pre-populate cache with all sectors from IndexedDB
-            // This allows Read28 to work synchronously by reading from cache
-            if (Module._ata_db) {
-                var transaction = Module._ata_db.transaction(['sectors'], 'readonly');
-                var store = transaction.objectStore('sectors');
-                var request = store.openCursor();
-                
-                if (!Module._ata_cache) {
-                    Module._ata_cache = {};
-                }
-                
-                request.onsuccess = function(event) {
-                    var cursor = event.target.result;
-                    if (cursor) {
-                        var sector = cursor.key;
-                        var sourceBuffer = cursor.value.data;
-                        // Create a copy of the ArrayBuffer to avoid corruption
-                        if (sourceBuffer instanceof ArrayBuffer) {
-                            var byteLength = sourceBuffer.byteLength;
-                            // Ensure we have at least 512 bytes (sector size)
-                            var targetLength = Math.max(512, byteLength);
-                            var data = new Uint8Array(targetLength);
-                            // Initialize with zeros
-                            for (var i = 0; i < targetLength; i++) {
-                                data[i] = 0;
-                            }
-                            // Copy from source buffer
-                            if (byteLength > 0) {
-                                var sourceView = new Uint8Array(sourceBuffer);
-                                var copyLength = Math.min(byteLength, targetLength);
-                                for (var i = 0; i < copyLength; i++) {
-                                    data[i] = sourceView[i];
-                                }
-                            }
-                            Module._ata_cache['sector_' + sector] = data;
-                        } else {
-                            console.error('[ATA] Cache init: data is not an ArrayBuffer for sector', sector, '- value:', cursor.value);
-                            // Use zeros if data format is wrong
-                            var zeroData = new Uint8Array(512);
-                            for (var i = 0; i < 512; i++) {
-                                zeroData[i] = 0;
-                            }
-                            Module._ata_cache['sector_' + sector] = zeroData;
-                        }
-                        cursor.continue();
-                    } else {
-                        console.log('[ATA] Cache populated, refreshing filesystem');
-                        // Mark cache as fully populated
-                        Module._ata_cache_populated = true;
-                        // Now that cache is populated, refresh filesystem
-                        if (Module._osakaFileSystemPtr && Module._refreshFileSystem) {
-                            try {
-                                Module._refreshFileSystem(Module._osakaFileSystemPtr);
-                                console.log('[ATA] Filesystem file table refreshed');
-                            } catch (e) {
-                                console.warn('[ATA] Could not refresh filesystem:', e);
-                            }
-                        }
-                    }
-                };
-                
-                request.onerror = function(event) {
-                    console.error('[ATA] Error populating cache:', event.target.error);
-                    // Still try to refresh filesystem even if cache fails
-                    if (Module._osakaFileSystemPtr && Module._refreshFileSystem) {
-                        try {
-                            Module._refreshFileSystem(Module._osakaFileSystemPtr);
-                        } catch (e) {
-                            console.warn('[ATA] Could not refresh filesystem:', e);
-                        }
+
+        // A chunk is usable once it's loaded, or if it never existed on disk
+        ata.ready = function(index, within) {
+            var written = ata.written[index];
+            return ata.chunks[index] && (!written || written[within]);
+        };
+
+        // Stored data fills in around sectors written while the chunk was loading
+        ata.install = function(index, buffer) {
+            delete ata.loading[index];
+
+            var resident = ata.chunks[index];
+            var written = ata.written[index];
+            if (resident && !written) {
+                return;
+            }
+
+            var data = new Uint8Array(chunkBytes);
+            if (buffer instanceof ArrayBuffer) {
+                data.set(new Uint8Array(buffer, 0, Math.min(buffer.byteLength, chunkBytes)));
+            }
+            if (resident) {
+                for (var s = 0; s < ata.chunkSectors; s++) {
+                    if (written[s]) {
+                        data.set(resident.subarray(s * 512, (s + 1) * 512), s * 512);
                     }
+                }
+            }
+            ata.chunks[index] = data;
+            delete ata.written[index];
+            delete ata.unread[index];
+
+            if (ata.dirty[index]) {
+                ata.scheduleFlush();
+            }
+        };
+
+        // Fetch a batch of chunks in one readonly transaction
+        ata.load = function(list, done) {
+            var wanted = list.filter(function(index) {
+                return ata.stored[index] && !ata.loading[index] && !(ata.chunks[index] && !ata.written[index]);
+            });
+            if (wanted.length == 0 || !ata.db) {
+                if (done) done();
+                return;
+            }
+
+            var transaction = ata.db.transaction(['chunks'], 'readonly');
+            var store = transaction.objectStore('chunks');
+
+            wanted.forEach(function(index) {
+                ata.loading[index] = true;
+                store.get(index).onsuccess = function(event) {
+                    var result = event.target.result;
+                    ata.install(index, result ? result.data : null);
                 };
+            });
+            transaction.oncomplete = function() {
+                if (done) done();
+            };
+            transaction.onerror = function(event) {
+                console.error('[ATA] Chunk load failed:', event.target.error);
+                wanted.forEach(function(index) { delete ata.loading[index]; });
+                if (done) done();
+            };
+        };
+
+        // Read28 can't block, a miss pulls the chunk in right away
+        // instead of waiting for its turn in the background stream
+        ata.demand = function(index) {
+            if (ata.mounted && ata.stored[index] && !ata.loading[index]) {
+                ata.load([index], null);
             }
         };
-        
-        request.onupgradeneeded = function(event) {
-            var db = event.target.result;
-            // Create object store for disk sectors
-            if (!db.objectStoreNames.contains('sectors')) {
-                var objectStore = db.createObjectStore('sectors', { keyPath: 'sector' });
-                console.log('[ATA] Created sectors object store');
+
+        // Everything past the mount area loads in batches between frames
+        ata.stream = function() {
+            var batch = [];
+            while (ata.queue.length > 0 && batch.length < ata.loadBatch) {
+                batch.push(ata.queue.shift());
+            }
+            if (batch.length > 0) {
+                ata.load(batch, function() { setTimeout(ata.stream, 0); });
             }
         };
-    });
-#endif
-}
 
-AdvancedTechnologyAttachment::~AdvancedTechnologyAttachment() {
-}
+        ata.scheduleFlush = function() {
+            if (!ata.flushTimer) {
+                ata.flushTimer = setTimeout(ata.flush, ata.flushInterval);
+            }
+        };
 
-bool AdvancedTechnologyAttachment::Identify() {
-#ifdef __EMSCRIPTEN__
-    // For web, return true if IndexedDB is available
-    return true;
-#else
-    return false;
-#endif
-}
+        // Every dirty chunk goes out in one readwrite transaction,
+        // the manifest only when a chunk is new
+        ata.flush = function() {
+            if (ata.flushTimer) {
+                clearTimeout(ata.flushTimer);
+                ata.flushTimer = null;
+            }
+            if (!ata.db || !ata.mounted) {
+                return;
+            }
 
-void AdvancedTechnologyAttachment::Read28(uint32_t sector, uint8_t* data, int count, int offset) {
-#ifdef __EMSCRIPTEN__
-    if (!data || count <= 0) return;
-    
-    // First, try to read from cache (fast path)
-    bool cacheHit = EM_ASM_INT({
-        var sector = $0;
-        var dataPtr = $1;
-        var count = $2;
-        var offset = $3;
-        
-        if (!Module._ata_db) {
-            // Database not ready yet - zero out data (fresh disk)
-            for (var i = 0; i < count; i++) {
-                HEAPU8[dataPtr + offset + i] = 0;
+            var list = Object.keys(ata.dirty).map(Number).filter(function(index) {
+                return !ata.written[index];
+            });
+            if (list.length == 0) {
+                return;
             }
-            return 1; // Handled (returned zeros)
-        }
-        
-        // Try to read from cache first
-        var cacheKey = 'sector_' + sector;
-        console.log('[ATA] Read28: sector=' + sector + ', cacheKey=' + cacheKey);
-        console.log('[ATA] Cache exists:', !!Module._ata_cache);
-        if (Module._ata_cache) {
-            console.log('[ATA] Cache has key:', cacheKey in Module._ata_cache);
-        }
-        if (Module._ata_cache && Module._ata_cache[cacheKey]) {
-            var cachedData = Module._ata_cache[cacheKey];
-            // Check if cached data is all zeros - if so, verify it exists in IndexedDB
-            // If it's all zeros and doesn't exist in IndexedDB, don't use the cache
-            var allZeros = true;
-            for (var i = 0; i < Math.min(512, cachedData.length); i++) {
-                if (cachedData[i] !== 0) {
-                    allZeros = false;
-                    break;
+
+            var transaction = ata.db.transaction(['chunks', 'meta'], 'readwrite');
+            var chunks = transaction.objectStore('chunks');
+            var grew = false;
+
+            list.forEach(function(index) {
+                // put() clones the buffer, later writes don't leak in
+                chunks.put({ chunk: index, data: ata.chunks[index].buffer });
+                delete ata.dirty[index];
+
+                if (!ata.stored[index]) {
+                    ata.stored[index] = true;
+                    grew = true;
                 }
+            });
+            if (grew) {
+                transaction.objectStore('meta').put(ata.manifest());
             }
-            
-            if (allZeros && Module._ata_db && sector > 1024) {
-                // Cache has all zeros for a file data sector - this might be stale
-                // Trigger an async IndexedDB read to verify and update cache if needed
-                console.log('[ATA] Cache HIT - cached data is all zeros for sector', sector, '- verifying with IndexedDB');
-                var verifyTransaction = Module._ata_db.transaction(['sectors'], 'readonly');
-                var verifyStore = verifyTransaction.objectStore('sectors');
-                var verifyRequest = verifyStore.get(sector);
-                verifyRequest.onsuccess = function(event) {
-                    var result = event.target.result;
-                    if (result && result.data) {
-                        // Sector exists in IndexedDB with data - update cache
-                        var sourceBuffer = result.data;
-                        if (sourceBuffer instanceof ArrayBuffer) {
-                            var byteLength = sourceBuffer.byteLength;
-                            var targetLength = Math.max(512, byteLength);
-                            var data = new Uint8Array(targetLength);
-                            for (var i = 0; i < targetLength; i++) {
-                                data[i] = 0;
-                            }
-                            if (byteLength > 0) {
-                                var sourceView = new Uint8Array(sourceBuffer);
-                                var copyLength = Math.min(byteLength, targetLength);
-                                for (var i = 0; i < copyLength; i++) {
-                                    data[i] = sourceView[i];
-                                }
-                            }
-                            var cacheCopy = new Uint8Array(data.length);
-                            for (var i = 0; i < data.length; i++) {
-                                cacheCopy[i] = data[i];
-                            }
-                            Module._ata_cache[cacheKey] = cacheCopy;
-                            console.log('[ATA] Updated cache for sector', sector, 'from IndexedDB (was zeros, now has data)');
-                        }
-                    }
-                };
-            } else {
-                console.log('[ATA] Cache HIT - using cached data');
+
+            transaction.onerror = function(event) {
+                console.error('[ATA] Flush failed:', event.target.error);
+                list.forEach(function(index) { ata.dirty[index] = true; });
+                ata.scheduleFlush();
+            };
+        };
+
+        // Returns how many sectors are still on their way. Only the
+        // kernel's own call tree can sleep until they're here, an event
+        // handler runs while the kernel is already suspended, so there
+        // the read fails and a write built on it can't replace stored data
+        ata.readSectors = function(sector, ptr, bytes) {
+            HEAPU8.fill(0, ptr, ptr + bytes);
+            var missing = [];
+
+            for (var done = 0; done < bytes; done += 512, sector++) {
+                var index = Math.floor(sector / ata.chunkSectors);
+                var within = sector % ata.chunkSectors;
+                var length = Math.min(512, bytes - done);
+
+                if (ata.ready(index, within)) {
+                    HEAPU8.set(ata.chunks[index].subarray(within * 512, within * 512 + length), ptr + done);
+                } else if (!ata.mounted || ata.stored[index]) {
+                    missing.push(sector);
+                    ata.demand(index);
+                }
             }
-            
-            // Use cached data
-            // Cache contains full 512-byte sector starting at index 0
-            // offset is the offset into the destination buffer, not the cache
-            // Always read from cache starting at index 0, regardless of destination offset
-            var copyCount = Math.min(count, cachedData.length);
-            console.log('[ATA]: copyCount: ', copyCount, ', cachedData.length:', cachedData.length, ', offset:', offset);
-            for (var i = 0; i < copyCount; i++) {
-                // Read from cache at index i (cache has full sector from 0)
-                // Write to destination at dataPtr + offset + i
-                if (i < cachedData.length) {
-                    HEAPU8[dataPtr + offset + i] = cachedData[i];
-                    if (i < 10) {
-                        console.log('[ATA]: copied data[', i, ']=', cachedData[i], ' to HEAPU8[', (dataPtr + offset + i), ']');
-                    }
-                } else {
-                    HEAPU8[dataPtr + offset + i] = 0;
+            var canWait = typeof Asyncify !== 'undefined' && !Asyncify.currData;
+            if (missing.length == 0 || canWait) {
+                return missing.length;
+            }
+
+            missing.forEach(function(sector) {
+                var index = Math.floor(sector / ata.chunkSectors);
+                if (!ata.unread[index]) {
+                    ata.unread[index] = new Uint8Array(ata.chunkSectors);
+                }
+                ata.unread[index][sector % ata.chunkSectors] = 1;
+            });
+            console.error('[ATA] Sector', missing[0], 'read before it loaded');
+            return -missing.length;
+        };
+
+        ata.writeSector = function(sector, ptr, count, offset) {
+            var index = Math.floor(sector / ata.chunkSectors);
+            var within = sector % ata.chunkSectors;
+            var chunk = ata.chunks[index];
+
+            if (!chunk) {
+                chunk = ata.chunks[index] = new Uint8Array(chunkBytes);
+
+                // Chunk is on disk but not here yet, remember which sectors are ours
+                if (!ata.mounted || ata.stored[index]) {
+                    ata.written[index] = new Uint8Array(ata.chunkSectors);
+                    ata.demand(index);
                 }
             }
-            // Fill remaining bytes with zeros if count > cachedData.length
-            for (var i = copyCount; i < count; i++) {
-                HEAPU8[dataPtr + offset + i] = 0;
+            // Contents came from a failed read, stored data wins
+            var unread = ata.unread[index];
+            if (ata.written[index] && !(unread && unread[within])) {
+                ata.written[index][within] = 1;
             }
-            return 1; // Cache hit
-        }
-        console.log('[ATA] Cache MISS - will read from IndexedDB');
-        return 0; // Cache miss - need to read from IndexedDB
-    }, sector, (uintptr_t)data, count, offset);
-    
-    if (cacheHit) {
-        EM_ASM_({
-            console.log('[ATA] Read28 returning early (cache hit)');
-        });
-        for (int i = 0; i < count; i++) {
-            EM_ASM_({
-                console.log('[ATA] data: ', HEAPU8[$0]);
-            }, (uintptr_t)data + offset + i);
-        }
-        return; // Data already copied from cache
-    }
-    
-    EM_ASM_({
-        console.log('[ATA] Read28: Cache miss, reading from IndexedDB for sector', $0);
-    }, sector); 
-    // Cache miss - read from IndexedDB synchronously
-    // Set up async read and wait for it to complete
-    EM_ASM_({
-        var sector = $0;
-        Module._ata_read_sector = sector;
-        Module._ata_read_result = null;
-        Module._ata_read_done = false;
-        
-        if (!Module._ata_db) {
-            Module._ata_read_result = null;
-            Module._ata_read_done = true;
-            return;
-        }
-        
-        var cacheKey = 'sector_' + sector;
-        var transaction = Module._ata_db.transaction(['sectors'], 'readonly');
-        var store = transaction.objectStore('sectors');
-        var request = store.get(sector);
-        
-        request.onsuccess = function(event) {
-            var result = event.target.result;
-            console.log('[ATA] IndexedDB read success for sector', sector, 'result:', !!result);
-            if (result && result.data) {
-                // Create a copy of the ArrayBuffer to avoid corruption
-                var sourceBuffer = result.data;
-                if (sourceBuffer instanceof ArrayBuffer) {
-                    var byteLength = sourceBuffer.byteLength;
-                    // Ensure we have at least 512 bytes (sector size)
-                    var targetLength = Math.max(512, byteLength);
-                    var data = new Uint8Array(targetLength);
-                    // Initialize with zeros
-                    for (var i = 0; i < targetLength; i++) {
-                        data[i] = 0;
-                    }
-                    // Copy from source buffer
-                    if (byteLength > 0) {
-                        var sourceView = new Uint8Array(sourceBuffer);
-                        var copyLength = Math.min(byteLength, targetLength);
-                        for (var i = 0; i < copyLength; i++) {
-                            data[i] = sourceView[i];
-                        }
-                    }
-                    console.log('[ATA] Got data from IndexedDB, length:', data.length);
-                    // Update cache for future reads - store a copy
-                    if (!Module._ata_cache) {
-                        Module._ata_cache = {};
-                    }
-                    // Create another copy for the cache to ensure it's independent
-                    var cacheCopy = new Uint8Array(data.length);
-                    for (var i = 0; i < data.length; i++) {
-                        cacheCopy[i] = data[i];
+
+            var length = Math.min(count, 512 - offset);
+            if (length > 0) {
+                chunk.set(HEAPU8.subarray(ptr, ptr + length), within * 512 + offset);
+            }
+            ata.dirty[index] = true;
+            ata.scheduleFlush();
+        };
+
+
+        // The old store kept one record per sector, pack it into
+        // chunks once and drop the sector records. Sector 999999
+        // belongs to the settings app and stays where it is.
+        ata.migrate = function(done) {
+            var transaction = ata.db.transaction(['sectors'], 'readonly');
+            var request = transaction.objectStore('sectors').openCursor(IDBKeyRange.upperBound(999998));
+            var packed = {};
+
+            request.onsuccess = function(event) {
+                var cursor = event.target.result;
+                if (cursor) {
+                    var sector = cursor.key;
+                    var index = Math.floor(sector / ata.chunkSectors);
+                    var source = cursor.value.data;
+
+                    if (!packed[index]) {
+                        packed[index] = new Uint8Array(chunkBytes);
                     }
-                    Module._ata_cache[cacheKey] = cacheCopy;
-                    Module._ata_read_result = data;
-                } else {
-                    console.error('[ATA] IndexedDB data is not an ArrayBuffer for sector', sector, '- result:', result);
-                    // Use zeros if data format is wrong
-                    var zeroData = new Uint8Array(512);
-                    for (var i = 0; i < 512; i++) {
-                        zeroData[i] = 0;
+                    if (source instanceof ArrayBuffer) {
+                        packed[index].set(new Uint8Array(source, 0, Math.min(512, source.byteLength)), (sector % ata.chunkSectors) * 512);
                     }
-                    Module._ata_read_result = zeroData;
+                    cursor.continue();
+                    return;
                 }
-            } else {
-                console.log('[ATA] No data in IndexedDB for sector', sector, '- using zeros');
-                // Sector doesn't exist - create zero-filled sector
-                var zeroData = new Uint8Array(512);
-                for (var i = 0; i < 512; i++) {
-                    zeroData[i] = 0;
+
+                var indices = Object.keys(packed).map(Number);
+                var write = ata.db.transaction(['chunks', 'meta', 'sectors'], 'readwrite');
+
+                // Every chunk is in memory already, keep them all so
+                // the legacy table loads without waiting on any
+                indices.forEach(function(index) {
+                    write.objectStore('chunks').put({ chunk: index, data: packed[index].buffer });
+                    ata.stored[index] = true;
+                    ata.install(index, packed[index].buffer);
+                });
+                write.objectStore('meta').put(ata.manifest());
+                write.objectStore('sectors').delete(IDBKeyRange.upperBound(999998));
+
+                write.oncomplete = function() {
+                    console.log('[ATA] Moved', indices.length, 'chunks out of the sector store');
+                    done();
+                };
+                write.onerror = function(event) {
+                    console.error('[ATA] Migration failed:', event.target.error);
+                    done();
+                };
+            };
+            request.onerror = function(event) {
+                console.error('[ATA] Migration failed:', event.target.error);
+                done();
+            };
+        };
+
+        // Chunks holding a file header listed in the directory, null
+        // when there's no superblock and the legacy table needs all of them
+        ata.headerChunks = function() {
+            var sector = function(number) {
+                var chunk = ata.chunks[Math.floor(number / ata.chunkSectors)];
+                var start = (number % ata.chunkSectors) * 512;
+                return chunk ? new DataView(chunk.buffer, start, 512) : null;
+            };
+
+            var superblock = sector($4);
+            if (!superblock) {
+                return null;
+            }
+            for (var i = 0; i < 8; i++) {
+                if (superblock.getUint8(i) != 'OSAKAOFS'.charCodeAt(i)) {
+                    return null;
+                }
+            }
+
+            // Version 1 with 64 byte entries, 8 to a sector
+            if (superblock.getUint16(8, true) != 1 || superblock.getUint16(10, true) != 64) {
+                return null;
+            }
+            var fileCount = Math.min(superblock.getUint32(12, true), superblock.getUint32(20, true) * 8);
+            var dirStart = superblock.getUint32(16, true);
+            var found = {};
+
+            for (var entry = 0; entry < fileCount; entry++) {
+                var dir = sector(dirStart + Math.floor(entry / 8));
+                if (!dir) {
+                    return null;
                 }
-                Module._ata_read_result = zeroData;
+                var location = dir.getUint32((entry % 8) * 64 + 40, true);
+                found[Math.floor(location / ata.chunkSectors)] = true;
             }
-            Module._ata_read_done = true;
+            return Object.keys(found).map(Number);
         };
-        
+
+        // Manifest is known, load what the filesystem reads at
+        // mount time and let the rest of the disk trickle in
+        ata.mount = function() {
+            // Writes made before the manifest was known lose to stored data
+            Object.keys(ata.written).map(Number).forEach(function(index) {
+                if (ata.stored[index]) {
+                    delete ata.chunks[index];
+                    delete ata.dirty[index];
+                }
+                delete ata.written[index];
+            });
+
+            var stored = Object.keys(ata.stored).map(Number).sort(function(a, b) { return a - b; });
+            var first = stored.filter(function(index) { return index < ata.mountChunks; });
+
+            ata.mounted = true;
+            ata.load(first, function() {
+                // Headers are read at mount and rewritten by most
+                // metadata updates, they come in before anything else
+                var headers = ata.headerChunks() || stored;
+
+                ata.load(headers, function() {
+                    ata.queue = stored.filter(function(index) { return index >= ata.mountChunks; });
+                    setTimeout(ata.stream, 0);
+                    ata.scheduleFlush();
+                });
+            });
+        };
+
+        // Last chance to get dirty chunks out when the tab goes away
+        window.addEventListener('pagehide', function() { ata.flush(); });
+        document.addEventListener('visibilitychange', function() {
+            if (document.visibilityState === 'hidden') {
+                ata.flush();
+            }
+        });
+
+
+        var request = indexedDB.open('osakaOS_disk', 2);
+
+        // Reads wait for the mount, an empty disk is better than none
         request.onerror = function(event) {
-            // Error reading - use zero-filled sector
-            var zeroData = new Uint8Array(512);
-            for (var i = 0; i < 512; i++) {
-                zeroData[i] = 0;
+            console.error('[ATA] IndexedDB error:', event.target.error);
+            ata.mount();
+        };
+
+        request.onupgradeneeded = function(event) {
+            var db = event.target.result;
+            if (!db.objectStoreNames.contains('sectors')) {
+                db.createObjectStore('sectors', { keyPath: 'sector' });
+            }
+            if (!db.objectStoreNames.contains('chunks')) {
+                db.createObjectStore('chunks', { keyPath: 'chunk' });
+            }
+            if (!db.objectStoreNames.contains('meta')) {
+                db.createObjectStore('meta', { keyPath: 'key' });
             }
-            Module._ata_read_result = zeroData;
-            Module._ata_read_done = true;
         };
-    }, sector);
-    
-    // Wait for read to complete
-    // During initialization (cache not yet populated), don't use emscripten_sleep
-    // to avoid deep ASYNCIFY stacks. Just return zeros and let cache populate async.
-    // After initialization, use a single sleep to wait for IndexedDB read.
-    bool cachePopulated = EM_ASM_INT({
-        return Module._ata_cache_populated ? 1 : 0;
-    });
-    
-    if (!cachePopulated) {
-        // Still in initialization - return zeros immediately
-        // Cache will be populated asynchronously, and RefreshFileTable will be called
-        // after cache is populated, at which point cache should have the data
-        EM_ASM_({
-            console.log('[ATA] Still initializing - returning zeros, cache will populate async');
-        });
-        for (int i = 0; i < count; i++) {
-            data[offset + i] = 0;
-        }
-        return;
-    }
-    
-    // Cache is populated, but this sector wasn't in cache
-    // Return zeros immediately and let IndexedDB read populate cache asynchronously
-    // This completely avoids ASYNCIFY stack issues
-    // Note: This means sectors not in cache will return zeros on first read.
-    // However, Write28 updates cache immediately, so written sectors should be in cache.
-    // For sectors that exist in IndexedDB but aren't in cache, they'll return zeros
-    // on first read, but subsequent reads will hit the cache.
-    EM_ASM_({
-        console.log('[ATA] Cache miss after init - returning zeros, IndexedDB read will populate cache async for sector', $0);
-        
-        // Trigger async IndexedDB read to populate cache for future reads
-        var sector = $0;
-        var cacheKey = 'sector_' + sector;
-        
-        if (Module._ata_db) {
-            var transaction = Module._ata_db.transaction(['sectors'], 'readonly');
-            var store = transaction.objectStore('sectors');
-            var request = store.get(sector);
-            
-            request.onsuccess = function(event) {
-                var result = event.target.result;
-                if (result && result.data) {
-                    var sourceBuffer = result.data;
-                    if (sourceBuffer instanceof ArrayBuffer) {
-                        var byteLength = sourceBuffer.byteLength;
-                        var targetLength = Math.max(512, byteLength);
-                        var data = new Uint8Array(targetLength);
-                        for (var i = 0; i < targetLength; i++) {
-                            data[i] = 0;
-                        }
-                        if (byteLength > 0) {
-                            var sourceView = new Uint8Array(sourceBuffer);
-                            var copyLength = Math.min(byteLength, targetLength);
-                            for (var i = 0; i < copyLength; i++) {
-                                data[i] = sourceView[i];
-                            }
-                        }
-                        // Update cache for future reads
-                        if (!Module._ata_cache) {
-                            Module._ata_cache = {};
-                        }
-                        var cacheCopy = new Uint8Array(data.length);
-                        for (var i = 0; i < data.length; i++) {
-                            cacheCopy[i] = data[i];
-                        }
-                        Module._ata_cache[cacheKey] = cacheCopy;
-                        console.log('[ATA] IndexedDB read completed, cache updated for sector', sector);
-                    }
+
+        request.onsuccess = function(event) {
+            ata.db = Module._ata_db = event.target.result;
+
+            var get = ata.db.transaction(['meta'], 'readonly').objectStore('meta').get('manifest');
+
+            get.onsuccess = function(event) {
+                var manifest = event.target.result;
+                if (manifest && manifest.chunkSectors == ata.chunkSectors) {
+                    manifest.chunks.forEach(function(index) { ata.stored[index] = true; });
+                    ata.mount();
                 } else {
-                    // Sector doesn't exist in IndexedDB
-                    // Don't cache zeros here - let the sector remain uncached
-                    // This way, if it gets written later, Write28 will cache it correctly
-                    // And if it's read again before being written, it will return zeros but won't cache them
-                    console.log('[ATA] Sector', sector, 'does not exist in IndexedDB - not caching (will return zeros on read)');
+                    ata.migrate(ata.mount);
                 }
             };
-            
-            request.onerror = function(event) {
-                console.error('[ATA] IndexedDB read error for sector', sector, ':', event.target.error);
+            get.onerror = function(event) {
+                console.error('[ATA] Manifest read failed:', event.target.error);
+                ata.mount();
             };
+        };
+    }, ATA_CHUNK_SECTORS, ATA_MOUNT_SECTORS, ATA_FLUSH_INTERVAL, ATA_LOAD_BATCH, ATA_SUPERBLOCK_SECTOR);
+#endif
+}
+
+AdvancedTechnologyAttachment::~AdvancedTechnologyAttachment() {
+}
+
+bool AdvancedTechnologyAttachment::Identify() {
+#ifdef __EMSCRIPTEN__
+    // For web, return true if IndexedDB is available
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AdvancedTechnologyAttachment::Read28(uint32_t sector, uint8_t* data, int count, int offset) {
+#ifdef __EMSCRIPTEN__
+    if (!data || count <= 0) return;
+    TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_READ, sector, 1);
+
+    // A sector that hasn't come in from IndexedDB yet is waited for,
+    // zeros would be taken for real data and could be written back
+    while (EM_ASM_INT({
+        var ptr = $1 + $3;
+        var count = Math.min($2, 512);
+
+        if (!Module._ata) {
+            HEAPU8.fill(0, ptr, ptr + $2);
+            return 0;
         }
-    }, sector);
-    
-    // Return zeros immediately - no ASYNCIFY, no stack issues
-    for (int i = 0; i < count; i++) {
-        data[offset + i] = 0;
+        HEAPU8.fill(0, ptr + count, ptr + $2);
+        return Module._ata.readSectors($0, ptr, count);
+    }, sector, (uintptr_t)data, count, offset) > 0) {
+        emscripten_sleep(ATA_READ_WAIT);
     }
 #else
     // Non-web: zero out data
@@ -454,148 +499,12 @@ void AdvancedTechnologyAttachment::Read28(uint32_t sector, uint8_t* data, int co
 void AdvancedTechnologyAttachment::Write28(uint32_t sector, uint8_t* data, int count, int offset) {
 #ifdef __EMSCRIPTEN__
     if (!data || count <= 0) return;
-    
-    // Write to IndexedDB
+    TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_WRITE, sector, 1);
+
     EM_ASM_({
-        var sector = $0;
-        var dataPtr = $1;
-        var count = $2;
-        var offset = $3;
-        
-        if (!Module._ata_db) {
-            // Database not ready yet (async initialization in progress)
-            // Queue the write or wait for database to be ready
-            console.warn('[ATA] Write28: Database not ready for sector', sector, '- write will be lost!');
-            // Still update cache so reads work
-            var cacheKey = 'sector_' + sector;
-            if (!Module._ata_cache) {
-                Module._ata_cache = {};
-            }
-            // Create sector data from WASM memory
-            var sectorData = new Uint8Array(512);
-            for (var i = 0; i < 512; i++) {
-                sectorData[i] = 0;
-            }
-            for (var i = 0; i < count && (offset + i) < 512; i++) {
-                sectorData[offset + i] = HEAPU8[dataPtr + i];
-            }
-            Module._ata_cache[cacheKey] = sectorData;
-            console.log('[ATA] Write28: Updated cache only (DB not ready) for sector', sector);
-            return;
-        }
-        
-        // Read existing sector data if it exists, then write
-        // We need to wait for the write to complete to ensure cache is correct
-        Module._ata_write_complete = false;
-        var cacheKey = 'sector_' + sector;
-        
-        // Update cache immediately with data from WASM memory (synchronous)
-        // This ensures subsequent reads will find the data even before IndexedDB write completes
-        if (!Module._ata_cache) {
-            Module._ata_cache = {};
+        if (Module._ata) {
+            Module._ata.writeSector($0, $1, $2, $3);
         }
-        // Read existing sector from cache if it exists, otherwise create new one
-        var sectorData;
-        if (Module._ata_cache[cacheKey]) {
-            // Use existing cached sector
-            sectorData = new Uint8Array(Module._ata_cache[cacheKey].length);
-            for (var i = 0; i < Module._ata_cache[cacheKey].length; i++) {
-                sectorData[i] = Module._ata_cache[cacheKey][i];
-            }
-            console.log('[ATA] Write28: Using cached sector data, first byte:', sectorData[0]);
-        } else {
-            // Create new sector (512 bytes)
-            sectorData = new Uint8Array(512);
-            for (var i = 0; i < 512; i++) {
-                sectorData[i] = 0;
-            }
-            console.log('[ATA] Write28: Created new sector (all zeros)');
-        }
-        
-        // Copy data from WASM memory to sector buffer (synchronous)
-        console.log('[ATA] Write28: Copying data, offset=' + offset);
-        for (var i = 0; i < count && (offset + i) < 512; i++) {
-            var wasmByte = HEAPU8[dataPtr + i];
-            sectorData[offset + i] = wasmByte;
-            if (i < 5) {
-                console.log('[ATA] Write28: i=' + i + ', wasmByte=' + wasmByte + ', wrote to sector[' + (offset + i) + ']');
-            }
-        }
-        console.log('[ATA] Write28: After copy, sector[0]=' + sectorData[0] + ', sector[' + offset + ']=' + sectorData[offset]);
-        
-        // Update cache immediately (synchronous, before async IndexedDB operations)
-        var cacheData = new Uint8Array(sectorData.length);
-        for (var i = 0; i < sectorData.length; i++) {
-            cacheData[i] = sectorData[i];
-        }
-        Module._ata_cache[cacheKey] = cacheData;
-        console.log('[ATA] Write28: Updated cache for sector', sector, '- cacheData[0]=' + cacheData[0] + ', cacheData.length=' + cacheData.length);
-        
-        // Now do the async IndexedDB read/write
-        var transaction = Module._ata_db.transaction(['sectors'], 'readwrite');
-        var store = transaction.objectStore('sectors');
-        var getRequest = store.get(sector);
-        
-        getRequest.onsuccess = function(event) {
-            var result = event.target.result;
-            // sectorData is already created and cache is already updated above (synchronously)
-            // For partial writes, we might need to merge with IndexedDB data, but for now
-            // we'll just use the sectorData we already have (which was created from cache or zeros)
-            // The cache already has the latest data, so IndexedDB write will persist it
-            
-            console.log('[ATA] Write28: About to save to IndexedDB, sectorData[0]=' + sectorData[0]);
-            
-            // Save to IndexedDB
-            // Create a copy of the ArrayBuffer to avoid corruption if sectorData is reused
-            var bufferCopy = new ArrayBuffer(sectorData.length);
-            var bufferView = new Uint8Array(bufferCopy);
-            bufferView.set(sectorData);
-            
-            console.log('[ATA] Write28: About to save sector', sector, 'to IndexedDB, sectorData[0]=' + sectorData[0] + ', sectorData[' + offset + ']=' + sectorData[offset]);
-            var putRequest = store.put({
-                sector: sector,
-                data: bufferCopy
-            });
-            
-            putRequest.onsuccess = function() {
-                console.log('[ATA] Write28: Successfully wrote sector', sector, 'to IndexedDB - sectorData[0] was', sectorData[0]);
-                // Verify the write by reading it back
-                var verifyRequest = store.get(sector);
-                verifyRequest.onsuccess = function(verifyEvent) {
-                    var verifyResult = verifyEvent.target.result;
-                    if (verifyResult && verifyResult.data) {
-                        console.log('[ATA] Write28: Verified sector', sector, 'exists in IndexedDB');
-                    } else {
-                        console.error('[ATA] Write28: ERROR - sector', sector, 'not found in IndexedDB after write!');
-                    }
-                };
-                Module._ata_write_complete = true;
-            };
-            
-            putRequest.onerror = function(event) {
-                console.error('[ATA] Write28: ERROR writing sector', sector, 'to IndexedDB:', event.target.error);
-                Module._ata_write_complete = true;
-            };
-            
-            // Also listen for transaction completion
-            transaction.oncomplete = function() {
-                console.log('[ATA] Write28: Transaction completed for sector', sector);
-            };
-            
-            transaction.onerror = function(event) {
-                console.error('[ATA] Write28: Transaction error for sector', sector, ':', event.target.error);
-            };
-        };
-        
-        getRequest.onerror = function(event) {
-            console.error('[ATA] Read error during write:', event.target.error);
-            Module._ata_write_complete = true;
-        };
-        
-        // Note: Write will complete asynchronously
-        // We can't wait here because it causes ASYNCIFY stack issues
-        // The cache is updated immediately, so reads will work from cache
-        // IndexedDB write will complete in background for persistence
     }, sector, (uintptr_t)data, count, offset);
 #else
     // Non-web: do nothing
@@ -606,15 +515,56 @@ void AdvancedTechnologyAttachment::Write28(uint32_t sector, uint8_t* data, int c
 #endif
 }
 
+void AdvancedTechnologyAttachment::Read28Multi(uint32_t sector, uint8_t* data, uint16_t sectorCount) {
+#ifdef __EMSCRIPTEN__
+    if (!data || sectorCount == 0) return;
+    TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_READ, sector, sectorCount);
+
+    // Copy every requested sector out of the resident chunks in a single
+    // call instead of crossing into JS once per sector, waiting like Read28
+    while (EM_ASM_INT({
+        if (!Module._ata) {
+            HEAPU8.fill(0, $1, $1 + $2 * 512);
+            return 0;
+        }
+        return Module._ata.readSectors($0, $1, $2 * 512);
+    }, sector, (uintptr_t)data, sectorCount) > 0) {
+        emscripten_sleep(ATA_READ_WAIT);
+    }
+#else
+    if (data && sectorCount > 0) {
+        memset(data, 0, sectorCount * 512);
+    }
+#endif
+}
+
+void AdvancedTechnologyAttachment::Write28Multi(uint32_t sector, uint8_t* data, uint16_t sectorCount) {
+#ifdef __EMSCRIPTEN__
+    if (!data || sectorCount == 0) return;
+    TRACE_INSTANT(TRACE_DEBUG, TRACE_ATA, TRACE_ATA_WRITE, sector, sectorCount);
+
+    EM_ASM_({
+        if (!Module._ata) {
+            return;
+        }
+        for (var s = 0; s < $2; s++) {
+            Module._ata.writeSector($0 + s, $1 + s * 512, 512, 0);
+        }
+    }, sector, (uintptr_t)data, sectorCount);
+#else
+    for (uint16_t s = 0; s < sectorCount; s++) {
+        Write28(sector + s, data + (s * 512), 512, 0);
+    }
+#endif
+}
+
 void AdvancedTechnologyAttachment::Flush() {
 #ifdef __EMSCRIPTEN__
-    // IndexedDB writes are synchronous in the transaction, but we can wait for completion
+    // Push dirty chunks now instead of at the next flush interval
     EM_ASM_({
-        if (Module._ata_db) {
-            // Force any pending transactions to complete
-            console.log('[ATA] Flush called');
+        if (Module._ata) {
+            Module._ata.flush();
         }
     });
 #endif
 }
-
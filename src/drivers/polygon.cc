@@ -0,0 +1,245 @@
+#include <drivers/polygon.h>
+#include <drivers/vga.h>
+#include <math.h>
+
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::math;
+
+
+PolygonEdge Polygon::edges[POLYGON_MAX_POINTS];
+PolygonEdge* Polygon::active[POLYGON_MAX_POINTS];
+
+int32_t Polygon::minX;
+int32_t Polygon::maxX;
+int32_t Polygon::minY;
+int32_t Polygon::maxY;
+
+
+
+//edge from (x0,y0) to (x1,y1) starting on row from or its top,
+//flat edges never cross a row so there's nothing to make
+bool Polygon::MakeEdge(PolygonEdge* edge, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t from) {
+
+	if (y0 == y1) { return false; }
+
+	if (y0 > y1) {
+
+		int32_t t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+	}
+
+	//rounded down, so x never runs past the real line and
+	//the ceil in FillSpan lands on the exact crossing
+	int64_t dx = (int64_t)(x1 - x0) << 16;
+	int32_t step = Div64(dx, y1 - y0);
+	if ((int64_t)step * (y1 - y0) > dx) { step--; }
+
+	edge->top = y0;
+	edge->bottom = y1;
+	edge->step = step;
+	edge->x = x0 << 16;
+
+	if (from > y0) { edge->x += (int32_t)((int64_t)(from - y0) * step); }
+
+	return true;
+}
+
+
+
+//left and right crossings a and b in 16.16, either order
+void Polygon::FillSpan(uint8_t* row, int32_t y, int32_t a, int32_t b, uint8_t color) {
+
+	if (a > b) { int32_t t = a; a = b; b = t; }
+
+	int32_t left = (a + 0xffff) >> 16;
+	int32_t right = (b + 0xffff) >> 16;
+
+	if (left < 0) { left = 0; }
+	if (right > WIDTH_13H) { right = WIDTH_13H; }
+	if (left >= right) { return; }
+
+	Span::Fill(row + left, color, right - left);
+
+	if (left < minX) { minX = left; }
+	if (right > maxX) { maxX = right; }
+	if (y < minY) { minY = y; }
+	if (y >= maxY) { maxY = y + 1; }
+}
+
+
+
+//at most two turns between going up and going down means every
+//row crosses the outline twice, true of anything convex and of
+//most of what gets drawn, no edge table is needed for those
+bool Polygon::Monotone(uint16_t y[], uint8_t count) {
+
+	int8_t first = 0;
+	int8_t last = 0;
+	uint8_t turns = 0;
+
+	for (uint8_t i = 0; i < count; i++) {
+
+		int16_t dy = (int16_t)y[(i + 1) % count] - (int16_t)y[i];
+		if (dy == 0) { continue; }
+
+		int8_t direction = dy > 0 ? 1 : -1;
+
+		if (first == 0) { first = direction; }
+		else if (direction != last) { turns++; }
+
+		last = direction;
+	}
+	if (last != first) { turns++; }
+
+	return turns <= 2;
+}
+
+
+//walks down the two chains from the top point together
+void Polygon::FillMonotone(uint8_t* pixels, uint16_t x[], uint16_t y[], uint8_t count, uint8_t color) {
+
+	uint8_t topPoint = 0;
+	int32_t bottomRow = (int16_t)y[0];
+
+	for (uint8_t i = 1; i < count; i++) {
+
+		if ((int16_t)y[i] < (int16_t)y[topPoint]) { topPoint = i; }
+		if ((int16_t)y[i] > bottomRow) { bottomRow = (int16_t)y[i]; }
+	}
+
+	int32_t row = (int16_t)y[topPoint];
+	if (row < 0) { row = 0; }
+	if (bottomRow > HEIGHT_13H) { bottomRow = HEIGHT_13H; }
+
+
+	//a chain's edge and the point it runs to, one chain
+	//goes forwards round the points and one backwards
+	PolygonEdge chain[2];
+	uint8_t point[2] = {topPoint, topPoint};
+	int8_t direction[2] = {1, -1};
+
+	for (uint8_t c = 0; c < 2; c++) { chain[c].bottom = (int16_t)y[topPoint]; }
+
+
+	for (; row < bottomRow; row++) {
+
+		for (uint8_t c = 0; c < 2; c++) {
+
+			//on to the next edge once this one's rows are done,
+			//going round every point at most once
+			uint8_t walked = 0;
+
+			while (chain[c].bottom <= row && walked < count) {
+
+				uint8_t from = point[c];
+				point[c] = (from + count + direction[c]) % count;
+				walked++;
+
+				MakeEdge(&chain[c], (int16_t)x[from], (int16_t)y[from],
+						(int16_t)x[point[c]], (int16_t)y[point[c]], row);
+			}
+			if (chain[c].bottom <= row) { return; }
+		}
+
+		FillSpan(pixels + (row * WIDTH_13H), row, chain[0].x, chain[1].x, color);
+
+		chain[0].x += chain[0].step;
+		chain[1].x += chain[1].step;
+	}
+}
+
+
+
+//anything else, edges go on the active list as the rows reach
+//their tops and stay sorted by x, which barely changes from one
+//row to the next so insertion sort is about one pass
+void Polygon::FillEdgeTable(uint8_t* pixels, uint16_t x[], uint16_t y[], uint8_t count, uint8_t color) {
+
+	uint16_t edgeCount = 0;
+	int32_t clipTop = HEIGHT_13H;
+	int32_t bottomRow = 0;
+
+	for (uint8_t i = 0; i < count; i++) {
+
+		uint8_t next = (i + 1) % count;
+		int32_t top = (int16_t)y[i] < (int16_t)y[next] ? (int16_t)y[i] : (int16_t)y[next];
+
+		PolygonEdge edge;
+		if (!MakeEdge(&edge, (int16_t)x[i], (int16_t)y[i], (int16_t)x[next], (int16_t)y[next], top > 0 ? top : 0)) { continue; }
+		if (edge.bottom <= 0) { continue; }
+
+		//insertion sort on top as they're added
+		uint16_t j = edgeCount++;
+		for (; j > 0 && edges[j - 1].top > edge.top; j--) { edges[j] = edges[j - 1]; }
+		edges[j] = edge;
+
+		if (edge.top < clipTop) { clipTop = edge.top; }
+		if (edge.bottom > bottomRow) { bottomRow = edge.bottom; }
+	}
+
+	int32_t row = clipTop > 0 ? clipTop : 0;
+	if (bottomRow > HEIGHT_13H) { bottomRow = HEIGHT_13H; }
+
+	uint16_t nextEdge = 0;
+	uint16_t activeCount = 0;
+
+	for (; row < bottomRow; row++) {
+
+		//edges starting here, ones that started above the
+		//screen were already stepped down to row 0
+		while (nextEdge < edgeCount && edges[nextEdge].top <= row) { active[activeCount++] = &edges[nextEdge++]; }
+
+		//drop finished edges and sort the rest on x
+		uint16_t kept = 0;
+
+		for (uint16_t i = 0; i < activeCount; i++) {
+
+			PolygonEdge* edge = active[i];
+			if (edge->bottom <= row) { continue; }
+
+			uint16_t j = kept++;
+			for (; j > 0 && active[j - 1]->x > edge->x; j--) { active[j] = active[j - 1]; }
+			active[j] = edge;
+		}
+		activeCount = kept;
+
+		uint8_t* line = pixels + (row * WIDTH_13H);
+
+		for (uint16_t i = 0; i + 1 < activeCount; i += 2) {
+
+			FillSpan(line, row, active[i]->x, active[i + 1]->x, color);
+		}
+
+		for (uint16_t i = 0; i < activeCount; i++) { active[i]->x += active[i]->step; }
+	}
+}
+
+
+
+bool Polygon::Fill(uint8_t* pixels, uint16_t x[], uint16_t y[], uint8_t count, uint8_t color,
+		int32_t* left, int32_t* top, int32_t* right, int32_t* bottom) {
+
+	if (count < 3) { return false; }
+
+	minX = WIDTH_13H;
+	maxX = 0;
+	minY = HEIGHT_13H;
+	maxY = 0;
+
+	if (Monotone(y, count)) {
+
+		FillMonotone(pixels, x, y, count, color);
+	} else {
+		FillEdgeTable(pixels, x, y, count, color);
+	}
+
+	*left = minX;
+	*top = minY;
+	*right = maxX;
+	*bottom = maxY;
+
+	return minX < maxX;
+}
@@ -0,0 +1,261 @@
+#include <drivers/vbe.h>
+
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::hardwarecommunication;
+
+
+
+BochsVBE::BochsVBE(PeripheralComponentInterconnectController* pci)
+: VideoGraphicsArray(),
+  indexPort(0x1ce),
+  dataPort(0x1cf) {
+
+	this->active = false;
+	this->flipping = false;
+	this->page = 0;
+	this->linearFrameBuffer = 0;
+
+	//id2 and up can do 32 bits per pixel and
+	//every later version still answers 0xb0cX
+	uint16_t id = ReadRegister(VBE_DISPI_INDEX_ID);
+	this->present = id >= VBE_DISPI_ID2 && id <= VBE_DISPI_ID5;
+
+	if (this->present) {
+
+		this->linearFrameBuffer = FindFrameBuffer(pci);
+	}
+}
+
+
+BochsVBE::~BochsVBE() {
+}
+
+
+
+void BochsVBE::WriteRegister(uint16_t index, uint16_t value) {
+
+	indexPort.Write(index);
+	dataPort.Write(value);
+}
+
+
+uint16_t BochsVBE::ReadRegister(uint16_t index) {
+
+	indexPort.Write(index);
+	return dataPort.Read();
+}
+
+
+
+//std-vga and virtio-vga both keep vram in their first memory bar
+uint8_t* BochsVBE::FindFrameBuffer(PeripheralComponentInterconnectController* pci) {
+
+	for (int bus = 0; bus < 8; bus++) {
+		for (int device = 0; device < 32; device++) {
+
+			PeripheralComponentInterconnectDeviceDescriptor dev = pci->GetDeviceDescriptor(bus, device, 0);
+
+			if (dev.vendor_id == 0x0000 || dev.vendor_id == 0xffff) { continue; }
+			if (dev.class_id != 0x03 || dev.subclass_id != 0x00) { continue; }
+
+			for (int barNum = 0; barNum < 6; barNum++) {
+
+				BaseAddressRegister bar = pci->GetBaseAddressRegister(bus, device, 0, barNum);
+
+				if (bar.address && bar.type == MemoryMapping) {
+
+					return bar.address;
+				}
+			}
+		}
+	}
+	return (uint8_t*)VBE_DISPI_LFB_PHYSICAL_ADDRESS;
+}
+
+
+
+bool BochsVBE::SetMode(uint32_t width, uint32_t height, uint32_t colordepth) {
+
+	if (!this->present) { return VideoGraphicsArray::SetMode(width, height, colordepth); }
+	if (!SupportsMode(width, height, colordepth)) { return false; }
+
+
+	WriteRegister(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+	WriteRegister(VBE_DISPI_INDEX_XRES, VBE_WIDTH);
+	WriteRegister(VBE_DISPI_INDEX_YRES, VBE_HEIGHT);
+	WriteRegister(VBE_DISPI_INDEX_BPP, VBE_BPP);
+	WriteRegister(VBE_DISPI_INDEX_VIRT_WIDTH, VBE_WIDTH);
+	WriteRegister(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED | VBE_DISPI_NOCLEARMEM);
+
+	//out of range values get ignored, so check what stuck
+	if (ReadRegister(VBE_DISPI_INDEX_XRES) != VBE_WIDTH
+	|| ReadRegister(VBE_DISPI_INDEX_YRES) != VBE_HEIGHT
+	|| ReadRegister(VBE_DISPI_INDEX_BPP) != VBE_BPP) {
+
+		WriteRegister(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+		this->present = false;
+		return VideoGraphicsArray::SetMode(width, height, colordepth);
+	}
+
+	this->screenWidth = VBE_WIDTH;
+	this->screenHeight = VBE_HEIGHT;
+	this->bytesPerPixel = VBE_BPP / 8;
+	this->pitch = this->screenWidth * this->bytesPerPixel;
+
+	//the virtual height is however many lines fit in vram
+	this->flipping = ReadRegister(VBE_DISPI_INDEX_VIRT_HEIGHT) >= 2 * this->screenHeight;
+	this->page = 0;
+
+	WriteRegister(VBE_DISPI_INDEX_X_OFFSET, 0);
+	WriteRegister(VBE_DISPI_INDEX_Y_OFFSET, 0);
+
+
+	this->scale = this->screenWidth / WIDTH_13H;
+	if (this->screenHeight / HEIGHT_13H < this->scale) { this->scale = this->screenHeight / HEIGHT_13H; }
+
+	this->originX = (this->screenWidth - (WIDTH_13H * this->scale)) / 2;
+	this->originY = (this->screenHeight - (HEIGHT_13H * this->scale)) / 2;
+
+
+	//black borders, on both pages
+	uint8_t* dst = this->linearFrameBuffer;
+
+	for (uint32_t row = 0; row < (this->flipping ? 2u : 1u) * this->screenHeight; row++) {
+
+		Span::Fill(dst, 0, this->pitch);
+		dst += this->pitch;
+	}
+
+	//8 bit modes still use the vga dac
+	this->active = true;
+	if (this->bytesPerPixel == 1) { this->colorPaletteMask.Write(0xff); }
+	this->LoadPalette();
+
+	this->InvalidatePages();
+	return true;
+}
+
+
+
+void BochsVBE::WriteColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+
+	//6 bits per channel same as the dac, stretched to 8
+	this->palette[index] = ((r & 0x3f) << 18) | ((g & 0x3f) << 10) | ((b & 0x3f) << 2);
+
+	if (this->active && this->bytesPerPixel == 4) {
+
+		//both pages hold the old color now
+		this->InvalidatePages();
+	} else {
+		VideoGraphicsArray::WriteColor(index, r, g, b);
+	}
+}
+
+
+void BochsVBE::InvalidatePages() {
+
+	this->frontValid = false;
+
+	for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+
+		this->lastLeft[y] = 0;
+		this->lastRight[y] = WIDTH_13H-1;
+	}
+}
+
+
+
+//scale one row of the front buffer into the line and copy
+//it out to however many rows of video memory it covers
+void BochsVBE::PresentRow(uint8_t* dst, uint16_t y, uint16_t left, uint16_t right) {
+
+	uint8_t* src = front+((y<<8)+(y<<6));
+	uint32_t offset = left * this->scale * this->bytesPerPixel;
+	uint32_t bytes = (right - left + 1) * this->scale * this->bytesPerPixel;
+
+	if (this->bytesPerPixel == 4) {
+
+		uint32_t* out = this->line + (left * this->scale);
+
+		for (uint16_t x = left; x <= right; x++) {
+
+			uint32_t color = this->palette[src[x]];
+			for (uint8_t s = 0; s < this->scale; s++) { *(out++) = color; }
+		}
+	} else {
+		uint8_t* out = (uint8_t*)this->line + (left * this->scale);
+
+		for (uint16_t x = left; x <= right; x++) {
+
+			for (uint8_t s = 0; s < this->scale; s++) { *(out++) = src[x]; }
+		}
+	}
+
+	for (uint8_t s = 0; s < this->scale; s++) {
+
+		Span::Copy(dst + offset, (uint8_t*)this->line + offset, bytes);
+		dst += this->pitch;
+	}
+}
+
+
+//draw into the page that isn't showing then flip to it
+void BochsVBE::DrawToScreen() {
+
+	if (!this->active) {
+
+		VideoGraphicsArray::DrawToScreen();
+		return;
+	}
+
+	uint8_t hidden = this->flipping ? (this->page ^ 1) : this->page;
+	uint8_t* base = this->linearFrameBuffer
+			+ ((hidden * this->screenHeight) + this->originY) * this->pitch
+			+ (this->originX * this->bytesPerPixel);
+
+	uint16_t left = 0;
+	uint16_t right = 0;
+
+	if (!frontValid) { this->MarkAllDirty(); }
+
+	for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+
+		int16_t drawLeft = WIDTH_13H;
+		int16_t drawRight = -1;
+
+		if (ChangedSpan(y, &left, &right)) {
+
+			drawLeft = left;
+			drawRight = right;
+		}
+
+		//the hidden page is a frame behind, catch it up on
+		//what changed last time as well as what changed now
+		if (this->flipping) {
+
+			int16_t newLeft = drawLeft;
+			int16_t newRight = drawRight;
+
+			if (this->lastLeft[y] < drawLeft) { drawLeft = this->lastLeft[y]; }
+			if (this->lastRight[y] > drawRight) { drawRight = this->lastRight[y]; }
+
+			this->lastLeft[y] = newLeft;
+			this->lastRight[y] = newRight;
+		}
+
+		if (drawRight < drawLeft) { continue; }
+
+		this->PresentRow(base + (y * this->scale * this->pitch), y, drawLeft, drawRight);
+	}
+	frontValid = true;
+	this->ClearDirty();
+
+	if (this->flipping) {
+
+		WriteRegister(VBE_DISPI_INDEX_Y_OFFSET, hidden * this->screenHeight);
+		this->page = hidden;
+	}
+}
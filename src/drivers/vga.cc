@@ -9,7 +9,6 @@ using namespace os::math;
 
 
 uint16_t strlen(char*);
-uint8_t Web2EGA(uint32_t webColor);
 
 
 VideoGraphicsArray::VideoGraphicsArray() :
@@ -32,7 +31,12 @@ VideoGraphicsArray::VideoGraphicsArray() :
 	attributeControllerWritePort(0x3c0),
 	attributeControllerResetPort(0x3da) {
 
+	frontValid = false;
+	dirtyRectCount = 0;
+	ClearDirty();
 
+	this->darkness = 0;
+	for (uint16_t c = 0; c < 256; c++) { this->shade[c] = c; }
 }
 
 
@@ -132,50 +136,85 @@ bool VideoGraphicsArray::SetMode(uint32_t width, uint32_t height, uint32_t color
 
 	this->FrameBufferSegment = GetFrameBufferSegment();
 
+	//vram is whatever the last mode left there
+	frontValid = false;
+
 	//pallete init
 	this->colorPaletteMask.Write(0xff);
+	this->LoadPalette();
+
+
+	return true;
+}
+
+void VideoGraphicsArray::PaletteUpdate(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+
+	this->colors[index][0] = r;
+	this->colors[index][1] = g;
+	this->colors[index][2] = b;
+
+	if (index < QUANT_COLORS) { ColorTable::stale = true; }
+
+	//every index darkened onto this one shows it too
+	for (uint16_t c = 0; c < 256; c++) {
+
+		if (this->shade[c] == index) { this->WriteColor(c, r, g, b); }
+	}
+}
+
+
+void VideoGraphicsArray::WriteColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+
+	this->colorRegisterWrite.Write(index);
 	
+	//color is in 18 bits with 6 bits for each channel
+	this->colorDataPort.Write(r); //Red
+	this->colorDataPort.Write(g); //Green
+	this->colorDataPort.Write(b); //Blue
+}
+
+
+void VideoGraphicsArray::LoadPalette() {
+
 	for (uint16_t color = 0; color < 256; color++) {
 	
-		this->colorRegisterWrite.Write(color);
-	
+		uint8_t* rgb = this->colors[color];
+
 		switch (color / 64) {	
 			
 			case 0:
-				this->colorDataPort.Write((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0));
-				this->colorDataPort.Write((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0));
-				this->colorDataPort.Write((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0));
+				rgb[0] = (color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0);
+				rgb[1] = (color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0);
+				rgb[2] = (color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0);
 				break;
 			case 1:
-				this->colorDataPort.Write((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0) >> 3);
-				this->colorDataPort.Write((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0) >> 3);
-				this->colorDataPort.Write((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0) >> 3);
+				rgb[0] = (color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0) >> 3;
+				rgb[1] = (color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0) >> 3;
+				rgb[2] = (color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0) >> 3;
 				break;
 			case 2:
-				this->colorDataPort.Write((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0) << 3);
-				this->colorDataPort.Write((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0) << 3);
-				this->colorDataPort.Write((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0) << 3);
+				rgb[0] = (color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0) << 3;
+				rgb[1] = (color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0) << 3;
+				rgb[2] = (color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0) << 3;
 				break;
 			default:
-				this->colorDataPort.Write(0);
-				this->colorDataPort.Write(0);
-				this->colorDataPort.Write(0);
+				rgb[0] = 0;
+				rgb[1] = 0;
+				rgb[2] = 0;
 				break;
 		}
 	}
+	this->WritePalette();
+}
 
 
-	return true;
-}
+void VideoGraphicsArray::WritePalette() {
 
-void VideoGraphicsArray::PaletteUpdate(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+	for (uint16_t c = 0; c < 256; c++) {
 
-	this->colorRegisterWrite.Write(index);
-	
-	//color is in 18 bits with 6 bits for each channel
-	this->colorDataPort.Write(r); //Red
-	this->colorDataPort.Write(g); //Green
-	this->colorDataPort.Write(b); //Blue
+		uint8_t* rgb = this->colors[this->shade[c]];
+		this->WriteColor(c, rgb[0], rgb[1], rgb[2]);
+	}
 }
 
 
@@ -197,11 +236,62 @@ uint8_t* VideoGraphicsArray::GetFrameBufferSegment() {
 
 
 
+//every primitive clips once up front and then
+//works on whole rows without checking again
+bool VideoGraphicsArray::ClipRect(int32_t* x, int32_t* y, int32_t* w, int32_t* h) {
+
+	if (*x < 0) { *w += *x; *x = 0; }
+	if (*y < 0) { *h += *y; *y = 0; }
+	if (*x + *w > WIDTH_13H) { *w = WIDTH_13H - *x; }
+	if (*y + *h > HEIGHT_13H) { *h = HEIGHT_13H - *y; }
+
+	return *w > 0 && *h > 0;
+}
+
+
+//grow the dirty rows to cover a rectangle
+void VideoGraphicsArray::MarkDirty(int32_t x, int32_t y, int32_t w, int32_t h) {
+
+	if (!ClipRect(&x, &y, &w, &h)) { return; }
+
+	for (int32_t Y = y; Y < y+h; Y++) {
+
+		if (x < dirtyLeft[Y]) { dirtyLeft[Y] = x; }
+		if (x+w-1 > dirtyRight[Y]) { dirtyRight[Y] = x+w-1; }
+	}
+}
+
+
+void VideoGraphicsArray::MarkAllDirty() {
+
+	for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+
+		dirtyLeft[y] = 0;
+		dirtyRight[y] = WIDTH_13H-1;
+	}
+}
+
+
+void VideoGraphicsArray::ClearDirty() {
+
+	for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+
+		dirtyLeft[y] = WIDTH_13H;
+		dirtyRight[y] = -1;
+	}
+}
+
+
+
 //place in backbuffer
 void VideoGraphicsArray::PutPixel(int32_t x, int32_t y, uint8_t color) {
 
 	if (x >= 0 && WIDTH_13H > x && y >= 0 && HEIGHT_13H > y) {
+
 		pixels[(y<<8)+(y<<6)+x] = color;
+
+		if (x < dirtyLeft[y]) { dirtyLeft[y] = x; }
+		if (x > dirtyRight[y]) { dirtyRight[y] = x; }
 	}
 }
 
@@ -214,6 +304,9 @@ void VideoGraphicsArray::PutPixelRaw(int32_t x, int32_t y, uint8_t colorIndex) {
 
 		uint8_t* pixelAddress = this->FrameBufferSegment+((y<<8) + (y<<6) + x);
 		*pixelAddress = colorIndex;
+
+		//keep the shadow copy honest
+		front[(y<<8)+(y<<6)+x] = colorIndex;
 	}
 }
 
@@ -224,6 +317,9 @@ void VideoGraphicsArray::DarkenPixel(int32_t x, int32_t y) {
 	if (x >= 0 && WIDTH_13H > x && y >= 0 && HEIGHT_13H > y) {
 	
 		pixels[(y<<8)+(y<<6)+x] = light2dark[pixels[(y<<8)+(y<<6)+x]];
+
+		if (x < dirtyLeft[y]) { dirtyLeft[y] = x; }
+		if (x > dirtyRight[y]) { dirtyRight[y] = x; }
 	}
 }
 
@@ -243,82 +339,101 @@ void VideoGraphicsArray::PutText(char* str, int32_t x, int32_t y, uint8_t color)
 
 	if ((WIDTH_13H - x) < (length * 5)) { return; }
 
-	uint8_t* charArr = charset[0];
-
-	for (int i = 0; str[i] != '\0'; i++) {
-	
-		charArr = charset[(uint8_t)(str[i])-32];
-
-		for (uint8_t w = 0; w < font_width; w++) {
-			for (uint8_t h = 0; h < font_height; h++) {
-			
-				if (charArr[w] && ((charArr[w] >> h) & 1)) {
-				
-					this->PutPixel(x+w, y+h, color);
-				}
-			}
-		}
-		x += font_width;
-	}
+	this->MarkDirty(x, y, length * font_width, font_height);
+	Glyphs::DrawString(pixels, WIDTH_13H, x, y, str, color, 0, 0, WIDTH_13H, HEIGHT_13H);
 }
 
 
 
-//draw from buffer
+//draw from buffer, buf is as wide as the screen
 void VideoGraphicsArray::FillBufferFull(int32_t x, int32_t y, 
 					int32_t w, int32_t h, uint8_t* buf) {
 
-	for (int32_t Y = y; Y < y+h; Y++) {
-		for (int32_t X = x; X < x+w; X++) {
-		
-			this->PutPixel(X, Y, buf[WIDTH_13H*(Y-y)+(X-x)]);
-		}
+	int32_t X = x;
+	int32_t Y = y;
+
+	if (!ClipRect(&X, &Y, &w, &h)) { return; }
+	this->MarkDirty(X, Y, w, h);
+
+	uint8_t* src = buf+(WIDTH_13H*(Y-y)+(X-x));
+	uint8_t* dst = pixels+((Y<<8)+(Y<<6)+X);
+
+	for (int32_t row = 0; row < h; row++) {
+
+		Span::Copy(dst, src, w);
+		src += WIDTH_13H;
+		dst += WIDTH_13H;
 	}
 }
 
 
+//sprite with color 0 as transparent
 void VideoGraphicsArray::FillBuffer(int16_t x, int16_t y, 
 				int16_t w, int16_t h, uint8_t* buf, bool mirror) {
 
-	uint8_t pixelColor = 0;
-	uint8_t scrollVert = 0;
-	bool scroll = false;
+	int32_t X = x;
+	int32_t Y = y;
+	int32_t W = w;
+	int32_t H = h;
+
+	if (!ClipRect(&X, &Y, &W, &H)) { return; }
+	this->MarkDirty(X, Y, W, H);
+
+	//mirrored rows start from the far end of the source row
+	uint8_t* src = buf+(w*(Y-y));
+	uint8_t* dst = pixels+((Y<<8)+(Y<<6)+X);
+
+	if (mirror) { src += w-1-(X-x);
+	} else {      src += X-x; }
 
-	if (y < 0) {
+	for (int32_t row = 0; row < H; row++) {
+
+		if (mirror) { Span::CopyMaskedMirror(dst, src, W);
+		} else {      Span::CopyMasked(dst, src, W); }
 		
-		if (y+h < 0) { return; }
-		scrollVert = (y * -1);
-		h -= (y * -1);
-		y = 0;
-		scroll = true;
+		src += w;
+		dst += WIDTH_13H;
 	}
+}
 
-	for (int16_t Y = y; Y < y+h; Y++) {
-		for (int16_t X = x; X < x+w; X++) {
-	
-			if (mirror) { pixelColor = buf[w*(Y-y+scrollVert)+(x+w-X-1)];
-			} else {      pixelColor = buf[w*(Y-y+scrollVert)+(X-x)]; }
-			
-			if (pixelColor) {
-			
-				this->PutPixel(X, Y, pixelColor);
-			}
-		}
+
+
+
+
+//encoded sprite, only the opaque runs get copied
+void VideoGraphicsArray::DrawSprite(int32_t x, int32_t y, Sprite* sprite, bool mirror) {
+
+	if (sprite->runs[mirror ? 1 : 0] == 0) {
+
+		this->FillBuffer(x, y, sprite->w, sprite->h, sprite->source, mirror);
+		return;
 	}
-}
 
+	int32_t X = x;
+	int32_t Y = y;
+	int32_t W = sprite->w;
+	int32_t H = sprite->h;
 
+	if (!ClipRect(&X, &Y, &W, &H)) { return; }
+	this->MarkDirty(X, Y, W, H);
+
+	sprite->Draw(pixels, x, y, mirror, 0, 0, WIDTH_13H, HEIGHT_13H);
+}
 
 
 
 void VideoGraphicsArray::FillRectangle(int32_t x, int32_t y, 
 		int32_t w, int32_t h, uint8_t color) {
 
-	for (int32_t Y = y; Y < y+h; Y++) {
-		for (int32_t X = x; X < x+w; X++) {
-			
-			this->PutPixel(X, Y, color);
-		}
+	if (!ClipRect(&x, &y, &w, &h)) { return; }
+	this->MarkDirty(x, y, w, h);
+
+	uint8_t* dst = pixels+((y<<8)+(y<<6)+x);
+
+	for (int32_t row = 0; row < h; row++) {
+		
+		Span::Fill(dst, color, w);
+		dst += WIDTH_13H;
 	}	
 }
 
@@ -326,18 +441,14 @@ void VideoGraphicsArray::FillRectangle(int32_t x, int32_t y,
 
 void VideoGraphicsArray::DrawRectangle(int32_t x, int32_t y, 
 		int32_t w, int32_t h, uint8_t color) {
-		
-	for (int32_t X = x; X < x+w; X++) {
-			
-		this->PutPixel(X, y,     color);
-		this->PutPixel(X, y+h-1, color);
-	}
+	
+	if (w <= 0 || h <= 0) { return; }
 
-	for (int32_t Y = y; Y < y+h; Y++) {
-			
-		this->PutPixel(x,     Y, color);
-		this->PutPixel(x+w-1, Y, color);
-	}	
+	//two rows and two one pixel wide columns
+	this->FillRectangle(x,     y,     w, 1, color);
+	this->FillRectangle(x,     y+h-1, w, 1, color);
+	this->FillRectangle(x,     y,     1, h, color);
+	this->FillRectangle(x+w-1, y,     1, h, color);
 }
 
 void VideoGraphicsArray::DrawLineFlat(int32_t x0, int32_t y0, 
@@ -345,15 +456,9 @@ void VideoGraphicsArray::DrawLineFlat(int32_t x0, int32_t y0,
 				uint8_t color,
 				bool x) {
 	if (x) {
-		for (int32_t X = x0; X < x1; X++) {
-			
-			this->PutPixel(X, y0, color);
-		}
+		this->FillRectangle(x0, y0, x1-x0, 1, color);
 	} else {
-		for (int32_t Y = y0; Y < y1; Y++) {
-			
-			this->PutPixel(x0, Y, color);
-		}
+		this->FillRectangle(x0, y0, 1, y1-y0, color);
 	}
 }
 
@@ -425,6 +530,19 @@ void VideoGraphicsArray::DrawLine(int32_t x0, int32_t y0,
 				int32_t x1, int32_t y1,
 				uint8_t color) {
 	
+	//straight lines are just spans, end pixel
+	//left out same as the bresenham loops do
+	if (y0 == y1) {
+	
+		this->FillRectangle(x0 < x1 ? x0 : x1, y0, abs(x1 - x0), 1, color);
+		return;
+	}
+	if (x0 == x1) {
+	
+		this->FillRectangle(x0, y0 < y1 ? y0 : y1, 1, abs(y1 - y0), color);
+		return;
+	}
+
 	if (abs(y1 - y0) < abs(x1 - x0)) {
 	
 		if (x0 > x1) {  DrawLineLow(x1, y1, x0, y0, color);
@@ -437,81 +555,48 @@ void VideoGraphicsArray::DrawLine(int32_t x0, int32_t y0,
 }
 
 
+//the edge walking is shared with the web driver
 void VideoGraphicsArray::FillPolygon(uint16_t x[], uint16_t y[], 
 				     uint8_t edgeNum, 
 				     uint8_t color) {
-	int16_t i, j, temp = 0;
-	uint16_t xmin = WIDTH_13H; 
-	uint16_t xmax = 0;
-
-	for (i = 0; i < edgeNum; i++) {
-	
-		if (x[i] < xmin) {
-			xmin = x[i];
-		}
-		if (x[i] > xmax) {
-			xmax = x[i];
-		}
-	}
-
-	for (i = xmin; i <= xmax; i++) {
-	
-		uint16_t interPoints[edgeNum];
-		uint16_t count = 0;
-
-		for (j = 0; j < edgeNum; j++) {
-		
-			uint16_t next = (j + 1) % edgeNum;
 
-			if ((y[j] > i && y[next] <= i) || (y[next] > i && y[j] <= i)) {
-			
-				interPoints[count++] = x[j] + (i - y[j]) 
-					* (x[next] - x[j]) / (y[next] - y[j]);
-			}
-		}	
+	int32_t left, top, right, bottom;
 
-		for (j = 0; j < count-1; j++) {
-			for (int k = 0; k < count-j-1; k++) {
-			
-				if (interPoints[k] > interPoints[k+1]) {
-				
-					temp = interPoints[k];
-					interPoints[k] = interPoints[k+1];
-					interPoints[k+1] = temp;
-				}
-			}
-		}
+	if (Polygon::Fill(this->pixels, x, y, edgeNum, color, &left, &top, &right, &bottom)) {
 
-		//draw line
-		for (j = 0; j < count; j += 2) {
-		
-			this->DrawLine(interPoints[j], i, interPoints[j+1], i, color);
-		}
+		this->MarkDirty(left, top, right - left, bottom - top);
 	}
 }
 
 
+//done through the palette, the back buffer is left alone
+//and a new level costs 256 color writes instead of a pass
+//over every pixel each frame
 void VideoGraphicsArray::MakeDark(uint8_t darkness) {
 
-	if (darkness > 0) {
+	if (darkness == this->darkness) { return; }
+	this->darkness = darkness;
+
+	for (uint16_t c = 0; c < 256; c++) {
+
+		uint8_t color = c;
 
-		for (uint8_t y = 0; y < HEIGHT_13H; y++) {
-			for (uint16_t x = 0; x < WIDTH_13H; x++) {
+		//colors past the table have no darker version
+		for (uint8_t i = 0; i < darkness && color < sizeof(light2dark); i++) {
 
-				//make pixel darker	
-				for (uint8_t i = 0; i < darkness; i++) {
-				
-					pixels[(y<<8)+(y<<6)+x] = light2dark[pixels[(y<<8)+(y<<6)+x]];
-				}
-			}
+			color = light2dark[color];
 		}
+		this->shade[c] = color;
 	}
+	this->WritePalette();
 }
 
 void VideoGraphicsArray::MakeWave(uint8_t waveLength) {
 
 	if (!waveLength) { return; }
 
+	this->MarkAllDirty();
+
 	uint16_t offset = waveLength;
 	bool incOrDec = true;
 
@@ -530,38 +615,72 @@ void VideoGraphicsArray::MakeWave(uint8_t waveLength) {
 }
 
 
-//actually draw to the screen
+//trim a dirty row down to the words that really differ
+//from what is shown and copy those into the front buffer,
+//rows are 320 bytes so every row starts word aligned
+bool VideoGraphicsArray::ChangedSpan(uint16_t y, uint16_t* left, uint16_t* right) {
+
+	if (dirtyRight[y] < dirtyLeft[y]) { return false; }
+
+	uint32_t* back = (uint32_t*)(pixels+((y<<8)+(y<<6)));
+	uint32_t* shown = (uint32_t*)(front+((y<<8)+(y<<6)));
+	
+	int16_t first = dirtyLeft[y] >> 2;
+	int16_t last = dirtyRight[y] >> 2;
+
+	if (frontValid) {
+
+		while (first <= last && back[first] == shown[first]) { first++; }
+		if (first > last) { return false; }
+		while (back[last] == shown[last]) { last--; }
+	}
+
+	for (int16_t i = first; i <= last; i++) { shown[i] = back[i]; }
+
+	*left = first << 2;
+	*right = (last << 2) + 3;
+	return true;
+}
+
+
+//actually draw to the screen, only the
+//parts that changed since the last frame
 void VideoGraphicsArray::DrawToScreen() {
 
+	uint16_t left = 0;
+	uint16_t right = 0;
+
+	if (!frontValid) { this->MarkAllDirty(); }
+
 	for (uint8_t y = 0; y < HEIGHT_13H; y++) {
-		for (uint16_t x = 0; x < WIDTH_13H; x++) {
 
-			uint8_t* pixelAddress = this->FrameBufferSegment+((y<<8) + (y<<6) + x);
-			*pixelAddress = pixels[(y<<8)+(y<<6)+x];
-		}
+		if (!ChangedSpan(y, &left, &right)) { continue; }
+
+		uint32_t* src = (uint32_t*)(front+((y<<8)+(y<<6)+left));
+		uint32_t* dst = (uint32_t*)(this->FrameBufferSegment+((y<<8)+(y<<6)+left));
+
+		for (uint16_t i = 0; i < ((right-left+1) >> 2); i++) { dst[i] = src[i]; }
 	}
+	frontValid = true;
+	this->ClearDirty();
 }
 
 
 
 void VideoGraphicsArray::FSdither(uint32_t* buf, uint16_t w, uint16_t h) {
 
-	uint8_t oldPixel = 0;
-	uint8_t newPixel = 0;
-	uint8_t quantError = 0;
+	if (ColorTable::stale) { ColorTable::Build(this->colors, VGA_COLOR_BITS); }
+	if (w > IMAGE_MAX_WIDTH) { return; }
+
+	uint8_t out[IMAGE_MAX_WIDTH];
+	ColorTable::DitherBegin(w);
 
 	for (uint16_t y = 0; y < h; y++) {
-		for (uint16_t x = 0; x < w; x++) {
-
-			oldPixel = buf[w*y+x];
-			newPixel = Web2EGA(oldPixel);
-			buf[w*y+x] = newPixel;
-			quantError = oldPixel - newPixel;
-			buf[w*(y)+(x+1)]   += quantError*7 / 16;
-			buf[w*(y+1)+(x-1)] += quantError*3 / 16;
-			buf[w*(y+1)+(x)]   += quantError*5 / 16;
-			buf[w*(y+1)+(x+1)] += quantError / 16;
-		}
+
+		uint32_t* row = buf + (w*y);
+		ColorTable::DitherRow(row, out);
+
+		for (uint16_t x = 0; x < w; x++) { row[x] = out[x]; }
 	}
 }
 
@@ -20,7 +20,6 @@ extern "C" {
 }
 
 uint16_t strlen(char*);
-uint8_t Web2EGA(uint32_t webColor);
 
 // EGA color palette (256 colors)
 static uint8_t ega_palette[256][3] = {0};
@@ -45,81 +44,65 @@ VideoGraphicsArray::VideoGraphicsArray() :
     FrameBufferSegment = pixels; // Use pixels array as framebuffer
     memset(pixels, 0, sizeof(pixels));
     
-    // Initialize default EGA palette - use the same calculation as the original VGA driver
-    // VGA hardware (and QEMU) writes 6-bit values (0-63) to colorDataPort (port 0x3C9)
-    // QEMU decodes these 6-bit values to 8-bit RGB by multiplying by 4:
-    //   - 6-bit value 0 → 8-bit RGB 0
-    //   - 6-bit value 21 (0x15) → 8-bit RGB 84
-    //   - 6-bit value 42 (0x2a) → 8-bit RGB 168
-    //   - 6-bit value 63 (max) → 8-bit RGB 252
-    // This matches standard VGA hardware behavior: value * 4
-    for (uint16_t color = 0; color < 256; color++) {
-        uint8_t r6 = 0, g6 = 0, b6 = 0; // 6-bit values (0-63)
-        uint8_t r = 0, g = 0, b = 0;    // 8-bit values (0-255)
-        
-        switch (color / 64) {
-            case 0:
-                r6 = (color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0);
-                g6 = (color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0);
-                b6 = (color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0);
-                // Scale 6-bit to 8-bit: multiply by 4
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
-                break;
-            case 1:
-                r6 = ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) >> 3;
-                g6 = ((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0)) >> 3;
-                b6 = ((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0)) >> 3;
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
-                break;
-            case 2:
-                r6 = ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) << 3;
-                g6 = ((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0)) << 3;
-                b6 = ((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0)) << 3;
-                // Clamp to 63 (6-bit max) before scaling
-                if (r6 > 63) r6 = 63;
-                if (g6 > 63) g6 = 63;
-                if (b6 > 63) b6 = 63;
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
-                break;
-            default:
-                r = g = b = 0;
-                break;
-        }
-        
-        // Store palette in RGB format: [Red, Green, Blue]
-        ega_palette[color][0] = r; // Red (0-255)
-        ega_palette[color][1] = g; // Green (0-255)
-        ega_palette[color][2] = b; // Blue (0-255)
-    }
+    frontValid = false;
+    dirtyRectCount = 0;
+    ClearDirty();
     
-    // Export palette to JavaScript - copy the actual calculated values
-    EM_ASM_({
-        if (!Module.ega_palette) {
-            Module.ega_palette = [];
-        }
-        // Export the C++ calculated palette values to JavaScript
-        // This ensures JavaScript uses the exact same palette as C++
-        var palettePtr = $0;
-        var heapU8 = (typeof HEAPU8 !== 'undefined') ? HEAPU8 : window.HEAPU8;
-        if (heapU8 && palettePtr) {
-            for (var i = 0; i < 256; i++) {
-                var offset = i * 3;
-                var r = heapU8[palettePtr + offset];
-                var g = heapU8[palettePtr + offset + 1];
-                var b = heapU8[palettePtr + offset + 2];
-                Module.ega_palette[i] = new Array(r, g, b);
+    darkness = 0;
+    for (uint16_t c = 0; c < 256; c++) { shade[c] = c; }
+    
+    LoadPalette();
+    
+    // Present only the changed rectangles of the front buffer. The ImageData
+    // and a packed RGBA copy of the palette are kept between frames, the
+    // palette copy is dropped whenever SetMode or PaletteUpdate changes it
+    EM_ASM({
+        Module.presentRects = function(frontPtr, rectsPtr, count) {
+            var canvas = document.getElementById('osaka-canvas');
+            if (!canvas) {
+                return;
             }
-            console.log('[C] Exported C++ palette to JavaScript. Color 0:', Module.ega_palette[0]);
-        } else {
-            console.error('[C] Could not export palette - heapU8 or palettePtr not available');
-        }
-    }, (uintptr_t)ega_palette);
+            if (!Module._vgaImage || Module._vgaCanvas !== canvas) {
+                Module._vgaCanvas = canvas;
+                Module._vgaContext = canvas.getContext('2d');
+                Module._vgaImage = Module._vgaContext.createImageData(320, 200);
+                Module._vgaWords = new Uint32Array(Module._vgaImage.data.buffer);
+            }
+            if (!Module._vgaPalette) {
+                var palette = new Uint32Array(256);
+                for (var i = 0; i < 256; i++) {
+                    var color = Module.ega_palette ? Module.ega_palette[i] : null;
+                    var r = color ? color[0] : (i & 0xE0);
+                    var g = color ? color[1] : ((i & 0x1C) << 3);
+                    var b = color ? color[2] : ((i & 0x03) << 6);
+                    // ImageData is RGBA in memory, little endian word is ABGR
+                    palette[i] = (0xFF000000 | (b << 16) | (g << 8) | r) >>> 0;
+                }
+                Module._vgaPalette = palette;
+            }
+            var heapU8 = (typeof HEAPU8 !== 'undefined') ? HEAPU8 : window.HEAPU8;
+            var words = Module._vgaWords;
+            var lut = Module._vgaPalette;
+            for (var n = 0; n < count; n++) {
+                var rect = rectsPtr + n * 8;
+                var x = heapU8[rect] | (heapU8[rect + 1] << 8);
+                var y = heapU8[rect + 2] | (heapU8[rect + 3] << 8);
+                var w = heapU8[rect + 4] | (heapU8[rect + 5] << 8);
+                var h = heapU8[rect + 6] | (heapU8[rect + 7] << 8);
+                for (var row = y; row < y + h; row++) {
+                    var index = row * 320 + x;
+                    var end = index + w;
+                    for (; index < end; index++) {
+                        words[index] = lut[heapU8[frontPtr + index]];
+                    }
+                }
+                Module._vgaContext.putImageData(Module._vgaImage, 0, 0, x, y, w, h);
+            }
+            if (canvas.style.display !== 'block' && Module.switchToGraphicsMode) {
+                Module.switchToGraphicsMode();
+            }
+        };
+    });
 }
 
 VideoGraphicsArray::~VideoGraphicsArray() {
@@ -142,36 +125,63 @@ bool VideoGraphicsArray::SetMode(uint32_t width, uint32_t height, uint32_t color
     FrameBufferSegment = pixels;
     memset(pixels, 0, sizeof(pixels));
     
-    // Initialize palette - copy exact logic from native VGA driver
-    // This matches the native driver's SetMode palette initialization
-    // The native driver writes 6-bit values to colorDataPort.Write()
-    // QEMU decodes these by multiplying by 4 to get 8-bit RGB values
+    LoadPalette();
+    
+    // Every pixel may map to a new color now
+    frontValid = false;
+    
+    return true;
+}
+
+void VideoGraphicsArray::PaletteUpdate(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+    colors[index][0] = r;
+    colors[index][1] = g;
+    colors[index][2] = b;
+    
+    if (index < QUANT_COLORS) { ColorTable::stale = true; }
+    
+    // Every index darkened onto this one shows it too
+    for (uint16_t c = 0; c < 256; c++) {
+        if (shade[c] == index) { WriteColor(c, r, g, b); }
+    }
+}
+
+void VideoGraphicsArray::WriteColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+    ega_palette[index][0] = r;
+    ega_palette[index][1] = g;
+    ega_palette[index][2] = b;
+    
+    // Update JavaScript palette when individual colors are changed
+    EM_ASM_({
+        if (Module.ega_palette && Module.ega_palette[$0] !== undefined) {
+            Module.ega_palette[$0] = new Array($1, $2, $3);
+        }
+        Module._vgaPalette = null;
+    }, index, r, g, b);
+    
+    // The canvas holds converted colors, repaint everything next frame
+    frontValid = false;
+}
+
+// Default EGA palette, the same calculation as the native VGA driver.
+// VGA hardware (and QEMU) takes 6-bit values (0-63) and scales them
+// to 8-bit RGB by multiplying by 4, the canvas gets the 8-bit values
+void VideoGraphicsArray::LoadPalette() {
     for (uint16_t color = 0; color < 256; color++) {
-        uint8_t r6 = 0, g6 = 0, b6 = 0; // 6-bit values (0-63) - what VGA hardware expects
-        uint8_t r = 0, g = 0, b = 0;    // 8-bit values (0-255) - for web canvas
+        uint8_t r6 = 0, g6 = 0, b6 = 0;
         
         switch (color / 64) {
             case 0:
-                // Native driver writes these 6-bit values directly to colorDataPort
                 r6 = (color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0);
                 g6 = (color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0);
                 b6 = (color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0);
-                // Scale 6-bit to 8-bit: multiply by 4
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
                 break;
             case 1:
-                // Native driver: ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) >> 3
                 r6 = ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) >> 3;
                 g6 = ((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0)) >> 3;
                 b6 = ((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0)) >> 3;
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
                 break;
             case 2:
-                // Native driver: ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) << 3
                 r6 = ((color & 0x20 ? 0x15 : 0) | (color & 0x04 ? 0x2a : 0)) << 3;
                 g6 = ((color & 0x10 ? 0x15 : 0) | (color & 0x02 ? 0x2a : 0)) << 3;
                 b6 = ((color & 0x08 ? 0x15 : 0) | (color & 0x01 ? 0x2a : 0)) << 3;
@@ -179,63 +189,86 @@ bool VideoGraphicsArray::SetMode(uint32_t width, uint32_t height, uint32_t color
                 if (r6 > 63) r6 = 63;
                 if (g6 > 63) g6 = 63;
                 if (b6 > 63) b6 = 63;
-                r = r6 * 4;
-                g = g6 * 4;
-                b = b6 * 4;
                 break;
             default:
-                // Native driver writes 0, 0, 0
-                r = g = b = 0;
                 break;
         }
         
         // Store palette in RGB format: [Red, Green, Blue]
-        ega_palette[color][0] = r; // Red (0-255)
-        ega_palette[color][1] = g; // Green (0-255)
-        ega_palette[color][2] = b; // Blue (0-255)
+        colors[color][0] = r6 * 4;
+        colors[color][1] = g6 * 4;
+        colors[color][2] = b6 * 4;
+    }
+    WritePalette();
+}
+
+// Every index through shade, handed to JavaScript in one go
+void VideoGraphicsArray::WritePalette() {
+    for (uint16_t c = 0; c < 256; c++) {
+        ega_palette[c][0] = colors[shade[c]][0];
+        ega_palette[c][1] = colors[shade[c]][1];
+        ega_palette[c][2] = colors[shade[c]][2];
     }
     
-    // Export updated palette to JavaScript after SetMode
     EM_ASM_({
-        var palettePtr = $0;
+        if (!Module.ega_palette) {
+            Module.ega_palette = [];
+        }
         var heapU8 = (typeof HEAPU8 !== 'undefined') ? HEAPU8 : window.HEAPU8;
-        if (heapU8 && palettePtr && Module.ega_palette) {
-            for (var i = 0; i < 256; i++) {
-                var offset = i * 3;
-                var r = heapU8[palettePtr + offset];
-                var g = heapU8[palettePtr + offset + 1];
-                var b = heapU8[palettePtr + offset + 2];
-                Module.ega_palette[i] = new Array(r, g, b);
-            }
-            console.log('[C] Updated JavaScript palette after SetMode. Color 0:', Module.ega_palette[0]);
+        for (var i = 0; i < 256; i++) {
+            var offset = $0 + i * 3;
+            Module.ega_palette[i] = new Array(heapU8[offset], heapU8[offset + 1], heapU8[offset + 2]);
         }
+        Module._vgaPalette = null;
     }, (uintptr_t)ega_palette);
     
-    return true;
+    frontValid = false;
 }
 
-void VideoGraphicsArray::PaletteUpdate(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
-    if (index < 256) {
-        ega_palette[index][0] = r;
-        ega_palette[index][1] = g;
-        ega_palette[index][2] = b;
-        
-        // Update JavaScript palette when individual colors are changed
-        EM_ASM_({
-            if (Module.ega_palette && Module.ega_palette[$0] !== undefined) {
-                Module.ega_palette[$0] = new Array($1, $2, $3);
-            }
-        }, index, r, g, b);
+uint8_t* VideoGraphicsArray::GetFrameBufferSegment() {
+    return pixels;
+}
+
+// Every primitive clips once up front and then works on whole rows
+bool VideoGraphicsArray::ClipRect(int32_t* x, int32_t* y, int32_t* w, int32_t* h) {
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > WIDTH_13H) { *w = WIDTH_13H - *x; }
+    if (*y + *h > HEIGHT_13H) { *h = HEIGHT_13H - *y; }
+    
+    return *w > 0 && *h > 0;
+}
+
+// Grow the dirty rows to cover a rectangle
+void VideoGraphicsArray::MarkDirty(int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (!ClipRect(&x, &y, &w, &h)) { return; }
+    
+    for (int32_t Y = y; Y < y+h; Y++) {
+        if (x < dirtyLeft[Y]) { dirtyLeft[Y] = x; }
+        if (x+w-1 > dirtyRight[Y]) { dirtyRight[Y] = x+w-1; }
     }
 }
 
-uint8_t* VideoGraphicsArray::GetFrameBufferSegment() {
-    return pixels;
+void VideoGraphicsArray::MarkAllDirty() {
+    for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+        dirtyLeft[y] = 0;
+        dirtyRight[y] = WIDTH_13H-1;
+    }
+}
+
+void VideoGraphicsArray::ClearDirty() {
+    for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+        dirtyLeft[y] = WIDTH_13H;
+        dirtyRight[y] = -1;
+    }
 }
 
 void VideoGraphicsArray::PutPixel(int32_t x, int32_t y, uint8_t color) {
     if (x >= 0 && WIDTH_13H > x && y >= 0 && HEIGHT_13H > y) {
         pixels[(y<<8)+(y<<6)+x] = color;
+        
+        if (x < dirtyLeft[y]) { dirtyLeft[y] = x; }
+        if (x > dirtyRight[y]) { dirtyRight[y] = x; }
     }
 }
 
@@ -246,6 +279,9 @@ void VideoGraphicsArray::PutPixelRaw(int32_t x, int32_t y, uint8_t colorIndex) {
 void VideoGraphicsArray::DarkenPixel(int32_t x, int32_t y) {
     if (x >= 0 && WIDTH_13H > x && y >= 0 && HEIGHT_13H > y) {
         pixels[(y<<8)+(y<<6)+x] = light2dark[pixels[(y<<8)+(y<<6)+x]];
+        
+        if (x < dirtyLeft[y]) { dirtyLeft[y] = x; }
+        if (x > dirtyRight[y]) { dirtyRight[y] = x; }
     }
 }
 
@@ -259,80 +295,101 @@ void VideoGraphicsArray::PutText(char* str, int32_t x, int32_t y, uint8_t color)
     
     if ((WIDTH_13H - x) < (length * 5)) { return; }
     
-    uint8_t* charArr = charset[0];
-    
-    for (int i = 0; str[i] != '\0'; i++) {
-        charArr = charset[(uint8_t)(str[i])-32];
-        
-        for (uint8_t w = 0; w < font_width; w++) {
-            for (uint8_t h = 0; h < font_height; h++) {
-                if (charArr[w] && ((charArr[w] >> h) & 1)) {
-                    this->PutPixel(x+w, y+h, color);
-                }
-            }
-        }
-        x += font_width;
-    }
+    this->MarkDirty(x, y, length * font_width, font_height);
+    Glyphs::DrawString(pixels, WIDTH_13H, x, y, str, color, 0, 0, WIDTH_13H, HEIGHT_13H);
 }
 
+// buf is as wide as the screen
 void VideoGraphicsArray::FillBufferFull(int32_t x, int32_t y, 
                     int32_t w, int32_t h, uint8_t* buf) {
-    for (int32_t Y = y; Y < y+h; Y++) {
-        for (int32_t X = x; X < x+w; X++) {
-            this->PutPixel(X, Y, buf[WIDTH_13H*(Y-y)+(X-x)]);
-        }
+    int32_t X = x;
+    int32_t Y = y;
+    
+    if (!ClipRect(&X, &Y, &w, &h)) { return; }
+    this->MarkDirty(X, Y, w, h);
+    
+    uint8_t* src = buf+(WIDTH_13H*(Y-y)+(X-x));
+    uint8_t* dst = pixels+((Y<<8)+(Y<<6)+X);
+    
+    for (int32_t row = 0; row < h; row++) {
+        Span::Copy(dst, src, w);
+        src += WIDTH_13H;
+        dst += WIDTH_13H;
     }
 }
 
+// Sprite with color 0 as transparent
 void VideoGraphicsArray::FillBuffer(int16_t x, int16_t y, 
                 int16_t w, int16_t h, uint8_t* buf, bool mirror) {
-    uint8_t pixelColor = 0;
-    uint8_t scrollVert = 0;
-    bool scroll = false;
-    
-    if (y < 0) {
-        if (y+h < 0) { return; }
-        scrollVert = (y * -1);
-        h -= (y * -1);
-        y = 0;
-        scroll = true;
+    int32_t X = x;
+    int32_t Y = y;
+    int32_t W = w;
+    int32_t H = h;
+    
+    if (!ClipRect(&X, &Y, &W, &H)) { return; }
+    this->MarkDirty(X, Y, W, H);
+    
+    // Mirrored rows start from the far end of the source row
+    uint8_t* src = buf+(w*(Y-y));
+    uint8_t* dst = pixels+((Y<<8)+(Y<<6)+X);
+    
+    if (mirror) { 
+        src += w-1-(X-x);
+    } else { 
+        src += X-x; 
     }
     
-    for (int16_t Y = y; Y < y+h; Y++) {
-        for (int16_t X = x; X < x+w; X++) {
-            if (mirror) { 
-                pixelColor = buf[w*(Y-y+scrollVert)+(x+w-X-1)];
-            } else { 
-                pixelColor = buf[w*(Y-y+scrollVert)+(X-x)]; 
-            }
-            
-            if (pixelColor) {
-                this->PutPixel(X, Y, pixelColor);
-            }
+    for (int32_t row = 0; row < H; row++) {
+        if (mirror) { 
+            Span::CopyMaskedMirror(dst, src, W);
+        } else { 
+            Span::CopyMasked(dst, src, W); 
         }
+        src += w;
+        dst += WIDTH_13H;
     }
 }
 
+// Encoded sprite, only the opaque runs get copied
+void VideoGraphicsArray::DrawSprite(int32_t x, int32_t y, Sprite* sprite, bool mirror) {
+    if (sprite->runs[mirror ? 1 : 0] == 0) {
+        this->FillBuffer(x, y, sprite->w, sprite->h, sprite->source, mirror);
+        return;
+    }
+    
+    int32_t X = x;
+    int32_t Y = y;
+    int32_t W = sprite->w;
+    int32_t H = sprite->h;
+    
+    if (!ClipRect(&X, &Y, &W, &H)) { return; }
+    this->MarkDirty(X, Y, W, H);
+    
+    sprite->Draw(pixels, x, y, mirror, 0, 0, WIDTH_13H, HEIGHT_13H);
+}
+
 void VideoGraphicsArray::FillRectangle(int32_t x, int32_t y, 
         int32_t w, int32_t h, uint8_t color) {
-    for (int32_t Y = y; Y < y+h; Y++) {
-        for (int32_t X = x; X < x+w; X++) {
-            this->PutPixel(X, Y, color);
-        }
+    if (!ClipRect(&x, &y, &w, &h)) { return; }
+    this->MarkDirty(x, y, w, h);
+    
+    uint8_t* dst = pixels+((y<<8)+(y<<6)+x);
+    
+    for (int32_t row = 0; row < h; row++) {
+        Span::Fill(dst, color, w);
+        dst += WIDTH_13H;
     }
 }
 
 void VideoGraphicsArray::DrawRectangle(int32_t x, int32_t y, 
         int32_t w, int32_t h, uint8_t color) {
-    for (int32_t X = x; X < x+w; X++) {
-        this->PutPixel(X, y,     color);
-        this->PutPixel(X, y+h-1, color);
-    }
+    if (w <= 0 || h <= 0) { return; }
     
-    for (int32_t Y = y; Y < y+h; Y++) {
-        this->PutPixel(x,     Y, color);
-        this->PutPixel(x+w-1, Y, color);
-    }
+    // Two rows and two one pixel wide columns
+    this->FillRectangle(x,     y,     w, 1, color);
+    this->FillRectangle(x,     y+h-1, w, 1, color);
+    this->FillRectangle(x,     y,     1, h, color);
+    this->FillRectangle(x+w-1, y,     1, h, color);
 }
 
 void VideoGraphicsArray::DrawLineFlat(int32_t x0, int32_t y0, 
@@ -340,13 +397,9 @@ void VideoGraphicsArray::DrawLineFlat(int32_t x0, int32_t y0,
                 uint8_t color,
                 bool x) {
     if (x) {
-        for (int32_t X = x0; X < x1; X++) {
-            this->PutPixel(X, y0, color);
-        }
+        this->FillRectangle(x0, y0, x1-x0, 1, color);
     } else {
-        for (int32_t Y = y0; Y < y1; Y++) {
-            this->PutPixel(x0, Y, color);
-        }
+        this->FillRectangle(x0, y0, 1, y1-y0, color);
     }
 }
 
@@ -405,6 +458,17 @@ void VideoGraphicsArray::DrawLineHigh(int32_t x0, int32_t y0,
 void VideoGraphicsArray::DrawLine(int32_t x0, int32_t y0, 
                 int32_t x1, int32_t y1,
                 uint8_t color) {
+    // Straight lines are just spans, end pixel left out
+    // same as the bresenham loops do
+    if (y0 == y1) {
+        this->FillRectangle(x0 < x1 ? x0 : x1, y0, ::abs(x1 - x0), 1, color);
+        return;
+    }
+    if (x0 == x1) {
+        this->FillRectangle(x0, y0 < y1 ? y0 : y1, 1, ::abs(y1 - y0), color);
+        return;
+    }
+    
     if (::abs(y1 - y0) < ::abs(x1 - x0)) {
         if (x0 > x1) {  
             DrawLineLow(x1, y1, x0, y0, color);
@@ -420,66 +484,40 @@ void VideoGraphicsArray::DrawLine(int32_t x0, int32_t y0,
     }
 }
 
+// Same edge walking as the native driver
 void VideoGraphicsArray::FillPolygon(uint16_t x[], uint16_t y[], 
                      uint8_t edgeNum, 
                      uint8_t color) {
-    int16_t i, j, temp = 0;
-    uint16_t xmin = WIDTH_13H; 
-    uint16_t xmax = 0;
+    int32_t left, top, right, bottom;
     
-    for (i = 0; i < edgeNum; i++) {
-        if (x[i] < xmin) {
-            xmin = x[i];
-        }
-        if (x[i] > xmax) {
-            xmax = x[i];
-        }
-    }
-    
-    for (i = xmin; i <= xmax; i++) {
-        uint16_t interPoints[edgeNum];
-        uint16_t count = 0;
-        
-        for (j = 0; j < edgeNum; j++) {
-            uint16_t next = (j + 1) % edgeNum;
-            
-            if ((y[j] > i && y[next] <= i) || (y[next] > i && y[j] <= i)) {
-                interPoints[count++] = x[j] + (i - y[j]) 
-                    * (x[next] - x[j]) / (y[next] - y[j]);
-            }
-        }
-        
-        for (j = 0; j < count-1; j++) {
-            for (int k = 0; k < count-j-1; k++) {
-                if (interPoints[k] > interPoints[k+1]) {
-                    temp = interPoints[k];
-                    interPoints[k] = interPoints[k+1];
-                    interPoints[k+1] = temp;
-                }
-            }
-        }
-        
-        for (j = 0; j < count; j += 2) {
-            this->DrawLine(interPoints[j], i, interPoints[j+1], i, color);
-        }
+    if (Polygon::Fill(this->pixels, x, y, edgeNum, color, &left, &top, &right, &bottom)) {
+        this->MarkDirty(left, top, right - left, bottom - top);
     }
 }
 
+// Done through the palette, the canvas lookup table gets rebuilt
+// once per level instead of every pixel being darkened each frame
 void VideoGraphicsArray::MakeDark(uint8_t darkness) {
-    if (darkness > 0) {
-        for (uint8_t y = 0; y < HEIGHT_13H; y++) {
-            for (uint16_t x = 0; x < WIDTH_13H; x++) {
-                for (uint8_t i = 0; i < darkness; i++) {
-                    pixels[(y<<8)+(y<<6)+x] = light2dark[pixels[(y<<8)+(y<<6)+x]];
-                }
-            }
+    if (darkness == this->darkness) { return; }
+    this->darkness = darkness;
+    
+    for (uint16_t c = 0; c < 256; c++) {
+        uint8_t color = c;
+        
+        // Colors past the table have no darker version
+        for (uint8_t i = 0; i < darkness && color < sizeof(light2dark); i++) {
+            color = light2dark[color];
         }
+        shade[c] = color;
     }
+    WritePalette();
 }
 
 void VideoGraphicsArray::MakeWave(uint8_t waveLength) {
     if (!waveLength) { return; }
     
+    this->MarkAllDirty();
+    
     uint16_t offset = waveLength;
     bool incOrDec = true;
     
@@ -496,38 +534,88 @@ void VideoGraphicsArray::MakeWave(uint8_t waveLength) {
     }
 }
 
-// Draw to canvas via JavaScript
+// Trim a dirty row down to the words that really differ from what
+// the canvas shows and copy those into the front buffer
+bool VideoGraphicsArray::ChangedSpan(uint16_t y, uint16_t* left, uint16_t* right) {
+    if (dirtyRight[y] < dirtyLeft[y]) { return false; }
+    
+    // Rows are 320 bytes so every row starts word aligned
+    uint32_t* back = (uint32_t*)(pixels+((y<<8)+(y<<6)));
+    uint32_t* shown = (uint32_t*)(front+((y<<8)+(y<<6)));
+    
+    int16_t first = dirtyLeft[y] >> 2;
+    int16_t last = dirtyRight[y] >> 2;
+    
+    if (frontValid) {
+        while (first <= last && back[first] == shown[first]) { first++; }
+        if (first > last) { return false; }
+        while (back[last] == shown[last]) { last--; }
+    }
+    
+    for (int16_t i = first; i <= last; i++) { shown[i] = back[i]; }
+    
+    *left = first << 2;
+    *right = (last << 2) + 3;
+    return true;
+}
+
+// Draw to canvas via JavaScript, only the rectangles that changed
 void VideoGraphicsArray::DrawToScreen() {
-    // Call JavaScript function defined in HTML
-    // Cast pixels pointer to unsigned int to avoid validation
-    unsigned int pixelsPtr = reinterpret_cast<unsigned int>(pixels);
-    EM_ASM_INT({
-        var ptr = $0;
-        if (Module.renderPixels) {
-            Module.renderPixels(ptr);
+    uint16_t left = 0;
+    uint16_t right = 0;
+    
+    if (!frontValid) { this->MarkAllDirty(); }
+    
+    // Changed spans on touching rows become one rectangle, once the
+    // list is full the last rectangle keeps growing to cover the rest
+    dirtyRectCount = 0;
+    for (uint8_t y = 0; y < HEIGHT_13H; y++) {
+        if (!ChangedSpan(y, &left, &right)) { continue; }
+        
+        VGARect* rect = &dirtyRects[dirtyRectCount > 0 ? dirtyRectCount-1 : 0];
+        
+        if (dirtyRectCount > 0 && (dirtyRectCount == VGA_DIRTY_RECTS || rect->y + rect->h == y)) {
+            uint16_t rectRight = rect->x + rect->w - 1;
+            
+            if (left < rect->x) { rect->x = left; }
+            if (right > rectRight) { rectRight = right; }
+            
+            rect->w = rectRight - rect->x + 1;
+            rect->h = y - rect->y + 1;
+        } else {
+            rect = &dirtyRects[dirtyRectCount++];
+            rect->x = left;
+            rect->y = y;
+            rect->w = right - left + 1;
+            rect->h = 1;
+        }
+    }
+    frontValid = true;
+    this->ClearDirty();
+    
+    if (dirtyRectCount == 0) { return; }
+    
+    EM_ASM_({
+        if (Module.presentRects) {
+            Module.presentRects($0, $1, $2);
         } else {
-            console.error('[VGA] Module.renderPixels not found!');
+            console.error('[VGA] Module.presentRects not found!');
         }
-        return 0;
-    }, pixelsPtr);
+    }, (uintptr_t)front, (uintptr_t)dirtyRects, dirtyRectCount);
 }
 
 void VideoGraphicsArray::FSdither(uint32_t* buf, uint16_t w, uint16_t h) {
-    uint8_t oldPixel = 0;
-    uint8_t newPixel = 0;
-    uint8_t quantError = 0;
+    if (ColorTable::stale) { ColorTable::Build(this->colors, VGA_COLOR_BITS); }
+    if (w > IMAGE_MAX_WIDTH) { return; }
+    
+    uint8_t out[IMAGE_MAX_WIDTH];
+    ColorTable::DitherBegin(w);
     
     for (uint16_t y = 0; y < h; y++) {
-        for (uint16_t x = 0; x < w; x++) {
-            oldPixel = buf[w*y+x];
-            newPixel = Web2EGA(oldPixel);
-            buf[w*y+x] = newPixel;
-            quantError = oldPixel - newPixel;
-            buf[w*(y)+(x+1)]   += quantError*7 / 16;
-            buf[w*(y+1)+(x-1)] += quantError*3 / 16;
-            buf[w*(y+1)+(x)]   += quantError*5 / 16;
-            buf[w*(y+1)+(x+1)] += quantError / 16;
-        }
+        uint32_t* row = buf + (w*y);
+        ColorTable::DitherRow(row, out);
+        
+        for (uint16_t x = 0; x < w; x++) { row[x] = out[x]; }
     }
 }
 
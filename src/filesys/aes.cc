@@ -0,0 +1,285 @@
+#include <filesys/aes.h>
+
+using namespace os;
+using namespace os::common;
+using namespace os::filesystem;
+
+
+static const uint8_t sbox[256] = {
+
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const uint8_t rcon[AES_ROUNDS] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+
+//subbytes + mixcolumns for one byte, other
+//three column positions are rotations of it
+static uint32_t te0[256];
+static bool tablesReady = false;
+
+//cpuid and the control register writes only happen once
+static bool hardwareChecked = false;
+static bool hardwareAvailable = false;
+
+
+static uint8_t XTime(uint8_t x) {
+
+	return (x << 1) ^ ((x & 0x80) ? 0x1b : 0x00);
+}
+
+
+static uint32_t Rotr(uint32_t x, uint8_t n) {
+
+	return (x >> n) | (x << (32 - n));
+}
+
+
+static uint32_t Load32(uint8_t* p) {
+
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+static void Store32(uint8_t* p, uint32_t x) {
+
+	p[0] = x >> 24;
+	p[1] = (x >> 16) & 0xff;
+	p[2] = (x >> 8) & 0xff;
+	p[3] = x & 0xff;
+}
+
+
+static void BuildTables() {
+
+	for (int i = 0; i < 256; i++) {
+
+		uint8_t s = sbox[i];
+		uint8_t s2 = XTime(s);
+
+		te0[i] = (s2 << 24) | (s << 16) | (s << 8) | (s2 ^ s);
+	}
+	tablesReady = true;
+}
+
+
+
+AES128::AES128() {
+
+	if (!tablesReady) { BuildTables(); }
+
+	if (!hardwareChecked) {
+
+		hardwareAvailable = HardwareSupport();
+		hardwareChecked = true;
+	}
+	this->hardware = hardwareAvailable;
+}
+
+AES128::~AES128() {
+}
+
+
+
+//cpuid leaf 1, ecx bit 25 is aes-ni. the cpu might be
+//too old for cpuid at all so check eflags.id first
+bool AES128::HardwareSupport() {
+
+#if defined(__i386__) && !defined(__EMSCRIPTEN__)
+	uint32_t before = 0;
+	uint32_t after = 0;
+
+	asm volatile("pushfl\n"
+		     "popl %0\n"
+		     "movl %0, %1\n"
+		     "xorl $0x200000, %1\n"
+		     "pushl %1\n"
+		     "popfl\n"
+		     "pushfl\n"
+		     "popl %1\n"
+		     "pushl %0\n"
+		     "popfl\n"
+		     : "=&r"(before), "=&r"(after));
+
+	if (((before ^ after) & 0x200000) == 0) { return false; }
+
+
+	uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+	if (eax < 1) { return false; }
+
+	asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+
+	//needs fxsr and sse too so cr4 can turn xmm registers on
+	if ((ecx & (1 << 25)) == 0 || (edx & (1 << 24)) == 0 || (edx & (1 << 25)) == 0) { return false; }
+
+
+	//cr0: clear em, set mp. cr4: osfxsr + osxmmexcpt
+	uint32_t cr = 0;
+
+	asm volatile("movl %%cr0, %0" : "=r"(cr));
+	cr = (cr & ~(1 << 2)) | (1 << 1);
+	asm volatile("movl %0, %%cr0" : : "r"(cr));
+
+	asm volatile("movl %%cr4, %0" : "=r"(cr));
+	cr |= (1 << 9) | (1 << 10);
+	asm volatile("movl %0, %%cr4" : : "r"(cr));
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+
+void AES128::SetKey(uint8_t key[16]) {
+
+	for (int i = 0; i < 16; i++) { this->roundKeys[i] = key[i]; }
+
+	for (int i = 4; i < (AES_ROUNDS + 1) * 4; i++) {
+
+		uint8_t* prev = &this->roundKeys[(i - 1) * 4];
+		uint8_t* word = &this->roundKeys[i * 4];
+		uint8_t temp[4] = { prev[0], prev[1], prev[2], prev[3] };
+
+		//rotword + subword + rcon every 4th word
+		if (i % 4 == 0) {
+
+			uint8_t first = temp[0];
+			temp[0] = sbox[temp[1]] ^ rcon[(i / 4) - 1];
+			temp[1] = sbox[temp[2]];
+			temp[2] = sbox[temp[3]];
+			temp[3] = sbox[first];
+		}
+
+		for (int j = 0; j < 4; j++) { word[j] = this->roundKeys[((i - 4) * 4) + j] ^ temp[j]; }
+	}
+}
+
+
+
+#if defined(__i386__) && !defined(__EMSCRIPTEN__)
+//built for sse on its own so the xmm registers can be named as
+//clobbered, the rest of the file stays plain i386 code
+__attribute__((target("sse2,aes")))
+static void EncryptBlockNI(uint8_t* roundKeys, uint8_t in[16], uint8_t out[16]) {
+
+	//xmm state isn't saved on task switch,
+	//so no interrupts while it's in use
+	asm volatile("pushfl\n"
+		     "cli\n"
+		     "movdqu (%0), %%xmm0\n"
+		     "movdqu (%1), %%xmm1\n"
+		     "pxor %%xmm1, %%xmm0\n"
+		     "movdqu 16(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 32(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 48(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 64(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 80(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 96(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 112(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 128(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 144(%1), %%xmm1\n"
+		     "aesenc %%xmm1, %%xmm0\n"
+		     "movdqu 160(%1), %%xmm1\n"
+		     "aesenclast %%xmm1, %%xmm0\n"
+		     "movdqu %%xmm0, (%2)\n"
+		     "popfl\n"
+		     : : "r"(in), "r"(roundKeys), "r"(out) : "xmm0", "xmm1", "memory", "cc");
+}
+#endif
+
+
+void AES128::EncryptBlock(uint8_t in[16], uint8_t out[16]) {
+
+#if defined(__i386__) && !defined(__EMSCRIPTEN__)
+	if (this->hardware) {
+
+		EncryptBlockNI(this->roundKeys, in, out);
+		return;
+	}
+#endif
+
+	uint8_t* rk = this->roundKeys;
+
+	uint32_t s0 = Load32(in)      ^ Load32(rk);
+	uint32_t s1 = Load32(in + 4)  ^ Load32(rk + 4);
+	uint32_t s2 = Load32(in + 8)  ^ Load32(rk + 8);
+	uint32_t s3 = Load32(in + 12) ^ Load32(rk + 12);
+
+
+	for (int round = 1; round < AES_ROUNDS; round++) {
+
+		rk += 16;
+
+		uint32_t t0 = te0[s0 >> 24] ^ Rotr(te0[(s1 >> 16) & 0xff], 8) ^ Rotr(te0[(s2 >> 8) & 0xff], 16) ^ Rotr(te0[s3 & 0xff], 24) ^ Load32(rk);
+		uint32_t t1 = te0[s1 >> 24] ^ Rotr(te0[(s2 >> 16) & 0xff], 8) ^ Rotr(te0[(s3 >> 8) & 0xff], 16) ^ Rotr(te0[s0 & 0xff], 24) ^ Load32(rk + 4);
+		uint32_t t2 = te0[s2 >> 24] ^ Rotr(te0[(s3 >> 16) & 0xff], 8) ^ Rotr(te0[(s0 >> 8) & 0xff], 16) ^ Rotr(te0[s1 & 0xff], 24) ^ Load32(rk + 8);
+		uint32_t t3 = te0[s3 >> 24] ^ Rotr(te0[(s0 >> 16) & 0xff], 8) ^ Rotr(te0[(s1 >> 8) & 0xff], 16) ^ Rotr(te0[s2 & 0xff], 24) ^ Load32(rk + 12);
+
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+	rk += 16;
+
+
+	//last round has no mixcolumns
+	uint32_t state[4] = { s0, s1, s2, s3 };
+
+	for (int i = 0; i < 4; i++) {
+
+		uint32_t word = ((uint32_t)sbox[state[i] >> 24] << 24)
+				| (sbox[(state[(i + 1) % 4] >> 16) & 0xff] << 16)
+				| (sbox[(state[(i + 2) % 4] >> 8) & 0xff] << 8)
+				| sbox[state[(i + 3) % 4] & 0xff];
+
+		Store32(out + (i * 4), word ^ Load32(rk + (i * 4)));
+	}
+}
+
+
+
+void AES128::CTR(uint8_t nonce[8], uint64_t counter, uint8_t* data, uint32_t size) {
+
+	uint8_t counterBlock[16];
+	uint8_t keystream[16];
+
+	for (int i = 0; i < 8; i++) { counterBlock[i] = nonce[i]; }
+
+
+	for (uint32_t offset = 0; offset < size; offset += AES_BLOCK_SIZE) {
+
+		for (int i = 0; i < 8; i++) { counterBlock[8 + i] = (counter >> (56 - (i * 8))) & 0xff; }
+		this->EncryptBlock(counterBlock, keystream);
+
+		for (uint32_t i = 0; i < AES_BLOCK_SIZE && offset + i < size; i++) { data[offset + i] ^= keystream[i]; }
+		counter++;
+	}
+}
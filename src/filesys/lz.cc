@@ -0,0 +1,186 @@
+#include <filesys/lz.h>
+
+using namespace os;
+using namespace os::common;
+using namespace os::filesystem;
+
+
+static uint32_t Read32(uint8_t* p) {
+
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static uint32_t Hash(uint32_t sequence) {
+
+	return (sequence * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+
+//token, literal length, literals, offset, match length,
+//returns new output index or capacity+1 when out of room
+static uint32_t WriteSequence(uint8_t* dst, uint32_t op, uint32_t capacity,
+				uint8_t* literals, uint32_t literalLength,
+				uint32_t offset, uint32_t matchLength) {
+
+	//worst case for the extra length bytes
+	uint32_t needed = 1 + (literalLength / 255) + 1 + literalLength + 2 + (matchLength / 255) + 1;
+	if (op + needed > capacity) { return capacity + 1; }
+
+	uint32_t token = op++;
+	dst[token] = 0x00;
+
+
+	if (literalLength >= 15) {
+
+		dst[token] = 0xf0;
+		uint32_t rest = literalLength - 15;
+
+		for (rest; rest >= 255; rest -= 255) { dst[op++] = 255; }
+		dst[op++] = rest;
+	} else {
+		dst[token] = literalLength << 4;
+	}
+
+	for (uint32_t i = 0; i < literalLength; i++) { dst[op++] = literals[i]; }
+
+	//last sequence is literals only
+	if (matchLength == 0) { return op; }
+
+
+	dst[op++] = offset & 0xff;
+	dst[op++] = (offset >> 8) & 0xff;
+
+	uint32_t code = matchLength - LZ_MIN_MATCH;
+
+	if (code >= 15) {
+
+		dst[token] |= 0x0f;
+		uint32_t rest = code - 15;
+
+		for (rest; rest >= 255; rest -= 255) { dst[op++] = 255; }
+		dst[op++] = rest;
+	} else {
+		dst[token] |= code;
+	}
+	return op;
+}
+
+
+
+uint32_t os::filesystem::LZCompressBlock(uint8_t* src, uint32_t size,
+			uint8_t* dst, uint32_t capacity, uint16_t* hashTable) {
+
+	uint32_t ip = 0;
+	uint32_t op = 0;
+	uint32_t anchor = 0;
+
+	if (size > 0xffff) { return 0; }
+
+	//positions are stored +1 so 0 means empty
+	for (int i = 0; i < LZ_HASH_SIZE; i++) { hashTable[i] = 0; }
+
+
+	if (size > LZ_MATCH_LIMIT) {
+
+		uint32_t matchStartLimit = size - LZ_MATCH_LIMIT;
+		uint32_t matchEndLimit = size - LZ_LAST_LITERALS;
+
+		while (ip < matchStartLimit) {
+
+			uint32_t sequence = Read32(src + ip);
+			uint32_t h = Hash(sequence);
+			uint32_t ref = hashTable[h];
+			hashTable[h] = ip + 1;
+
+			if (ref == 0 || Read32(src + ref - 1) != sequence) {
+
+				ip++;
+				continue;
+			}
+			ref--;
+
+
+			//extend match forward, then back over literals
+			uint32_t matchLength = LZ_MIN_MATCH;
+			while (ip + matchLength < matchEndLimit && src[ref + matchLength] == src[ip + matchLength]) { matchLength++; }
+
+			while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+
+				ip--;
+				ref--;
+				matchLength++;
+			}
+
+			op = WriteSequence(dst, op, capacity, src + anchor, ip - anchor, ip - ref, matchLength);
+			if (op > capacity) { return 0; }
+
+			ip += matchLength;
+			anchor = ip;
+
+			//keep the table warm inside long matches
+			if (ip - 2 < matchStartLimit) { hashTable[Hash(Read32(src + ip - 2))] = ip - 1; }
+		}
+	}
+
+	op = WriteSequence(dst, op, capacity, src + anchor, size - anchor, 0, 0);
+	if (op > capacity) { return 0; }
+
+	return op;
+}
+
+
+
+uint32_t os::filesystem::LZDecompressBlock(uint8_t* src, uint32_t size, uint8_t* dst, uint32_t capacity) {
+
+	uint32_t ip = 0;
+	uint32_t op = 0;
+
+	while (ip < size) {
+
+		uint8_t token = src[ip++];
+		uint32_t literalLength = token >> 4;
+
+		if (literalLength == 15) {
+
+			uint8_t extra = 255;
+			while (extra == 255 && ip < size) {
+
+				extra = src[ip++];
+				literalLength += extra;
+			}
+		}
+
+		if (ip + literalLength > size || op + literalLength > capacity) { return 0; }
+		for (uint32_t i = 0; i < literalLength; i++) { dst[op++] = src[ip++]; }
+
+		//end of block
+		if (ip >= size) { break; }
+
+
+		if (ip + 2 > size) { return 0; }
+		uint32_t offset = src[ip] | (src[ip+1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > op) { return 0; }
+
+		uint32_t matchLength = (token & 0x0f) + LZ_MIN_MATCH;
+
+		if ((token & 0x0f) == 15) {
+
+			uint8_t extra = 255;
+			while (extra == 255 && ip < size) {
+
+				extra = src[ip++];
+				matchLength += extra;
+			}
+		}
+
+		if (op + matchLength > capacity) { return 0; }
+
+		//byte at a time since matches can overlap themselves
+		uint32_t ref = op - offset;
+		for (uint32_t i = 0; i < matchLength; i++) { dst[op++] = dst[ref + i]; }
+	}
+	return op;
+}
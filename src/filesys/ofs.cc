@@ -1,4 +1,5 @@
 #include <filesys/ofs.h>
+#include <common/trace.h>
 #include <new>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -17,14 +18,80 @@ void printf(char*);
 #endif
 bool strcmp(char* one, char* two);
 uint16_t strlen(char*);
+uint16_t prng();
 char* int2str(uint32_t);
 void sleep(uint32_t);
 
 
+static const uint8_t ofsMagic[8] = { 'O', 'S', 'A', 'K', 'A', 'O', 'F', 'S' };
+static const uint8_t journalMagic[8] = { 'O', 'F', 'S', 'J', 'R', 'N', 'L', '1' };
+
+
+//fragment table is header bytes 64 to 96,
+//returns 0 if lba isn't in a fragment
+static uint32_t FragmentSector(uint32_t location, uint8_t* fragments, uint32_t lba) {
+
+	if (fragments[0] == 0) { return location + 1 + ((lba*OFS_BLOCK_SIZE)/512); }
+
+
+	for (int i = 0; i < 32; i += 2) {
+	
+		if (lba >= fragments[i] && lba <= fragments[i+2]) {
+		
+			return location + fragments[i+1];
+		}
+	}
+
+	return 0;
+}
+
+
+//index entries hold up to 32 chars and aren't
+//terminated when full, names end at a space like NewTag
+static bool TagMatches(char* tagName, char* tag) {
+
+	for (int i = 0; i < 32; i++) {
+
+		if (tagName[i] == '\0' || tagName[i] == ' ') { return tag[i] == '\0'; }
+		if (tagName[i] != tag[i]) { return false; }
+	}
+	return true;
+}
+
+
+//first 8 bytes of keystream at a counter no data block uses,
+//lets unlock tell a wrong key apart before anything is decrypted
+static void KeyCheck(AES128* aes, uint8_t nonce[8], uint8_t check[8]) {
+
+	for (int i = 0; i < 8; i++) { check[i] = 0x00; }
+	aes->CTR(nonce, 0xffffffffffffffffULL, check, 8);
+}
+
+
+//fnv-1a, lets replay tell a whole transaction from a torn one
+static uint32_t JournalChecksum(uint8_t* data, uint32_t size, uint32_t hash) {
+
+	for (uint32_t i = 0; i < size; i++) {
+
+		hash ^= data[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+
 File::File(uint32_t location, uint32_t size, char name[33]) {
 
 	this->Location = location;
 	this->Size = size;
+	this->Flags = 0;
+	this->Parent = OFS_ROOT;
+	this->Slot = 0;
+
+	this->NextName = nullptr;
+	this->NextLocation = nullptr;
+	this->FirstChild = nullptr;
+	this->NextSibling = nullptr;
 
 	for (int i = 0; i < 33; i++) { this->Name[i] = name[i]; }
 }
@@ -40,127 +107,41 @@ FileSystem::FileSystem(AdvancedTechnologyAttachment* ata0m,
 	this->table = table;
 	this->memoryManager = memoryManager;
 
-	this->table->fileCount = GetFileCount();
-	this->table->files = (List*)(this->memoryManager->malloc(sizeof(List)));
-	new (this->table->files) List(this->memoryManager);
-	
-	
-	//cache sectors for every file currently allocated
-	uint8_t sectorData[512];
-	uint32_t fileNum = 0;	
-	uint32_t fileSize = 0;
-	uint32_t location = 0;
-	uint32_t totalSize = 0;
-	uint16_t index = 0;
+	//journal buffers live on the heap, task stacks are only 4KB
+	this->txBlocks = (OFS_JournalBlock*)(this->memoryManager->malloc(sizeof(OFS_JournalBlock) * OFS_JOURNAL_MAX_TX));
+	this->pendingBlocks = (OFS_JournalBlock*)(this->memoryManager->malloc(sizeof(OFS_JournalBlock) * OFS_JOURNAL_MAX_PENDING));
+	this->journalBuffer = (uint8_t*)(this->memoryManager->malloc((OFS_JOURNAL_MAX_TX + 1) * 512));
 
-	
-	//init table in memory	
-	for (uint32_t fileNum = 0; fileNum < this->table->fileCount; fileNum++) {
-	
-		char fileName[33];
-		location = this->GetFileName(fileNum, fileName);
-		
-		// Validate file exists before adding to table
-		if (location == 0 || !FileIf(location)) {
-			// Invalid file entry, skip it
-			continue;
-		}
-		
-		// Validate file name is not empty or garbage
-		bool validName = false;
-		for (int i = 0; i < 32; i++) {
-			if (fileName[i] != '\0' && fileName[i] >= 32 && fileName[i] < 127) {
-				validName = true;
-				break;
-			}
-		}
-		if (!validName) {
-			// Invalid file name, skip it
-			continue;
-		}
-		
-		//add to memory table
-		File* file = (File*)(this->memoryManager->malloc(sizeof(File)));
-		new (file) File(location, OFS_BLOCK_SIZE, fileName);
-		this->table->files->Push(file);
+	for (int i = 0; i < OFS_MAX_OPEN_FILES; i++) { this->handles[i].open = false; }
+	for (int i = 0; i < OFS_MAX_KEYS; i++) { this->keys[i].used = false; }
 
-		//this uses mem table info so we do it after
-		fileSize = this->GetFileSize(fileName);
-		file->Size = fileSize;
-		totalSize += file->Size;
-	}
-	this->newestLocation = location;
-	
-	if (this->table->fileCount > 0) { this->table->currentOpenSector = location + (fileSize / 512) + 1;
-	} else { 			  this->table->currentOpenSector = tableStartSector + 512; }
+	this->tagIndex = (uint8_t*)(this->memoryManager->malloc(tagIndexSectorCount * 512));
+	this->tagCount = 0;
+
+	this->lzTable = (uint16_t*)(this->memoryManager->malloc(sizeof(uint16_t) * LZ_HASH_SIZE));
+	this->lzBuffer = (uint8_t*)(this->memoryManager->malloc(OFS_BLOCK_SIZE));
+
+	this->nameHash = (File**)(this->memoryManager->malloc(sizeof(File*) * OFS_DIR_HASH_SIZE));
+	this->locationHash = (File**)(this->memoryManager->malloc(sizeof(File*) * OFS_DIR_HASH_SIZE));
+	this->rootFirstChild = nullptr;
+	this->workingDirectory = OFS_ROOT;
+
+	this->LoadFileTable();
 }
 
 FileSystem::~FileSystem() {
 }
 
 void FileSystem::RefreshFileTable() {
-	// Clear existing file list
+	// Clear existing file list, DestroyList frees the File objects too
 	if (this->table->files) {
-		// Free existing File objects
-		for (int i = 0; i < this->table->files->numOfNodes; i++) {
-			File* file = (File*)(this->table->files->Read(i));
-			if (file) {
-				this->memoryManager->free(file);
-			}
-		}
 		this->table->files->DestroyList();
 		this->memoryManager->free(this->table->files);
 	}
-	
+
 	// Re-initialize file table (same logic as constructor)
 	// Read28 is now synchronous, so it will wait for IndexedDB reads to complete
-	this->table->fileCount = GetFileCount();
-	this->table->files = (List*)(this->memoryManager->malloc(sizeof(List)));
-	new (this->table->files) List(this->memoryManager);
-	
-	uint8_t sectorData[512];
-	uint32_t fileSize = 0;
-	uint32_t location = 0;
-	uint32_t totalSize = 0;
-	
-	// Load files into memory table
-	for (uint32_t fileNum = 0; fileNum < this->table->fileCount; fileNum++) {
-		char fileName[33];
-		location = this->GetFileName(fileNum, fileName);
-		
-		// Validate file exists before adding to table
-		if (location == 0 || !FileIf(location)) {
-			continue;
-		}
-		
-		// Validate file name is not empty or garbage
-		bool validName = false;
-		for (int i = 0; i < 32; i++) {
-			if (fileName[i] != '\0' && fileName[i] >= 32 && fileName[i] < 127) {
-				validName = true;
-				break;
-			}
-		}
-		if (!validName) {
-			continue;
-		}
-		
-		// Add to memory table
-		File* file = (File*)(this->memoryManager->malloc(sizeof(File)));
-		new (file) File(location, OFS_BLOCK_SIZE, fileName);
-		this->table->files->Push(file);
-		
-		fileSize = this->GetFileSize(fileName);
-		file->Size = fileSize;
-		totalSize += file->Size;
-	}
-	this->newestLocation = location;
-	
-	if (this->table->fileCount > 0) {
-		this->table->currentOpenSector = location + (fileSize / 512) + 1;
-	} else {
-		this->table->currentOpenSector = tableStartSector + 512;
-	}
+	this->LoadFileTable();
 }
 
 #ifdef __EMSCRIPTEN__
@@ -177,1215 +158,2589 @@ extern "C" {
 
 
 
+//init table in memory
+void FileSystem::LoadFileTable() {
 
-uint32_t FileSystem::GetFileSectorTable(char* name) {
-//uint32_t FileSystem::GetFileSector(char* name) {
+	TRACE_BEGIN(TRACE_INFO, TRACE_OFS, TRACE_OFS_MOUNT, 0, 0);
 
-	uint32_t location = 0;
-	char fileName[33];
+	this->table->fileCount = 0;
+	this->table->files = (List*)(this->memoryManager->malloc(sizeof(List)));
+	new (this->table->files) List(this->memoryManager);
 
-	//if file is already here
-	for (int i = 0; i < this->table->fileCount; i++) {
-	
-		location = this->GetFileName(i, fileName);
-		if (strcmp(name, fileName)) { return location; }
+	//finish whatever was committed before the last shutdown
+	this->ReplayJournal();
+
+
+	bool rewrite = false;
+	bool indexed = false;
+
+	if (this->ReadSuperblock()) {
+
+		indexed = this->superblock.tagStart == tagIndexStartSector
+			&& this->superblock.tagSectors == tagIndexSectorCount;
+
+		//whole directory comes in with one multi sector read,
+		//bad entries get dropped so pack the directory again
+		rewrite = this->LoadDirectory() != this->superblock.fileCount;
+	} else {
+		//disk still uses the old location table,
+		//load it the slow way once then migrate it
+		rewrite = this->LoadLegacyTable() > 0;
 	}
-	//if not allocate new file
-	return this->table->currentOpenSector;
-}
 
 
-//query the ofs table
-uint32_t FileSystem::GetFileSector(char* name) {
-//uint32_t FileSystem::GetFileSectorTable(char* name) {
+	//allocation starts after the furthest file
+	uint32_t openSector = tableStartSector + 512;
+	this->newestLocation = 0;
 
-	uint32_t location = 0;
-	
-	//if file is already here
-	for (int i = 0; i < this->table->fileCount; i++) {
-	
-		File* readFile = (File*)(this->table->files->Read(i));
-		if (strcmp(name, readFile->Name)) { return readFile->Location; }
+	for (Node* node = this->table->files->entryNode; node != nullptr; node = node->next) {
+
+		File* file = (File*)(node->value);
+		uint32_t fileEnd = file->Location + (file->Size / 512) + 1;
+
+		if (fileEnd > openSector) { openSector = fileEnd; }
+		if (file->Location > this->newestLocation) { this->newestLocation = file->Location; }
 	}
 
-	//if not allocate new file
-	return this->table->currentOpenSector;
+	//fragments can be placed past the end of every file
+	if (this->superblock.currentOpenSector > openSector) {
+
+		openSector = this->superblock.currentOpenSector;
+	}
+	this->table->currentOpenSector = openSector;
+
+	this->IndexDirectory();
+
+	//directory first, its superblock leaves the index marked
+	//missing so a crash before the index is done rebuilds it
+	if (rewrite) { this->UpdateTable(); }
+
+	//dropped entries can leave stale tags behind so
+	//rebuild the index whenever the directory is repacked
+	if (indexed && !rewrite) {
+
+		this->LoadTagIndex();
+	} else {
+		this->BuildTagIndex();
+	}
+
+	TRACE_END(TRACE_INFO, TRACE_OFS, TRACE_OFS_MOUNT, this->table->fileCount, openSector);
 }
 
 
-//return 0 if no fragmentation
-//1st is for lba num for when fragment starts
-//2nd is for offset of sector where fragments is located	
-uint32_t FileSystem::GetFragmentFromLBA(uint32_t location, uint8_t lba) {
+bool FileSystem::ReadSuperblock() {
 
-	uint8_t sectorData[512];
-	ata0m->Read28(location, sectorData, 512, 0);
+	ata0m->Read28(superblockSector, (uint8_t*)(&this->superblock), 512, 0);
 
-	if (sectorData[64] == 0) { return location + 1 + ((lba*OFS_BLOCK_SIZE)/512); }
+	for (int i = 0; i < 8; i++) {
 
+		if (this->superblock.magic[i] != ofsMagic[i]) {
 
-	for (int i = 64; i < 96; i += 2) {
-	
-		if (lba >= sectorData[i] && lba <= sectorData[i+2]) {
-		
-			return location + sectorData[i+1];
+			for (int j = 0; j < 512; j++) { ((uint8_t*)(&this->superblock))[j] = 0x00; }
+			return false;
 		}
 	}
-
-	return 0;
+	return this->superblock.version == OFS_VERSION
+		&& this->superblock.entrySize == OFS_DIR_ENTRY_SIZE;
 }
 
 
+//indexed false says the tag index can't be trusted yet
+void FileSystem::WriteSuperblock(bool indexed) {
 
-bool FileSystem::FileIf(uint32_t sector) {
+	for (int i = 0; i < 8; i++) { this->superblock.magic[i] = ofsMagic[i]; }
 
-	uint8_t file[2];
-	ata0m->Read28(sector, file, 2, 0);
+	this->superblock.version = OFS_VERSION;
+	this->superblock.entrySize = OFS_DIR_ENTRY_SIZE;
+	this->superblock.fileCount = this->table->fileCount;
+	this->superblock.dirStart = dirStartSector;
+	this->superblock.dirSectors = dirSectorCount;
+	this->superblock.currentOpenSector = this->table->currentOpenSector;
+	this->superblock.journalStart = journalStartSector;
+	this->superblock.journalSectors = journalSectorCount;
+	this->superblock.tagStart = tagIndexStartSector;
+	this->superblock.tagSectors = indexed ? tagIndexSectorCount : 0;
+	this->superblock.tagCount = indexed ? this->tagCount : 0;
 
-	bool fileExists = file[0] == 0xf1 && file[1] == 0x7e;
-	
-	return file[0] != 0x00;
+	this->WriteMetadata(superblockSector, (uint8_t*)(&this->superblock));
 }
 
 
-uint32_t FileSystem::SetFileSize(char* name, uint32_t size) {
+//returns number of files loaded
+uint32_t FileSystem::LoadDirectory() {
 
-	uint32_t location = this->GetFileSector(name);
+	uint32_t fileCount = this->superblock.fileCount;
+	uint32_t maxFiles = this->superblock.dirSectors * OFS_DIR_ENTRIES_PER_SECTOR;
 
-	if (FileIf(location)) {
-	
-		uint8_t sectorData[512];
-		ata0m->Read28(location, sectorData, 512, 0);
-		
-		sectorData[4] = (size)       & 0xff;
-		sectorData[5] = (size >> 8)  & 0xff;
-		sectorData[6] = (size >> 16) & 0xff;
-		sectorData[7] = (size >> 24);
-	
-		ata0m->Write28(location, sectorData, 512, 0);
-	}
-	return size;
-}
+	if (fileCount > maxFiles) { fileCount = maxFiles; }
+	if (fileCount == 0) { return 0; }
 
+	uint32_t sectors = ((fileCount - 1) / OFS_DIR_ENTRIES_PER_SECTOR) + 1;
+	uint8_t* dirData = (uint8_t*)(this->memoryManager->malloc(sectors * 512));
 
-uint32_t FileSystem::GetFileSize(char* name) {
-		
-	uint32_t size = 0;
-	uint32_t location = this->GetFileSector(name);
+	//a 28 bit command tops out at 256 sectors (2048 files)
+	for (uint32_t done = 0; done < sectors; done += 256) {
 
-	if (FileIf(location)) {
-	
-		uint8_t data[8];
-		ata0m->Read28(location, data, 8, 0);
+		uint32_t count = sectors - done;
+		if (count > 256) { count = 256; }
 
-		size = (data[7] << 24) | (data[6] << 16) | 
-			(data[5] << 8) | data[4];
+		ata0m->Read28Multi(this->superblock.dirStart + done, dirData + (done * 512), count);
 	}
-	return size;
-}
 
-uint32_t FileSystem::GetDataSize(char* name) {
-	
-	uint32_t size = 0;
-	uint32_t location = this->GetFileSector(name);
 
-	if (FileIf(location)) {
-	
-		uint8_t data[44];
-		ata0m->Read28(location, data, 44, 0);
+	OFS_DirEntry* entries = (OFS_DirEntry*)dirData;
 
-		size = (data[40] << 24) | (data[41] << 16) | 
-			(data[42] << 8) | data[43];
+	//location hash catches entries left twice by a repack that
+	//didn't finish, IndexDirectory builds it properly after
+	for (int i = 0; i < OFS_DIR_HASH_SIZE; i++) { this->locationHash[i] = nullptr; }
+
+	for (uint32_t i = 0; i < fileCount; i++) {
+
+		OFS_DirEntry* entry = &entries[i];
+
+		//validate file name is not empty or garbage
+		bool validName = false;
+		for (int j = 0; j < 32 && entry->name[j] != '\0'; j++) {
+			if (entry->name[j] >= 32 && entry->name[j] < 127) {
+				validName = true;
+				break;
+			}
+		}
+		if (entry->location == 0 || !validName) { continue; }
+		if (this->GetFileFromLocation(entry->location) != nullptr) { continue; }
+
+		char fileName[33];
+		int j = 0;
+		for (j; j < 32 && entry->name[j] != '\0'; j++) { fileName[j] = entry->name[j]; }
+		fileName[j] = '\0';
+
+		File* file = (File*)(this->memoryManager->malloc(sizeof(File)));
+		new (file) File(entry->location, entry->size, fileName);
+		file->Flags = entry->flags;
+		file->Parent = entry->parent;
+
+		uint32_t bucket = file->Location % OFS_DIR_HASH_SIZE;
+		file->NextLocation = this->locationHash[bucket];
+		this->locationHash[bucket] = file;
+
+		this->table->files->Push(file);
+		this->table->fileCount++;
 	}
-	return size;
+	this->memoryManager->free(dirData);
+
+	return this->table->fileCount;
 }
 
 
-uint32_t FileSystem::AddTable(char* name, uint32_t location) {
+//rewrite one directory sector from the memory table
+void FileSystem::WriteDirectorySector(uint32_t sectorNum) {
 
-	//+1 file added to system
-	uint32_t fileNum = 0;
 	uint8_t sectorData[512];
-	ata0m->Read28(tableStartSector, sectorData, 512, 0);
+	for (int i = 0; i < 512; i++) { sectorData[i] = 0x00; }
 
-	for (int i = 0; i < 256; i++) {
+	OFS_DirEntry* entries = (OFS_DirEntry*)sectorData;
+	uint32_t first = sectorNum * OFS_DIR_ENTRIES_PER_SECTOR;
 
-		//first half for file num
-		fileNum += sectorData[i];
+	//one walk to the sector's first entry, then follow the nodes
+	Node* node = this->table->files->entryNode;
+	for (uint32_t i = 0; i < first && node != nullptr; i++) { node = node->next; }
 
-		if (sectorData[i] < 0xff) {
-		
-			sectorData[i]++;
-			break;
-		}
+	for (uint32_t i = 0; i < OFS_DIR_ENTRIES_PER_SECTOR && node != nullptr; i++, node = node->next) {
+
+		File* file = (File*)(node->value);
+		if (first + i >= this->table->fileCount) { break; }
+
+		for (int j = 0; j < 33 && file->Name[j] != '\0'; j++) { entries[i].name[j] = file->Name[j]; }
+
+		entries[i].location = file->Location;
+		entries[i].size = file->Size;
+		entries[i].flags = file->Flags;
+		entries[i].parent = file->Parent;
 	}
-	ata0m->Write28(tableStartSector, sectorData, 512, 0);
-	
-	uint16_t index = (fileNum%128)*4;
+	this->WriteMetadata(dirStartSector + sectorNum, sectorData);
+}
 
-	ata0m->Read28(fileStartSector+(fileNum/128), sectorData, 512, 0);
 
-	sectorData[index] = (location & 0xffffffff)   >> 24;
-	sectorData[index+1] = (location & 0xffffff)     >> 16; 
-	sectorData[index+2] = (location & 0xffff)       >> 8; 
-	sectorData[index+3] = (location & 0xff); 
+//whole index comes in with one multi sector read
+void FileSystem::LoadTagIndex() {
 
-	ata0m->Write28(fileStartSector+(fileNum/128), sectorData, 512, 0);
+	for (uint32_t i = 0; i < tagIndexSectorCount * 512; i++) { this->tagIndex[i] = 0x00; }
 
-	return fileNum+1;
-}
+	this->tagCount = this->superblock.tagCount;
+	if (this->tagCount > OFS_TAG_INDEX_MAX) { this->tagCount = OFS_TAG_INDEX_MAX; }
+	if (this->tagCount == 0) { return; }
 
+	uint32_t sectors = ((this->tagCount - 1) / OFS_TAG_ENTRIES_PER_SECTOR) + 1;
+	ata0m->Read28Multi(tagIndexStartSector, this->tagIndex, sectors);
+}
 
 
-uint32_t FileSystem::RemoveTable(char* name, uint32_t location) {
+//disk from before the index, read every header once
+void FileSystem::BuildTagIndex() {
 
-	//1 file removed from system
-	//remove from list by index here
-	uint32_t fileNum = 0;
 	uint8_t sectorData[512];
-	ata0m->Read28(tableStartSector, sectorData, 512, 0);
 
-	for (int i = 0; i < 256; i++) {
-	
-		//first half for file num
-		fileNum += sectorData[i];
+	for (uint32_t i = 0; i < tagIndexSectorCount * 512; i++) { this->tagIndex[i] = 0x00; }
+	this->tagCount = 0;
 
-		if (sectorData[i+1] == 0) {
-		
-			sectorData[i]--;
-			break;
+	for (Node* node = this->table->files->entryNode; node != nullptr; node = node->next) {
+
+		File* file = (File*)(node->value);
+		this->ReadMetadata(file->Location, sectorData, 512);
+
+		for (uint8_t slot = 0; slot < 8; slot++) {
+
+			uint16_t offset = 256 + (slot * 32);
+			if (sectorData[offset] == 0x00 || this->tagCount >= OFS_TAG_INDEX_MAX) { continue; }
+
+			OFS_TagEntry* entry = this->GetTagEntry(this->tagCount);
+			for (int j = 0; j < 32; j++) { entry->tag[j] = (char)(sectorData[offset+j]); }
+
+			entry->location = file->Location;
+			entry->slot = slot;
+			this->tagCount++;
 		}
 	}
-	//we will have one less file
-	fileNum--;
-	ata0m->Write28(tableStartSector, sectorData, 512, 0);
-	
-	uint16_t index = (fileNum%128)*4;
 
-	//check if removing newest file or not
-	ata0m->Read28(fileStartSector+(fileNum/128), sectorData, 512, 0);
+	//nothing to persist on an empty disk
+	if (this->table->fileCount == 0) { return; }
 
-	//get the newest file allocated	to replace one being deleted
-	uint32_t newLocation =  (sectorData[index] << 24) |
-				(sectorData[index+1] << 16) | 
-				(sectorData[index+2] << 8) | 
-				(sectorData[index+3]);
+	uint32_t sectors = (this->tagCount + OFS_TAG_ENTRIES_PER_SECTOR - 1) / OFS_TAG_ENTRIES_PER_SECTOR;
 
-	//printf(int2str(newLocation));
+	//too big for one transaction, mark the index missing first
+	//so a crash partway rebuilds it instead of trusting half of it
+	if (sectors + 1 > OFS_JOURNAL_MAX_TX) { this->WriteSuperblock(false); }
 
-	//removing newest file
-	for (int j = 0; j < 4; j++) { sectorData[index+j] = 0x00; }
-	ata0m->Write28(fileStartSector+(fileNum/128), sectorData, 512, 0);
-		
-	
-	//move newest entry to deleted table entry 
-	if (fileNum > 0 || newLocation != location) {
-					
-		//for each sector
-		for (int j = 0; j < (fileNum/128)+1; j++) {
-	
-			ata0m->Read28(fileStartSector+j, sectorData, 512, 0);
-		
-			//go through sector
-			for (int k = 0; k < 512; k += 4) {
-			
-				uint32_t findLocation =  (sectorData[k] << 24) |
-							 (sectorData[k+1] << 16) | 
-							 (sectorData[k+2] << 8) | 
-							 (sectorData[k+3]);
-			
-				if (location == findLocation) {
-				
-					sectorData[k] = newLocation >> 24;
-					sectorData[k+1] = (newLocation >> 16) & 0xff; 
-					sectorData[k+2] = (newLocation >> 8) & 0xff; 
-					sectorData[k+3] = (newLocation & 0xff);
-
-					ata0m->Write28(fileStartSector+j, sectorData, 512, 0);
-				
-					return fileNum;
-				}
-			}
+	this->BeginTransaction();
+	for (uint32_t i = 0; i < sectors; i++) {
+
+		//leave room for the superblock, it's what commits the index
+		if (this->txCount + 2 > OFS_JOURNAL_MAX_TX) {
+
+			this->CommitTransaction();
+			this->BeginTransaction();
 		}
+		this->WriteTagSector(i);
 	}
-	return fileNum;
+	this->WriteSuperblock();
+	this->CommitTransaction();
 }
 
 
-//update table (rewrite table using memory cache)
-//this is done because im not spending anymore time on this
-//i got other shit to work to make the deadline for the video
-uint32_t FileSystem::UpdateTable() {
+void FileSystem::WriteTagSector(uint32_t sectorNum) {
 
-	uint8_t sectorData[512];
-	uint32_t sectorOffset = 0;
-	uint32_t location = 0;
-	uint32_t index = 0;
+	this->WriteMetadata(tagIndexStartSector + sectorNum, this->tagIndex + (sectorNum * 512));
+}
 
-	for (int i = 0; i < this->table->fileCount; i++) {
-	
-		File* file = (File*)(this->table->files->Read(i));
-		location = file->Location;
-		index = (i%128)*4;
-
-		sectorData[index] = (location & 0xffffffff)   >> 24;
-		sectorData[index+1] = (location & 0xffffff)     >> 16; 
-		sectorData[index+2] = (location & 0xffff)       >> 8; 
-		sectorData[index+3] = (location & 0xff); 				
-	
-		if ((i % 128) == 0) {
-			ata0m->Write28(fileStartSector+sectorOffset, sectorData, 512, 0);
-			sectorOffset++;
-		}
-	}
 
-	return 0;
+OFS_TagEntry* FileSystem::GetTagEntry(uint32_t index) {
+
+	return (OFS_TagEntry*)(this->tagIndex + ((index / OFS_TAG_ENTRIES_PER_SECTOR) * 512)
+				+ ((index % OFS_TAG_ENTRIES_PER_SECTOR) * OFS_TAG_ENTRY_SIZE));
 }
 
 
-uint32_t FileSystem::GetFileCount() {
+
+//metadata writes between begin and commit
+//go to the journal as one transaction
+void FileSystem::BeginTransaction() {
+
+	this->txDepth++;
+}
+
+
+void FileSystem::CommitTransaction() {
+
+	if (this->txDepth == 0) { return; }
+	this->txDepth--;
+
+	//only the outermost commit hits the disk
+	if (this->txDepth == 0 && this->txCount > 0) { this->WriteTransaction(); }
+}
+
+
+//descriptor + metadata sectors in one sequential write
+void FileSystem::WriteTransaction() {
+
+	uint32_t sectors = this->txCount + 1;
+
+	//make room in the log and in memory before writing,
+	//a checkpoint after this would drop the new transaction
+	if (this->journalHead + sectors > journalSectorCount
+		|| this->pendingCount + this->txCount > OFS_JOURNAL_MAX_PENDING) {
+
+		this->Checkpoint();
+	}
+
+	//first transaction on a fresh disk
+	if (this->journalHead == 0) {
+
+		OFS_JournalHeader* header = (OFS_JournalHeader*)this->journalBuffer;
+		for (int i = 0; i < 512; i++) { this->journalBuffer[i] = 0x00; }
+		for (int i = 0; i < 8; i++) { header->magic[i] = journalMagic[i]; }
+		header->sequence = this->journalSequence;
+
+		ata0m->Write28(journalStartSector, this->journalBuffer, 512, 0);
+		this->journalHead = 1;
+	}
+
+
+	OFS_JournalDescriptor* desc = (OFS_JournalDescriptor*)this->journalBuffer;
+	for (int i = 0; i < 512; i++) { this->journalBuffer[i] = 0x00; }
+
+	for (int i = 0; i < 8; i++) { desc->magic[i] = journalMagic[i]; }
+	desc->sequence = this->journalSequence;
+	desc->count = this->txCount;
+
+	for (uint32_t i = 0; i < this->txCount; i++) {
+
+		desc->sectors[i] = this->txBlocks[i].sector;
+
+		for (int j = 0; j < 512; j++) { this->journalBuffer[((i+1)*512)+j] = this->txBlocks[i].data[j]; }
+	}
+	desc->checksum = JournalChecksum(this->journalBuffer, sectors * 512, 2166136261);
+
+	ata0m->Write28Multi(journalStartSector + this->journalHead, this->journalBuffer, sectors);
+
+	this->journalHead += sectors;
+	this->journalSequence++;
+
+
+	//committed, hold on to it until the next checkpoint
+	for (uint32_t i = 0; i < this->txCount; i++) {
+
+		uint32_t j = 0;
+		for (j; j < this->pendingCount; j++) {
+
+			if (this->pendingBlocks[j].sector == this->txBlocks[i].sector) { break; }
+		}
+		if (j == this->pendingCount) { this->pendingCount++; }
+
+		this->pendingBlocks[j] = this->txBlocks[i];
+	}
+	this->txCount = 0;
+}
+
+
+//write committed metadata to where it belongs, then empty the log
+void FileSystem::Checkpoint() {
+
+	if (this->pendingCount == 0) { return; }
+
+	//sort by sector so neighbours go out in one write
+	for (uint32_t i = 1; i < this->pendingCount; i++) {
+
+		for (uint32_t j = i; j > 0 && this->pendingBlocks[j-1].sector > this->pendingBlocks[j].sector; j--) {
+
+			//swap in place, a whole block is too much for a task stack
+			uint8_t* a = (uint8_t*)(&this->pendingBlocks[j]);
+			uint8_t* b = (uint8_t*)(&this->pendingBlocks[j-1]);
+
+			for (uint32_t k = 0; k < sizeof(OFS_JournalBlock); k++) {
+
+				uint8_t tmp = a[k];
+				a[k] = b[k];
+				b[k] = tmp;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < this->pendingCount;) {
+
+		uint32_t run = 1;
+		while (i + run < this->pendingCount && run < OFS_JOURNAL_MAX_TX + 1
+			&& this->pendingBlocks[i+run].sector == this->pendingBlocks[i].sector + run) {
+
+			run++;
+		}
+
+		for (uint32_t j = 0; j < run; j++) {
+			for (int k = 0; k < 512; k++) { this->journalBuffer[(j*512)+k] = this->pendingBlocks[i+j].data[k]; }
+		}
+
+		if (run == 1) { ata0m->Write28(this->pendingBlocks[i].sector, this->journalBuffer, 512, 0);
+		} else {	ata0m->Write28Multi(this->pendingBlocks[i].sector, this->journalBuffer, run); }
+
+		i += run;
+	}
+	this->pendingCount = 0;
+
+
+	//everything before this sequence is home now
+	OFS_JournalHeader* header = (OFS_JournalHeader*)this->journalBuffer;
+	for (int i = 0; i < 512; i++) { this->journalBuffer[i] = 0x00; }
+	for (int i = 0; i < 8; i++) { header->magic[i] = journalMagic[i]; }
+	header->sequence = this->journalSequence;
+
+	ata0m->Write28(journalStartSector, this->journalBuffer, 512, 0);
+	this->journalHead = 1;
+}
+
+
+//redo every complete transaction left in the log
+void FileSystem::ReplayJournal() {
+
+	this->txCount = 0;
+	this->txDepth = 0;
+	this->pendingCount = 0;
+	this->journalHead = 0;
+	this->journalSequence = 1;
+
+	ata0m->Read28(journalStartSector, this->journalBuffer, 512, 0);
+	OFS_JournalHeader* header = (OFS_JournalHeader*)this->journalBuffer;
+
+	for (int i = 0; i < 8; i++) {
+
+		//no journal yet, header gets written with the first transaction
+		if (header->magic[i] != journalMagic[i]) { return; }
+	}
+	this->journalSequence = header->sequence;
+	this->journalHead = 1;
+
+
+	uint32_t logSectors = journalSectorCount - 1;
+	uint8_t* log = (uint8_t*)(this->memoryManager->malloc(logSectors * 512));
+	ata0m->Read28Multi(journalStartSector + 1, log, logSectors);
+
+	uint32_t head = 0;
+	uint32_t replayed = 0;
+
+	while (head < logSectors) {
+
+		OFS_JournalDescriptor* desc = (OFS_JournalDescriptor*)(log + (head * 512));
+
+		bool valid = desc->sequence == this->journalSequence
+			  && desc->count > 0 && desc->count <= OFS_JOURNAL_MAX_TX
+			  && head + 1 + desc->count <= logSectors;
+
+		for (int i = 0; i < 8 && valid; i++) { valid = desc->magic[i] == journalMagic[i]; }
+		if (!valid) { break; }
+
+		//torn write, this transaction never committed
+		uint32_t checksum = desc->checksum;
+		desc->checksum = 0;
+
+		if (JournalChecksum((uint8_t*)desc, (desc->count + 1) * 512, 2166136261) != checksum) { break; }
+
+		for (uint32_t i = 0; i < desc->count; i++) {
+
+			ata0m->Write28(desc->sectors[i], log + ((head + 1 + i) * 512), 512, 0);
+		}
+		head += desc->count + 1;
+		this->journalSequence++;
+		replayed++;
+	}
+	this->memoryManager->free(log);
+
+
+	if (replayed > 0) {
+
+		for (int i = 0; i < 512; i++) { this->journalBuffer[i] = 0x00; }
+		for (int i = 0; i < 8; i++) { header->magic[i] = journalMagic[i]; }
+		header->sequence = this->journalSequence;
+
+		ata0m->Write28(journalStartSector, this->journalBuffer, 512, 0);
+	}
+}
+
+
+//stage one full metadata sector in the open transaction,
+//starts and commits its own if none is open
+void FileSystem::WriteMetadata(uint32_t sector, uint8_t* data) {
+
+	this->BeginTransaction();
+
+	uint32_t i = 0;
+	for (i; i < this->txCount; i++) {
+
+		if (this->txBlocks[i].sector == sector) { break; }
+	}
+
+	if (i == this->txCount) {
+
+		//too big for one transaction, split it
+		//every caller stays under this, splitting
+		//here means the operation isn't atomic anymore
+		if (this->txCount == OFS_JOURNAL_MAX_TX) {
+
+			printf("Metadata transaction split.\n");
+			this->WriteTransaction();
+			i = 0;
+		}
+		this->txBlocks[i].sector = sector;
+		this->txCount++;
+	}
+
+	for (int j = 0; j < 512; j++) { this->txBlocks[i].data[j] = data[j]; }
+
+	this->CommitTransaction();
+}
+
+
+//a freed header or directory sector handed out as file data,
+//a copy still in the log would land on top of the data at the
+//next checkpoint or replay, so it goes home now and the log
+//starts over before the data is written
+void FileSystem::RevokeMetadata(uint32_t sector, uint32_t count) {
+
+	for (uint32_t i = 0; i < this->txCount;) {
+
+		if (this->txBlocks[i].sector - sector < count) {
+
+			this->txBlocks[i] = this->txBlocks[--this->txCount];
+		} else { i++; }
+	}
+
+	for (uint32_t i = 0; i < this->pendingCount; i++) {
+
+		if (this->pendingBlocks[i].sector - sector < count) {
+
+			this->Checkpoint();
+			return;
+		}
+	}
+}
+
+
+//newest copy wins, open transaction then pending then disk
+void FileSystem::ReadMetadata(uint32_t sector, uint8_t* data, int count) {
+
+	for (uint32_t i = 0; i < this->txCount; i++) {
+
+		if (this->txBlocks[i].sector == sector) {
+
+			for (int j = 0; j < count; j++) { data[j] = this->txBlocks[i].data[j]; }
+			return;
+		}
+	}
+
+	for (uint32_t i = 0; i < this->pendingCount; i++) {
+
+		if (this->pendingBlocks[i].sector == sector) {
+
+			for (int j = 0; j < count; j++) { data[j] = this->pendingBlocks[i].data[j]; }
+			return;
+		}
+	}
+
+	ata0m->Read28(sector, data, count, 0);
+}
+
+
+
+uint32_t FileSystem::LoadLegacyTable() {
+
+	uint32_t fileCount = this->GetLegacyFileCount();
+	uint8_t sectorData[512];
+
+	for (uint32_t fileNum = 0; fileNum < fileCount; fileNum++) {
+
+		char fileName[33];
+		uint32_t location = this->GetLegacyFileName(fileNum, fileName);
+
+		// Validate file exists before adding to table
+		if (location == 0 || !FileIf(location)) {
+			// Invalid file entry, skip it
+			continue;
+		}
+
+		// Validate file name is not empty or garbage
+		bool validName = false;
+		for (int i = 0; i < 32; i++) {
+			if (fileName[i] != '\0' && fileName[i] >= 32 && fileName[i] < 127) {
+				validName = true;
+				break;
+			}
+		}
+		if (!validName) {
+			// Invalid file name, skip it
+			continue;
+		}
+
+		//size and flags come from the file header
+		ata0m->Read28(location, sectorData, 8, 0);
+
+		uint32_t size = (sectorData[7] << 24) | (sectorData[6] << 16) |
+				(sectorData[5] << 8) | sectorData[4];
+
+		File* file = (File*)(this->memoryManager->malloc(sizeof(File)));
+		new (file) File(location, size, fileName);
+		file->Flags = sectorData[2] | (sectorData[3] << 8);
+
+		this->table->files->Push(file);
+		this->table->fileCount++;
+	}
+	return this->table->fileCount;
+}
+
+
+
+
+//names end at '\0' or '/' so path components hash in place
+static uint32_t NameHash(uint32_t parent, char* name) {
+
+	uint32_t hash = 2166136261u;
+
+	for (int i = 0; i < 32 && name[i] != '\0' && name[i] != '/'; i++) {
+
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+	}
+	hash = (hash ^ parent) * 16777619u;
+
+	return hash % OFS_DIR_HASH_SIZE;
+}
+
+
+static bool NameMatches(char* name, char* fileName) {
+
+	int i = 0;
+
+	for (i; i < 32 && name[i] != '\0' && name[i] != '/'; i++) {
+
+		if (name[i] != fileName[i]) { return false; }
+	}
+	return fileName[i] == '\0';
+}
+
+
+//rebuild both hashes and every child list from the memory table
+void FileSystem::IndexDirectory() {
+
+	for (int i = 0; i < OFS_DIR_HASH_SIZE; i++) {
+
+		this->nameHash[i] = nullptr;
+		this->locationHash[i] = nullptr;
+	}
+	this->rootFirstChild = nullptr;
+
+	uint32_t slot = 0;
+
+	for (Node* node = this->table->files->entryNode; node != nullptr; node = node->next) {
+
+		File* file = (File*)(node->value);
+		file->Slot = slot++;
+		file->FirstChild = nullptr;
+
+		uint32_t bucket = file->Location % OFS_DIR_HASH_SIZE;
+		file->NextLocation = this->locationHash[bucket];
+		this->locationHash[bucket] = file;
+	}
+
+	//parents have to be findable before children hook onto them,
+	//anything left without one ends up in the root
+	for (Node* node = this->table->files->entryNode; node != nullptr; node = node->next) {
+
+		File* file = (File*)(node->value);
+		File* parent = this->GetFileFromLocation(file->Parent);
+
+		if (parent == nullptr || (parent->Flags & OFS_FLAG_DIRECTORY) == 0 || parent == file) {
+
+			file->Parent = OFS_ROOT;
+			parent = nullptr;
+		}
+
+		uint32_t bucket = NameHash(file->Parent, file->Name);
+		file->NextName = this->nameHash[bucket];
+		this->nameHash[bucket] = file;
+
+		File** children = parent ? &parent->FirstChild : &this->rootFirstChild;
+		file->NextSibling = *children;
+		*children = file;
+	}
+
+	if (this->workingDirectory != OFS_ROOT && this->GetFileFromLocation(this->workingDirectory) == nullptr) {
+
+		this->workingDirectory = OFS_ROOT;
+	}
+}
+
+
+//file keeps its own children, only its place in
+//the hashes and its parent's list changes
+void FileSystem::LinkFile(File* file) {
+
+	uint32_t bucket = NameHash(file->Parent, file->Name);
+	file->NextName = this->nameHash[bucket];
+	this->nameHash[bucket] = file;
+
+	bucket = file->Location % OFS_DIR_HASH_SIZE;
+	file->NextLocation = this->locationHash[bucket];
+	this->locationHash[bucket] = file;
+
+	File* parent = this->GetFileFromLocation(file->Parent);
+	File** children = parent ? &parent->FirstChild : &this->rootFirstChild;
+
+	file->NextSibling = *children;
+	*children = file;
+}
+
+
+void FileSystem::UnlinkFile(File* file) {
+
+	File* parent = this->GetFileFromLocation(file->Parent);
+
+	for (File** link = &this->nameHash[NameHash(file->Parent, file->Name)]; *link != nullptr; link = &(*link)->NextName) {
+
+		if (*link == file) { *link = file->NextName; break; }
+	}
+	for (File** link = &this->locationHash[file->Location % OFS_DIR_HASH_SIZE]; *link != nullptr; link = &(*link)->NextLocation) {
+
+		if (*link == file) { *link = file->NextLocation; break; }
+	}
+	for (File** link = parent ? &parent->FirstChild : &this->rootFirstChild; *link != nullptr; link = &(*link)->NextSibling) {
+
+		if (*link == file) { *link = file->NextSibling; break; }
+	}
+}
+
+
+File* FileSystem::LookupFile(uint32_t parent, char* name) {
+
+	for (File* file = this->nameHash[NameHash(parent, name)]; file != nullptr; file = file->NextName) {
+
+		if (file->Parent == parent && NameMatches(name, file->Name)) { return file; }
+	}
+	return nullptr;
+}
+
+
+uint32_t FileSystem::GetParent(uint32_t directory) {
+
+	File* file = this->GetFileFromLocation(directory);
+	return file ? file->Parent : OFS_ROOT;
+}
+
+
+//walks every directory in path, leaf is the last name
+//and is empty when path ends at a directory
+bool FileSystem::ResolvePath(char* path, uint32_t* parent, char leaf[33]) {
+
+	uint32_t directory = this->workingDirectory;
+	int i = 0;
+
+	if (path[0] == '/') { directory = OFS_ROOT; }
+	leaf[0] = '\0';
+
+	for (int depth = 0; depth < OFS_MAX_DEPTH; depth++) {
+
+		while (path[i] == '/') { i++; }
+
+		char* name = path + i;
+		int length = 0;
+
+		for (length; name[length] != '\0' && name[length] != '/'; length++) {}
+		if (length > 32) { return false; }
+
+		i += length;
+		bool last = true;
+		for (int j = i; path[j] != '\0'; j++) { if (path[j] != '/') { last = false; break; } }
+
+		bool dot = length == 1 && name[0] == '.';
+		bool dotdot = length == 2 && name[0] == '.' && name[1] == '.';
+
+
+		if (dotdot) { directory = this->GetParent(directory); }
+
+		else if (length > 0 && !dot && last) {
+
+			for (int j = 0; j < length; j++) { leaf[j] = name[j]; }
+			leaf[length] = '\0';
+
+		} else if (length > 0 && !dot) {
+
+			File* file = this->LookupFile(directory, name);
+			if (file == nullptr || (file->Flags & OFS_FLAG_DIRECTORY) == 0) { return false; }
+
+			directory = file->Location;
+		}
+
+		if (last) {
+
+			*parent = directory;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+File* FileSystem::GetFile(char* name) {
+
+	uint32_t parent = OFS_ROOT;
+	char leaf[33];
+
+	if (this->ResolvePath(name, &parent, leaf) == false || leaf[0] == '\0') { return nullptr; }
+
+	File* file = this->LookupFile(parent, leaf);
+
+	//plain names fall back to the root so system
+	//files like "home" are found from any directory
+	bool plain = true;
+	for (int i = 0; name[i] != '\0'; i++) { if (name[i] == '/') { plain = false; break; } }
+
+	if (file == nullptr && plain && parent != OFS_ROOT) { file = this->LookupFile(OFS_ROOT, leaf); }
+
+	return file;
+}
+
+
+File* FileSystem::GetFileFromLocation(uint32_t location) {
+
+	for (File* file = this->locationHash[location % OFS_DIR_HASH_SIZE]; file != nullptr; file = file->NextLocation) {
+
+		if (file->Location == location) { return file; }
+	}
+	return nullptr;
+}
+
+
+bool FileSystem::NewDirectory(char* path) {
+
+	uint32_t parent = OFS_ROOT;
+	char leaf[33];
+
+	if (this->ResolvePath(path, &parent, leaf) == false || leaf[0] == '\0') { return false; }
+	if (this->LookupFile(parent, leaf) != nullptr) { return false; }
+
+	//a directory is just a header, its children
+	//point back at it from their own entries
+	return this->NewEntry(parent, leaf, 0, OFS_FLAG_DIRECTORY) != 0;
+}
+
+
+bool FileSystem::ChangeDirectory(char* path) {
+
+	uint32_t parent = OFS_ROOT;
+	char leaf[33];
+
+	if (this->ResolvePath(path, &parent, leaf) == false) { return false; }
+
+	if (leaf[0] == '\0') {
+
+		this->workingDirectory = parent;
+		return true;
+	}
+
+	File* file = this->LookupFile(parent, leaf);
+	if (file == nullptr || (file->Flags & OFS_FLAG_DIRECTORY) == 0) { return false; }
+
+	this->workingDirectory = file->Location;
+	return true;
+}
+
+
+//only walks the children of directory
+uint32_t FileSystem::GetDirectoryFiles(uint32_t directory, File** files, uint32_t maxFiles) {
+
+	File* dir = this->GetFileFromLocation(directory);
+	File* file = (directory == OFS_ROOT || dir == nullptr) ? this->rootFirstChild : dir->FirstChild;
+	uint32_t count = 0;
+
+	for (file; file != nullptr && count < maxFiles; file = file->NextSibling) {
+
+		files[count++] = file;
+	}
+	return count;
+}
+
+
+void FileSystem::GetPath(uint32_t directory, char* path, uint32_t size) {
+
+	File* parents[OFS_MAX_DEPTH];
+	uint32_t depth = 0;
+
+	for (File* file = this->GetFileFromLocation(directory); file != nullptr && depth < OFS_MAX_DEPTH;
+		file = this->GetFileFromLocation(file->Parent)) {
+
+		parents[depth++] = file;
+	}
+
+	uint32_t length = 0;
+	path[length++] = '/';
+
+	while (depth > 0) {
+
+		File* file = parents[--depth];
+
+		for (int i = 0; file->Name[i] != '\0' && length < size - 2; i++) { path[length++] = file->Name[i]; }
+		if (depth > 0 && length < size - 2) { path[length++] = '/'; }
+	}
+	path[length] = '\0';
+}
+
+
+//slot is kept with the file so this is just the location hash
+int32_t FileSystem::GetFileIndex(uint32_t location) {
+
+	File* file = this->GetFileFromLocation(location);
+
+	if (file == nullptr) { return -1; }
+	return file->Slot;
+}
+
+
+
+
+uint32_t FileSystem::GetFileSectorTable(char* name) {
+//uint32_t FileSystem::GetFileSector(char* name) {
+
+	uint32_t location = 0;
+	char fileName[33];
+
+	//if file is already here
+	for (int i = 0; i < this->table->fileCount; i++) {
+
+		location = this->GetFileName(i, fileName);
+		if (strcmp(name, fileName)) { return location; }
+	}
+	//if not allocate new file
+	return this->table->currentOpenSector;
+}
+
+
+//query the ofs table
+uint32_t FileSystem::GetFileSector(char* name) {
+//uint32_t FileSystem::GetFileSectorTable(char* name) {
+
+	File* file = this->GetFile(name);
+	if (file) { return file->Location; }
+
+	//if not allocate new file
+	return this->table->currentOpenSector;
+}
+
+
+//return 0 if no fragmentation
+//1st is for lba num for when fragment starts
+//2nd is for offset of sector where fragments is located	
+uint32_t FileSystem::GetFragmentFromLBA(uint32_t location, uint8_t lba) {
+
+	uint8_t sectorData[512];
+	this->ReadMetadata(location, sectorData, 512);
+
+	return FragmentSector(location, sectorData + 64, lba);
+}
+
+
+
+bool FileSystem::FileIf(uint32_t sector) {
+
+	uint8_t file[2];
+	this->ReadMetadata(sector, file, 2);
+
+	bool fileExists = file[0] == 0xf1 && file[1] == 0x7e;
+	
+	return file[0] != 0x00;
+}
+
+
+uint32_t FileSystem::SetFileSize(char* name, uint32_t size) {
+
+	uint32_t location = this->GetFileSector(name);
+
+	if (FileIf(location)) {
+
+		this->UpdateSize(location, size);
+	}
+	return size;
+}
+
+
+//sizes are kept in the directory so no disk access here
+uint32_t FileSystem::GetFileSize(char* name) {
+
+	File* file = this->GetFile(name);
+
+	if (file) { return file->Size; }
+	return 0;
+}
+
+uint32_t FileSystem::GetDataSize(char* name) {
+	
+	uint32_t size = 0;
+	uint32_t location = this->GetFileSector(name);
+
+	if (FileIf(location)) {
+	
+		uint8_t data[44];
+		this->ReadMetadata(location, data, 44);
+
+		size = (data[40] << 24) | (data[41] << 16) | 
+			(data[42] << 8) | data[43];
+	}
+	return size;
+}
+
+
+//file must already be in the memory table,
+//writes its directory entry and the new count
+uint32_t FileSystem::AddTable(char* name, uint32_t location) {
+
+	int32_t index = this->GetFileIndex(location);
+
+	this->BeginTransaction();
+	if (index >= 0) {
+
+		this->WriteDirectorySector(index / OFS_DIR_ENTRIES_PER_SECTOR);
+	}
+	this->WriteSuperblock();
+	this->CommitTransaction();
+
+	return this->table->fileCount;
+}
+
+
+
+uint32_t FileSystem::RemoveTable(char* name, uint32_t location) {
+
+	//1 file removed from system
+	File* removed = this->GetFileFromLocation(location);
+	if (removed == nullptr) { return this->table->fileCount; }
+
+	uint32_t index = removed->Slot;
+	uint32_t last = this->table->fileCount - 1;
+	this->UnlinkFile(removed);
+
+	//move newest entry to deleted table entry
+	//so only two directory sectors change
+	if (index != last) {
+
+		File* newest = (File*)(this->table->files->lastNode->value);
+		this->UnlinkFile(newest);
+
+		*removed = *newest;
+		removed->Slot = index;
+		this->LinkFile(removed);
+	}
+	this->table->files->Remove(last);
+	this->table->fileCount--;
+
+	this->BeginTransaction();
+	this->WriteDirectorySector(index / OFS_DIR_ENTRIES_PER_SECTOR);
+
+	if ((last / OFS_DIR_ENTRIES_PER_SECTOR) != (index / OFS_DIR_ENTRIES_PER_SECTOR)) {
+
+		this->WriteDirectorySector(last / OFS_DIR_ENTRIES_PER_SECTOR);
+	}
+	this->WriteSuperblock();
+	this->CommitTransaction();
+
+	return this->table->fileCount;
+}
+
+
+//update table (rewrite table using memory cache)
+uint32_t FileSystem::UpdateTable() {
+
+	uint32_t sectors = (this->table->fileCount + OFS_DIR_ENTRIES_PER_SECTOR - 1) / OFS_DIR_ENTRIES_PER_SECTOR;
+
+	//a directory too big for the log goes out in order with the
+	//superblock last, packing only moves entries down so a crash
+	//partway can leave an entry twice but never lose one
+	this->BeginTransaction();
+	for (uint32_t i = 0; i < sectors; i++) {
+
+		if (this->txCount + 2 > OFS_JOURNAL_MAX_TX) {
+
+			this->CommitTransaction();
+			this->BeginTransaction();
+		}
+		this->WriteDirectorySector(i);
+	}
+	this->WriteSuperblock(false);
+	this->CommitTransaction();
+
+	return 0;
+}
+
+
+uint32_t FileSystem::GetFileCount() {
+
+	return this->table->fileCount;
+}
+
+
+uint32_t FileSystem::GetLegacyFileCount() {
 
 	// Instead of reading a stored count (which may be garbage), 
 	// count valid files by scanning the file table
 	uint32_t validCount = 0;
 	uint8_t sectorData[512];
 	
-	// Scan through file table sectors to find valid files
-	// Each sector can hold 128 file entries (4 bytes each)
-	for (uint32_t sectorOffset = 0; sectorOffset < 256; sectorOffset++) { // Max 256 sectors = 32768 files
-		ata0m->Read28(fileStartSector + sectorOffset, sectorData, 512, 0);
+	// Scan through file table sectors to find valid files
+	// Each sector can hold 128 file entries (4 bytes each)
+	for (uint32_t sectorOffset = 0; sectorOffset < 256; sectorOffset++) { // Max 256 sectors = 32768 files
+		ata0m->Read28(fileStartSector + sectorOffset, sectorData, 512, 0);
+		
+		bool foundValid = false;
+		// Check each entry in this sector (128 entries per sector)
+		for (uint32_t entry = 0; entry < 128; entry++) {
+			uint16_t index = entry * 4;
+			
+			uint32_t location = (sectorData[index] << 24) |
+			                    (sectorData[index+1] << 16) | 
+			                    (sectorData[index+2] << 8) | 
+			                    (sectorData[index+3]);
+			
+			// Only count if location is valid and file actually exists
+			if (location != 0 && FileIf(location)) {
+				validCount++;
+				foundValid = true;
+			} else if (location == 0 && !foundValid && entry == 0) {
+				// First entry in sector is empty, this sector is unused
+				// If we haven't found any valid files yet, we can stop
+				if (sectorOffset == 0) {
+					return 0; // No files at all
+				}
+				// Otherwise, this sector is empty but previous sectors had files
+				// Continue checking in case there are gaps
+			}
+		}
+		
+		// If entire sector is empty (all zeros) and we've found files before,
+		// we can stop (files are stored contiguously)
+		if (!foundValid && validCount > 0 && sectorOffset > 0) {
+			// Check if entire sector is zeros
+			bool allZeros = true;
+			for (int i = 0; i < 512; i++) {
+				if (sectorData[i] != 0) {
+					allZeros = false;
+					break;
+				}
+			}
+			if (allZeros) {
+				break; // Found end of file table
+			}
+		}
+	}
+	
+	return validCount;
+}
+
+
+//store name in string, return location
+uint32_t FileSystem::GetFileName(uint16_t fileNum, char fileName[33]) {
+
+	File* file = (File*)(this->table->files->Read(fileNum));
+
+	if (file == nullptr || fileNum >= this->table->fileCount) {
+
+		if (fileName != nullptr) { fileName[0] = '\0'; }
+		return 0;
+	}
+
+	if (fileName != nullptr) {
+
+		for (int i = 0; i < 33; i++) { fileName[i] = file->Name[i]; }
+	}
+	return file->Location;
+}
+
+
+//old layout: big endian locations, 128 per sector
+uint32_t FileSystem::GetLegacyFileName(uint16_t fileNum, char fileName[33]) {
+
+	uint8_t sectorData[512];
+	uint32_t location = 0;
+	uint16_t index = (fileNum%128)*4;
+
+	ata0m->Read28(fileStartSector+(fileNum/128), sectorData, 512, 0);
+
+	location = (sectorData[index] << 24) |
+		   (sectorData[index+1] << 16) |
+		   (sectorData[index+2] << 8) |
+		   (sectorData[index+3]);
+
+	if (FileIf(location) == false) {
+
+		printf("Failed to get file location.\n");
+		return 0;
+	}
+
+	if (fileName != nullptr) {
+
+		ata0m->Read28(location, sectorData, 72, 0);
+		int i = 0;
+
+		//name
+		for (i; (sectorData[i+8] != '\0' && i < 32); i++) {
+
+			fileName[i] = (char)(sectorData[i+8]);
+		}
+		fileName[i] = '\0';
+	}
+	return location;
+}
+
+
+//return tag string stored in char tag[33]
+uint32_t FileSystem::GetFileTag(char* fileName, uint8_t tagNum, char tag[33]) {
+
+	uint32_t location = this->GetFileSector(fileName);
+	tag[0] = '\0';
+	
+	if (location == 0 || tagNum >= 8) { return location; }
+
+	for (uint32_t i = 0; i < this->tagCount; i++) {
+
+		OFS_TagEntry* entry = this->GetTagEntry(i);
+
+		if (entry->location == location && entry->slot == tagNum) {
+
+			int j = 0;
+			for (j; j < 32 && entry->tag[j] != '\0'; j++) { tag[j] = entry->tag[j]; }
+			tag[j] = '\0';
+			break;
+		}
+	}
+	return location;
+}
+
+
+//return file location if it has given tag
+uint32_t FileSystem::GetTagFile(char* tagName, uint32_t location, uint8_t* tagNum) {
+
+	for (uint32_t i = 0; i < this->tagCount; i++) {
+
+		OFS_TagEntry* entry = this->GetTagEntry(i);
+
+		if (entry->location == location && TagMatches(tagName, entry->tag)) { 
+			
+			if (tagNum != nullptr) { *tagNum = entry->slot; }
+			return location; 
+		}
+	}
+	return 0;
+}
+
+
+//fill locations with every file that has given tag, returns count
+uint32_t FileSystem::GetTagFiles(char* tagName, uint32_t* locations, uint32_t maxLocations) {
+
+	uint32_t found = 0;
+
+	for (uint32_t i = 0; i < this->tagCount && found < maxLocations; i++) {
+
+		OFS_TagEntry* entry = this->GetTagEntry(i);
+		if (TagMatches(tagName, entry->tag) == false) { continue; }
+
+		//same tag can be on a file twice
+		bool duplicate = false;
+		for (uint32_t j = 0; j < found; j++) {
+
+			if (locations[j] == entry->location) { duplicate = true; }
+		}
+		if (!duplicate) { locations[found++] = entry->location; }
+	}
+	return found;
+}
+
+
+
+bool FileSystem::NewFile(char* name, uint8_t* file, uint32_t size) {
+
+	uint32_t parent = OFS_ROOT;
+	char leaf[33];
+
+	if (this->ResolvePath(name, &parent, leaf) == false || leaf[0] == '\0') {
+
+		printf("No such directory.\n");
+		return false;
+	}
+	if (this->LookupFile(parent, leaf) != nullptr) {
+
+		printf("File already exists.\n");
+		return false;
+	}
+
+	if (this->NewEntry(parent, leaf, size, 0) == 0) { return false; }
+
+	//write initial block of data
+	WriteLBA(name, file, 0);
+	
+	return true;
+}
+
+
+//header, directory entry and superblock for a new
+//file in parent, returns its location or 0
+uint32_t FileSystem::NewEntry(uint32_t parent, char* name, uint32_t size, uint32_t flags) {
+
+	uint32_t location = this->table->currentOpenSector;
+	
+	if (FileIf(location)) {
+
+		//collision lol
+		printf("Collision detected, file can't be created.\n");
+		return 0;
+	}
+	
+	//directory, superblock and header commit together
+	this->BeginTransaction();
+
+	//add to memory table	
+	this->table->fileCount++;
+
+	File* newFile = (File*)(this->memoryManager->malloc(sizeof(File)));
+	new (newFile) File(location, size, name);
+	newFile->Flags = flags;
+	newFile->Parent = parent;
+	newFile->Slot = this->table->fileCount - 1;
+
+	this->table->files->Push(newFile);
+	this->LinkFile(newFile);
+	this->newestLocation = location;
+	this->table->currentOpenSector += (size/512) + 1;
+
+	//directory entry + superblock
+	AddTable(name, location);
+	
+	
+	//OFS FILE STRUCTURE BELOW
+	
+	//first 8 bytes for file nums and size
+	uint8_t sectorData[512];
+
+	//init with zeros
+	for (int i = 0; i < 512; i++) { sectorData[i] = 0x00; }
+
+
+	//start of file
+	sectorData[0] = 0xf1;
+	sectorData[1] = 0x7e;
+
+	//file information and flags
+	sectorData[2] = flags & 0xff;
+	sectorData[3] = (flags >> 8) & 0xff;
+	
+	//file size in 32 bits
+	sectorData[4] = (size)       & 0xff;
+	sectorData[5] = (size >> 8)  & 0xff;
+	sectorData[6] = (size >> 16) & 0xff;
+	sectorData[7] = (size >> 24);
+
+	
+	//byte 8 to 40 for file name
+	int i = 0;
+	for (i; name[i] != '\0'; i++) {
+	
+		sectorData[i+8] = (uint8_t)name[i];
+	}
+	sectorData[i+8] = '\0';
+	
+
+	//size of file data in 32 bits
+	sectorData[40] = (size)       & 0xff;
+	sectorData[41] = (size >> 8)  & 0xff;
+	sectorData[42] = (size >> 16) & 0xff;
+	sectorData[43] = (size >> 24);
+
+	//byte 44 to 48 for the parent directory
+	sectorData[OFS_PARENT_OFFSET]     = (parent)       & 0xff;
+	sectorData[OFS_PARENT_OFFSET + 1] = (parent >> 8)  & 0xff;
+	sectorData[OFS_PARENT_OFFSET + 2] = (parent >> 16) & 0xff;
+	sectorData[OFS_PARENT_OFFSET + 3] = (parent >> 24);
+
+
+	//fragmentation byte 64 to 96
+	//16 different 2 byte encodings, 
+	//1st is for lba num for when fragment starts
+	//2nd is for offset of sector where fragments is located	
+	sectorData[97] = 0xff;
+	
+	
+	//byte 124 to 128 for image resolution
+	//default is full resolution
+	sectorData[124] = 255; sectorData[125] = 65;
+	sectorData[126] = 200; sectorData[127] = 0;
+
+
+	//byte 256 to end for tag strings
+	/*
+	for (i = 0; tag[i] != '\0'; i++) {
+	
+		sectorData[i+40] = (uint8_t)tag[i];
+	}
+	*/
+
+
+
+	//END OF OFS FILE STRUCTURE
+
+
+	//first sector is reserved for file metadata	
+	this->WriteMetadata(location, sectorData);
+	this->CommitTransaction();
+
+	return location;
+}
+
+
+
+bool FileSystem::DeleteFile(char* name) {
+	
+	uint32_t location = this->GetFileSector(name);
+	uint32_t size = GetFileSize(name);
+
+	if (FileIf(location) == false) { return false; }
+
+	//directories go once they're empty
+	File* entry = this->GetFile(name);
+
+	if (entry && entry->FirstChild != nullptr) {
+
+		printf("Directory isn't empty.\n");
+		return false;
+	}
+	if (entry && entry->Location == this->workingDirectory) { this->workingDirectory = entry->Parent; }
+	
+	//delete actual file data	
+	uint8_t zeros[OFS_BLOCK_SIZE];
+	for (int i = 0; i < OFS_BLOCK_SIZE; i++) { zeros[i] = 0x00; }
+
+	//nothing readable in an encrypted file without the key anyway
+	if (entry == nullptr || (entry->Flags & OFS_FLAG_ENCRYPTED) == 0) {
+
+		for (uint32_t i = 0; i < (size/OFS_BLOCK_SIZE); i++) {
+		
+			WriteLBA(name, zeros, i);
+		}
+	}
+	
+	//get rid of magic numbers + other metadata
+	this->BeginTransaction();
+	this->WriteMetadata(location, zeros);
+	
+
+	if (location+(size/512)+1 == this->table->currentOpenSector) { 
+	
+		this->table->currentOpenSector -= ((size/512)+1); 
+	}
+
+	//remove from memory table and directory
+	RemoveTable(name, location);
+	this->RemoveFileTags(location);
+	this->CommitTransaction();
+
+	this->InvalidateHandles(location);
+	this->LockFile(location);
+	
+	return true;
+}
+
+
+
+bool FileSystem::NewTag(char* name, uint32_t location) {
+
+	uint16_t tagIndex = 0;
+	uint8_t sectorData[512];
+
+	if (this->GetFileFromLocation(location) == nullptr) { return false; }
+	if (this->tagCount >= OFS_TAG_INDEX_MAX) { return false; }
+
+	//byte 256 to end for tag strings
+	this->ReadMetadata(location, sectorData, 512);
+
+	//find new tag location
+	for (int i = 256; i < 512; i += 32) {
+	
+		if (sectorData[i] == 0x00) {
+		
+			tagIndex = i;
+			break;
+		}
+	}
+	
+	//can't attach any more tags
+	if (tagIndex == 0) { return false; }
+
+	//write new tag
+	for (int j = 0; (name[j] != '\0' && name[j] != ' ' && j < 32); j++) {
+	
+		sectorData[j+tagIndex] = (uint8_t)(name[j]);
+	}
+
+	//header and index change together
+	this->BeginTransaction();
+	this->WriteMetadata(location, sectorData);
+	this->AddTagEntry(name, location, (tagIndex >> 5) - 8);
+	this->CommitTransaction();
+
+	return true;
+}
+
+
+
+bool FileSystem::DeleteTag(common::uint32_t location, common::uint8_t tagNum) {
+
+	uint8_t sectorData[512];
+	uint16_t sectorTagIndex = 256+(tagNum*32);
+
+	if (tagNum >= 8) { return false; }
+
+	//byte 256 to end for tag strings
+	this->ReadMetadata(location, sectorData, 512);
+
+	//remove tag by overwriting with zeros
+	for (int i = sectorTagIndex; i < sectorTagIndex+32; i++) { 
+		
+		sectorData[i] = 0x00; 
+	}
+
+	this->BeginTransaction();
+	this->WriteMetadata(location, sectorData);
+
+	for (uint32_t i = 0; i < this->tagCount; i++) {
+
+		OFS_TagEntry* entry = this->GetTagEntry(i);
+
+		if (entry->location == location && entry->slot == tagNum) {
+
+			this->RemoveTagEntry(i);
+			break;
+		}
+	}
+	this->CommitTransaction();
+
+	return true;
+}
+
+
+//append to the index, only the last sector changes
+bool FileSystem::AddTagEntry(char* tagName, uint32_t location, uint8_t slot) {
+
+	if (this->tagCount >= OFS_TAG_INDEX_MAX) { return false; }
+
+	OFS_TagEntry* entry = this->GetTagEntry(this->tagCount);
+	for (int j = 0; j < 32; j++) { entry->tag[j] = '\0'; }
+
+	for (int j = 0; (tagName[j] != '\0' && tagName[j] != ' ' && j < 32); j++) {
+
+		entry->tag[j] = tagName[j];
+	}
+	entry->location = location;
+	entry->slot = slot;
+	this->tagCount++;
+
+	this->BeginTransaction();
+	this->WriteTagSector((this->tagCount - 1) / OFS_TAG_ENTRIES_PER_SECTOR);
+	this->WriteSuperblock();
+	this->CommitTransaction();
+
+	return true;
+}
+
+
+//move the last entry into the hole like RemoveTable
+void FileSystem::RemoveTagEntry(uint32_t index) {
+
+	if (index >= this->tagCount) { return; }
+
+	uint32_t last = this->tagCount - 1;
+	uint8_t* hole = (uint8_t*)(this->GetTagEntry(index));
+	uint8_t* tail = (uint8_t*)(this->GetTagEntry(last));
+
+	for (int j = 0; j < OFS_TAG_ENTRY_SIZE; j++) {
+
+		if (index != last) { hole[j] = tail[j]; }
+		tail[j] = 0x00;
+	}
+	this->tagCount--;
+
+	this->BeginTransaction();
+	this->WriteTagSector(index / OFS_TAG_ENTRIES_PER_SECTOR);
+
+	if ((last / OFS_TAG_ENTRIES_PER_SECTOR) != (index / OFS_TAG_ENTRIES_PER_SECTOR)) {
+
+		this->WriteTagSector(last / OFS_TAG_ENTRIES_PER_SECTOR);
+	}
+	this->WriteSuperblock();
+	this->CommitTransaction();
+}
+
+
+void FileSystem::RemoveFileTags(uint32_t location) {
+
+	this->BeginTransaction();
+
+	//removing swaps in the last entry so check the same index again
+	uint32_t i = 0;
+	while (i < this->tagCount) {
+
+		if (this->GetTagEntry(i)->location == location) {
+
+			this->RemoveTagEntry(i);
+		} else {
+			i++;
+		}
+	}
+	this->CommitTransaction();
+}
+
+
+void FileSystem::UpdateSize(uint32_t location, uint32_t size) {
+
+	uint8_t sectorData[512];
+
+	this->ReadMetadata(location, sectorData, 512);
+	sectorData[4] = (size)       & 0xff;
+	sectorData[5] = (size >> 8)  & 0xff;
+	sectorData[6] = (size >> 16) & 0xff;
+	sectorData[7] = (size >> 24);
+	
+	this->BeginTransaction();
+	this->WriteMetadata(location, sectorData);
+
+	//keep directory in sync with header
+	File* file = this->GetFileFromLocation(location);
+
+	if (file != nullptr) {
+
+		file->Size = size;
+		this->WriteDirectorySector(file->Slot / OFS_DIR_ENTRIES_PER_SECTOR);
+	}
+	this->CommitTransaction();
+}
+
+
+//fragmentation byte 64 to 96
+bool FileSystem::WriteLBA(char* name, uint8_t* file, uint32_t lba) {
+
+	uint32_t size = OFS_BLOCK_SIZE * (lba + 1);
+	uint32_t location = this->GetFileSector(name);
+
+	if (FileIf(location) == false) {
+	
+		printf("write what?\n");
+		return false;
+	}
+
+	File* entry = this->GetFile(name);
+
+	if (this->FileLocked(entry)) {
+
+		printf("File is locked.\n");
+		return false;
+	}
+
+	bool encrypted = entry && (entry->Flags & OFS_FLAG_ENCRYPTED);
+	OFS_FileKey* fileKey = encrypted ? this->GetFileKey(location) : nullptr;
+
+	//a block's counters under this nonce ran out, or it's past
+	//the table and can't get new ones, only a new nonce helps
+	if (fileKey && (lba < OFS_COMPRESSED_BLOCKS ? fileKey->generations[lba] == OFS_BLOCK_GENERATION_MAX : lba < fileKey->blocks)) {
+
+		printf("Block can't be written again, decrypt and encrypt the file.\n");
+		return false;
+	}
+
+	TRACE_BEGIN(TRACE_INFO, TRACE_OFS, TRACE_OFS_WRITE_LBA, location, lba);
+	
+	uint32_t startSector = location + 1 + ((size - OFS_BLOCK_SIZE) / 512);
+	uint8_t sectorData[512];
+	
+
+	//check for fragmentation
+	bool addFragment = false;
+	int fragmentCheck = 0;
+	while (FileIf(startSector) == true && size > GetFileSize(name)) {
+	
+		startSector += OFS_BLOCK_SIZE;
+		fragmentCheck++;
+		addFragment = true;
+
+		//check for max of 64 blocks for availability
+		if (fragmentCheck >= 64) { break; }
+	}
+
+	//fragment, size and superblock updates commit
+	//together after the data is on disk
+	this->BeginTransaction();
+
+	//add a new fragment to file
+	if (addFragment) {
+	
+		uint8_t frIndex = 64;
+		uint8_t fragmentData[512];
+		this->ReadMetadata(location, fragmentData, 512);
+
+		while (fragmentData[frIndex] != 0 && frIndex < 96) { frIndex += 2; }
+
+		if (frIndex < 96) {
 		
-		bool foundValid = false;
-		// Check each entry in this sector (128 entries per sector)
-		for (uint32_t entry = 0; entry < 128; entry++) {
-			uint16_t index = entry * 4;
-			
-			uint32_t location = (sectorData[index] << 24) |
-			                    (sectorData[index+1] << 16) | 
-			                    (sectorData[index+2] << 8) | 
-			                    (sectorData[index+3]);
-			
-			// Only count if location is valid and file actually exists
-			if (location != 0 && FileIf(location)) {
-				validCount++;
-				foundValid = true;
-			} else if (location == 0 && !foundValid && entry == 0) {
-				// First entry in sector is empty, this sector is unused
-				// If we haven't found any valid files yet, we can stop
-				if (sectorOffset == 0) {
-					return 0; // No files at all
-				}
-				// Otherwise, this sector is empty but previous sectors had files
-				// Continue checking in case there are gaps
+			fragmentData[frIndex] = (size-location)/512;
+			fragmentData[frIndex+1] = (startSector-location)/512;
+		} else {
+			printf("fragmentation error.\n");
+			this->CommitTransaction();
+			TRACE_END(TRACE_INFO, TRACE_OFS, TRACE_OFS_WRITE_LBA, location, lba);
+			return false;
+		}
+		this->WriteMetadata(location, fragmentData);
+		TRACE_INSTANT(TRACE_INFO, TRACE_OFS, TRACE_OFS_FRAGMENT, location, startSector);
+	}
+
+
+
+
+	uint8_t* blockData = file;
+	uint32_t sectorCount = OFS_BLOCK_SIZE/512;
+
+	bool inTable = lba < OFS_COMPRESSED_BLOCKS;
+	uint16_t tableEntry = 0;
+
+	//compressed blocks keep their slot but only
+	//take as many sectors as the compressed data needs
+	if (entry && (entry->Flags & OFS_FLAG_COMPRESSED) && inTable) {
+
+		//only worth it if at least one sector is saved,
+		//encrypted blocks start with their size
+		uint32_t prefix = encrypted ? 2 : 0;
+		uint32_t compressedSize = LZCompressBlock(file, OFS_BLOCK_SIZE, this->lzBuffer + prefix, OFS_BLOCK_SIZE - 512 - prefix, this->lzTable);
+
+		if (compressedSize > 0) {
+
+			if (encrypted) {
+
+				this->lzBuffer[0] = compressedSize & 0xff;
+				this->lzBuffer[1] = (compressedSize >> 8) & 0xff;
+				tableEntry = OFS_BLOCK_COMPRESSED;
+			} else {
+				tableEntry = compressedSize;
 			}
+			compressedSize += prefix;
+
+			sectorCount = (compressedSize + 511) / 512;
+			for (uint32_t i = compressedSize; i < sectorCount * 512; i++) { this->lzBuffer[i] = 0x00; }
+
+			blockData = this->lzBuffer;
+		}
+	}
+
+	//encrypt whatever actually goes to disk, compressed or not
+	if (fileKey) {
+
+		if (blockData == file) {
+
+			for (uint32_t i = 0; i < sectorCount * 512; i++) { this->lzBuffer[i] = file[i]; }
+			blockData = this->lzBuffer;
+		}
+
+		//every write of a block gets counters nothing has used yet
+		if (inTable) { tableEntry |= ++fileKey->generations[lba]; }
+		if (lba >= fileKey->blocks) { fileKey->blocks = lba + 1; }
+
+		this->CryptBlock(location, lba, blockData, sectorCount * 512);
+	}
+
+	//block table and spent counters, kept in the header for the next unlock
+	if ((entry && (entry->Flags & OFS_FLAG_COMPRESSED) && inTable) || fileKey) {
+
+		this->ReadMetadata(location, sectorData, 512);
+
+		if (inTable) {
+
+			sectorData[OFS_BLOCK_TABLE_OFFSET + (lba*2)] = tableEntry & 0xff;
+			sectorData[OFS_BLOCK_TABLE_OFFSET + (lba*2) + 1] = (tableEntry >> 8) & 0xff;
+		}
+		if (fileKey) {
+
+			for (int i = 0; i < 4; i++) { sectorData[OFS_NONCE_BLOCKS_OFFSET + i] = (fileKey->blocks >> (i * 8)) & 0xff; }
 		}
+		this->WriteMetadata(location, sectorData);
+	}
+
+	//write block in one transfer
+	this->RevokeMetadata(startSector, sectorCount);
+	ata0m->Write28Multi(startSector, blockData, sectorCount);
+
+	//update size
+	if (GetFileSize(name) < size) {
+	
+		//incase file is newest allocated and size exceeds sector target
 		
-		// If entire sector is empty (all zeros) and we've found files before,
-		// we can stop (files are stored contiguously)
-		if (!foundValid && validCount > 0 && sectorOffset > 0) {
-			// Check if entire sector is zeros
-			bool allZeros = true;
-			for (int i = 0; i < 512; i++) {
-				if (sectorData[i] != 0) {
-					allZeros = false;
-					break;
-				}
-			}
-			if (allZeros) {
-				break; // Found end of file table
-			}
+		//if (location == newestLocation) {
+		
+		//	this->table->currentOpenSector = location + (size/512);
+		//}
+		
+		if (startSector >= this->table->currentOpenSector) {
+		
+			this->table->currentOpenSector = startSector + OFS_BLOCK_SIZE;
+			this->WriteSuperblock();
 		}
+
+		//header + directory entry
+		this->UpdateSize(location, size);
 	}
+	this->CommitTransaction();
 	
-	return validCount;
+	//open handles may have this block read ahead
+	this->InvalidateHandles(location);
+
+	TRACE_END(TRACE_INFO, TRACE_OFS, TRACE_OFS_WRITE_LBA, location, lba);
+	return true;
 }
 
 
 
-//store name in string, return location
-uint32_t FileSystem::GetFileName(uint16_t fileNum, char fileName[33]) {
+//what ReadCompressedBlock takes for a block table entry, 0 for a raw
+//block, an encrypted block's real size is only known once it's decrypted
+static uint16_t CompressedSize(uint16_t tableEntry, bool encrypted) {
 
-	uint8_t sectorData[512];
-	uint32_t location = 0;
-	uint16_t index = (fileNum%128)*4;
+	if (encrypted == false) { return tableEntry; }
+	return (tableEntry & OFS_BLOCK_COMPRESSED) ? OFS_BLOCK_SIZE - 512 : 0;
+}
+
+
+bool FileSystem::ReadLBA(char* name, uint8_t* file, uint32_t lba) {
 	
-	ata0m->Read28(fileStartSector+(fileNum/128), sectorData, 512, 0);
+	uint32_t size = OFS_BLOCK_SIZE * (lba + 1);
+	uint32_t location = this->GetFileSector(name);
 
-	location = (sectorData[index] << 24) |
-		   (sectorData[index+1] << 16) | 
-		   (sectorData[index+2] << 8) | 
-		   (sectorData[index+3]);
+	if (FileIf(location) == false) {
 	
-	if (FileIf(location) == false) { 
-		
-		//I WANT TO FUCKING KILL MYSELF
-		printf("Failed to get file location.\n");
-		//return 0; 
+		for (int i = 0; i < OFS_BLOCK_SIZE; i++) { file[i] = 0x00; }
+		printf("Can't read file that doesn't exist.\n");
+		return false;
+	}
+
+	File* entry = this->GetFile(name);
+
+	if (this->FileLocked(entry)) {
+
+		for (int i = 0; i < OFS_BLOCK_SIZE; i++) { file[i] = 0x00; }
+		printf("File is locked.\n");
+		return false;
 	}
 
-	if (fileName != nullptr) {
-		
-		ata0m->Read28(location, sectorData, 72, 0);
-		int i = 0;
-		
-		//name
-		for (i; (sectorData[i+8] != '\0' || i < 32); i++) {
+	TRACE_BEGIN(TRACE_INFO, TRACE_OFS, TRACE_OFS_READ_LBA, location, lba);
 
-			fileName[i] = (char)(sectorData[i+8]);
-		}
-		fileName[i] = '\0';
-	}
-	return location;
-}
+	uint32_t startSector = location + 1 + ((size - OFS_BLOCK_SIZE) / 512);
+	uint8_t sectorData[512];
 
+	//fragments and block sizes both come from the header
+	this->ReadMetadata(location, sectorData, 512);
 
-//return tag string stored in char tag[33]
-uint32_t FileSystem::GetFileTag(char* fileName, uint8_t tagNum, char tag[33]) {
 
-	uint8_t sectorData[512];
-	uint32_t location = this->GetFileSector(fileName);
+	//check if fragmented
+	//read from fragment if needed
+	uint32_t fragmentSector = FragmentSector(location, sectorData + 64, lba);
+
+	if (fragmentSector != 0) {
 	
-	if (location && tagNum < 8) {
-		
-		ata0m->Read28(location, sectorData, 512, 0);
-		uint8_t offset = (tagNum * 32);
-		int i = 0;
-		
-		//tags
-		for (i = 0; (sectorData[256+offset+i] != '\0' && i < 32); i++) {
+		startSector = fragmentSector;
+	}
+
+
+	//compressed block, decode just this one
+	if (entry && (entry->Flags & OFS_FLAG_COMPRESSED) && lba < OFS_COMPRESSED_BLOCKS) {
+
+		uint16_t compressedSize = CompressedSize(sectorData[OFS_BLOCK_TABLE_OFFSET + (lba*2)]
+					| (sectorData[OFS_BLOCK_TABLE_OFFSET + (lba*2) + 1] << 8), entry->Flags & OFS_FLAG_ENCRYPTED);
 
-			tag[i] = (char)(sectorData[256+offset+i]);
+		if (compressedSize > 0) {
+
+			bool ok = this->ReadCompressedBlock(location, lba, startSector, compressedSize, file);
+			TRACE_END(TRACE_INFO, TRACE_OFS, TRACE_OFS_READ_LBA, location, lba);
+			return ok;
 		}
-		tag[i] = '\0';
-	} else {
-		tag[0] = '\0';
 	}
-	return location;
+
+	//read block in one transfer
+	ata0m->Read28Multi(startSector, file, OFS_BLOCK_SIZE/512);
+	this->CryptBlock(location, lba, file, OFS_BLOCK_SIZE);
+	
+	TRACE_END(TRACE_INFO, TRACE_OFS, TRACE_OFS_READ_LBA, location, lba);
+	return true;
 }
 
 
-//return file location if it has given tag
-uint32_t FileSystem::GetTagFile(char* tagName, uint32_t location, uint8_t* tagNum) {
+//only the sectors holding compressed data get read
+bool FileSystem::ReadCompressedBlock(uint32_t location, uint32_t lba, uint32_t sector, uint16_t compressedSize, uint8_t* buffer) {
 
-	char tag[33];
-	uint8_t sectorData[512];
+	uint32_t sectorCount = (compressedSize + 511) / 512;
 
-	ata0m->Read28(location, sectorData, 512, 0);
+	if (sectorCount > OFS_BLOCK_SIZE/512) { sectorCount = OFS_BLOCK_SIZE/512; }
+	ata0m->Read28Multi(sector, this->lzBuffer, sectorCount);
+	this->CryptBlock(location, lba, this->lzBuffer, sectorCount * 512);
 
-	//go through tag section of sector	
-	for (int i = 256; i < 512; i += 32) {
+	uint8_t* data = this->lzBuffer;
 
-		//get tag
-		int j = 0;
-		for (j; j < 32 && sectorData[i+j] != '\0'; j++) {
+	if (this->GetFileKey(location) != nullptr) {
 
-			tag[j] = (char)(sectorData[i+j]);
-		}
-		tag[j] = '\0';
+		compressedSize = data[0] | (data[1] << 8);
+		if (compressedSize > (sectorCount * 512) - 2) { compressedSize = (sectorCount * 512) - 2; }
+		data += 2;
+	}
 
-		if (strcmp(tagName, tag)) { 
-			
-			*tagNum = ((i>>5)-8);
-			return location; 
-		}
+	uint32_t size = LZDecompressBlock(data, compressedSize, buffer, OFS_BLOCK_SIZE);
+	for (uint32_t i = size; i < OFS_BLOCK_SIZE; i++) { buffer[i] = 0x00; }
+
+	if (size == 0) {
+
+		printf("Compressed block is corrupt.\n");
+		return false;
 	}
-	return 0;
+	return true;
 }
 
 
 
-bool FileSystem::NewFile(char* name, uint8_t* file, uint32_t size) {
+int32_t FileSystem::Open(char* name) {
 
-	uint32_t location = this->table->currentOpenSector;
-	AddTable(name, location);
-	
-	if (FileIf(location)) {
+	File* file = this->GetFile(name);
+	if (file == nullptr) { return -1; }
 
-		//collision lol
-		printf("Collision detected, file can't be created.\n");
-		return false;
+	if (this->FileLocked(file)) {
+
+		printf("File is locked.\n");
+		return -1;
 	}
-	
-	//add to memory table	
-	this->table->fileCount++;
 
-	File* newFile = (File*)(this->memoryManager->malloc(sizeof(File)));
-	new (newFile) File(location, size, name);
-	this->table->files->Push(newFile);
-	this->newestLocation = location;
-	this->table->currentOpenSector += (size/512) + 1;
-	
-	
-	//OFS FILE STRUCTURE BELOW
-	
-	//first 8 bytes for file nums and size
-	uint8_t sectorData[512];
+	for (int32_t i = 0; i < OFS_MAX_OPEN_FILES; i++) {
 
-	//init with zeros
-	for (int i = 0; i < 512; i++) { sectorData[i] = 0x00; }
+		OFS_FileHandle* handle = &this->handles[i];
+		if (handle->open) { continue; }
 
+		handle->location = file->Location;
+		handle->size = file->Size;
+		handle->position = 0;
+		handle->lastBlock = 0xffffffff;
+		handle->cacheFirstBlock = 0;
+		handle->cacheBlocks = 0;
 
-	//start of file
-	sectorData[0] = 0xf1;
-	sectorData[1] = 0x7e;
+		this->LoadHandleExtents(handle);
 
-	//file information and flags
-	sectorData[2] = 0x00;
-	sectorData[3] = 0x00;
-	
-	//file size in 32 bits
-	sectorData[4] = (size)       & 0xff;
-	sectorData[5] = (size >> 8)  & 0xff;
-	sectorData[6] = (size >> 16) & 0xff;
-	sectorData[7] = (size >> 24);
+		handle->cache = (uint8_t*)(this->memoryManager->malloc(OFS_READAHEAD_BLOCKS * OFS_BLOCK_SIZE));
+		handle->open = true;
 
-	
-	//byte 8 to 40 for file name
-	int i = 0;
-	for (i; name[i] != '\0'; i++) {
-	
-		sectorData[i+8] = (uint8_t)name[i];
+		return i;
 	}
-	sectorData[i+8] = '\0';
-	
+	printf("Too many open files.\n");
+	return -1;
+}
 
-	//size of file data in 32 bits
-	sectorData[40] = (size)       & 0xff;
-	sectorData[41] = (size >> 8)  & 0xff;
-	sectorData[42] = (size >> 16) & 0xff;
-	sectorData[43] = (size >> 24);
 
+void FileSystem::Close(int32_t handle) {
 
-	//fragmentation byte 64 to 96
-	//16 different 2 byte encodings, 
-	//1st is for lba num for when fragment starts
-	//2nd is for offset of sector where fragments is located	
-	sectorData[97] = 0xff;
-	
-	
-	//byte 124 to 128 for image resolution
-	//default is full resolution
-	sectorData[124] = 255; sectorData[125] = 65;
-	sectorData[126] = 200; sectorData[127] = 0;
+	if (handle < 0 || handle >= OFS_MAX_OPEN_FILES || !this->handles[handle].open) { return; }
 
+	this->memoryManager->free(this->handles[handle].cache);
+	this->handles[handle].open = false;
+}
 
-	//byte 256 to end for tag strings
-	/*
-	for (i = 0; tag[i] != '\0'; i++) {
-	
-		sectorData[i+40] = (uint8_t)tag[i];
-	}
-	*/
 
+bool FileSystem::Seek(int32_t handle, uint32_t position) {
 
+	if (handle < 0 || handle >= OFS_MAX_OPEN_FILES || !this->handles[handle].open) { return false; }
+	if (position > this->handles[handle].size) { return false; }
 
-	//END OF OFS FILE STRUCTURE
+	this->handles[handle].position = position;
+	return true;
+}
 
 
-	//first sector is reserved for file metadata	
-	ata0m->Write28(location, sectorData, 512, 0);
+uint32_t FileSystem::GetBlockSector(OFS_FileHandle* handle, uint32_t lba) {
 
-	//write initial block of data
-	WriteLBA(name, file, 0);
-	
-	return true;
+	uint32_t sector = FragmentSector(handle->location, handle->fragments, lba);
+
+	if (sector == 0) { sector = handle->location + 1 + ((lba*OFS_BLOCK_SIZE)/512); }
+	return sector;
 }
 
 
+//read a run of blocks that sit next to each other on disk
+//with one multi sector transfer, returns number of blocks read
+uint32_t FileSystem::ReadBlocks(OFS_FileHandle* handle, uint32_t lba, uint8_t* buffer, uint32_t maxBlocks) {
 
-bool FileSystem::DeleteFile(char* name) {
-	
-	uint32_t location = this->GetFileSector(name);
-	uint32_t size = GetFileSize(name);
+	uint32_t sectorsPerBlock = OFS_BLOCK_SIZE / 512;
+	uint32_t sector = this->GetBlockSector(handle, lba);
+	uint32_t blocks = 1;
 
-	if (FileIf(location) == false) { return false; }
-	
-	//remove from table
-	RemoveTable(name, location);
-	
-	//delete actual file data	
-	uint8_t zeros[OFS_BLOCK_SIZE];
-	for (int i = 0; i < OFS_BLOCK_SIZE; i++) { zeros[i] = 0x00; }
+	//compressed blocks get decoded one at a time
+	if (handle->compressed && lba < OFS_COMPRESSED_BLOCKS) {
 
-	for (uint32_t i = 0; i < (size/OFS_BLOCK_SIZE); i++) {
-	
-		WriteLBA(name, zeros, i);
+		for (blocks = 0; blocks < maxBlocks && lba + blocks < OFS_COMPRESSED_BLOCKS; blocks++) {
+
+			uint32_t blockSector = this->GetBlockSector(handle, lba + blocks);
+			uint8_t* blockBuffer = buffer + (blocks * OFS_BLOCK_SIZE);
+
+			if (handle->blockSizes[lba + blocks] > 0) {
+
+				this->ReadCompressedBlock(handle->location, lba + blocks, blockSector, handle->blockSizes[lba + blocks], blockBuffer);
+			} else {
+				ata0m->Read28Multi(blockSector, blockBuffer, sectorsPerBlock);
+				this->CryptBlock(handle->location, lba + blocks, blockBuffer, OFS_BLOCK_SIZE);
+			}
+		}
+		return blocks;
 	}
-	
-	//get rid of magic numbers + other metadata
-	ata0m->Write28(location, zeros, 512, 0);
-	
 
-	//remove from memory table
-	if (location+(size/512)+1 == this->table->currentOpenSector) { 
-	
-		this->table->currentOpenSector -= ((size/512)+1); 
+	while (blocks < maxBlocks && blocks < 256 / sectorsPerBlock
+		&& this->GetBlockSector(handle, lba + blocks) == sector + (blocks * sectorsPerBlock)) {
+
+		blocks++;
 	}
+	ata0m->Read28Multi(sector, buffer, blocks * sectorsPerBlock);
 
-	for (int i = 0; i < this->table->fileCount; i++) {
-	
-		File* file = (File*)(this->table->files->Read(i));
+	//every block has its own counter range so decrypting in place works
+	for (uint32_t i = 0; i < blocks; i++) {
 
-		if (location == file->Location) {
-			
-			this->table->files->Remove(i);
-			break;
-		}
+		this->CryptBlock(handle->location, lba + i, buffer + (i * OFS_BLOCK_SIZE), OFS_BLOCK_SIZE);
 	}
-	this->table->fileCount--;
-	
-	return true;
+	return blocks;
 }
 
 
+//returns number of bytes read, 0 at end of file
+uint32_t FileSystem::Read(int32_t handle, uint8_t* buffer, uint32_t count) {
 
-bool FileSystem::NewTag(char* name, uint32_t location) {
+	if (handle < 0 || handle >= OFS_MAX_OPEN_FILES || !this->handles[handle].open) { return 0; }
 
-	uint16_t tagIndex = 0;
-	uint8_t sectorData[512];
+	OFS_FileHandle* fh = &this->handles[handle];
 
-	//byte 256 to end for tag strings
-	ata0m->Read28(location, sectorData, 512, 0);
+	if (fh->position >= fh->size) { return 0; }
+	if (count > fh->size - fh->position) { count = fh->size - fh->position; }
 
-	//find new tag location
-	for (int i = 256; i < 512; i += 32) {
-	
-		if (sectorData[i] == 0x00) {
-		
-			tagIndex = i;
-			break;
-		}
-	}
-	
-	//can't attach any more tags
-	if (tagIndex == 0) { return false; }
+	uint32_t done = 0;
 
-	//write new tag
-	for (int j = 0; (name[j] != '\0' && name[j] != ' ' && j < 32); j++) {
-	
-		sectorData[j+tagIndex] = (uint8_t)(name[j]);
-	}
-	ata0m->Write28(location, sectorData, 512, 0);
+	while (done < count) {
 
-	return true;
-}
+		uint32_t lba = fh->position / OFS_BLOCK_SIZE;
+		uint32_t offset = fh->position % OFS_BLOCK_SIZE;
+		bool cached = lba >= fh->cacheFirstBlock && lba < fh->cacheFirstBlock + fh->cacheBlocks;
 
+		if (!cached) {
 
+			uint32_t wholeBlocks = offset == 0 ? (count - done) / OFS_BLOCK_SIZE : 0;
+			bool sequential = lba == fh->lastBlock + 1;
 
-//unfinished
-bool FileSystem::DeleteTag(common::uint32_t location, common::uint8_t tagNum) {
+			//whole blocks go straight into the callers buffer, unless
+			//it's reading in order a block or two at a time, then the
+			//read ahead below batches them (scripts, cat)
+			if (wholeBlocks > 0 && (!sequential || wholeBlocks >= OFS_READAHEAD_BLOCKS)) {
 
-	uint8_t sectorData[512];
-	uint16_t sectorTagIndex = 256+(tagNum*32);
+				uint32_t blocks = this->ReadBlocks(fh, lba, buffer + done, wholeBlocks);
 
-	//byte 256 to end for tag strings
-	ata0m->Read28(location, sectorData, 512, 0);
+				fh->position += blocks * OFS_BLOCK_SIZE;
+				fh->lastBlock = lba + blocks - 1;
+				done += blocks * OFS_BLOCK_SIZE;
+				continue;
+			}
 
-	//remove tag by overwriting with zeros
-	for (int i = sectorTagIndex; i < sectorTagIndex+32; i++) { 
-		
-		sectorData[i] = 0x00; 
-	}
-	ata0m->Write28(location, sectorData, 512, 0);
+			//reading in order, grab the next few blocks too
+			uint32_t readAhead = 1;
 
-	return true;
-}
+			if (sequential) {
 
+				uint32_t blocksLeft = ((fh->size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE) - lba;
+				readAhead = blocksLeft < OFS_READAHEAD_BLOCKS ? blocksLeft : OFS_READAHEAD_BLOCKS;
+			}
+			fh->cacheBlocks = this->ReadBlocks(fh, lba, fh->cache, readAhead);
+			fh->cacheFirstBlock = lba;
+		}
 
-void FileSystem::UpdateSize(uint32_t location, uint32_t size) {
+		uint32_t chunk = OFS_BLOCK_SIZE - offset;
+		if (chunk > count - done) { chunk = count - done; }
 
-	uint8_t sectorData[512];
+		uint8_t* src = fh->cache + ((lba - fh->cacheFirstBlock) * OFS_BLOCK_SIZE) + offset;
+		for (uint32_t i = 0; i < chunk; i++) { buffer[done + i] = src[i]; }
 
-	ata0m->Read28(location, sectorData, 512, 0);
-	sectorData[4] = (size)       & 0xff;
-	sectorData[5] = (size >> 8)  & 0xff;
-	sectorData[6] = (size >> 16) & 0xff;
-	sectorData[7] = (size >> 24);
-	
-	ata0m->Write28(location, sectorData, 512, 0);
+		fh->position += chunk;
+		fh->lastBlock = lba;
+		done += chunk;
+	}
+	return done;
 }
 
 
-//fragmentation byte 64 to 96
-bool FileSystem::WriteLBA(char* name, uint8_t* file, uint32_t lba) {
+//file changed on disk, drop read ahead and reload extents
+void FileSystem::InvalidateHandles(uint32_t location) {
 
-	uint32_t size = OFS_BLOCK_SIZE * (lba + 1);
-	uint32_t location = this->GetFileSector(name);
+	for (int i = 0; i < OFS_MAX_OPEN_FILES; i++) {
 
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] Called for file, lba=' + $0 + ', location=' + $1);
-	}, lba, location);
-#else
-	printf("WriteLBA called\n");
-#endif
+		OFS_FileHandle* handle = &this->handles[i];
+		if (!handle->open || handle->location != location) { continue; }
 
-	bool fileExists = FileIf(location);
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] FileIf(' + $0 + ') returned: ' + ($1 ? 'true' : 'false'));
-	}, location, fileExists ? 1 : 0);
-#endif
+		File* file = this->GetFileFromLocation(location);
+		handle->size = file ? file->Size : 0;
+		handle->cacheBlocks = 0;
 
-	if (fileExists == false) {
-	
-		printf("write what?\n");
-		return false;
+		if (file) { this->LoadHandleExtents(handle); }
 	}
-	
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] FileIf check passed, continuing...');
-	}, 0);
-#endif
-	
-	uint32_t startSector = location + 1 + ((size - OFS_BLOCK_SIZE) / 512);
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] Calculated startSector=' + $0 + ' (location=' + $1 + ', size=' + $2 + ')');
-	}, startSector, location, size);
-#endif
-	uint8_t sectorData[512];
-	
+}
 
-	//check for fragmentation
-	bool addFragment = false;
-	int fragmentCheck = 0;
-	while (FileIf(startSector) == true && size > GetFileSize(name)) {
-	
-#ifdef __EMSCRIPTEN__
-		EM_ASM_({
-			console.log('[WriteLBA] Fragmentation detected, skipping from sector ' + $0);
-		}, startSector);
-#endif
-		startSector += OFS_BLOCK_SIZE;
-		fragmentCheck++;
-		addFragment = true;
 
-		//check for max of 64 blocks for availability
-		if (fragmentCheck >= 64) { break; }
-	}
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] Final startSector=' + $0 + ', will write ' + $1 + ' sectors');
-	}, startSector, OFS_BLOCK_SIZE/512);
-#endif
+//extent map and block sizes for every block come from the header
+void FileSystem::LoadHandleExtents(OFS_FileHandle* handle) {
 
-	//add a new fragment to file
-	if (addFragment) {
-	
-		uint8_t frIndex = 64;
-		uint8_t fragmentData[512];
-		ata0m->Read28(location, fragmentData, 512, 0);
+	uint8_t sectorData[256];
+	this->ReadMetadata(handle->location, sectorData, 256);
 
-		while (fragmentData[frIndex] != 0 && frIndex < 96) { frIndex += 2; }
+	for (int j = 0; j < 34; j++) { handle->fragments[j] = sectorData[64+j]; }
 
-		if (frIndex < 96) {
-		
-			fragmentData[frIndex] = (size-location)/512;
-			fragmentData[frIndex+1] = (startSector-location)/512;
-		} else {
-			printf("fragmentation error.\n");
-			return false;
-		}
-		ata0m->Write28(location, fragmentData, 512, 0);
+	File* file = this->GetFileFromLocation(handle->location);
+	handle->compressed = file && (file->Flags & OFS_FLAG_COMPRESSED);
+	bool encrypted = file && (file->Flags & OFS_FLAG_ENCRYPTED);
+
+	for (int j = 0; j < OFS_COMPRESSED_BLOCKS; j++) {
+
+		handle->blockSizes[j] = handle->compressed 
+			? CompressedSize(sectorData[OFS_BLOCK_TABLE_OFFSET + (j*2)] | (sectorData[OFS_BLOCK_TABLE_OFFSET + (j*2) + 1] << 8), encrypted)
+			: 0;
 	}
+}
 
 
 
 
-	//write block sector by sector
-#ifdef __EMSCRIPTEN__
-	EM_ASM_({
-		console.log('[WriteLBA] About to start writing sectors, startSector=' + $0 + ', will write ' + $1 + ' sectors');
-	}, startSector, OFS_BLOCK_SIZE/512);
-#endif
-	for (int i = 0; i < OFS_BLOCK_SIZE/512; i++) {
+//switch a file between raw and compressed blocks,
+//whatever is already in it gets rewritten in the new format
+bool FileSystem::SetCompression(char* name, bool compress) {
 
-		//fill in sector data with file data
-		for (int j = 0; j < 512; j++) {
-		
-			sectorData[j] = file[(512*i)+j];
-		}
+	File* file = this->GetFile(name);
+	if (file == nullptr || this->FileLocked(file)) { return false; }
 
-		//write sector to file
-#ifdef __EMSCRIPTEN__
-		EM_ASM_({
-			console.log('[WriteLBA] Writing sector ' + $0 + ' (i=' + $1 + '), first byte=0x' + $2.toString(16));
-		}, startSector+i, i, sectorData[0]);
-#endif
-		ata0m->Write28(startSector+i, sectorData, 512, 0);
-	}
+	bool compressed = (file->Flags & OFS_FLAG_COMPRESSED) != 0;
+	if (compressed == compress) { return true; }
 
-	//update size
-	if (GetFileSize(name) < size) {
-	
-		ata0m->Read28(location, sectorData, 512, 0);
-		sectorData[4] = (size)       & 0xff;
-		sectorData[5] = (size >> 8)  & 0xff;
-		sectorData[6] = (size >> 16) & 0xff;
-		sectorData[7] = (size >> 24);
-	
-		ata0m->Write28(location, sectorData, 512, 0);
-	
-		//incase file is newest allocated and size exceeds sector target
-		
-		//if (location == newestLocation) {
-		
-		//	this->table->currentOpenSector = location + (size/512);
-		//}
-		
-		if (startSector >= this->table->currentOpenSector) {
-		
-			this->table->currentOpenSector = startSector + OFS_BLOCK_SIZE;
-		}
+
+	uint32_t blocks = (file->Size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE;
+	uint8_t* data = (uint8_t*)(this->memoryManager->malloc(blocks * OFS_BLOCK_SIZE));
+
+	for (uint32_t i = 0; i < blocks; i++) { this->ReadLBA(name, data + (i * OFS_BLOCK_SIZE), i); }
+
+
+	//old block sizes mean nothing once the flag flips, an
+	//encrypted file's generations have to stay where they are
+	uint8_t sectorData[512];
+	this->ReadMetadata(file->Location, sectorData, 512);
+
+	if ((file->Flags & OFS_FLAG_ENCRYPTED) == 0) {
+
+		for (int i = 0; i < OFS_COMPRESSED_BLOCKS * 2; i++) { sectorData[OFS_BLOCK_TABLE_OFFSET + i] = 0x00; }
 	}
-	
+
+	this->BeginTransaction();
+	this->WriteMetadata(file->Location, sectorData);
+	this->SetFileFlags(file->Location, file->Flags ^ OFS_FLAG_COMPRESSED);
+	this->CommitTransaction();
+
+	for (uint32_t i = 0; i < blocks; i++) { this->WriteLBA(name, data + (i * OFS_BLOCK_SIZE), i); }
+	this->memoryManager->free(data);
 
 	return true;
 }
 
 
+//header bytes 2 to 4 and the directory entry
+void FileSystem::SetFileFlags(uint32_t location, uint32_t flags) {
 
-bool FileSystem::ReadLBA(char* name, uint8_t* file, uint32_t lba) {
-	
-	uint32_t size = OFS_BLOCK_SIZE * (lba + 1);
-	uint32_t location = this->GetFileSector(name);
+	uint8_t sectorData[512];
 
-	if (FileIf(location) == false) {
-	
-		for (int i = 0; i < OFS_BLOCK_SIZE; i++) { file[i] = 0x00; }
-		printf("Can't read file that doesn't exist.\n");
-		return false;
+	this->ReadMetadata(location, sectorData, 512);
+	sectorData[2] = flags & 0xff;
+	sectorData[3] = (flags >> 8) & 0xff;
+
+	this->BeginTransaction();
+	this->WriteMetadata(location, sectorData);
+
+	File* file = this->GetFileFromLocation(location);
+
+	if (file != nullptr) {
+
+		file->Flags = flags;
+		this->WriteDirectorySector(file->Slot / OFS_DIR_ENTRIES_PER_SECTOR);
 	}
+	this->CommitTransaction();
 
-	uint32_t startSector = location + 1 + ((size - OFS_BLOCK_SIZE) / 512);
-	uint8_t sectorData[512];
+	this->InvalidateHandles(location);
+}
 
 
-	//check if fragmented
-	//read from fragment if needed
-	if (GetFragmentFromLBA(location, lba) != 0) {
+//buffer will contain data from file to compress,
+//blocks are compressed on their own by WriteLBA
+void FileSystem::Compress(char* name, uint8_t* buffer, uint32_t bufsize) {
+
+	if (this->SetCompression(name, true) == false) { return; }
+
+	uint8_t* data = (uint8_t*)(this->memoryManager->malloc(OFS_BLOCK_SIZE));
 	
-		startSector = GetFragmentFromLBA(location, lba);
+	for (uint32_t lba = 0; lba < (bufsize + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE; lba++) {
+
+		for (uint32_t j = 0; j < OFS_BLOCK_SIZE; j++) {
+
+			uint32_t index = (lba * OFS_BLOCK_SIZE) + j;
+			data[j] = index < bufsize ? buffer[index] : 0x00;
+		}
+		this->WriteLBA(name, data, lba);
 	}
+	this->memoryManager->free(data);
+}
 
 
-	//read block sector by sector
-	for (int i = 0; i < OFS_BLOCK_SIZE/512; i++) {
-		
-		//read sector from file
-		ata0m->Read28(startSector+i, sectorData, 512, 0);
+//buffer have uncompressed data written to it,
+//reads decode block by block on their own
+void FileSystem::Decompress(char* name, uint8_t* buffer, uint32_t bufsize) {
 
-		//fill in sector data with file data
-		for (int j = 0; j < 512; j++) {
-		
-			file[(512*i)+j] = sectorData[j];
-		}
+	int32_t handle = this->Open(name);
+	uint32_t size = this->Read(handle, buffer, bufsize);
+	this->Close(handle);
 
-	}
-	return true;
+	for (uint32_t i = size; i < bufsize; i++) { buffer[i] = 0x00; }
 }
 
 
 
 
-//buffer will contain data from file to compress
-void FileSystem::Compress(char* name, uint8_t* buffer, uint32_t bufsize) {
+//new nonce and key check into a file header, location keeps the
+//nonce unique between files and the generation after it goes up by
+//one each time, a file that never had one starts somewhere random
+//so a file made later at the same location doesn't start over
+static void NewNonce(AES128* aes, uint32_t location, uint8_t* sectorData) {
 
-	//uint16_t blockNum = bufsize / OFS_BLOCK_SIZE;
-	
-	//write compressed data here
-	//List newBuffer(this->memoryManager);
-	uint8_t newBuffer[bufsize];
-	uint8_t instructionBuffer[OFS_BLOCK_SIZE*8];
-	
-	uint32_t newBufIndex = 0;
-	uint32_t intBufIndex = 2;
+	uint8_t* nonce = sectorData + OFS_NONCE_OFFSET;
+	uint32_t generation = (nonce[4] << 24) | (nonce[5] << 16) | (nonce[6] << 8) | nonce[7];
 
-	//run length
-	uint8_t runLengthVal = 0;
-	uint16_t runLength = 0;
-	uint32_t runLengthIndex = 0;
-	uint16_t runLengthInstructionNum = 0;
+	if (generation == 0) { generation = ((uint32_t)prng() << 16) | prng(); }
+	generation++;
 
-	/*
-	float valueFrequencyTable[256];
-	for (int i = 0; i < 256; i++) { valueFrequencyTable[i] = 0.0; }
+	for (int i = 0; i < 4; i++) { nonce[i] = (location >> (24 - (i * 8))) & 0xff; }
+	for (int i = 0; i < 4; i++) { nonce[i+4] = (generation >> (24 - (i * 8))) & 0xff; }
+	KeyCheck(aes, nonce, sectorData + OFS_KEYCHECK_OFFSET);
 
-	//frequency table
-	for (int i = 0; i < bufsize; i++) {
-	
-		valueFrequencyTable[buffer[i]]++;
+	//block generations start over under the new nonce
+	for (int i = 0; i < 4; i++) { sectorData[OFS_NONCE_BLOCKS_OFFSET + i] = 0x00; }
+	for (int i = 0; i < OFS_COMPRESSED_BLOCKS * 2; i++) { sectorData[OFS_BLOCK_TABLE_OFFSET + i] = 0x00; }
+}
+
+
+//turn encryption on or off for the whole file,
+//reads and writes in between go through the key table
+void FileSystem::CryptFile(char* name, uint8_t key[16], bool encrypt) {
+
+	File* file = this->GetFile(name);
+	if (file == nullptr) { return; }
+
+	bool encrypted = (file->Flags & OFS_FLAG_ENCRYPTED) != 0;
+
+	if (encrypted == encrypt) {
+
+		if (encrypt) { printf("File is already encrypted.\n"); }
+		else { printf("File isn't encrypted.\n"); }
+		return;
 	}
-	*/
 
+	if (encrypted && this->UnlockFile(name, key) == false) { 
 		
-	//2 indexes, i for old buf
-	//newBufIndex for new buf
-	for (int i = 0; i < bufsize; i++) {
+		printf("Wrong key.\n");
+		return; 
+	}
 
-		//write uncompressed data to new buffer
-		newBuffer[newBufIndex] = buffer[i];
 
-		if (i < (bufsize-6)) {
-		
-			int j = i+1;
-			
-			while (buffer[i] == buffer[j] && j < bufsize) { j++; }
-
-			if (j > 6) {
-				runLengthIndex = i;
-				runLengthVal = buffer[i];
-				runLength = j-i;
-
-				instructionBuffer[intBufIndex] = (runLengthIndex >> 16) & 0xff;
-				instructionBuffer[intBufIndex+1] = (runLengthIndex >> 8) & 0xff;
-				instructionBuffer[intBufIndex+2] = runLengthIndex & 0xff;
-				instructionBuffer[intBufIndex+3] = runLengthVal;
-				instructionBuffer[intBufIndex+4] = runLength >> 8;
-				instructionBuffer[intBufIndex+5] = runLength & 0xff;
-				
-				intBufIndex += 6;
-				runLengthInstructionNum++;
-				
-				i += j;
-			}
-		}
-		newBufIndex++;
+	//plaintext of the whole file
+	uint32_t blocks = (file->Size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE;
+	uint8_t* data = (uint8_t*)(this->memoryManager->malloc(blocks * OFS_BLOCK_SIZE));
+
+	if (data == nullptr) {
+
+		printf("File is too big to fit in memory.\n");
+		this->LockFile(file->Location);
+		return;
 	}
-	//add num of run length instructions encoded
-	instructionBuffer[0] = runLengthInstructionNum >> 8;
-	instructionBuffer[1] = runLengthInstructionNum & 0xff;
 
+	for (uint32_t i = 0; i < blocks; i++) { this->ReadLBA(name, data + (i * OFS_BLOCK_SIZE), i); }
+	this->LockFile(file->Location);
 
-	//done with compression, now we write data
 
+	uint8_t sectorData[512];
+	this->ReadMetadata(file->Location, sectorData, 512);
 
-	//write list data to disk
-	uint8_t data[OFS_BLOCK_SIZE];
-	for (int j = 0; j < OFS_BLOCK_SIZE; j++) { data[j] = 0x00; }
+	if (encrypt) {
 
-	bool setSize = false;
-	uint32_t dataIndex = 0;
-	
-	//write file with compressed data
-	for (int i = 0; i < ((newBufIndex+intBufIndex)/OFS_BLOCK_SIZE)+1; i++) {
-	
-		for (int j = 0; j < OFS_BLOCK_SIZE; j++) {
-		
-			if (dataIndex < intBufIndex) {
-			
-				data[j] = instructionBuffer[dataIndex];
-			
-			} else if (dataIndex < intBufIndex+newBufIndex) {
-			
-				data[j] = newBuffer[dataIndex-intBufIndex];
-			} else {
-				data[j] = 0x00;
-				setSize = true;
-			}
-			dataIndex++;
-		}
-		//write compressed data
-		WriteLBA(name, data, i);
+		//fresh nonce every time a file gets encrypted
+		AES128 aes;
+		aes.SetKey(key);
+		NewNonce(&aes, file->Location, sectorData);
+	} else {
 
-		//set size and exit
-		if (setSize) {
-		
-			//this->UpdateSize(this->GetFileSector(name), i*OFS_BLOCK_SIZE);
-			break;
-		}
+		//the nonce stays so the next encrypt moves past it,
+		//block table goes back to plain compressed sizes
+		for (int i = 0; i < 8; i++) { sectorData[OFS_KEYCHECK_OFFSET + i] = 0x00; }
+		for (int i = 0; i < 4; i++) { sectorData[OFS_NONCE_BLOCKS_OFFSET + i] = 0x00; }
+		for (int i = 0; i < OFS_COMPRESSED_BLOCKS * 2; i++) { sectorData[OFS_BLOCK_TABLE_OFFSET + i] = 0x00; }
 	}
+
+	this->BeginTransaction();
+	this->WriteMetadata(file->Location, sectorData);
+	this->SetFileFlags(file->Location, file->Flags ^ OFS_FLAG_ENCRYPTED);
+	this->CommitTransaction();
+
+
+	//write everything back in the new format,
+	//nothing has used the new nonce yet
+	if (encrypt && this->UnlockFile(name, key)) { this->GetFileKey(file->Location)->blocks = 0; }
+
+	for (uint32_t i = 0; i < blocks; i++) { this->WriteLBA(name, data + (i * OFS_BLOCK_SIZE), i); }
+
+	this->LockFile(file->Location);
+	this->memoryManager->free(data);
 }
 
 
-//buffer have uncompressed data written to it
-void FileSystem::Decompress(char* name, uint8_t* buffer, uint32_t bufsize) {
+bool FileSystem::UnlockFile(char* name, uint8_t key[16]) {
 
-	uint8_t oldBuffer[bufsize];
-	uint32_t oldBufIndex = 0;
-	
-	uint8_t readData[OFS_BLOCK_SIZE];
+	File* file = this->GetFile(name);
+	if (file == nullptr || (file->Flags & OFS_FLAG_ENCRYPTED) == 0) { return false; }
 
-	for (int i = 0; i < GetFileSize(name)/OFS_BLOCK_SIZE; i++) {
-	
-		this->ReadLBA(name, readData, i);
-		
-		for (int j = 0; j < OFS_BLOCK_SIZE; j++) {
+	OFS_FileKey* fileKey = this->GetFileKey(file->Location);
+
+	for (int i = 0; i < OFS_MAX_KEYS && fileKey == nullptr; i++) {
+
+		if (!this->keys[i].used) { fileKey = &this->keys[i]; }
+	}
+
+	if (fileKey == nullptr) { 
 		
-			oldBuffer[oldBufIndex] = readData[j];
-			oldBufIndex++;
-		}
+		printf("Too many unlocked files.\n");
+		return false; 
 	}
 
-	//run length
-	uint8_t runLengthInstructionNum = (oldBuffer[0] << 8) | oldBuffer[1];
-	uint32_t encodingInstructionBytes = (runLengthInstructionNum*6)+2;
-	
 
-	uint32_t newBufIndex = 0;
-	uint16_t locationIndex = 1;
-	
-	uint32_t location = (oldBuffer[2] << 16) 
-			  | (oldBuffer[3] << 8) 
-			   | oldBuffer[4];
-	
-	uint8_t runLengthVal = oldBuffer[5];
-	uint16_t runLength = (oldBuffer[6] << 8) 
-			   | (oldBuffer[7]);
+	uint8_t sectorData[512];
+	uint8_t check[8];
 
-	//the more run length instructions there are, 
-	//there more memory corruption at top of image
+	this->ReadMetadata(file->Location, sectorData, 512);
+	for (int i = 0; i < 8; i++) { fileKey->nonce[i] = sectorData[OFS_NONCE_OFFSET + i]; }
 
-		
-	//start from after instructions to actual data
-	for (int i = encodingInstructionBytes; i < oldBufIndex; i++) {
-			
-		
-		//add uncompressed data to file
-		if (newBufIndex < bufsize) {
+	fileKey->aes.SetKey(key);
+	KeyCheck(&fileKey->aes, fileKey->nonce, check);
 
-			buffer[newBufIndex] = oldBuffer[i];
-			newBufIndex++;
-		} else {
-			return;
-		}
-	
-		
-		//add compressed data to file
-		if (i == location+encodingInstructionBytes) {
-			
-			for (int j = 0; j < runLength; j++) {
-			
-				if (newBufIndex < bufsize) {
-					buffer[newBufIndex] = runLengthVal;
-					newBufIndex++;
-				} else {
-					return;
-				}
-			}
-				
-			location = (oldBuffer[(locationIndex*6)+2] << 16) 
-				 | (oldBuffer[(locationIndex*6)+3] << 8) 
-				  | oldBuffer[(locationIndex*6)+4];
-				
-			runLengthVal = oldBuffer[(locationIndex*6)+5];
-				
-			runLength = (oldBuffer[(locationIndex*6)+6] << 8) 
-				  | (oldBuffer[(locationIndex*6)+7]);
-				
-			locationIndex++;
-			
-			/*
-			//update location
-			if (locationIndex < runLengthInstructionNum) {
-				
-				location = (oldBuffer[(locationIndex*6)+2] << 16) 
-					 | (oldBuffer[(locationIndex*6)+3] << 8) 
-					  | oldBuffer[(locationIndex*6)+4];
-				
-				runLengthVal = oldBuffer[(locationIndex*6)+5];
-				
-				runLength = (oldBuffer[(locationIndex*6)+6] << 8) 
-					  | (oldBuffer[(locationIndex*6)+7]);
-				
-				locationIndex++;
-			} else {
-				location = 0xffffffff;
-			}
-			*/
-			
-			runLength = 0x00;
+	for (int i = 0; i < 8; i++) {
+
+		if (check[i] != sectorData[OFS_KEYCHECK_OFFSET + i]) {
+
+			fileKey->used = false;
+			return false;
 		}
 	}
+	//files from before the count was kept have used
+	//the nonce for at least every block in their size
+	uint32_t blocks = sectorData[OFS_NONCE_BLOCKS_OFFSET] | (sectorData[OFS_NONCE_BLOCKS_OFFSET + 1] << 8)
+			| (sectorData[OFS_NONCE_BLOCKS_OFFSET + 2] << 16) | (sectorData[OFS_NONCE_BLOCKS_OFFSET + 3] << 24);
+	uint32_t sizeBlocks = (file->Size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE;
+
+	fileKey->blocks = blocks > sizeBlocks ? blocks : sizeBlocks;
+	fileKey->location = file->Location;
+
+	for (int i = 0; i < OFS_COMPRESSED_BLOCKS; i++) {
+
+		fileKey->generations[i] = (sectorData[OFS_BLOCK_TABLE_OFFSET + (i*2)]
+					| (sectorData[OFS_BLOCK_TABLE_OFFSET + (i*2) + 1] << 8)) & OFS_BLOCK_GENERATION_MAX;
+	}
+	fileKey->used = true;
+
+	return true;
 }
 
 
+void FileSystem::LockFile(uint32_t location) {
 
+	OFS_FileKey* fileKey = this->GetFileKey(location);
+	if (fileKey == nullptr) { return; }
 
-void FileSystem::EncryptBlock(uint8_t data[16], uint8_t key[16]) {
+	//don't leave the key schedule lying around
+	for (int i = 0; i < (AES_ROUNDS + 1) * AES_BLOCK_SIZE; i++) { fileKey->aes.roundKeys[i] = 0x00; }
 
-	uint8_t copyData[16];
-	for (int i = 0; i < 16; i++) { copyData[i] = data[i]; }
+	fileKey->used = false;
+	this->InvalidateHandles(location);
+}
 
-	for (int i = 0; i < 10; i++) {
-	
-		//rotation
-		for (int j = 0; j < 16; j++) { data[j] = copyData[(j+i)%16]; }
-		
-		//addition
-		for (int j = 0; j < 16; j++) { data[j] += (uint8_t)(key[j] * key[i]); }
 
-		//xor
-		for (int j = 0; j < 16; j++) { data[j] ^= key[j]; }
+OFS_FileKey* FileSystem::GetFileKey(uint32_t location) {
+
+	for (int i = 0; i < OFS_MAX_KEYS; i++) {
+
+		if (this->keys[i].used && this->keys[i].location == location) { return &this->keys[i]; }
 	}
+	return nullptr;
 }
-void FileSystem::DecryptBlock(uint8_t data[16], uint8_t key[16]) {
-	
-	uint8_t copyData[16];
-	for (int i = 0; i < 16; i++) { copyData[i] = data[i]; }
-		
-	for (int i = 0; i < 10; i++) {
-		
-		//xor
-		for (int j = 0; j < 16; j++) { data[j] ^= key[j]; }
-		
-		//addition
-		for (int j = 0; j < 16; j++) { data[j] -= (uint8_t)(key[j] * key[i]); }
-		
-		//rotation
-		for (int j = 0; j < 16; j++) { 
-			
-			//????
-			if (j-i < 0) {
-				data[j] = copyData[16+(j-i)];
-			} else {
-				data[j] = copyData[(j-i)%16];
-			}
-		}
-	}
+
+
+bool FileSystem::FileLocked(File* file) {
+
+	return file && (file->Flags & OFS_FLAG_ENCRYPTED) && this->GetFileKey(file->Location) == nullptr;
 }
 
 
-void FileSystem::CryptFile(char* name, uint8_t key[16], bool encrypt) {
+//xor keystream for one block in place, counters for a block depend
+//only on its lba and how many times it was written, so blocks
+//decrypt independently and a rewrite never reuses keystream
+void FileSystem::CryptBlock(uint32_t location, uint32_t lba, uint8_t* data, uint32_t size) {
 
-	uint8_t data[OFS_BLOCK_SIZE];
-	uint8_t block[16];
-	uint8_t prev_block[16];
-	uint8_t init_vector[16];
-			
-	//need to hash key to fixed sized length before anything
-	//do this later ok? thanks future self, ur welcume man
+	OFS_FileKey* fileKey = this->GetFileKey(location);
+	if (fileKey == nullptr) { return; }
 
-	//for each ofs file lba
-	for (int i = 0; i < GetFileSize(name)/OFS_BLOCK_SIZE; i++) {
-	
-		//read from file
-		ReadLBA(name, data, i);
+	uint64_t generation = lba < OFS_COMPRESSED_BLOCKS ? fileKey->generations[lba] : 0;
+	uint64_t counter = (generation << 32) + ((uint64_t)lba * (OFS_BLOCK_SIZE / AES_BLOCK_SIZE));
+	fileKey->aes.CTR(fileKey->nonce, counter, data, size);
+}
 
-		
-		//init the init vector
-		for (int j = 0; j < 16; j++) { init_vector[j] = (uint8_t)(key[j] * 0xb3); }
-		
 
-		//for each 128 bit encryption block
-		for (int j = 0; j < OFS_BLOCK_SIZE/16; j++) {
-		
-			//get block data from file
-			for (int k = 0; k < 16; k++) { block[k] = data[16*j+k]; }
-			
 
-			if (encrypt) {
-			
-				//xor with init vector for cbc mode
-				for (int k = 0; k < 16; k++) { block[k] ^= init_vector[k]; }
 
-				//encrypt
-				this->EncryptBlock(block, key);
-			
-				//save new init vector (next blocks previous ciphertext)
-				for (int k = 0; k < 16; k++) { init_vector[k] = block[k]; }
-			} else {
-				//save ciphertext for next init vector
-				for (int k = 0; k < 16; k++) { prev_block[k] = block[k]; }
-				
-				//decrypt
-				this->DecryptBlock(block, key);
-				
-				//xor with init vector to get plaintext
-				for (int k = 0; k < 16; k++) { block[k] ^= init_vector[k]; }
-				
-				//put ciphertext data into init vector
-				for (int k = 0; k < 16; k++) { init_vector[k] = prev_block[k]; }
-			}
-		
-			
-			
-			//put encrypted data instead
-			for (int k = 0; k < 16; k++) { data[16*j+k] = block[k]; }
-		}
+//tiled images keep their size in the image header,
+//older ones summed bytes 124 to 128 and full screen left them empty
+static bool ImageHeader(uint8_t* sectorData, uint16_t* width, uint16_t* height, uint16_t* rowsPerTile) {
+
+	OFS_ImageHeader* image = (OFS_ImageHeader*)(sectorData + OFS_IMAGE_OFFSET);
 
-		//write to file
-		WriteLBA(name, data, i);
+	if (image->magic == OFS_IMAGE_MAGIC && image->rowsPerTile > 0 && image->width > 0) {
+
+		*width = image->width;
+		*height = image->height;
+		*rowsPerTile = image->rowsPerTile;
+		return true;
 	}
-}
 
+	*width = sectorData[124] + sectorData[125];
+	*height = sectorData[126] + sectorData[127];
+	*rowsPerTile = 0;
 
+	if (*width == 0 && *height == 0) {
+
+		*width = 320;
+		*height = 200;
+	}
+	return false;
+}
 
 
 uint32_t FileSystem::GetImageResolution(char* name) {
 
 	uint8_t data[512];
-	ata0m->Read28(this->GetFileSector(name), data, 256, 0);
+	this->ReadMetadata(this->GetFileSector(name), data, 256);
 	
-	uint16_t width = data[124] + data[125];
-	uint16_t height = data[126] + data[127];
+	uint16_t width = 0;
+	uint16_t height = 0;
+	uint16_t rowsPerTile = 0;
+	ImageHeader(data, &width, &height, &rowsPerTile);
 
 	return (width << 16) | height;
 }
 
 
+//anything past destWidth x destHeight is clipped, tiles that
+//line up with dest are read into it without a copy
+bool FileSystem::ReadImage(char* name, uint8_t* dest, uint16_t destWidth, uint16_t destHeight, 
+				uint16_t* retWidth, uint16_t* retHeight) {
 
+	uint32_t location = this->GetFileSector(name);
+	if (FileIf(location) == false) { return false; }
 
-//read and write VGA mode 13H buffer 
-//from disk to memory and vice versa
-bool FileSystem::Read13H(char* name, uint8_t* buffer, uint16_t* retWidth, uint8_t* retHeight, bool compress) {
-
-	if (FileIf(this->GetFileSector(name)) == false) { return false; }
-
-	uint8_t file[OFS_BLOCK_SIZE];
-	uint16_t x = 0;
-	uint8_t y = 0;
-	uint32_t lba = 0;
+	uint8_t data[512];
+	this->ReadMetadata(location, data, 256);
 
-	//retrieve and save res data
-	uint32_t res = GetImageResolution(name);
-	uint16_t width = res >> 16;
-	uint16_t height = res & 0xffff;
+	uint16_t width = 0;
+	uint16_t height = 0;
+	uint16_t rowsPerTile = 0;
+	bool tiled = ImageHeader(data, &width, &height, &rowsPerTile);
 
 	*retWidth = width;
 	*retHeight = height;
 
+	uint16_t copyWidth = width < destWidth ? width : destWidth;
+	uint16_t copyHeight = height < destHeight ? height : destHeight;
 
-	if (compress) {
+	int32_t handle = this->Open(name);
+	if (handle < 0) { return false; }
 
-		this->Decompress(name, buffer, width*height);
-		//this->Decompress(name, buffer, 320*200);
-		
-	//read bitmap
-	} else {
-		
-		//read file and write buffer
-		for (lba; lba < ((width*height)/OFS_BLOCK_SIZE)+1; lba++) {
 
-			ReadLBA(name, file, lba);
+	//old images are rows back to back
+	if (tiled == false) {
 
-			for (uint16_t j = 0; j < OFS_BLOCK_SIZE; j++) {
-	
-				//leave if buffer already full	
-				if ((lba*OFS_BLOCK_SIZE)+j >= width*height) { return true; }
+		for (uint32_t y = 0; y < copyHeight; y++) {
 
-				buffer[width*y+x] = file[j];
-				x++;
+			this->Seek(handle, y*width);
+			this->Read(handle, dest + (y*destWidth), copyWidth);
+		}
+		this->Close(handle);
+		return true;
+	}
 
-				if (x >= width) {
 
-					y++;
-					x = 0;
-				}
+	OFS_FileHandle* fh = &this->handles[handle];
+	uint8_t* tile = nullptr;
+	uint32_t imageEnd = copyHeight * destWidth;
+
+	for (uint32_t t = 0; t * rowsPerTile < copyHeight; t++) {
+
+		uint32_t y = t * rowsPerTile;
+		uint32_t rows = copyHeight - y < rowsPerTile ? copyHeight - y : rowsPerTile;
+		uint8_t* target = dest + (y*destWidth);
+
+		//same stride, padding after the last row only
+		//lands on rows the next tile writes anyway
+		if (destWidth == width && (y*destWidth) + OFS_BLOCK_SIZE <= imageEnd) {
+
+			this->ReadBlocks(fh, t, target, 1);
+			continue;
+		}
+
+		if (tile == nullptr) { tile = (uint8_t*)(this->memoryManager->malloc(OFS_BLOCK_SIZE)); }
+		this->ReadBlocks(fh, t, tile, 1);
+
+		for (uint32_t r = 0; r < rows; r++) {
+			for (uint32_t x = 0; x < copyWidth; x++) {
+
+				target[(r*destWidth)+x] = tile[(r*width)+x];
 			}
 		}
 	}
+
+	if (tile != nullptr) { this->memoryManager->free(tile); }
+	this->Close(handle);
 	return true;
 }
 
 
+
+
+//read and write VGA mode 13H buffer 
+//from disk to memory and vice versa
+bool FileSystem::Read13H(char* name, uint8_t* buffer, uint16_t destWidth, uint16_t destHeight, 
+			uint16_t* retWidth, uint16_t* retHeight, bool compress) {
+
+	if (FileIf(this->GetFileSector(name)) == false) { return false; }
+
+	//rows come back packed at the image width, or the
+	//buffer's if that's smaller, compressed tiles are
+	//decoded by the block layer
+	uint32_t res = GetImageResolution(name);
+	uint16_t width = res >> 16;
+	uint16_t height = res & 0xffff;
+
+	if (width > destWidth) { width = destWidth; }
+	if (height > destHeight) { height = destHeight; }
+
+	*retWidth = width;
+	*retHeight = height;
+
+	uint16_t w = 0;
+	uint16_t h = 0;
+	return this->ReadImage(name, buffer, width, height, &w, &h);
+}
+
+
 bool FileSystem::Write13H(char* name, uint8_t* buffer, uint16_t width, uint16_t height, bool compress) {
 
-	uint32_t lba = 0;
-	uint32_t size = width*height;
-	uint8_t file[OFS_BLOCK_SIZE];
+	if (width == 0 || width > OFS_BLOCK_SIZE) { return false; }
+
+	uint16_t rowsPerTile = OFS_BLOCK_SIZE / width;
+	if (rowsPerTile > 255) { rowsPerTile = 255; }
+
+	uint8_t* file = (uint8_t*)(this->memoryManager->malloc(OFS_BLOCK_SIZE));
 	for (uint32_t i = 0; i < OFS_BLOCK_SIZE; i++) { file[i] = 0x00; }
 
 	//make new file if it doesn't exist
@@ -1395,46 +2750,48 @@ bool FileSystem::Write13H(char* name, uint8_t* buffer, uint16_t width, uint16_t
 		this->NewTag("img", this->GetFileSector(name));
 	}
 
+	uint32_t location = this->GetFileSector(name);
+
+	//tiles compress on their own
+	if (this->SetCompression(name, compress) == false) {
+
+		this->memoryManager->free(file);
+		return false;
+	}
+
+
 	//write width and height of image
-	if (width < 320 && height < 200) {
+	uint8_t data[512];
+	this->ReadMetadata(location, data, 512);
+
+	OFS_ImageHeader* image = (OFS_ImageHeader*)(data + OFS_IMAGE_OFFSET);
+	image->magic = OFS_IMAGE_MAGIC;
+	image->rowsPerTile = rowsPerTile;
+	image->width = width;
+	image->height = height;
+	image->reserved = 0;
 	
-		uint8_t data[512];
-		ata0m->Read28(this->GetFileSector(name), data, 512, 0);
+	this->WriteMetadata(location, data);
 
-		if (width < 256) {
-		
-			data[124] = width; 
-			data[125] = 0;
-		} else {
-			data[124] = 255; 
-			data[125] = width % 256;
-		}
-		data[126] = height; 
-		data[127] = 0;
-		
-		ata0m->Write28(this->GetFileSector(name), data, 512, 0);
-	}
 
+	//whole rows per block, rest of the block is zeroed
+	for (uint32_t t = 0; t * rowsPerTile < height; t++) {
 
+		uint32_t y = t * rowsPerTile;
+		uint32_t rows = height - y < rowsPerTile ? height - y : rowsPerTile;
 
-	if (compress) {
+		for (uint32_t i = 0; i < OFS_BLOCK_SIZE; i++) {
 
-		this->Compress(name, buffer, width*height);
-		this->NewTag("compressed", this->GetFileSector(name));
-		//this->Compress(name, buffer, 320*200);
-	
-	//write bitmap
-	} else {
-		//read buffer and write file
-		for (lba; lba < (size/OFS_BLOCK_SIZE)+1; lba++) {
-		
-			for (uint16_t j = 0; j < OFS_BLOCK_SIZE; j++) {
-		
-				if ((lba*OFS_BLOCK_SIZE)+j < size) { file[j] = buffer[(lba*OFS_BLOCK_SIZE)+j];
-				} else { 		   file[j] = 0x00; }
-			}
-			WriteLBA(name, file, lba);
+			file[i] = i < rows*width ? buffer[(y*width)+i] : 0x00;
 		}
+		this->WriteLBA(name, file, t);
+	}
+	this->memoryManager->free(file);
+
+
+	if (compress && this->GetTagFile("compressed", location, nullptr) == 0) {
+
+		this->NewTag("compressed", location);
 	}
 	return true;
 }
@@ -0,0 +1,131 @@
+#include <gui/colortable.h>
+
+
+using namespace os::common;
+using namespace os::gui;
+
+
+uint8_t ColorTable::table[QUANT_SIZE];
+uint8_t ColorTable::rgb[QUANT_COLORS][3];
+bool ColorTable::stale = true;
+
+int16_t ColorTable::error[2][(IMAGE_MAX_WIDTH + 2) * 3];
+uint8_t ColorTable::current = 0;
+uint16_t ColorTable::width = 0;
+
+
+
+void ColorTable::Build(uint8_t colors[][3], uint8_t colorBits) {
+
+	//6 bit dac values get their top bits repeated into the bottom
+	for (uint8_t c = 0; c < QUANT_COLORS; c++) {
+		for (uint8_t i = 0; i < 3; i++) {
+
+			uint8_t value = colors[c][i] << (8 - colorBits);
+			rgb[c][i] = value | (value >> colorBits);
+		}
+	}
+
+
+	//squared distance of every cell center to every color on
+	//one channel, the search below is then just three adds
+	static uint16_t dist[3][1 << QUANT_BITS][QUANT_COLORS];
+	uint8_t half = 1 << (7 - QUANT_BITS);
+
+	for (uint8_t i = 0; i < 3; i++) {
+		for (uint8_t cell = 0; cell < (1 << QUANT_BITS); cell++) {
+			for (uint8_t c = 0; c < QUANT_COLORS; c++) {
+
+				int32_t d = ((cell << (8 - QUANT_BITS)) + half) - rgb[c][i];
+				dist[i][cell][c] = d * d;
+			}
+		}
+	}
+
+	uint32_t index = 0;
+
+	for (uint8_t r = 0; r < (1 << QUANT_BITS); r++) {
+		for (uint8_t g = 0; g < (1 << QUANT_BITS); g++) {
+			for (uint8_t b = 0; b < (1 << QUANT_BITS); b++, index++) {
+
+				uint16_t* dr = dist[0][r];
+				uint16_t* dg = dist[1][g];
+				uint16_t* db = dist[2][b];
+
+				uint32_t best = 0xffffffff;
+				uint8_t nearest = 0;
+
+				for (uint8_t c = 0; c < QUANT_COLORS; c++) {
+
+					uint32_t d = dr[c] + dg[c] + db[c];
+					if (d < best) { best = d; nearest = c; }
+				}
+				table[index] = nearest;
+			}
+		}
+	}
+	stale = false;
+}
+
+
+
+void ColorTable::DitherBegin(uint16_t width) {
+
+	if (width > IMAGE_MAX_WIDTH) { width = IMAGE_MAX_WIDTH; }
+
+	ColorTable::width = width;
+	current = 0;
+
+	for (uint32_t i = 0; i < (uint32_t)(width + 2) * 3; i++) {
+
+		error[0][i] = 0;
+		error[1][i] = 0;
+	}
+}
+
+
+void ColorTable::DitherRow(uint32_t* pixels, uint8_t* out) {
+
+	//pixel x is at (x+1)*3 in both rows
+	int16_t* here = error[current] + 3;
+	int16_t* next = error[current ^ 1] + 3;
+
+	for (uint16_t x = 0; x < width; x++, here += 3, next += 3) {
+
+		uint32_t pixel = pixels[x];
+		int32_t want[3];
+
+		want[0] = (pixel >> 16) & 0xff;
+		want[1] = (pixel >> 8) & 0xff;
+		want[2] = pixel & 0xff;
+
+		for (uint8_t i = 0; i < 3; i++) {
+
+			want[i] += (here[i] + 8) >> 4;
+
+			if (want[i] < 0) { want[i] = 0; }
+			if (want[i] > 255) { want[i] = 255; }
+		}
+
+		uint8_t color = Map(want[0], want[1], want[2]);
+		out[x] = color;
+
+		//7/16 right, 3/16 down left, 5/16 down, 1/16 down right
+		for (uint8_t i = 0; i < 3; i++) {
+
+			int16_t e = want[i] - rgb[color][i];
+
+			here[i + 3] += e * 7;
+			next[i - 3] += e * 3;
+			next[i]     += e * 5;
+			next[i + 3] += e;
+		}
+	}
+
+
+	//this row's error is used up, it becomes the next one
+	int16_t* used = error[current];
+	for (uint32_t i = 0; i < (uint32_t)(width + 2) * 3; i++) { used[i] = 0; }
+
+	current ^= 1;
+}
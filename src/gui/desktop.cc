@@ -53,22 +53,12 @@ Desktop::Desktop(common::int32_t w, common::int32_t h,
 	new (buttons) List(memoryManager);
 
 
-	//setup background
-	uint8_t tmp[64000];
-	for (int i = 0; i < 64000; i++) { tmp[i] = 0x11; }
+	//setup background, tiles go straight into the window surface
+	for (int i = 0; i < this->bufWidth*this->bufHeight; i++) { this->buf[i] = 0x11; }
 	
 	uint16_t bgw = WIDTH_13H;
-	uint8_t bgh = HEIGHT_13H;
-	this->filesystem->Read13H("home", tmp, &bgw, &bgh, true);
-	//this->filesystem->Read13H("home", tmp, &bgw, &bgh, false);
-
-
-	for (uint32_t y = 0; y < HEIGHT_13H; y++) {	
-		for (uint32_t x = 0; x < WIDTH_13H; x++) {
-		
-			this->WritePixel(x, y, tmp[WIDTH_13H*y+x]);
-		}
-	}
+	uint16_t bgh = HEIGHT_13H;
+	this->filesystem->ReadImage("home", this->buf, this->bufWidth, this->bufHeight, &bgw, &bgh);
 }
 
 
@@ -229,15 +219,44 @@ void Desktop::FreeChild(Window* window) {
 
 
 
-void Desktop::Draw(common::GraphicsContext* gc) {
-	
+//one fixed step of everything that moves by itself
+void Desktop::Update() {
+
 	if (this->mouseStartClick) {
 
 		this->osaka->sim ^= 1;
 		this->OnMouseUp(0);
 		this->mouseStartClick = false;
 	}
-	
+
+	if (this->osaka->sim) { this->osaka->ComputeGameState(); }
+}
+
+
+void Desktop::Frame() {
+
+	uint8_t updates = FrameScheduler::Begin();
+
+	for (uint8_t i = 0; i < updates; i++) { this->Update(); }
+	FrameScheduler::Lap(FRAME_UPDATE);
+
+	//the room moves on every step, the desktop only changes
+	//when something happens to it
+	if (FrameScheduler::Ready(this->osaka->sim && updates > 0) == false) { return; }
+
+	this->Draw(this->gc);
+	if (FrameScheduler::overlay) { FrameScheduler::DrawOverlay(this->gc); }
+	FrameScheduler::Lap(FRAME_COMPOSE);
+
+	//write to video memory
+	this->gc->DrawToScreen();
+	FrameScheduler::Lap(FRAME_PRESENT);
+
+	FrameScheduler::End();
+}
+
+
+void Desktop::Draw(common::GraphicsContext* gc) {
 	
 	if (this->osaka->sim == false) {
 #ifdef __EMSCRIPTEN__
@@ -247,14 +266,14 @@ void Desktop::Draw(common::GraphicsContext* gc) {
 				// Fill desktop buffer with the configured color
 				var color = Module._settings_desktopBg;
 				var bufPtr = $0;
-				for (var i = 0; i < 64000; i++) {
+				for (var i = 0; i < $1; i++) {
 					HEAPU8[bufPtr + i] = color;
 				}
 			}
-		}, (uintptr_t)this->buf);
+		}, (uintptr_t)this->buf, this->bufWidth*this->bufHeight);
 #endif
-		//draw background
-		gc->FillBuffer(0, 0, WIDTH_13H, HEIGHT_13H, this->buf, false);
+		//draw background, except where windows will cover it
+		this->BlitUncovered(gc, 0, 0, 0, this->bufWidth, this->bufHeight, this->buf, this->bufWidth);
 	
 		//draw buttons
 		for (int i = 0; i < this->buttons->numOfNodes; i++) {
@@ -290,9 +309,6 @@ void Desktop::Draw(common::GraphicsContext* gc) {
 		this->Screenshot();
 		this->takeSS = false;
 	}
-		
-	//write to video memory
-	gc->DrawToScreen();
 #ifdef __EMSCRIPTEN__
 	// Log first few draws to verify it's being called
 	static int drawCount = 0;
@@ -459,6 +475,8 @@ void Desktop::Screenshot() {
 
 void Desktop::OnMouseDown(common::uint8_t button) {
 
+	FrameScheduler::stale = true;
+
 	if (this->osaka->sim) { 
 		// Check if clicking on escape button (top-right corner: 300-320, 5-20)
 		if (button == 1 && MouseX >= 300 && MouseX < 320 && MouseY >= 5 && MouseY < 20) {
@@ -517,7 +535,9 @@ void Desktop::OnMouseDown(common::uint8_t button) {
 }
 
 void Desktop::OnMouseUp(common::uint8_t button) {
-	
+
+	FrameScheduler::stale = true;
+
 	if (this->osaka->sim) {
 		//this->osaka->OnMouseUp(MouseX, MouseY, button);
 	} else {
@@ -527,8 +547,9 @@ void Desktop::OnMouseUp(common::uint8_t button) {
 }
 
 void Desktop::OnMouseMove(int x, int y) {
-	
-		
+
+	FrameScheduler::stale = true;
+
 	int32_t newMouseX = MouseX + x;
 	this->oldMouseX = MouseX;
 
@@ -554,6 +575,8 @@ void Desktop::OnMouseMove(int x, int y) {
 
 void Desktop::OnKeyDown(char str) {
 
+	FrameScheduler::stale = true;
+
 	if (this->osaka->sim) { this->osaka->OnKeyDown(str);
 	} else {
 		switch (str) {
@@ -573,7 +596,9 @@ void Desktop::OnKeyDown(char str) {
 
 
 void Desktop::OnKeyUp(char str) {
-	
+
+	FrameScheduler::stale = true;
+
 	if (this->osaka->sim) { this->osaka->OnKeyUp(str); }
 	else { CompositeWidget::OnKeyUp(str); }
 }
@@ -587,6 +612,14 @@ void Desktop::CreateButton(char* file, uint8_t openType, char* imageFile) {
 	DesktopButton* button = (DesktopButton*)(this->memoryManager->malloc(sizeof(DesktopButton)));
 	new (button) DesktopButton(file, openType, imageFile, this->buttons->numOfNodes);
 
+	//icon is read into the button surface
+	if (imageFile != nullptr) {
+	
+		uint16_t w = 0;
+		uint16_t h = 0;
+		this->filesystem->ReadImage(imageFile, button->buffer, 20, 20, &w, &h);
+	}
+
 	this->buttons->Push(button);
 }
 
@@ -613,6 +646,8 @@ DesktopButton::DesktopButton(char* file, uint8_t openType, char* imageFile, uint
 	//20x20 sprite res
 	for (int i = 0; i < 400; i++) { this->buffer[i] = 0x00; }
 	this->buf = this->buffer;
+	this->bufWidth = 20;
+	this->bufHeight = 20;
 
 	//no image provided
 	if (imageFile == nullptr) { 
@@ -0,0 +1,194 @@
+#include <gui/frame.h>
+#include <common/trace.h>
+#include <math.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::gui;
+using namespace os::math;
+
+
+uint32_t FrameScheduler::rate = FRAME_RATE;
+uint32_t FrameScheduler::updateRate = FRAME_UPDATE_RATE;
+bool FrameScheduler::overlay = false;
+volatile bool FrameScheduler::stale = true;
+
+uint32_t FrameScheduler::fps = 0;
+uint32_t FrameScheduler::skipped = 0;
+uint32_t FrameScheduler::stageTime[FRAME_STAGES];
+
+uint64_t FrameScheduler::nextFrame = 0;
+uint64_t FrameScheduler::updateTime = 0;
+uint64_t FrameScheduler::lastShown = 0;
+uint64_t FrameScheduler::lap = 0;
+
+uint64_t FrameScheduler::windowStart = 0;
+uint32_t FrameScheduler::frames = 0;
+uint32_t FrameScheduler::skips = 0;
+uint32_t FrameScheduler::stageSum[FRAME_STAGES];
+uint32_t FrameScheduler::stageCount[FRAME_STAGES];
+
+
+
+//split so nothing goes past 32 bits, count is at most FRAME_RATE_MAX
+uint32_t FrameScheduler::Period(uint32_t count) {
+
+	uint32_t unitsPerMs = Trace::unitsPerMs;
+	return ((unitsPerMs / count) * 1000) + (((unitsPerMs % count) * 1000) / count);
+}
+
+
+
+uint8_t FrameScheduler::Begin() {
+
+	uint64_t now = Trace::Now();
+	uint32_t period = Period(rate);
+
+	if (nextFrame == 0) {
+
+		nextFrame = now;
+		updateTime = now;
+		windowStart = now;
+	}
+
+	//a lower rate set since the last frame takes effect now
+	if (nextFrame > now + period) { nextFrame = now + period; }
+
+	while (now < nextFrame) {
+
+#ifdef __EMSCRIPTEN__
+		emscripten_sleep((uint32_t)(nextFrame - now) / Trace::unitsPerMs);
+#else
+		//the 1 kHz timer interrupt wakes us well inside a
+		//frame, spinning would only keep the cpu busy
+		asm volatile("hlt");
+#endif
+		now = Trace::Now();
+	}
+
+	//slots missed by a slow frame are dropped, not rushed through
+	nextFrame += period;
+	if (nextFrame <= now) { nextFrame = now + period; }
+
+
+	//game steps keep their own time, a frame gets however many
+	//came due since the last one
+	uint32_t step = Period(updateRate);
+	uint8_t updates = 0;
+
+	while (now - updateTime >= step && updates < FRAME_MAX_UPDATES) {
+
+		updateTime += step;
+		updates++;
+	}
+	if (now - updateTime >= step) { updateTime = now; }
+
+	lap = now;
+	return updates;
+}
+
+
+bool FrameScheduler::Ready(bool changed) {
+
+	uint64_t now = Trace::Now();
+
+	if (changed == false && stale == false && now - lastShown < Period(FRAME_IDLE_RATE)) {
+
+		skips++;
+		return false;
+	}
+
+	//cleared before drawing so anything that
+	//changes during it gets the next frame
+	stale = false;
+	lastShown = now;
+
+	return true;
+}
+
+
+void FrameScheduler::Lap(uint8_t stage) {
+
+	uint64_t now = Trace::Now();
+
+	stageSum[stage] += (uint32_t)(now - lap);
+	stageCount[stage]++;
+	lap = now;
+}
+
+
+void FrameScheduler::End() {
+
+	frames++;
+
+	uint64_t now = Trace::Now();
+	uint32_t elapsed = (uint32_t)(now - windowStart);
+
+	if (elapsed < Period(1)) { return; }
+
+
+	uint32_t unitsPerMs = Trace::unitsPerMs;
+	fps = Div64((int64_t)frames * 1000 * unitsPerMs, elapsed);
+	skipped = skips;
+
+	for (uint8_t s = 0; s < FRAME_STAGES; s++) {
+
+		stageTime[s] = stageCount[s] ? Div64((int64_t)stageSum[s] * 1000, unitsPerMs * stageCount[s]) : 0;
+		stageSum[s] = 0;
+		stageCount[s] = 0;
+	}
+
+	frames = 0;
+	skips = 0;
+	windowStart = now;
+}
+
+
+
+static uint8_t Append(char* text, uint8_t n, char* str) {
+
+	for (; *str != '\0'; str++) { text[n++] = *str; }
+	return n;
+}
+
+static uint8_t AppendNumber(char* text, uint8_t n, uint32_t num) {
+
+	char digits[10];
+	uint8_t count = 0;
+
+	do {
+		digits[count++] = '0' + (num % 10);
+		num /= 10;
+
+	} while (num > 0);
+
+	while (count > 0) { text[n++] = digits[--count]; }
+	return n;
+}
+
+
+void FrameScheduler::DrawOverlay(GraphicsContext* gc) {
+
+	//at most 6 labels and 5 ten digit numbers
+	char text[96];
+	uint8_t n = 0;
+
+	n = AppendNumber(text, n, fps);
+	n = Append(text, n, " fps upd ");
+	n = AppendNumber(text, n, stageTime[FRAME_UPDATE]);
+	n = Append(text, n, " cmp ");
+	n = AppendNumber(text, n, stageTime[FRAME_COMPOSE]);
+	n = Append(text, n, " pre ");
+	n = AppendNumber(text, n, stageTime[FRAME_PRESENT]);
+	n = Append(text, n, "us skip ");
+	n = AppendNumber(text, n, skipped);
+	text[n] = '\0';
+
+	gc->FillRectangle(0, 0, (n * font_width) + 2, font_height + 1, 0x40);
+	gc->PutText(text, 1, 1, 0x3f);
+}
@@ -6,6 +6,10 @@ using namespace os::common;
 using namespace os::drivers;
 
 
+static Sprite playerSprite1(osakaPlatSprite1, 13, 20);
+static Sprite playerSprite2(osakaPlatSprite2, 13, 20);
+
+
 Platformer::Platformer() {
 
 	this->LoadData();
@@ -17,21 +21,26 @@ Platformer::~Platformer() {
 
 void Platformer::Draw(GraphicsContext* gc, uint16_t ticks) {
 
-	gc->FillRectangle(0, 0, 320, 200, 0x0b);
-	gc->FillRectangle(0, 160, 320, 200, 0x10);
+	if (background == 0 || background->Restore(gc, LAYER_PLATFORMER) == false) {
+
+		gc->FillRectangle(0, 0, 320, 200, 0x0b);
+		gc->FillRectangle(0, 160, 320, 200, 0x10);
+
+		if (background) { background->Capture(gc, LAYER_PLATFORMER); }
+	}
 
 	if (data.run) {
 	
 		switch ((ticks/5)%2) {
 		
 			case 1:
-				gc->FillBuffer(playerX, playerY, 13, 20, osakaPlatSprite1, data.facingLeft);
+				gc->DrawSprite(playerX, playerY, &playerSprite1, data.facingLeft);
 				break;
 			default:
-				gc->FillBuffer(playerX, playerY, 13, 20, osakaPlatSprite2, data.facingLeft);
+				gc->DrawSprite(playerX, playerY, &playerSprite2, data.facingLeft);
 				break;
 		}
-	} else { gc->FillBuffer(playerX, playerY, 13, 20, osakaPlatSprite1, data.facingLeft); }
+	} else { gc->DrawSprite(playerX, playerY, &playerSprite1, data.facingLeft); }
 }
 
 
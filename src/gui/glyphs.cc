@@ -0,0 +1,110 @@
+#include <gui/glyphs.h>
+#include <drivers/vga.h>
+
+
+using namespace os::common;
+using namespace os::gui;
+
+
+GlyphRows Glyphs::rows[GLYPH_COUNT];
+
+
+
+void Glyphs::Build() {
+
+	for (uint16_t g = 0; g < GLYPH_COUNT; g++) {
+
+		uint8_t* columns = (g == GLYPH_FULL) ? font_full : charset[g];
+		GlyphRows* glyph = &rows[g];
+
+		//top past bottom means there's nothing to draw
+		glyph->top = GLYPH_ROWS;
+		glyph->bottom = 0;
+
+		for (uint8_t j = 0; j < GLYPH_ROWS; j++) {
+
+			glyph->left[j] = 0;
+			glyph->right[j] = ((columns[4] >> j) & 1) ? 0xff : 0x00;
+
+			for (uint8_t i = 0; i < 4; i++) {
+
+				if ((columns[i] >> j) & 1) { glyph->left[j] |= 0xff << (i * 8); }
+			}
+
+			if (glyph->left[j] || glyph->right[j]) {
+
+				if (j < glyph->top) { glyph->top = j; }
+				glyph->bottom = j;
+			}
+		}
+	}
+}
+
+
+
+void Glyphs::Draw(uint8_t* buf, int32_t stride, int32_t x, int32_t y,
+		uint16_t glyph, uint8_t color,
+		int32_t clipX, int32_t clipY,
+		int32_t clipW, int32_t clipH) {
+
+	GlyphRows* g = &rows[glyph];
+	if (g->top > g->bottom) { return; }
+
+	int32_t top = y + g->top;
+	int32_t bottom = y + g->bottom;
+
+	//whole glyph inside, a masked word and a byte per row
+	if (x >= clipX && x + 5 <= clipX + clipW
+	&& top >= clipY && bottom < clipY + clipH) {
+
+		uint8_t* dst = buf + (stride * top) + x;
+		uint32_t color4 = color * 0x01010101;
+
+		for (uint8_t j = g->top; j <= g->bottom; j++, dst += stride) {
+
+			uint32_t mask = g->left[j];
+#ifdef __EMSCRIPTEN__
+			//no unaligned words on the web heap
+			for (uint8_t i = 0; i < 4; i++) {
+
+				if ((mask >> (i * 8)) & 1) { dst[i] = color; }
+			}
+#else
+			if (mask) { *(uint32_t*)dst = (*(uint32_t*)dst & ~mask) | (color4 & mask); }
+#endif
+			if (g->right[j]) { dst[4] = color; }
+		}
+		return;
+	}
+
+	//partly clipped, check every pixel
+	for (uint8_t j = g->top; j <= g->bottom; j++) {
+
+		int32_t Y = y + j;
+		if (Y < clipY || Y >= clipY + clipH) { continue; }
+
+		for (uint8_t i = 0; i < 5; i++) {
+
+			int32_t X = x + i;
+			bool set = (i < 4) ? ((g->left[j] >> (i * 8)) & 1) : g->right[j];
+
+			if (set && X >= clipX && X < clipX + clipW) { buf[(stride * Y) + X] = color; }
+		}
+	}
+}
+
+
+
+void Glyphs::DrawString(uint8_t* buf, int32_t stride, int32_t x, int32_t y,
+		char* str, uint8_t color,
+		int32_t clipX, int32_t clipY,
+		int32_t clipW, int32_t clipH) {
+
+	if (y + GLYPH_ROWS <= clipY || y >= clipY + clipH) { return; }
+
+	for (int i = 0; str[i] != '\0'; i++, x += font_width) {
+
+		if (x >= clipX + clipW) { break; }
+		Draw(buf, stride, x, y, Index(str[i]), color, clipX, clipY, clipW, clipH);
+	}
+}
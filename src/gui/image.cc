@@ -0,0 +1,250 @@
+#include <gui/image.h>
+
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::filesystem;
+using namespace os::gui;
+
+
+//where the pixels are and how they're laid out
+struct ImageFormat {
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset;
+	uint32_t stride;
+	uint8_t bytesPerPixel;
+	uint16_t maxValue;
+	bool bgr;
+	bool topDown;
+};
+
+
+static inline uint32_t Read32(uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24); }
+static inline uint16_t Read16(uint8_t* p) { return p[0] | (p[1] << 8); }
+
+
+
+//windows bitmap, only BI_RGB at 24 or 32 bits
+static bool BitmapHeader(uint8_t* header, uint32_t size, ImageFormat* format) {
+
+	if (size < 54 || header[0] != 'B' || header[1] != 'M') { return false; }
+	if (Read32(header + 14) < 40 || Read32(header + 30) != 0) { return false; }
+
+	int32_t width = (int32_t)Read32(header + 18);
+	int32_t height = (int32_t)Read32(header + 22);
+	uint16_t bits = Read16(header + 28);
+
+	if (bits != 24 && bits != 32) { return false; }
+	if (width <= 0 || width > 0xffff || height == 0 || height > 0xffff || height < -0xffff) { return false; }
+
+	//rows are stored bottom up unless the height is negative
+	format->topDown = height < 0;
+	format->width = width;
+	format->height = format->topDown ? -height : height;
+	format->offset = Read32(header + 10);
+	format->bytesPerPixel = bits / 8;
+	format->stride = ((format->width * bits + 31) / 32) * 4;
+	format->maxValue = 255;
+	format->bgr = true;
+
+	return true;
+}
+
+
+//binary ppm, header fields split by whitespace and # comments
+static bool PixmapHeader(uint8_t* header, uint32_t size, ImageFormat* format) {
+
+	if (size < 2 || header[0] != 'P' || header[1] != '6') { return false; }
+
+	uint32_t fields[3];
+	uint32_t i = 2;
+
+	for (uint8_t f = 0; f < 3; f++) {
+
+		while (i < size) {
+
+			if (header[i] == '#') {
+
+				while (i < size && header[i] != '\n') { i++; }
+
+			} else if (header[i] == ' ' || header[i] == '\t' || header[i] == '\r' || header[i] == '\n') {
+				i++;
+			} else {
+				break;
+			}
+		}
+
+		if (i >= size || header[i] < '0' || header[i] > '9') { return false; }
+
+		fields[f] = 0;
+
+		for (; i < size && header[i] >= '0' && header[i] <= '9'; i++) {
+
+			fields[f] = (fields[f] * 10) + (header[i] - '0');
+			if (fields[f] > 0xffff) { return false; }
+		}
+	}
+
+	//a single whitespace and then the pixels
+	if (i >= size || fields[0] == 0 || fields[1] == 0) { return false; }
+	if (fields[2] == 0 || fields[2] > 255) { return false; }
+
+	format->width = fields[0];
+	format->height = fields[1];
+	format->offset = i + 1;
+	format->bytesPerPixel = 3;
+	format->stride = fields[0] * 3;
+	format->maxValue = fields[2];
+	format->bgr = false;
+	format->topDown = true;
+
+	return true;
+}
+
+
+
+bool ImageImport::Decode(FileSystem* filesystem, VideoGraphicsArray* vga,
+			char* name, uint8_t* dest,
+			uint16_t destWidth, uint16_t destHeight,
+			uint16_t* retWidth, uint16_t* retHeight) {
+
+	int32_t handle = filesystem->Open(name);
+	if (handle < 0) { return false; }
+
+	uint8_t header[IMAGE_HEADER_SIZE];
+	uint32_t got = filesystem->Read(handle, header, IMAGE_HEADER_SIZE);
+
+	ImageFormat format;
+	uint32_t size = filesystem->GetFileSize(name);
+
+	if ((BitmapHeader(header, got, &format) || PixmapHeader(header, got, &format)) == false
+	|| format.offset > size || (size - format.offset) / format.height < format.stride) {
+
+		filesystem->Close(handle);
+		return false;
+	}
+
+
+	//fit inside dest keeping the aspect, never scaled up
+	uint32_t fitWidth = destWidth < IMAGE_MAX_WIDTH ? destWidth : IMAGE_MAX_WIDTH;
+	uint32_t width = format.width;
+	uint32_t height = format.height;
+
+	if (width > fitWidth) {
+
+		height = (height * fitWidth) / width;
+		width = fitWidth;
+	}
+	if (height > destHeight) {
+
+		width = (width * destHeight) / height;
+		height = destHeight;
+	}
+	if (width == 0) { width = 1; }
+	if (height == 0) { height = 1; }
+
+	*retWidth = width;
+	*retHeight = height;
+
+
+	MemoryManager* memoryManager = filesystem->memoryManager;
+
+	uint8_t* row = (uint8_t*)(memoryManager->malloc(format.stride));
+	uint32_t* sum = (uint32_t*)(memoryManager->malloc(width * 3 * sizeof(uint32_t)));
+	uint32_t* pixels = (uint32_t*)(memoryManager->malloc(width * sizeof(uint32_t)));
+	uint16_t* columns = (uint16_t*)(memoryManager->malloc(width * sizeof(uint16_t)));
+
+	bool allocated = row && sum && pixels && columns;
+	uint32_t done = 0;
+
+	if (allocated && filesystem->Seek(handle, format.offset)) {
+
+		//source columns that land in each dest column, the
+		//same stepping is used to find them for every row
+		for (uint32_t x = 0; x < width; x++) { columns[x] = 0; }
+		for (uint32_t x = 0; x < width * 3; x++) { sum[x] = 0; }
+
+		uint32_t column = 0;
+		uint32_t columnStep = 0;
+
+		for (uint32_t x = 0; x < format.width; x++) {
+
+			columns[column]++;
+			columnStep += width;
+			if (columnStep >= format.width) { columnStep -= format.width; column++; }
+		}
+
+		if (ColorTable::stale) { ColorTable::Build(vga->colors, VGA_COLOR_BITS); }
+		ColorTable::DitherBegin(width);
+
+		uint32_t rows = 0;
+		uint32_t step = 0;
+
+		for (uint32_t y = 0; y < format.height; y++) {
+
+			if (filesystem->Read(handle, row, format.stride) < format.width * format.bytesPerPixel) { break; }
+
+			//add the row into its dest row's boxes
+			uint8_t* p = row;
+			uint32_t* s = sum;
+			columnStep = 0;
+
+			for (uint32_t x = 0; x < format.width; x++, p += format.bytesPerPixel) {
+
+				if (format.bgr) {
+
+					s[0] += p[2];
+					s[1] += p[1];
+					s[2] += p[0];
+				} else {
+					s[0] += p[0];
+					s[1] += p[1];
+					s[2] += p[2];
+				}
+
+				columnStep += width;
+				if (columnStep >= format.width) { columnStep -= format.width; s += 3; }
+			}
+			rows++;
+
+
+			//last source row of this dest row, average and dither it
+			step += height;
+			if (step < format.height) { continue; }
+			step -= format.height;
+
+			for (uint32_t x = 0; x < width; x++) {
+
+				uint32_t count = columns[x] * rows;
+				uint32_t rgb[3];
+
+				for (uint8_t i = 0; i < 3; i++) {
+
+					rgb[i] = sum[(x * 3) + i] / count;
+					if (format.maxValue != 255) { rgb[i] = (rgb[i] * 255) / format.maxValue; }
+					if (rgb[i] > 255) { rgb[i] = 255; }
+
+					sum[(x * 3) + i] = 0;
+				}
+				pixels[x] = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+			}
+
+			uint32_t destY = format.topDown ? done : height - 1 - done;
+			ColorTable::DitherRow(pixels, dest + (destY * destWidth));
+
+			rows = 0;
+			done++;
+		}
+	}
+
+	if (row) { memoryManager->free(row); }
+	if (sum) { memoryManager->free(sum); }
+	if (pixels) { memoryManager->free(pixels); }
+	if (columns) { memoryManager->free(columns); }
+
+	filesystem->Close(handle);
+	return done == height;
+}
@@ -0,0 +1,47 @@
+#include <gui/layer.h>
+
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::gui;
+
+
+
+Layer::Layer() {
+
+	this->key = 0;
+	this->valid = false;
+}
+
+Layer::~Layer() {
+}
+
+
+
+bool Layer::Restore(GraphicsContext* gc, uint32_t key) {
+
+	if (this->valid == false || this->key != key) { return false; }
+
+	//the whole screen is replaced, presenting still only
+	//sends the rows that came out different
+	Span::Copy(gc->pixels, this->pixels, WIDTH_13H * HEIGHT_13H);
+	gc->MarkAllDirty();
+
+	return true;
+}
+
+
+void Layer::Capture(GraphicsContext* gc, uint32_t key) {
+
+	Span::Copy(this->pixels, gc->pixels, WIDTH_13H * HEIGHT_13H);
+
+	this->key = key;
+	this->valid = true;
+}
+
+
+void Layer::Invalidate() {
+
+	this->valid = false;
+}
@@ -7,10 +7,6 @@ using namespace os::common;
 using namespace os::drivers;
 
 
-double getTicks();
-uint8_t Web2EGA(uint32_t color);
-
-
 RaycastSpace::RaycastSpace() {
 
 	for (int h = 0; h < spaceH; h++) {
@@ -23,236 +19,291 @@ RaycastSpace::RaycastSpace() {
 
 	//generate textures
 	for (int i = 0; i < 8; i++) {
-		for (int x = 0; x < texW; x++) {
-			for (int y = 0; y < texH; y++) {
+		for (int x = 0; x < RAY_TEX_SIZE; x++) {
+			for (int y = 0; y < RAY_TEX_SIZE; y++) {
 		
-				uint16_t texCoord = texW*y+x;
+				//patterns are worked out on rows, stored in columns
+				uint16_t texCoord = RAY_TEX_SIZE*y+x;
+				uint16_t texel = RAY_TEX_SIZE*x+y;
 
 				if (i == 2) {
 				
 					switch (texCoord % 8) {
 					
-						case 0:textures[i][texCoord] = 0x31;break;
-						default:textures[i][texCoord] = 0x0f;break;
+						case 0:textures[i][texel] = 0x31;break;
+						default:textures[i][texel] = 0x0f;break;
 					}
 
 				} else if (i == 3) {
 					
 					switch (texCoord % 8) {
 					
-						case 0:textures[i][texCoord] = 0x38;break;
-						default:textures[i][texCoord] = 0x07;break;
+						case 0:textures[i][texel] = 0x38;break;
+						default:textures[i][texel] = 0x07;break;
 					}
 				} else {
 					switch (y) {
 
 						case 0:case 1:case 56:case 57:case 62:case 63:
-							textures[i][texCoord] = 0x39;break;
+							textures[i][texel] = 0x39;break;
 						
-						case 3:textures[i][texCoord] = 0x0f;break;
+						case 3:textures[i][texel] = 0x0f;break;
 						
 						case 58:case 59:case 60:case 61:
-							textures[i][texCoord] = 0x03;break;
+							textures[i][texel] = 0x03;break;
 						
-						default:textures[i][texCoord] = 0x1f;break;
+						default:textures[i][texel] = 0x1f;break;
 					}
 				}
 			}
 		}
 	}
+
+
+	//floor distance only depends on the row, the camera is
+	//half the screen up, the horizon row just gets a far one
+	for (int p = 0; p < HEIGHT_13H / 2; p++) {
+
+		this->rowDistance[p] = ((HEIGHT_13H / 2) << RAY_SHIFT) / (p > 0 ? p : 1);
+	}
+
+	this->tableAngle = -1;
+	this->layerX = -1;
+	this->layerY = -1;
+	this->layerAngle = RAY_ANGLES;
+	this->SetCamera(this->posX, this->posY, this->angle);
 }
 
+
 RaycastSpace::~RaycastSpace() {
 }
 
 
 
-void RaycastSpace::ComputeSpace(GraphicsContext* gc, char keylog[16], uint8_t logIndex, int32_t mouseX) {
+void RaycastSpace::SetCamera(int32_t x, int32_t y, uint16_t angle) {
 
-	
-	double time = 0;
-	double oldTime = 0;
+	this->posX = x;
+	this->posY = y;
+	this->angle = angle % RAY_ANGLES;
+
+	//plane is dir turned a quarter clockwise, 0.66 wide for the fov
+	this->dirX = Cos(this->angle);
+	this->dirY = Sin(this->angle);
+	this->planeX = Mul(this->dirY, RAY_FIX(0.66));
+	this->planeY = Mul(-this->dirX, RAY_FIX(0.66));
+}
 
-	const uint16_t w = 320;
-	const uint8_t h = 200;
 
-	gc->FillRectangle(0, 0, 320, 200, 0x40);
 
+void RaycastSpace::BuildColumns() {
 
-	//floor casting
-	for (int y = 0; y < h; y++) {
+	for (int32_t x = 0; x < WIDTH_13H; x++) {
 	
-		float rayDirX0 = dirX - planeX;
-		float rayDirY0 = dirY - planeY;
-		float rayDirX1 = dirX + planeX;
-		float rayDirY1 = dirY + planeY;
+		//-1 at the left edge to almost 1 at the right
+		int32_t cameraX = ((2 * x - WIDTH_13H) << RAY_SHIFT) / WIDTH_13H;
+
+		int32_t rayX = this->dirX + Mul(this->planeX, cameraX);
+		int32_t rayY = this->dirY + Mul(this->planeY, cameraX);
+
+		this->rayDirX[x] = rayX;
+		this->rayDirY[x] = rayY;
 
-		//horizon
-		int p = y - h / 2;
+		//1/ray in 16.16 is 2^32/ray, near 0 it's just far
+		uint32_t absX = rayX < 0 ? -rayX : rayX;
+		uint32_t absY = rayY < 0 ? -rayY : rayY;
 
-		//vertical pos of cam
-		float posZ = 0.5 * h;
+		this->deltaDistX[x] = (absX <= 0xffffffff / RAY_FAR) ? RAY_FAR : 0xffffffff / absX;
+		this->deltaDistY[x] = (absY <= 0xffffffff / RAY_FAR) ? RAY_FAR : 0xffffffff / absY;
+	}
+	this->tableAngle = this->angle;
+}
 
-		//horizontal distance from cam to floor
-		float rowDistance = posZ / p;
 
-		//real world step vector to add for each x
-		float floorStepX = rowDistance * (rayDirX1 - rayDirX0) / w;
-		float floorStepY = rowDistance * (rayDirY1 - rayDirY0) / w;
 
-		//coords of leftmost column
-		float floorX = posX + rowDistance * rayDirX0;
-		float floorY = posY + rowDistance * rayDirY0;
+//the floor and the ceiling mirrored over the horizon, each row is
+//a straight line across the floor so it's stepped along as spans
+void RaycastSpace::DrawFloor(uint8_t* pixels) {
 
-		for (int x = 0; x < w; ++x) {
-		
-			int cellX = (int)(floorX);
-			int cellY = (int)(floorY);
+	int32_t rayX0 = this->dirX - this->planeX;
+	int32_t rayY0 = this->dirY - this->planeY;
+	int32_t rayX1 = this->dirX + this->planeX;
+	int32_t rayY1 = this->dirY + this->planeY;
+
+	uint8_t* floorTexture = this->textures[2];
+	uint8_t* ceilingTexture = this->textures[3];
 
-			//tex coords from fractional part
-			int tx = (int)(texW * (floorX - cellX)) & (texW - 1);
-			int ty = (int)(texH * (floorY - cellY)) & (texH - 1);
+	for (int32_t p = 0; p < HEIGHT_13H / 2; p++) {
 
-			floorX += floorStepX;
-			floorY += floorStepY;
+		int32_t distance = this->rowDistance[p];
 
-			//choose textures and color
-			int floorTexture = 2;
-			int ceilingTexture = 3;
-			uint8_t color;
+		//real world step for each x and where the left column lands
+		int32_t stepX = Mul(distance, rayX1 - rayX0) / WIDTH_13H;
+		int32_t stepY = Mul(distance, rayY1 - rayY0) / WIDTH_13H;
 
-			//draw floor
-			color = textures[floorTexture][texW*ty+tx];
-			gc->PutPixel(x, y, color);
+		int32_t floorX = this->posX + Mul(distance, rayX0);
+		int32_t floorY = this->posY + Mul(distance, rayY0);
 
-			//draw ceiling
-			color = textures[ceilingTexture][texW*ty+tx];
-			gc->PutPixel(x, h-y-1, color);
+		uint8_t* floor = pixels + (WIDTH_13H * (HEIGHT_13H / 2 + p));
+		uint8_t* ceiling = pixels + (WIDTH_13H * (HEIGHT_13H / 2 - 1 - p));
+
+		for (int32_t x = 0; x < WIDTH_13H; x++) {
+
+			//texel from the fraction of the cell
+			uint16_t tx = (floorX >> (RAY_SHIFT - RAY_TEX_SHIFT)) & (RAY_TEX_SIZE - 1);
+			uint16_t ty = (floorY >> (RAY_SHIFT - RAY_TEX_SHIFT)) & (RAY_TEX_SIZE - 1);
+			uint16_t texel = (tx << RAY_TEX_SHIFT) | ty;
+
+			floor[x] = floorTexture[texel];
+			ceiling[x] = ceilingTexture[texel];
+
+			floorX += stepX;
+			floorY += stepY;
 		}
 	}
+}
 
 
-	//draw frame and walls
-	for (double x = 0; x < w; x++) {
-	
-		//calculate ray position and direction
-		double cameraX = 2.0 * x / w - 1.0;
-		double rayDirX = dirX + planeX * cameraX;
-		double rayDirY = dirY + planeY * cameraX;
-	
-		//box of map player is in
-		int mapX = int(posX);
-		int mapY = int(posY);
 
-		//length of ray from current position to next x or y side
-		double sideDistX = 0;
-		double sideDistY = 0;
-		
+void RaycastSpace::DrawWalls(uint8_t* pixels) {
 
-		double deltaDistX = (rayDirX == 0) ? 1e30 : absD(1.0/rayDirX);
-		double deltaDistY = (rayDirY == 0) ? 1e30 : absD(1.0/rayDirY);
-		double perpWallDist = 0;
+	const int32_t h = HEIGHT_13H;
 
-		int stepX, stepY = 0;
+	for (int32_t x = 0; x < WIDTH_13H; x++) {
+	
+		int32_t rayX = this->rayDirX[x];
+		int32_t rayY = this->rayDirY[x];
+		int32_t deltaX = this->deltaDistX[x];
+		int32_t deltaY = this->deltaDistY[x];
 
-		int hit = 0; //wall hit
-		int side = 0; //ns or ew wall hit
+		//box of map player is in
+		int32_t mapX = this->posX >> RAY_SHIFT;
+		int32_t mapY = this->posY >> RAY_SHIFT;
 
-		//calculate step and initial sideDist
-		if (rayDirX < 0) {
-		
-			stepX = -1;
-			sideDistX = (posX - mapX) * deltaDistX;
-		} else {
-			stepX = 1;
-			sideDistX = (mapX + 1.0 - posX) * deltaDistX;
-		}
+		int32_t fracX = this->posX & (RAY_ONE - 1);
+		int32_t fracY = this->posY & (RAY_ONE - 1);
 
-		if (rayDirY < 0) {
+		//length of ray from current position to next x or y side
+		int32_t stepX = rayX < 0 ? -1 : 1;
+		int32_t stepY = rayY < 0 ? -1 : 1;
+		int32_t sideDistX = Mul(rayX < 0 ? fracX : RAY_ONE - fracX, deltaX);
+		int32_t sideDistY = Mul(rayY < 0 ? fracY : RAY_ONE - fracY, deltaY);
 
-			stepY = -1;
-			sideDistY = (posY - mapY) * deltaDistY;
-		} else {
-			stepY = 1;
-			sideDistY = (mapY + 1.0 - posY) * deltaDistY;
-		}
+		int side = 0; //ns or ew wall hit
 
 		//perform DDA
-		while (hit == 0) {
+		while (true) {
 
 			//jump to next map square
 			if (sideDistX < sideDistY) {
 
-				sideDistX += deltaDistX;
+				sideDistX += deltaX;
 				mapX += stepX;
 				side = 0;
 			} else {
-				sideDistY += deltaDistY;
+				sideDistY += deltaY;
 				mapY += stepY;
 				side = 1;
 			}
 			//check if ray has hit a wall
-			if (worldMap[mapX][mapY] > 0) { hit = 1; }
+			if (mapX < 0 || mapX >= spaceW || mapY < 0 || mapY >= spaceH) { break; }
+			if (worldMap[mapX][mapY] > 0) { break; }
 		}
+		if (mapX < 0 || mapX >= spaceW || mapY < 0 || mapY >= spaceH) { continue; }
 
 		//calculate distance projected on camera direction
 		//otherwise fisheye effect
-		if (side == 0) { perpWallDist = (sideDistX - deltaDistX); }
-		else           { perpWallDist = (sideDistY - deltaDistY); }
+		int32_t perpWallDist = (side == 0) ? sideDistX - deltaX : sideDistY - deltaY;
+		if (perpWallDist < RAY_NEAR) { perpWallDist = RAY_NEAR; }
 
 
 		//calculate height of line to draw on screen
-		int lineHeight = (int)(h / perpWallDist);
-
-		//height of camera
-		int pitch = 0;
+		int32_t lineHeight = (h << RAY_SHIFT) / perpWallDist;
+		if (lineHeight < 1) { lineHeight = 1; }
 
 		//calculate lowest and highest pixel to fill current stripe
-		int drawStart = -lineHeight / 2 + h / 2 + pitch;
+		int32_t drawStart = -lineHeight / 2 + h / 2;
 		if (drawStart < 0) { drawStart = 0; }
-		int drawEnd = lineHeight / 2 + h / 2 + pitch;
+		int32_t drawEnd = lineHeight / 2 + h / 2;
 		if (drawEnd >= h) { drawEnd = h - 1; }
 
 
 		//texture calculations
 		int texNum = worldMap[mapX][mapY] - 1;
 
-		//calculate value of wallx
-		double wallX; //where wall was hit
-		if (side == 0) { wallX = posY + perpWallDist * rayDirY;
-		} else {         wallX = posX + perpWallDist * rayDirX; }
-		wallX -= (double)((int)wallX);
-
-		//x coordinate on texture
-		int texX = int(wallX * double(texW));
-		if (side == 0 && rayDirX > 0) { texX = texW - texX - 1; }
-		if (side == 1 && rayDirX < 0) { texX = texW - texX - 1; }
-		double step = 1.0 * texH / lineHeight;
-		
+		//where the wall was hit, x coordinate on texture
+		int32_t wallX = (side == 0) ? this->posY + Mul(perpWallDist, rayY)
+					    : this->posX + Mul(perpWallDist, rayX);
+
+		int32_t texX = (wallX & (RAY_ONE - 1)) >> (RAY_SHIFT - RAY_TEX_SHIFT);
+		if (side == 0 && rayX > 0) { texX = RAY_TEX_SIZE - texX - 1; }
+		if (side == 1 && rayX < 0) { texX = RAY_TEX_SIZE - texX - 1; }
+
+		int32_t step = (RAY_TEX_SIZE << RAY_SHIFT) / lineHeight;
+		int32_t texPos = (drawStart - h / 2 + lineHeight / 2) * step;
 
-		//draw walls and their textures.
-		//starting texture coordinate
-		double texPos = (drawStart - h / 2 + lineHeight / 2) * step;
-		for (int y = drawStart; y < drawEnd; y++) {
+
+		//draw walls and their textures, the stripe
+		//is one column of the texture read downwards
+		uint8_t* column = this->textures[texNum] + (texX << RAY_TEX_SHIFT);
+		uint8_t* dst = pixels + (WIDTH_13H * drawStart) + x;
+
+		for (int32_t y = drawStart; y < drawEnd; y++, dst += WIDTH_13H) {
 		
-			int texY = (int)texPos & (texH - 1);
+			uint8_t color = column[(texPos >> RAY_SHIFT) & (RAY_TEX_SIZE - 1)];
 			texPos += step;
-			uint8_t color = textures[texNum][texH*texY+texX];
 			
 			//make color darker for y-sides
-			if (side == 1) { color = light2dark[color]; }
-			gc->PutPixel(x, y, color);
+			*dst = (side == 1) ? light2dark[color] : color;
 		}
 	}
-	oldTime = time;
-	time = getTicks() / 40.0;
-	double frameTime = (time - oldTime) / 1000.0;
+}
+
+
+
+bool RaycastSpace::Blocked(int32_t x, int32_t y) {
+
+	int32_t mapX = x >> RAY_SHIFT;
+	int32_t mapY = y >> RAY_SHIFT;
+
+	if (mapX < 0 || mapX >= spaceW || mapY < 0 || mapY >= spaceH) { return true; }
+	return worldMap[mapX][mapY] != 0;
+}
+
+
+
+void RaycastSpace::DrawSpace(GraphicsContext* gc) {
 
-	//speed modifiers
-	double moveSpeed = frameTime * 3.0;
-	double rotSpeed = frameTime * (double)(mouseX/4);
+	//rays only change when the camera turns
+	if (this->angle != this->tableAngle) { this->BuildColumns(); }
 
+	//every pixel gets drawn so it goes straight to the back buffer,
+	//the floor only changes when the camera does and standing
+	//still it comes back from the layer under fresh walls
+	bool still = this->posX == this->layerX && this->posY == this->layerY && this->angle == this->layerAngle;
 
+	if (this->background == 0 || still == false || this->background->Restore(gc, LAYER_SHOOTER) == false) {
+
+		gc->MarkDirty(0, 0, WIDTH_13H, HEIGHT_13H);
+		this->DrawFloor(gc->pixels);
+
+		if (this->background) {
+
+			this->background->Capture(gc, LAYER_SHOOTER);
+			this->layerX = this->posX;
+			this->layerY = this->posY;
+			this->layerAngle = this->angle;
+		}
+	}
+	this->DrawWalls(gc->pixels);
+}
+
+
+void RaycastSpace::MoveCamera(char keylog[16], uint8_t logIndex, int32_t mouseX) {
+
+	//speed modifiers, per step
+	int32_t moveSpeed = RAY_FIX(0.05);
+	int32_t moveX = 0;
+	int32_t moveY = 0;
 
 	//input
 	if (this->keyDown) {
@@ -263,44 +314,36 @@ void RaycastSpace::ComputeSpace(GraphicsContext* gc, char keylog[16], uint8_t lo
 	
 				//walking
 				case 'w':
-					if (worldMap[int(posX+dirX*moveSpeed)][int(posY)] == false) { posX += dirX * moveSpeed; }
-					if (worldMap[int(posX)][int(posY+dirY*moveSpeed)] == false) { posY += dirY * moveSpeed; }
+					moveX = Mul(dirX, moveSpeed);
+					moveY = Mul(dirY, moveSpeed);
 					break;
 				case 'a':
-					if (worldMap[int(posX-planeX*moveSpeed)][int(posY)] == false) { posX -= planeX * moveSpeed; }
-					if (worldMap[int(posX)][int(posY-planeY*moveSpeed)] == false) { posY -= planeY * moveSpeed; }
+					moveX = -Mul(planeX, moveSpeed);
+					moveY = -Mul(planeY, moveSpeed);
 					break;
 				case 's':
-					if (worldMap[int(posX-dirX*moveSpeed)][int(posY)] == false) { posX -= dirX * moveSpeed; }
-					if (worldMap[int(posX)][int(posY-dirY*moveSpeed)] == false) { posY -= dirY * moveSpeed; }
+					moveX = -Mul(dirX, moveSpeed);
+					moveY = -Mul(dirY, moveSpeed);
 					break;
 				case 'd':
-					if (worldMap[int(posX+planeX*moveSpeed)][int(posY)] == false) { posX += planeX * moveSpeed; }
-					if (worldMap[int(posX)][int(posY+planeY*moveSpeed)] == false) { posY += planeY * moveSpeed; }
+					moveX = Mul(planeX, moveSpeed);
+					moveY = Mul(planeY, moveSpeed);
 					break;
+				default:
+					continue;
 			}
+			if (this->Blocked(posX + moveX, posY) == false) { posX += moveX; }
+			if (this->Blocked(posX, posY + moveY) == false) { posY += moveY; }
 		}
 	}
 
-	//rotate right
-	if (mouseX < w/2) {
-		
-		double oldDirX = dirX;
-		dirX = dirX * cos(-rotSpeed) - dirY * sin(-rotSpeed);
-		dirY = oldDirX * sin(-rotSpeed) + dirY * cos(-rotSpeed);
-		double oldPlaneX = planeX;
-		planeX = planeX * cos(-rotSpeed) - planeY * sin(-rotSpeed);
-		planeY = oldPlaneX * sin(-rotSpeed) + planeY * cos(-rotSpeed);
-	}
-	
-	//rotate left
-	if (mouseX > w/2) {
-		
-		double oldDirX = dirX;
-		dirX = dirX * cos(rotSpeed) - dirY * sin(rotSpeed);
-		dirY = oldDirX * sin(rotSpeed) + dirY * cos(rotSpeed);
-		double oldPlaneX = planeX;
-		planeX = planeX * cos(rotSpeed) - planeY * sin(rotSpeed);
-		planeY = oldPlaneX * sin(rotSpeed) + planeY * cos(rotSpeed);
+
+	//turn further the further the mouse is from the middle,
+	//left of it is clockwise same as before
+	int32_t turn = (mouseX - WIDTH_13H / 2) / 16;
+
+	if (turn != 0) {
+
+		this->SetCamera(posX, posY, (this->angle + RAY_ANGLES + turn) % RAY_ANGLES);
 	}
 }
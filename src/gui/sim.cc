@@ -1,5 +1,6 @@
 #include <gui/sim.h>
 
+using namespace os;
 using namespace os::common;
 using namespace os::drivers;
 using namespace os::gui;
@@ -12,6 +13,67 @@ uint16_t prng();
 void reboot();
 
 
+//room art and osaka, encoded once at boot
+static Sprite dreamBubbleMini1Sprite(dreamBubbleMini1, 4, 4);
+static Sprite dreamBubbleMini2Sprite(dreamBubbleMini2, 5, 5);
+static Sprite dreamBubbleHalfSprite(dreamBubbleHalf, 21, 29);
+static Sprite cursorChiChiSprite(cursorChiChi, 17, 19);
+static Sprite osakaPlatDreamSprite(osakaPlatSprite1, 13, 20);
+static Sprite pigtailUpSprite(pigtailUp, 9, 10);
+static Sprite pigtailDownSprite(pigtailDown, 11, 8);
+static Sprite catPosterSprite(catPoster, 20, 30);
+static Sprite awakeningPosterSprite(awakeningPoster, 20, 30);
+static Sprite brazilPosterSprite(brazilPoster, 20, 30);
+static Sprite wallOutletSprite(wallOutlet, 7, 10);
+static Sprite crtTVSprite(crtTV, 38, 33);
+static Sprite gameConsoleSprite(gameConsole, 17, 15);
+static Sprite computerSprite(computer, 20, 23);
+static Sprite deskSprite(desk, 49, 46);
+static Sprite crtPCSprite(crtPC, 22, 18);
+static Sprite keyboardSprite(keyboard, 16, 7);
+static Sprite keyboardCableSprite(keyboardCable, 9, 8);
+static Sprite mouseSprite(mouse, 7, 9);
+static Sprite bongDirtySprite(bongDirty, 11, 18);
+static Sprite chairSprite(chair, 30, 40);
+static Sprite dresserSprite(dresser, 49, 26);
+static Sprite photoFrameSprite(photoFrame, 10, 10);
+static Sprite blindsRepeatSprite(blindsRepeat, 35, 8);
+static Sprite windowShelfSprite(windowShelf, 38, 9);
+static Sprite lampSprite(lamp, 17, 59);
+static Sprite bedSprite(bed, 76, 61);
+static Sprite osakaSleepSprite(osakaSleep, 17, 10);
+
+static Sprite osakaWalkSprites[] = {
+	Sprite(osakaSprites[0], osakaWidths[0], 49),
+	Sprite(osakaSprites[1], osakaWidths[1], 49),
+	Sprite(osakaSprites[2], osakaWidths[2], 49),
+	Sprite(osakaSprites[3], osakaWidths[3], 49),
+	Sprite(osakaSprites[4], osakaWidths[4], 49),
+	Sprite(osakaSprites[5], osakaWidths[5], 49),
+	Sprite(osakaSprites[6], osakaWidths[6], 49),
+	Sprite(osakaSprites[7], osakaWidths[7], 49),
+	Sprite(osakaSprites[8], osakaWidths[8], 49),
+	Sprite(osakaSprites[9], osakaWidths[9], 49),
+	Sprite(osakaSprites[10], osakaWidths[10], 49),
+	Sprite(osakaSprites[11], osakaWidths[11], 49)
+};
+
+static Sprite osakaSummerWalkSprites[] = {
+	Sprite(osakaSummerSprites[0], osakaWidths[0], 19),
+	Sprite(osakaSummerSprites[1], osakaWidths[1], 19),
+	Sprite(osakaSummerSprites[2], osakaWidths[2], 19),
+	Sprite(osakaSummerSprites[3], osakaWidths[3], 19),
+	Sprite(osakaSummerSprites[4], osakaWidths[4], 19),
+	Sprite(osakaSummerSprites[5], osakaWidths[5], 19),
+	Sprite(osakaSummerSprites[6], osakaWidths[6], 19),
+	Sprite(osakaSummerSprites[7], osakaWidths[7], 19),
+	Sprite(osakaSummerSprites[8], osakaWidths[8], 19),
+	Sprite(osakaSummerSprites[9], osakaWidths[9], 19),
+	Sprite(osakaSummerSprites[10], osakaWidths[10], 19),
+	Sprite(osakaSummerSprites[11], osakaWidths[11], 19)
+};
+
+
 
 Simulator::Simulator(CMOS* cmos) {
 
@@ -34,6 +96,9 @@ Simulator::Simulator(CMOS* cmos) {
 		walkPixels[i].y = 0;
 	}
 
+	this->platformer.background = &this->background;
+	this->shooter.raycaster.background = &this->background;
+
 	this->cmos = cmos;
 	cmos->ReadRTC();
 }
@@ -330,25 +395,25 @@ void Simulator::Dream(GraphicsContext* gc) {
 	//gc->FillBuffer(241, 79, 76, 61, bed, false);
 
 	//first dream bubble
-	gc->FillBuffer(275, 73, 4, 4, dreamBubbleMini1, false);
+	gc->DrawSprite(275, 73, &dreamBubbleMini1Sprite, false);
 
 	//second dream bubble	
 	if (ticks > 780) {
 	
-		gc->FillBuffer(264, 67, 5, 5, dreamBubbleMini2, false);
+		gc->DrawSprite(264, 67, &dreamBubbleMini2Sprite, false);
 	}
 	
 	//third dream bubble	
 	if (ticks > 900) {
 	
-		gc->FillBuffer(220, 40, 21, 29, dreamBubbleHalf, false);
-		gc->FillBuffer(240, 40, 21, 29, dreamBubbleHalf, true);
+		gc->DrawSprite(220, 40, &dreamBubbleHalfSprite, false);
+		gc->DrawSprite(240, 40, &dreamBubbleHalfSprite, true);
 
 		switch (this->ticks / (3600)) {
 	
 			case 0:
-				gc->FillBuffer(224, 44, 17, 19, cursorChiChi, false);
-				gc->FillBuffer(242, 44, 13, 20, osakaPlatSprite1, true);
+				gc->DrawSprite(224, 44, &cursorChiChiSprite, false);
+				gc->DrawSprite(242, 44, &osakaPlatDreamSprite, true);
 				break;
 			case 1:
 				gc->PutText("=D", 230, 50, 0x40);
@@ -383,16 +448,21 @@ void Simulator::Fly(GraphicsContext* gc, uint16_t osakaSpriteNum) {
 		default:
 			break;
 	}
-	osakaY--;
-
 	if ((osakaY % 20) < 10) {
 	
-		gc->FillBuffer(osakaX-6, osakaY-6, 9, 10, pigtailUp, false);
-		gc->FillBuffer(osakaX+13, osakaY-6, 9, 10, pigtailUp, true);
+		gc->DrawSprite(osakaX-6, osakaY-6, &pigtailUpSprite, false);
+		gc->DrawSprite(osakaX+13, osakaY-6, &pigtailUpSprite, true);
 	} else {
-		gc->FillBuffer(osakaX-7, osakaY, 11, 8, pigtailDown, true);
-		gc->FillBuffer(osakaX+12, osakaY, 11, 8, pigtailDown, false);
+		gc->DrawSprite(osakaX-7, osakaY, &pigtailDownSprite, true);
+		gc->DrawSprite(osakaX+12, osakaY, &pigtailDownSprite, false);
 	}
+}
+
+
+//up a pixel a step, off the top of the screen starts an event
+void Simulator::Rise() {
+
+	osakaY--;
 
 	if (osakaY < -150) {
 	
@@ -462,66 +532,36 @@ void Simulator::ComputeGameState() {
 		
 		default://normal room
 			this->Walk();
+
+			//only while the room is what's drawn
+			if (this->flying && this->sleeping == false && this->menu == false && this->event == 0) { this->Rise(); }
 			break;
 	}
 	this->ticks++;
 
-	//60 frames
-	this->cmos->pit->sleep(15);
-}
-
-
-void Simulator::DrawRoom(GraphicsContext* gc) {
+	//events count at double time and end in a reboot
+	switch (event) {
 
-	this->ComputeGameState();
-	
-	//draw menu select
-	if (this->menu) {
-	
-		DrawMenuSelect(gc);
-		return;
+		case 0:
+			break;
+		case 1:
+			if (ticks >= 720) { reboot(); }
+			ticks++;
+			break;
+		case 2:
+			if (ticks >= 1080) { reboot(); }
+			ticks++;
+			break;
+		default:
+			ticks = 0;
+			break;
 	}
+}
 
-	//event draw
-	if (this->event) {
-				
-		switch (event) {
-		
-			case 1:
-				gc->FillRectangle(0, 0, 320, 200, 0x40);
-				if (ticks >= 360) { gc->PutText("GAME OVER", 133, 96, 0x24); }
-				if (ticks >= 720) { reboot(); }
-				ticks++;
-				break;
-			case 2:
-				if (ticks >= 360) { gc->ErrorScreen(); }
-				if (ticks >= 1080) { reboot(); }
-				ticks++;
-				break;
-			default:
-				ticks = 0;
-				break;
-		}
-		return;
-	}
-
-	//draw games/tv
-	if (this->mode) {
-	
-		switch (mode) {
-		
-			case 1: //platformer
-				this->platformer.Draw(gc, ticks);
-				break;
-			case 2: //shooter
-				this->shooter.Draw(gc, ticks, keylog, logIndex, keyPress, moveMouseX, moveMouseY);
-				break;
-			default:
-				break;
-		}
-		return;
-	}
 
+//the room without osaka or anything that changes by the frame,
+//the tv screen gets its flash drawn over it after
+void Simulator::DrawRoomStatic(GraphicsContext* gc) {
 
 	//background
 	gc->FillRectangle(0, 0, 320, 200, 0x08);
@@ -574,14 +614,14 @@ void Simulator::DrawRoom(GraphicsContext* gc) {
 	//draw the items inside the room
 
 	//posters
-	gc->FillBuffer(208, 15, 20, 30, catPoster, false);
-	gc->FillBuffer(267, 26, 20, 30, awakeningPoster, false);
-	gc->FillBuffer(9, 29, 20, 30, brazilPoster, true);
+	gc->DrawSprite(208, 15, &catPosterSprite, false);
+	gc->DrawSprite(267, 26, &awakeningPosterSprite, false);
+	gc->DrawSprite(9, 29, &brazilPosterSprite, true);
 
 	//wall outlets
-	gc->FillBuffer(127, 59, 7, 10, wallOutlet, false);
-	gc->FillBuffer(25, 78, 7, 10, wallOutlet, false);
-	gc->FillBuffer(263, 73, 7, 10, wallOutlet, true);
+	gc->DrawSprite(127, 59, &wallOutletSprite, false);
+	gc->DrawSprite(25, 78, &wallOutletSprite, false);
+	gc->DrawSprite(263, 73, &wallOutletSprite, true);
 
 
 	//tv stand
@@ -591,61 +631,123 @@ void Simulator::DrawRoom(GraphicsContext* gc) {
 	gc->DrawRectangle(138, 61, 44, 7, 0x40);
 	gc->DrawLine(158, 71, 162, 71, 0x38);
 	//tv
-	gc->FillBuffer(141, 33, 38, 33, crtTV, false);
+	gc->DrawSprite(141, 33, &crtTVSprite, false);
 	gc->DrawLine(130, 62, 138, 65, 0x40);
-	//tv flash
-	gc->FillRectangle(145, 37, 30, 22, (((ticks/5)%2)*8)+1);
 	
 	//game console
-	gc->FillBuffer(122, 73, 17, 15, gameConsole, false);
+	gc->DrawSprite(122, 73, &gameConsoleSprite, false);
 	gc->DrawLine(131, 75, 130, 65, 0x40);
 	
 	
 	//computer
-	gc->FillBuffer(30, 78, 20, 23, computer, false);
+	gc->DrawSprite(30, 78, &computerSprite, false);
 	//desk
-	gc->FillBuffer(18, 60, 49, 46, desk, false);
+	gc->DrawSprite(18, 60, &deskSprite, false);
 	
 	//monitor
-	gc->FillBuffer(27, 53, 22, 18, crtPC, false);
+	gc->DrawSprite(27, 53, &crtPCSprite, false);
 	//keyboard
-	gc->FillBuffer(35, 69, 16, 7, keyboard, false);
+	gc->DrawSprite(35, 69, &keyboardSprite, false);
 	//keyboard cable
-	gc->FillBuffer(26, 66, 9, 8, keyboardCable, false);
+	gc->DrawSprite(26, 66, &keyboardCableSprite, false);
 	//mouse
-	gc->FillBuffer(51, 62, 7, 9, mouse, false);
+	gc->DrawSprite(51, 62, &mouseSprite, false);
 	//bong
-	gc->FillBuffer(6, 84, 11, 18, bongDirty, false);
+	gc->DrawSprite(6, 84, &bongDirtySprite, false);
 	
 
 
 	//chair
-	gc->FillBuffer(43, 71, 30, 40, chair, false);
+	gc->DrawSprite(43, 71, &chairSprite, false);
 
 
 	//dresser
-	gc->FillBuffer(184, 63, 49, 26, dresser, true);
-	gc->FillBuffer(184, 56, 49, 26, dresser, true);
+	gc->DrawSprite(184, 63, &dresserSprite, true);
+	gc->DrawSprite(184, 56, &dresserSprite, true);
 
 	//photo frame
-	gc->FillBuffer(192, 58, 10, 10, photoFrame, false);
+	gc->DrawSprite(192, 58, &photoFrameSprite, false);
 
 
 	//blinds
 	for (uint8_t i = 15; i < 42; i += 3) {
-		gc->FillBuffer(65, i, 35, 8, blindsRepeat, false);
+		gc->DrawSprite(65, i, &blindsRepeatSprite, false);
 	}
 	gc->DrawLine(67, 23, 67, 42, 0x40);
 	gc->DrawLine(68, 23, 68, 42, 0x07);
 	gc->DrawLine(69, 23, 69, 42, 0x40);
 	gc->PutPixel(68, 41, 0x40);
-	gc->FillBuffer(64, 42, 38, 9, windowShelf, false);
+	gc->DrawSprite(64, 42, &windowShelfSprite, false);
 
 
 	//lamp
-	gc->FillBuffer(237, 33, 17, 59, lamp, false);
+	gc->DrawSprite(237, 33, &lampSprite, false);
 	//bed
-	gc->FillBuffer(241, 79, 76, 61, bed, false);
+	gc->DrawSprite(241, 79, &bedSprite, false);
+}
+
+
+void Simulator::DrawRoom(GraphicsContext* gc) {
+
+	//draw menu select
+	if (this->menu) {
+	
+		DrawMenuSelect(gc);
+		return;
+	}
+
+	//event draw
+	if (this->event) {
+				
+		switch (event) {
+		
+			case 1:
+				gc->FillRectangle(0, 0, 320, 200, 0x40);
+				if (ticks >= 360) { gc->PutText("GAME OVER", 133, 96, 0x24); }
+				break;
+			case 2:
+				if (ticks >= 360) { gc->ErrorScreen(); }
+				break;
+			default:
+				break;
+		}
+		return;
+	}
+
+	//draw games/tv
+	if (this->mode) {
+	
+		switch (mode) {
+		
+			case 1: //platformer
+				this->platformer.Draw(gc, ticks);
+				break;
+			case 2: //shooter
+				this->shooter.Draw(gc, ticks, keylog, logIndex, keyPress, moveMouseX, moveMouseY);
+				break;
+			default:
+				break;
+		}
+		return;
+	}
+
+
+	//everything up to osaka stays put, drawn once into the layer
+	//and copied back after, DrawRoomStatic reads no sim state so
+	//the key is just the room. darkness is a palette effect, waves
+	//do shift pixels but MakeWave runs on the finished frame in
+	//Desktop::Draw, after this, so the layer never holds them
+	uint32_t roomKey = LAYER_ROOM;
+
+	if (this->background.Restore(gc, roomKey) == false) {
+
+		this->DrawRoomStatic(gc);
+		this->background.Capture(gc, roomKey);
+	}
+
+	//tv flash
+	gc->FillRectangle(145, 37, 30, 22, (((ticks/5)%2)*8)+1);
+
 	
 	/*
 	//files
@@ -674,7 +776,7 @@ void Simulator::DrawRoom(GraphicsContext* gc) {
 	//draw osaka
 	if (this->sleeping) {
 	
-		gc->FillBuffer(284, 82, 17, 10, osakaSleep, false);
+		gc->DrawSprite(284, 82, &osakaSleepSprite, false);
 		if (this->ticks > 600) { this->Dream(gc); }
 	} else {
 		bool facingLeft = false;
@@ -685,12 +787,12 @@ void Simulator::DrawRoom(GraphicsContext* gc) {
 		
 			facingLeft = true;
 		}
-		gc->FillBuffer(osakaX, osakaY, osakaWidths[walkFrames], 49, osakaSprites[walkFrames], facingLeft);
+		gc->DrawSprite(osakaX, osakaY, &osakaWalkSprites[walkFrames], facingLeft);
 
 		switch (this->outfit) {
 		
 			case 1:
-				gc->FillBuffer(osakaX, osakaY+18, osakaWidths[walkFrames], 19, osakaSummerSprites[walkFrames], facingLeft);
+				gc->DrawSprite(osakaX, osakaY+18, &osakaSummerWalkSprites[walkFrames], facingLeft);
 				break;
 			default:
 				break;
@@ -0,0 +1,143 @@
+#include <gui/sprite.h>
+#include <drivers/vga.h>
+
+
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::gui;
+
+
+uint8_t Sprite::pool[SPRITE_POOL_SIZE] __attribute__((aligned(4)));
+uint32_t Sprite::poolUsed = 0;
+
+
+
+//sprites are globals so this runs from callConstructors at boot
+Sprite::Sprite(uint8_t* source, uint16_t w, uint16_t h) {
+
+	this->source = source;
+	this->w = w;
+	this->h = h;
+
+	this->runs[0] = Encode(false);
+	this->runs[1] = Encode(true);
+}
+
+
+Sprite::~Sprite() {
+}
+
+
+
+uint8_t* Sprite::Encode(bool mirror) {
+
+	if (this->w == 0 || this->w > SPRITE_MAX_WIDTH) { return 0; }
+
+	//offset table first, the rows go after it
+	uint32_t start = poolUsed;
+	uint32_t used = this->h * sizeof(uint16_t);
+
+	if (start + used > SPRITE_POOL_SIZE) { return 0; }
+
+	uint8_t* runs = pool + start;
+	uint16_t* offsets = (uint16_t*)runs;
+
+	for (uint16_t row = 0; row < this->h; row++) {
+
+		uint8_t* src = this->source + (this->w * row);
+
+		//worst case is a run count then every other pixel opaque
+		if (start + used + 1 + (this->w / 2 + 1) * 3 > SPRITE_POOL_SIZE || used > 0xffff) { return 0; }
+
+		offsets[row] = used;
+		uint8_t* count = runs + (used++);
+		*count = 0;
+
+		uint16_t x = 0;
+		uint16_t last = 0;
+
+		while (x < this->w) {
+
+			//mirrored rows are read from the right
+			if (src[mirror ? (this->w - 1 - x) : x] == 0) { x++; continue; }
+
+			uint8_t* run = runs + used;
+			uint8_t length = 0;
+
+			run[0] = x - last;
+
+			for (; x < this->w; x++, length++) {
+
+				uint8_t pixel = src[mirror ? (this->w - 1 - x) : x];
+				if (pixel == 0) { break; }
+
+				run[2 + length] = pixel;
+			}
+			run[1] = length;
+
+			used += 2 + length;
+			last = x;
+			(*count)++;
+		}
+	}
+
+	if (used > 0xffff) { return 0; }
+
+	//keep the next offset table aligned
+	poolUsed = (start + used + 3) & ~3;
+	return runs;
+}
+
+
+
+//runs are mostly shorter than a rep movs is worth starting
+//for, so whole words and then the bytes left over
+inline void Sprite::CopyRun(uint8_t* dst, uint8_t* src, uint32_t count) {
+
+#ifdef __EMSCRIPTEN__
+	__builtin_memcpy(dst, src, count);
+#else
+	for (; count >= 4; count -= 4, dst += 4, src += 4) { *(uint32_t*)dst = *(uint32_t*)src; }
+	for (; count > 0; count--) { *(dst++) = *(src++); }
+#endif
+}
+
+
+
+void Sprite::Draw(uint8_t* buf, int32_t x, int32_t y, bool mirror,
+		int32_t clipX, int32_t clipY,
+		int32_t clipW, int32_t clipH) {
+
+	uint8_t* runs = this->runs[mirror ? 1 : 0];
+
+	int32_t top = (y < clipY) ? clipY : y;
+	int32_t bottom = (y + this->h > clipY + clipH) ? clipY + clipH : y + this->h;
+	int32_t left = clipX;
+	int32_t right = clipX + clipW;
+
+	if (runs == 0 || top >= bottom) { return; }
+
+	uint16_t* offsets = (uint16_t*)runs;
+	uint8_t* dst = buf + (WIDTH_13H * top);
+
+	for (int32_t row = top - y; row < bottom - y; row++, dst += WIDTH_13H) {
+
+		uint8_t* run = runs + offsets[row];
+		int32_t end = x;
+
+		for (uint8_t n = *(run++); n > 0; n--) {
+
+			int32_t begin = end + run[0];
+			uint8_t* src = run + 2;
+
+			end = begin + run[1];
+			run += 2 + run[1];
+
+			//only the runs crossing the edge need trimming
+			int32_t from = (begin < left) ? left : begin;
+			int32_t to = (end > right) ? right : end;
+
+			if (from < to) { CopyRun(dst + from, src + (from - begin), to - from); }
+		}
+	}
+}
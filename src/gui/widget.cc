@@ -1,7 +1,9 @@
 #include <gui/widget.h>
+#include <gui/frame.h>
 
 
 using namespace os::common;
+using namespace os::drivers;
 using namespace os::gui;
 
 
@@ -16,6 +18,10 @@ Widget::Widget(int32_t x, int32_t y, int32_t w, int32_t h)
 	this->y = y;
 	this->w = w;
 	this->h = h;
+
+	this->buf = nullptr;
+	this->bufWidth = 0;
+	this->bufHeight = 0;
 }
 
 
@@ -31,11 +37,14 @@ bool Widget::ContainsCoordinate(int32_t x, int32_t y) {
 
 void Widget::PutPixel(int32_t x, int32_t y, uint8_t color) {
 
-	if (x < this->x+w && y < this->y+h && 
-	    x >= this->x && y >= this->y) {
+	int32_t X = x - this->x;
+	int32_t Y = y - this->y;
+
+	if (X < this->bufWidth && Y < this->bufHeight && X >= 0 && Y >= 0
+	 && this->buf[this->bufWidth*Y+X] != color) {
 	
-		//this->buf[this->w*(y-this->y)+(x-this->x)] = color;
-		this->buf[WIDTH_13H*(y-this->y)+(x-this->x)] = color;
+		this->buf[this->bufWidth*Y+X] = color;
+		FrameScheduler::stale = true;
 	}
 }
 
@@ -45,23 +54,10 @@ void Widget::PutText(char* str, int32_t x, int32_t y, uint8_t color) {
 
 	if ((WIDTH_13H - x) < (length * 5)) { return; }
 
-	uint8_t* charArr = charset[0];
-
-	for (int i = 0; str[i] != '\0'; i++) {
-	
-		charArr = charset[str[i]-32];
-
-		for (uint8_t w = 0; w < font_width; w++) {
-			for (uint8_t h = 0; h < font_height; h++) {
-			
-				if (charArr[w] && ((charArr[w] >> h) & 1)) {
-				
-					this->PutPixel(x+w, y+h, color);
-				}
-			}
-		}
-		x += font_width;
-	}
+	//same clipping PutPixel does, in buffer coordinates
+	FrameScheduler::stale = true;
+	Glyphs::DrawString(this->buf, this->bufWidth, x - this->x, y - this->y, str, color, 
+			0, 0, this->bufWidth, this->bufHeight);
 }
 
 
@@ -120,8 +116,6 @@ CompositeWidget::CompositeWidget(CompositeWidget* parent,  int32_t x, int32_t y,
 	
 	this->windowOffset = 0;
 
-	this->buf = this->windowBuffer;
-
 	//orignial resolution	
 	this->xo = x;
 	this->yo = y;
@@ -141,9 +135,27 @@ CompositeWidget::CompositeWidget(CompositeWidget* parent,  int32_t x, int32_t y,
 	numChildren = 0;
 	outx = 0;
 	outy = 0;
+
+	for (uint8_t y = 0; y < TEXT_MAX_HEIGHT; y++) {
+		for (uint8_t x = 0; x < TEXT_MAX_WIDTH; x++) {
+
+			this->textCells[y][x].glyph = 0;
+			this->textCells[y][x].color = color;
+			this->textCells[y][x].dirty = 0;
+		}
+		this->textRowDirty[y] = false;
+	}
+	this->textHead = 0;
+	this->textScrolled = 0;
+	this->textPending = false;
+
+	this->ResizeSurface();
 }
 
-CompositeWidget::~CompositeWidget() {}
+CompositeWidget::~CompositeWidget() {
+
+	if (this->buf != nullptr) { MemoryManager::activeMemoryManager->free(this->buf); }
+}
 
 
 
@@ -275,6 +287,56 @@ void CompositeWidget::Resize(int32_t oldx, int32_t oldy, int32_t newx, int32_t n
 }
 
 
+bool CompositeWidget::ResizeSurface() {
+
+	if (this->buf != nullptr && this->bufWidth == this->w && this->bufHeight == this->h) { return true; }
+	if (this->w <= 0 || this->h <= 0 || MemoryManager::activeMemoryManager == 0) { return false; }
+
+	uint8_t* surface = (uint8_t*)MemoryManager::activeMemoryManager->malloc(this->w * this->h);
+	if (surface == nullptr) { return false; }
+
+	//anything still queued goes into the old one first
+	if (this->textPending) { this->FlushText(); }
+
+	Span::Fill(surface, this->color, this->w * this->h);
+
+	int32_t keepW = (this->bufWidth < this->w) ? this->bufWidth : this->w;
+	int32_t keepH = (this->bufHeight < this->h) ? this->bufHeight : this->h;
+
+	for (int32_t y = 0; y < keepH; y++) {
+
+		Span::Copy(surface + (this->w * y), this->buf + (this->bufWidth * y), keepW);
+	}
+
+
+	//cells the old surface cut off, blanks have nothing to draw
+	for (uint8_t y = 0; y < TEXT_MAX_HEIGHT; y++) {
+
+		uint8_t row = (this->textHead + y) % TEXT_MAX_HEIGHT;
+
+		for (uint8_t x = 0; x < TEXT_MAX_WIDTH; x++) {
+
+			TerminalCell* cell = &this->textCells[row][x];
+
+			if (cell->glyph == 0 || cell->dirty) { continue; }
+			if ((x+1)*font_width <= this->bufWidth && (y+1)*font_height <= this->bufHeight) { continue; }
+
+			cell->dirty = 1;
+			this->textRowDirty[row] = true;
+			this->textPending = true;
+		}
+	}
+
+	if (this->buf != nullptr) { MemoryManager::activeMemoryManager->free(this->buf); }
+
+	this->buf = surface;
+	this->bufWidth = this->w;
+	this->bufHeight = this->h;
+
+	return true;
+}
+
+
 void CompositeWidget::ModelToScreen(int32_t &x, int32_t &y) {
 
 	if (parent != 0) { parent->ModelToScreen(x, y); }
@@ -283,6 +345,81 @@ void CompositeWidget::ModelToScreen(int32_t &x, int32_t &y) {
 }
 
 
+uint8_t CompositeWidget::Uncovered(CompositeWidget* child, 
+				int32_t x, int32_t y, int32_t w, int32_t h,
+				CompositeRect* out) {
+
+	//start from the part that's on screen
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x + w > WIDTH_13H) { w = WIDTH_13H - x; }
+	if (y + h > HEIGHT_13H) { h = HEIGHT_13H - y; }
+
+	if (w <= 0 || h <= 0) { return 0; }
+
+	out[0].x = x;
+	out[0].y = y;
+	out[0].w = w;
+	out[0].h = h;
+	uint8_t count = 1;
+
+	//children[0] is on top, so everything before child covers it
+	for (int i = windowOffset; i < numChildren && count > 0; i++) {
+
+		CompositeWidget* above = children[i];
+
+		if (above == child) { break; }
+		if (above == nullptr || above->Min) { continue; }
+
+		CompositeRect pieces[COMPOSITE_RECTS];
+		uint8_t kept = 0;
+
+		for (uint8_t r = 0; r < count; r++) {
+
+			CompositeRect* rect = &out[r];
+
+			int32_t left = (rect->x > above->x) ? rect->x : above->x;
+			int32_t top = (rect->y > above->y) ? rect->y : above->y;
+			int32_t right = (rect->x + rect->w < above->x + above->w) ? rect->x + rect->w : above->x + above->w;
+			int32_t bottom = (rect->y + rect->h < above->y + above->h) ? rect->y + rect->h : above->y + above->h;
+
+			//untouched, or no room to split it so it stays whole
+			if (left >= right || top >= bottom || kept + 4 > COMPOSITE_RECTS - (count - r - 1)) {
+
+				pieces[kept++] = *rect;
+				continue;
+			}
+
+			//the strips above, below, left and right of the overlap
+			if (top > rect->y) { pieces[kept++] = { rect->x, rect->y, rect->w, top - rect->y }; }
+			if (bottom < rect->y + rect->h) { pieces[kept++] = { rect->x, bottom, rect->w, rect->y + rect->h - bottom }; }
+			if (left > rect->x) { pieces[kept++] = { rect->x, top, left - rect->x, bottom - top }; }
+			if (right < rect->x + rect->w) { pieces[kept++] = { right, top, rect->x + rect->w - right, bottom - top }; }
+		}
+
+		for (uint8_t r = 0; r < kept; r++) { out[r] = pieces[r]; }
+		count = kept;
+	}
+	return count;
+}
+
+
+void CompositeWidget::BlitUncovered(GraphicsContext* gc, CompositeWidget* child, 
+				int32_t x, int32_t y, int32_t w, int32_t h,
+				uint8_t* surface, int32_t stride) {
+
+	CompositeRect pieces[COMPOSITE_RECTS];
+	uint8_t count = this->Uncovered(child, x, y, w, h, pieces);
+
+	for (uint8_t r = 0; r < count; r++) {
+
+		CompositeRect* rect = &pieces[r];
+		gc->FillBufferFull(rect->x, rect->y, rect->w, rect->h, 
+				surface + (stride * (rect->y - y)) + (rect->x - x));
+	}
+}
+
+
 void CompositeWidget::Draw(GraphicsContext* gc) {
 
 	int X = 0;
@@ -328,16 +465,34 @@ uint8_t CompositeWidget::ReturnAppType() {}
 
 void CompositeWidget::WritePixel(int32_t x, int32_t y, uint8_t color) {
 
-	if (x < WIDTH_13H && y < HEIGHT_13H) { this->buf[WIDTH_13H*y+x] = color; }
+	if (this->textPending) { this->FlushText(); }
+	if (x < this->bufWidth && y < this->bufHeight && x >= 0 && y >= 0
+	 && this->buf[this->bufWidth*y+x] != color) {
+
+		this->buf[this->bufWidth*y+x] = color;
+		FrameScheduler::stale = true;
+	}
 }
 
-uint8_t CompositeWidget::ReadPixel(uint32_t i) { return this->buf[i]; }
+//i is still a WIDTH_13H wide index, off the surface is background
+uint8_t CompositeWidget::ReadPixel(uint32_t i) {
+
+	if (this->textPending) { this->FlushText(); }
+
+	int32_t x = i % WIDTH_13H;
+	int32_t y = i / WIDTH_13H;
+
+	if (x >= this->bufWidth || y >= this->bufHeight) { return this->color; }
+	return this->buf[this->bufWidth*y+x];
+}
 
 
 void CompositeWidget::DrawRectangle(int32_t x0, int32_t y0, 
 				    int32_t x1, int32_t y1, 
 				    uint8_t color, bool fill) {
 
+	if (this->textPending) { this->FlushText(); }
+
 	if (fill) {
 		for (int y = y0; y < y0+y1; y++) {
 			for (int x = x0; x < x0+x1; x++) {
@@ -361,24 +516,22 @@ void CompositeWidget::DrawRectangle(int32_t x0, int32_t y0,
 void CompositeWidget::DrawLine(int32_t x0, int32_t y0, 
 			       int32_t x1, int32_t y1, 
 			       uint8_t color) {
+
+	if (this->textPending) { this->FlushText(); }
 	
 	struct math::point pointArr[WIDTH_13H];
 	uint16_t pixelNum = LineFillArray(x0, y0, x1, y1, pointArr);
 
-	int32_t index = 0;
-
 	for (int i = 0; i < pixelNum; i++) {
 			
-		index = (WIDTH_13H*(pointArr[i].y - this->y)+(pointArr[i].x - this->x));
-
-		/*
-		if (pointArr[i].x < this->x+w && pointArr[i].y < this->y+h
-		 && pointArr[i].x >= this->x && pointArr[i].y >= this->y
-		 && index < 64000 && index >= 0) {
-		*/
-		if (pointArr[i].x >= this->x && pointArr[i].y >= this->y && index < 64000 && index >= 0) {
+		int32_t X = pointArr[i].x - this->x;
+		int32_t Y = pointArr[i].y - this->y;
+
+		if (X >= 0 && Y >= 0 && X < this->bufWidth && Y < this->bufHeight
+		 && this->buf[this->bufWidth*Y+X] != color) {
 		
-			this->buf[WIDTH_13H*(pointArr[i].y - this->y)+(pointArr[i].x - this->x)] = color;
+			this->buf[this->bufWidth*Y+X] = color;
+			FrameScheduler::stale = true;
 		}
 	}
 }
@@ -386,6 +539,8 @@ void CompositeWidget::DrawLine(int32_t x0, int32_t y0,
 
 void CompositeWidget::DrawCircle(int32_t x, int32_t y, 
 				 int32_t r, uint8_t color) {
+
+	if (this->textPending) { this->FlushText(); }
 	
 	int xc = 0, yc = r;
 	int d = 3 - 2 * r;
@@ -428,8 +583,11 @@ void CompositeWidget::DrawCircle(int32_t x, int32_t y,
 void CompositeWidget::FillBuffer(int32_t x, int32_t y, 
 			       int16_t w, int16_t h, 
 			       uint8_t* newbuf) {
+
+	if (this->textPending) { this->FlushText(); }
+
 	uint8_t pixelColor = 0;
-	uint8_t scrollVert = 0;
+	int32_t scrollVert = 0;
 	bool scroll = false;
 
 	if (y < 0) {
@@ -441,14 +599,17 @@ void CompositeWidget::FillBuffer(int32_t x, int32_t y,
 		scroll = true;
 	}
 
+	//newbuf is w by h from its own top left corner
 	for (int16_t Y = y; Y < y+h; Y++) {
 		for (int16_t X = x; X < x+w; X++) {
 		
-			pixelColor = newbuf[w*Y+X];
+			pixelColor = newbuf[w*(Y-y+scrollVert)+(X-x)];
 
-			if (pixelColor) {
+			if (pixelColor && X >= 0 && X < this->bufWidth && Y < this->bufHeight
+			 && this->buf[this->bufWidth*Y+X] != pixelColor) {
 			
-				this->buf[WIDTH_13H*Y+X] = pixelColor; 
+				this->buf[this->bufWidth*Y+X] = pixelColor; 
+				FrameScheduler::stale = true;
 			}
 		}
 	}
@@ -545,15 +706,15 @@ void CompositeWidget::PutChar(char ch) {
 
 	//53x22 text res
 
-	uint8_t* charArr = charset[0];
+	uint16_t glyph = 0;
 	uint8_t pixelColor = textColor;
 	
 	uint8_t adjustedTextHeight = TEXT_MAX_HEIGHT - (1 * this->Fullscreen == false);
 
 
 	//load font char
-	if (ch >= 32 && ch <= 127) { charArr = charset[ch-32];
-	} else { charArr = font_full; }
+	if (ch >= 32 && ch <= 127) { glyph = ch-32;
+	} else { glyph = GLYPH_FULL; }
 
 	switch(ch) {
 
@@ -577,13 +738,7 @@ void CompositeWidget::PutChar(char ch) {
 	//scrolling
 	if (outy >= adjustedTextHeight) {
 	
-		for (uint8_t y = 0; y < HEIGHT_13H; y++) {
-			for (uint16_t x = 0; x < WIDTH_13H; x++) {
-	
-				if (y < 189) {  this->buf[WIDTH_13H*y+x] = this->buf[WIDTH_13H*(y+font_height)+x];
-				} else { 	this->buf[WIDTH_13H*y+x] = this->color; }
-			}
-		}
+		this->TextScroll();
 		outx = 0;
 		outy--;
 
@@ -592,15 +747,7 @@ void CompositeWidget::PutChar(char ch) {
 
 
 	//font is 8x5 monospace
-	for (uint16_t i = 0; i < font_width; i++) {
-		for (uint8_t j = 0; j < font_height; j++) {
-		
-			if (charArr[i] && ((charArr[i] >> j) & 1)) {
-			
-				this->buf[WIDTH_13H*((outy*9)+j)+((outx*6)+i)] = pixelColor;
-			}
-		}
-	}		
+	this->TextCell(glyph, pixelColor);
 	if (ch != '\b') { outx++; }
 
 
@@ -616,7 +763,7 @@ void CompositeWidget::Print(char* str) {
 
 	//better if this method doesn't have to call
 	//putchar for each char in string
-	uint8_t* charArr = charset[0];
+	uint16_t glyph = 0;
 	uint8_t pixelColor = textColor;
 
 	
@@ -635,11 +782,21 @@ void CompositeWidget::Print(char* str) {
 		switch (str[ch]) {
 		
 			case '\v':
-				//clear text
-				for (uint16_t i = 0; i < 64000; i++) {
-					
-					this->buf[i] = this->color;
+				//clear text, nothing queued is worth drawing now
+				for (uint8_t y = 0; y < TEXT_MAX_HEIGHT; y++) {
+					for (uint8_t x = 0; x < TEXT_MAX_WIDTH; x++) {
+
+						this->textCells[y][x].glyph = 0;
+						this->textCells[y][x].color = this->color;
+						this->textCells[y][x].dirty = 0;
+					}
+					this->textRowDirty[y] = false;
 				}
+				this->textScrolled = 0;
+				this->textPending = false;
+
+				Span::Fill(this->buf, this->color, this->bufWidth*this->bufHeight);
+				FrameScheduler::stale = true;
 				outx = 0;
 				outy = 0;
 				
@@ -651,21 +808,15 @@ void CompositeWidget::Print(char* str) {
 			default:
 				// Bounds check to prevent invalid charset access
 				if (str[ch] >= 32 && str[ch] <= 127) {
-					charArr = charset[str[ch]-32];
+					glyph = str[ch]-32;
 				} else {
-					charArr = charset[0]; // Use default character for invalid values
+					glyph = 0; // Use default character for invalid values
 				}
 				
 				//scrolling
 				if (outy >= adjustedTextHeight) {
 	
-					for (uint8_t y = 0; y < HEIGHT_13H; y++) {
-						for (uint16_t x = 0; x < WIDTH_13H; x++) {
-	
-							if (y < 189) {  this->buf[WIDTH_13H*y+x] = this->buf[WIDTH_13H*(y+font_height)+x];
-							} else {	this->buf[WIDTH_13H*y+x] = this->color; }
-						}
-					}
+					this->TextScroll();
 					outx = 0;
 					outy--;
 
@@ -673,15 +824,7 @@ void CompositeWidget::Print(char* str) {
 				} else {this->textScroll = false; }
 			
 
-				for (uint8_t i = 0; i < font_width; i++) {
-					for (uint8_t j = 0; j < font_height; j++) {
-		
-						if (charArr[i] && ((charArr[i] >> j) & 1)) {
-			
-							this->buf[WIDTH_13H*((outy*9)+j)+((outx*6)+i)] = pixelColor;
-						}
-					}
-				}
+				this->TextCell(glyph, pixelColor);
 				if (outx >= TEXT_MAX_WIDTH) { outx = 0; outy++; }
 				if (outy < adjustedTextHeight) { outx++; }
 				
@@ -691,6 +834,105 @@ void CompositeWidget::Print(char* str) {
 }
 
 
+void CompositeWidget::PutText(char* str, int32_t x, int32_t y, uint8_t color) {
+
+	if (this->textPending) { this->FlushText(); }
+	Widget::PutText(str, x, y, color);
+}
+
+
+
+//the cell under the text cursor, off the grid is
+//dropped same as the clipped glyph it used to be
+void CompositeWidget::TextCell(uint8_t glyph, uint8_t color) {
+
+	if (outx >= TEXT_MAX_WIDTH || outy >= TEXT_MAX_HEIGHT) { return; }
+
+	uint8_t row = (this->textHead + outy) % TEXT_MAX_HEIGHT;
+	TerminalCell* cell = &this->textCells[row][outx];
+
+	cell->glyph = glyph;
+	cell->color = color;
+	cell->dirty = cell->dirty ? 2 : 1;
+
+	this->textRowDirty[row] = true;
+	this->textPending = true;
+
+	//printing from a script or the cli is drawn next frame
+	//instead of waiting for the idle one
+	FrameScheduler::stale = true;
+}
+
+
+//top row goes round to the bottom as a blank line, the
+//pixels aren't touched until the window is drawn
+void CompositeWidget::TextScroll() {
+
+	TerminalCell* cells = this->textCells[this->textHead];
+
+	for (uint8_t x = 0; x < TEXT_MAX_WIDTH; x++) {
+
+		cells[x].glyph = 0;
+		cells[x].color = this->color;
+		cells[x].dirty = 0;
+	}
+	this->textRowDirty[this->textHead] = false;
+	this->textHead = (this->textHead + 1) % TEXT_MAX_HEIGHT;
+
+	if (this->textScrolled < HEIGHT_13H) { this->textScrolled++; }
+	this->textPending = true;
+	FrameScheduler::stale = true;
+}
+
+
+void CompositeWidget::FlushText() {
+
+	//every scroll moved the buffer up a line and blanked
+	//the last 11 rows, n of them at once is the same thing
+	if (this->textScrolled > 0) {
+
+		int32_t shift = font_height * this->textScrolled;
+		int32_t stride = this->bufWidth;
+		int32_t keep = (this->bufHeight - 2) - shift;
+
+		if (keep < 0) { keep = 0; }
+
+		for (int32_t y = 0; y < keep; y++) {
+
+			Span::Copy(this->buf + (stride * y), this->buf + (stride * (y + shift)), stride);
+		}
+		Span::Fill(this->buf + (stride * keep), this->color, stride * (this->bufHeight - keep));
+
+		this->textScrolled = 0;
+	}
+
+
+	//then only the cells written since last time
+	for (uint8_t y = 0; y < TEXT_MAX_HEIGHT; y++) {
+
+		uint8_t row = (this->textHead + y) % TEXT_MAX_HEIGHT;
+		if (this->textRowDirty[row] == false) { continue; }
+
+		for (uint8_t x = 0; x < TEXT_MAX_WIDTH; x++) {
+
+			TerminalCell* cell = &this->textCells[row][x];
+			if (cell->dirty == 0) { continue; }
+
+			if (cell->dirty == 2) {
+
+				Glyphs::Draw(this->buf, this->bufWidth, x*font_width, y*font_height, GLYPH_FULL, this->color, 
+						0, 0, this->bufWidth, this->bufHeight);
+			}
+			Glyphs::Draw(this->buf, this->bufWidth, x*font_width, y*font_height, cell->glyph, cell->color, 
+					0, 0, this->bufWidth, this->bufHeight);
+			cell->dirty = 0;
+		}
+		this->textRowDirty[row] = false;
+	}
+	this->textPending = false;
+}
+
+
 void CompositeWidget::OnKeyDown(char str) {
 
 	if (focussedChild != 0 && windowOffset == 0) {
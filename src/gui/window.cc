@@ -60,7 +60,7 @@ FileSystem* filesystem)
 
 
 	//fill buffer with some color
-	for (int i = 0; i < 64000; i++) { this->buf[i] = color; }
+	for (int i = 0; i < this->bufWidth*this->bufHeight; i++) { this->buf[i] = color; }
 }
 
 
@@ -71,57 +71,77 @@ Window::~Window() {
 
 void Window::Draw(GraphicsContext* gc) {
 
+	//resizing, maximizing and fullscreen only change w and h,
+	//the surface catches up here before anything is drawn into it
+	this->ResizeSurface();
+
+	//text printed since the last frame goes into the buffer now
+	if (this->textPending) { this->FlushText(); }
+
+	//a surface that couldn't grow is drawn as far as it goes
+	int32_t surfaceW = (w < this->bufWidth) ? w : this->bufWidth;
+	int32_t surfaceH = (h < this->bufHeight) ? h : this->bufHeight;
+
 	if (!Fullscreen) {
 	
-		//fill in window buffer (actual graphical program)
-		gc->FillBufferFull(x+1, y+10, w-1, h-10, this->buf);
+		//windows above may cover all of it, then
+		//only the shadow can still be showing
+		CompositeRect pieces[COMPOSITE_RECTS];
+
+		if (parent->Uncovered(this, x, y, w, h, pieces) > 0) {
+
+			//fill in window buffer (actual graphical program),
+			//the parts under other windows are left out
+			parent->BlitUncovered(gc, this, x+1, y+10, surfaceW-1, surfaceH-10, 
+					this->buf, this->bufWidth);
 
 
-		//draw ui stuff
-		gc->FillRectangle(x, y, w, 10, this->winColor);
+			//draw ui stuff
+			gc->FillRectangle(x, y, w, 10, this->winColor);
 	
-		for (int by = 0; by < 10; by++) {
-			for (int bx = 0; bx < w; bx++) {
+			for (int by = 0; by < 10; by++) {
+				for (int bx = 0; bx < w; bx++) {
 		
-				if (bx % (by+1) == 0) { 
+					if (bx % (by+1) == 0) { 
 					
-					gc->PutPixel(x+bx, y+by, light2dark[this->winColor]); 
+						gc->PutPixel(x+bx, y+by, light2dark[this->winColor]); 
+					}
 				}
 			}
-		}
 
-		//delete button
-		gc->DrawLine(x+w-7, y+9, x+w-2, y+4, 0x40);
-		gc->DrawLine(x+w-6, y+4, x+w-1, y+9, 0x40);
-		gc->DrawLine(x+w-8, y+8, x+w-3, y+3, 0x07);
-		gc->DrawLine(x+w-7, y+3, x+w-2, y+8, 0x07);
+			//delete button
+			gc->DrawLine(x+w-7, y+9, x+w-2, y+4, 0x40);
+			gc->DrawLine(x+w-6, y+4, x+w-1, y+9, 0x40);
+			gc->DrawLine(x+w-8, y+8, x+w-3, y+3, 0x07);
+			gc->DrawLine(x+w-7, y+3, x+w-2, y+8, 0x07);
 
-		//max button
-		gc->DrawRectangle(x+w-17, y+3, 6, 6, 0x40);
-		gc->DrawRectangle(x+w-18, y+2, 6, 6, 0x07);
+			//max button
+			gc->DrawRectangle(x+w-17, y+3, 6, 6, 0x40);
+			gc->DrawRectangle(x+w-18, y+2, 6, 6, 0x07);
 
-		//min button
-		gc->DrawLine(x+w-27, y+8, x+w-21, y+8, 0x40);
-		gc->DrawLine(x+w-28, y+7, x+w-22, y+7, 0x07);
+			//min button
+			gc->DrawLine(x+w-27, y+8, x+w-21, y+8, 0x40);
+			gc->DrawLine(x+w-28, y+7, x+w-22, y+7, 0x07);
 
-		//menu button
-		gc->PutText("<", x+w-37, y+2, 0x40);
-		gc->PutText("<", x+w-38, y+1, 0x07);
+			//menu button
+			gc->PutText("<", x+w-37, y+2, 0x40);
+			gc->PutText("<", x+w-38, y+1, 0x07);
 	
-		//name of window
-		gc->PutText(this->name, x+2, y+2, 0x40);
-		gc->PutText(this->name, x+1, y+1, this->textColor);
+			//name of window
+			gc->PutText(this->name, x+2, y+2, 0x40);
+			gc->PutText(this->name, x+1, y+1, this->textColor);
 	
-		//draw menu if active
-		if (this->Menu) { this->MenuDraw(gc); }
+			//draw menu if active
+			if (this->Menu) { this->MenuDraw(gc); }
 
-		//outer rectangle
-		gc->DrawRectangle(x, y, w, 10, 0x38);
+			//outer rectangle
+			gc->DrawRectangle(x, y, w, 10, 0x38);
 
-		//window border
-		gc->DrawRectangle(x, y, w, h, 0x38);
-		gc->DrawLineFlat(x, y, x+w, y+h, 0x07, false);
-		gc->DrawLineFlat(x, y, x+w, y+h, 0x07, true);
+			//window border
+			gc->DrawRectangle(x, y, w, h, 0x38);
+			gc->DrawLineFlat(x, y, x+w, y+h, 0x07, false);
+			gc->DrawLineFlat(x, y, x+w, y+h, 0x07, true);
+		}
 
 		//create shadow effect
 		uint16_t darkx = x+w;
@@ -140,7 +160,7 @@ void Window::Draw(GraphicsContext* gc) {
 			}
 		}
 	} else {
-		gc->FillBufferFull(x, y, w, h, this->buf);
+		parent->BlitUncovered(gc, this, x, y, surfaceW, surfaceH, this->buf, this->bufWidth);
 		if (this->Menu) { this->MenuDraw(gc); }
 	}
 
@@ -246,6 +266,10 @@ void Window::DestroyWindow() {
 	this->buttons->DestroyList();
 	mm->free(this->buttons);
 	mm->free(this->app);
+
+	//the window itself is freed without its destructor
+	mm->free(this->buf);
+	this->buf = nullptr;
 }
 
 
@@ -1,4 +1,5 @@
 #include <hardwarecommunication/interrupts.h>
+#include <common/trace.h>
 
 
 using namespace os;
@@ -215,6 +216,8 @@ uint32_t InterruptManager::DoHandleInterrupt(uint8_t interruptNumber, uint32_t e
 	//compute tasks
 	if (interruptNumber == hardwareInterruptOffset) {
 		
+		Trace::Tick();
+
 		asm volatile("cli");
 		esp = (uint32_t)taskManager->Schedule((CPUState*)esp);
 		asm volatile("sti");
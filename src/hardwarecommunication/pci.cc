@@ -138,6 +138,7 @@ BaseAddressRegister PeripheralComponentInterconnectController::GetBaseAddressReg
 		uint16_t bus, uint16_t device, uint16_t function, uint16_t bar) {
 
 	BaseAddressRegister result;
+	result.address = 0;
 	
 	uint32_t headertype = Read(bus, device, function, 0x0e) & 0x7f;
 	int maxBARS = 6 - (4 * headertype);
@@ -157,13 +158,13 @@ BaseAddressRegister PeripheralComponentInterconnectController::GetBaseAddressReg
 	
 		switch ((bar_value >> 1) & 0x3) {
 		
-			//finish later
-
+			//low 4 bits are flags, a 64 bit bar has the
+			//high half in the next register and we only
+			//get to use it if that half is 0 anyway
 			case 0x00: //32 bit mode
-				break;		
 			case 0x01: //20 bit mode
-				break;
-			case 0x10: //64 bit mode
+			case 0x02: //64 bit mode
+				result.address = (uint8_t*)(bar_value & ~0xf);
 				break;
 		}
 		result.prefetchable = ((bar_value >> 3) & 0x1) == 0x1;
@@ -1,4 +1,5 @@
 #include <common/types.h>
+#include <common/trace.h>
 #include <gdt.h>
 #include <memorymanagement.h>
 #include <art.h>
@@ -12,6 +13,7 @@
 #include <drivers/keyboard.h>
 #include <drivers/mouse.h>
 #include <drivers/vga.h>
+#include <drivers/vbe.h>
 #include <drivers/amd_am79c973.h>
 #include <drivers/ata.h>
 #include <drivers/speaker.h>
@@ -23,6 +25,7 @@
 #include <gui/sim.h>
 #include <gui/raycasting.h>
 #include <gui/font.h>
+#include <gui/glyphs.h>
 #include <gui/pixelart.h>
 #include <multitasking.h>
 #include <code/asm.h>
@@ -901,39 +904,17 @@ uint32_t cmosDetectMemory() {
 
 
 
+//each channel to the nearest of 0, 0x55, 0xaa and 0xff, 0x55 is the
+//high bit of the channel in an ega index and 0xaa the low one, images
+//go through ColorTable which follows the palette that's loaded instead
 uint8_t Web2EGA(uint32_t color) {
 
-	uint8_t bytes[3];
-	bytes[2] = color >> 16;
-	bytes[1] = (color >> 8) & 0xff;
-	bytes[0] = color & 0xff;
-
 	uint8_t result = 0;
 
 	for (int i = 0; i < 3; i++) {
 	
-		if        (bytes[i] < 0x2b) { bytes[i] = 0x00;
-		} else if (bytes[i] < 0x80) { bytes[i] = 0x55; 
-		} else if (bytes[i] < 0xd5) { bytes[i] = 0xaa; 
-		} else {		      bytes[i] = 0xff; }
-	}
-
-	for (int i = 0; i < 3; i++) {
-	
-		switch (bytes[i]) {
-		
-			//both sets of
-			//3 bits
-			case 0xff:
-				result |= (1 << (i+3));
-				result |= (1 << i);
-				break;
-			//most sig 3 bits
-			case 0x55: result |= (1 << (i+3)); break;
-			//least sig 3 bits
-			case 0xaa: result |= (1 << i); break;
-			default: break;
-		}
+		uint8_t level = (((color >> (i * 8)) & 0xff) + 42) / 85;
+		result |= ((level & 1) << (i+3)) | ((level >> 1) << i);
 	}
 	return result;
 }
@@ -993,7 +974,7 @@ void DrawDesktopTask() {
 #endif
 
 	while (1) { 
-		desktop->Draw(desktop->gc);
+		desktop->Frame();
 #ifdef __EMSCRIPTEN__
 		emscripten_sleep(0); // Yield to browser event loop
 #endif
@@ -1073,6 +1054,9 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
 	InterruptManager interrupts(0x20, gdt, &taskManager);
 	printf("Initializing Hardware, Stage 1\n");
 
+	//before anything records an event
+	Trace::Init();
+
 #ifdef __EMSCRIPTEN__
 	// Yield after interrupt manager
 	emscripten_sleep(0);
@@ -1082,8 +1066,15 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
 	
 	//drivers and command line
 	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	PeripheralComponentInterconnectController PCIController(&memoryManager);
+#if defined(VBE_ENABLE) && !defined(__EMSCRIPTEN__)
+	//bochs vbe when qemu/bochs have it, plain 13h otherwise
+	BochsVBE vga(&PCIController);
+#else
 	VideoGraphicsArray vga;
+#endif
 	printf("[KERNEL] VGA driver created\n");
+	Glyphs::Build();
 	OFS_Table table;
 	FileSystem osakaFileSystem(&ata0m, &memoryManager, &table);
 #ifdef __EMSCRIPTEN__
@@ -1124,7 +1115,6 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
 
 
 	//pci and init
-	PeripheralComponentInterconnectController PCIController(&memoryManager);
 	PCIController.SelectDrivers(&drvManager, &interrupts);
 
 
@@ -1340,7 +1330,7 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
 			// For Emscripten, directly call desktop draw since task manager
 			// relies on timer interrupts which don't work the same way
 			// The desktop draw will yield via emscripten_sleep internally
-			desktop.Draw(desktop.gc);
+			desktop.Frame();
 			// Yield to browser event loop to prevent blocking
 			emscripten_sleep(0);
 #else
@@ -24,6 +24,9 @@ Node::~Node() {
 List::List(MemoryManager* memoryManager) {
 	
 	this->memoryManager = memoryManager;
+	this->numOfNodes = 0;
+	this->entryNode = nullptr;
+	this->lastNode = nullptr;
 	this->indexNode = nullptr;
 }
 
@@ -198,11 +201,16 @@ void List::Remove(uint32_t index) {
 		//remove from list
 		Node* removeIndex = indexNode->next;
 		indexNode->next = indexNode->next->next;
+
+		//keep tail valid for push
+		if (removeIndex == this->lastNode) { this->lastNode = indexNode; }
 		this->DestroyNode(removeIndex);
 	} else {
 		//remove from first index
 		this->entryNode = indexNode->next;
 		Node* removeIndex = indexNode;
+		
+		if (removeIndex == this->lastNode) { this->lastNode = nullptr; }
 		this->DestroyNode(indexNode);
 	}
 	this->numOfNodes--;
@@ -55,37 +55,259 @@ double os::math::fmod(double a, double b) {
 
 
 
+//pi/2 split so n*pi/2 is exact in the high part for any
+//n under 2^20, the low parts soak up what the rounding lost
+static constexpr double halfPiHigh = 1.57079632673412561417e+00;
+static constexpr double halfPiMid = 6.07710050630396597660e-11;
+static constexpr double halfPiLow = 2.02226624879595063154e-21;
+
+
+//taylor to r^15 and r^16, for |r| <= pi/4 the first term left
+//off is under 5e-17 so rounding is all the error there is
+static inline double QuarterSin(double r) {
+
+	double r2 = r * r;
+
+	return r + r * r2 * (-1.0/6 + r2 * (1.0/120 + r2 * (-1.0/5040 + r2 * (1.0/362880
+		 + r2 * (-1.0/39916800 + r2 * (1.0/6227020800 + r2 * (-1.0/1307674368000)))))));
+}
+
+static inline double QuarterCos(double r) {
+
+	double r2 = r * r;
+
+	return 1.0 + r2 * (-1.0/2 + r2 * (1.0/24 + r2 * (-1.0/720 + r2 * (1.0/40320
+		   + r2 * (-1.0/3628800 + r2 * (1.0/479001600 + r2 * (-1.0/87178291200
+		   + r2 * (1.0/20922789888000))))))));
+}
+
+
+//sin(x + quadrant * pi/2)
+static double Quadrant(double x, int32_t quadrant) {
+
+	//n fits an int32 up to about 3e9 radians, past that the
+	//reduction by whole turns is left to fmod first
+	if (absD(x) > 1e9) { x = fmod(x, 2 * pi); }
+
+	double scaled = x * (2.0 / pi);
+	int32_t n = (int32_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+
+	double r = ((x - n * halfPiHigh) - n * halfPiMid) - n * halfPiLow;
+
+	switch ((n + quadrant) & 3) {
+
+		case 0: return QuarterSin(r);
+		case 1: return QuarterCos(r);
+		case 2: return -QuarterSin(r);
+		default: return -QuarterCos(r);
+	}
+}
+
+
 double os::math::sin(double x) {
 
-	x = fmod(x, 2*pi);
-	if (x < 0) { x = (2 * pi) - x; }
-	
-	int8_t sign = 1;
+	return Quadrant(x, 0);
+}
 
-	if (x > pi) {
+double os::math::cos(double x) { 
 	
-		x -= pi;
-		sign = -1;
+	return Quadrant(x, 1); 
+}
+
+
+
+//atan(2^-i) in 2^32 to a turn and the gain all the steps add
+//up to, both worked out by the compiler
+struct CordicTable {
+
+	uint32_t angle[CORDIC_STEPS];
+	int32_t gain;
+
+	constexpr CordicTable() : angle(), gain(0) {
+
+		double k = 1.0;
+
+		for (int i = 0; i < CORDIC_STEPS; i++) {
+
+			double t = 1.0 / (1u << i);
+			double a = (i == 0) ? (pi / 4.0) : SeriesAtan(t);
+
+			angle[i] = (uint32_t)((a / (2.0 * pi)) * 4294967296.0 + 0.5);
+
+			//1/sqrt(1+t*t) by newton's method
+			double s = 1.0 + t * t;
+			double root = 1.0;
+			for (int n = 0; n < 8; n++) { root = 0.5 * (root + s / root); }
+
+			k /= root;
+		}
+		gain = (int32_t)(k * TRIG_ONE + 0.5);
 	}
-	double result = x;
-	double coefficient = 3.0;
+};
 
-	for (int i = 0; i < 10; i++) {
-	
-		double pow = power(x, coefficient);
-		double frac = factorial(coefficient);
-	
-		if (i % 2 == 0) { result -= (pow/frac); }
-		else { result += (pow/frac); }
+static constexpr CordicTable cordic;
+
+
+void os::math::SinCosCordic(uint16_t angle, int32_t* sine, int32_t* cosine) {
+
+	//only converges within about 99 degrees of 0, so the
+	//back half of the circle is turned round first
+	int32_t z = (int32_t)((uint32_t)angle << 16);
+	bool flip = (z > 0x40000000 || z < -0x40000000);
+
+	if (flip) { z += (int32_t)0x80000000; }
 
-		coefficient += 2.0;
+	//starting at the gain means the length ends up at one
+	int32_t x = cordic.gain;
+	int32_t y = 0;
+
+	//which way each step turns is a coin flip, so it's done
+	//with a sign mask instead of a branch that mispredicts
+	for (uint8_t i = 0; i < CORDIC_STEPS; i++) {
+
+		int32_t sign = z >> 31;
+		int32_t dx = y >> i;
+		int32_t dy = x >> i;
+
+		x -= (dx ^ sign) - sign;
+		y += (dy ^ sign) - sign;
+		z -= (cordic.angle[i] ^ sign) - sign;
 	}
-	return ((double)sign)*result;
+
+	*sine = flip ? -y : y;
+	*cosine = flip ? -x : x;
 }
 
-double os::math::cos(double x) { 
-	
-	return sin((pi / 2.0) - x); 
+
+//turns (x,y) onto the x axis, x ends up as the length times
+//the gain and z as how far it was turned in 2^32 to a turn
+static void CordicVector(int32_t y, int32_t x, uint32_t* angle, uint32_t* length) {
+
+	uint32_t z = 0;
+
+	//left half goes through 180 first, same as SinCosCordic
+	if (x < 0) {
+
+		x = -x;
+		y = -y;
+		z = 0x80000000;
+	}
+
+	//the bigger side goes to just under 2^29, small vectors
+	//would run out of bits to shift and the gain needs room,
+	//2^29 * sqrt(2) * 1.65 < 2^31
+	uint32_t big = (uint32_t)x > abs(y) ? (uint32_t)x : abs(y);
+	int8_t shift = 0;
+
+	if (big == 0) {
+
+		*angle = 0;
+		*length = 0;
+		return;
+	}
+
+	while (big >= (1u << 29)) { big >>= 1; shift++; }
+	while (big < (1u << 28)) { big <<= 1; shift--; }
+
+	if (shift > 0) {
+
+		x = (uint32_t)x >> shift;
+		y >>= shift;
+	} else {
+		x <<= -shift;
+		y = (int32_t)((uint32_t)y << -shift);
+	}
+
+	for (uint8_t i = 0; i < CORDIC_STEPS; i++) {
+
+		int32_t sign = y >> 31;
+		int32_t dx = y >> i;
+		int32_t dy = x >> i;
+
+		x += (dx ^ sign) - sign;
+		y -= (dy ^ sign) - sign;
+		z += (cordic.angle[i] ^ sign) - sign;
+	}
+
+	*angle = z;
+
+	uint64_t scaled = (uint64_t)(uint32_t)x * cordic.gain;
+	*length = (scaled + (1ull << (TRIG_SHIFT - 1 - shift))) >> (TRIG_SHIFT - shift);
+}
+
+
+uint16_t os::math::Atan2(int32_t y, int32_t x) {
+
+	uint32_t angle;
+	uint32_t length;
+
+	CordicVector(y, x, &angle, &length);
+	return (angle + 0x8000) >> 16;
+}
+
+
+uint32_t os::math::Hypot(int32_t x, int32_t y) {
+
+	uint32_t angle;
+	uint32_t length;
+
+	CordicVector(y, x, &angle, &length);
+	return length;
+}
+
+
+uint16_t os::math::AngleFromRadians(uint32_t radians) {
+
+	//1/2pi as a 64 bit fraction, the turns that overflow off
+	//the top of the product are whole turns and don't matter
+	uint64_t high = 683565275;
+	uint64_t low = 2475754826;
+
+	uint64_t turns = ((radians * high) << 32) + (radians * low);
+	return (turns + 0x800000000000) >> 48;
+}
+
+
+
+uint16_t os::math::isqrt(uint32_t x) {
+
+	uint32_t root = 0;
+	uint32_t bit = 1u << 30;
+
+	while (bit > x) { bit >>= 2; }
+
+	//subtract when it fits, masked so there's no branch
+	for (; bit != 0; bit >>= 2) {
+
+		uint32_t trial = root + bit;
+		uint32_t fits = -(uint32_t)(x >= trial);
+
+		x -= trial & fits;
+		root = (root >> 1) + (bit & fits);
+	}
+	return root;
+}
+
+
+uint32_t os::math::isqrt64(uint64_t x) {
+
+	if (x <= 0xffffffff) { return isqrt(x); }
+
+	uint64_t root = 0;
+	uint64_t bit = 1ull << 62;
+
+	while (bit > x) { bit >>= 2; }
+
+	//subtract when it fits, masked so there's no branch
+	for (; bit != 0; bit >>= 2) {
+
+		uint64_t trial = root + bit;
+		uint64_t fits = -(uint64_t)(x >= trial);
+
+		x -= trial & fits;
+		root = (root >> 1) + (bit & fits);
+	}
+	return root;
 }
 
 
@@ -180,18 +402,37 @@ uint16_t os::math::LineFillArray(int32_t x0, int32_t y0,
 
 float os::math::calculateX(int i, int j, int k, Cube* data) {
 
-	return j * sin(data->A) * sin(data->B) * cos(data->C) - k * cos(data->A) * sin(data->B) * cos(data->C) + 
-		j * cos(data->A) * sin(data->C) + k * sin(data->A) * sin(data->C) + i * cos(data->B) * cos(data->C);
+	return i * data->rotation[0][0] + j * data->rotation[0][1] + k * data->rotation[0][2];
 }
 float os::math::calculateY(int i, int j, int k, Cube* data) {
 
-	return j * cos(data->A) * cos(data->C) + k * sin(data->A) * cos(data->C) - 
-		j * sin(data->A) * sin(data->B) * sin(data->C) + k * cos(data->A) * sin(data->B) * sin(data->C) - 
-		i * cos(data->B) * sin(data->C);
+	return i * data->rotation[1][0] + j * data->rotation[1][1] + k * data->rotation[1][2];
 }
 float os::math::calculateZ(int i, int j, int k, Cube* data) {
 	
-	return k * cos(data->A) * cos(data->B) - j * sin(data->A) * cos(data->B) + i * sin(data->B);
+	return i * data->rotation[2][0] + j * data->rotation[2][1] + k * data->rotation[2][2];
+}
+
+
+//the angles are the same for every point of a frame, so
+//their products are worked out once instead of per point
+void os::math::calculateRotation(Cube* data) {
+
+	float sA = sin(data->A), cA = cos(data->A);
+	float sB = sin(data->B), cB = cos(data->B);
+	float sC = sin(data->C), cC = cos(data->C);
+
+	data->rotation[0][0] = cB * cC;
+	data->rotation[0][1] = sA * sB * cC + cA * sC;
+	data->rotation[0][2] = sA * sC - cA * sB * cC;
+
+	data->rotation[1][0] = -cB * sC;
+	data->rotation[1][1] = cA * cC - sA * sB * sC;
+	data->rotation[1][2] = sA * cC + cA * sB * sC;
+
+	data->rotation[2][0] = sB;
+	data->rotation[2][1] = -sA * cB;
+	data->rotation[2][2] = cA * cB;
 }
 
 void os::math::calculateForSurface(float cubeX, float cubeY, float cubeZ, int ch, Cube* data) {
@@ -219,6 +460,8 @@ void os::math::calculateForSurface(float cubeX, float cubeY, float cubeZ, int ch
 
 void os::math::calculateCube(float incrementSpeed, Cube* data) {
 
+	calculateRotation(data);
+
 	for (float cubeX = -data->cubeWidth; cubeX < data->cubeWidth; cubeX += incrementSpeed) {
 		for (float cubeY = -data->cubeWidth; cubeY < data->cubeWidth; cubeY += incrementSpeed) {
 
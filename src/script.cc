@@ -104,7 +104,10 @@ void AyumuScriptCli(char* name, os::CommandLine* cli) {
 	//get file info
 	uint32_t size = cli->filesystem->GetFileSize(argparse(name, 0));
 	uint8_t file[OFS_BLOCK_SIZE];
-	uint8_t LBA = 0;
+	
+	//blocks come in order so the handle reads ahead
+	int32_t handle = cli->filesystem->Open(argparse(name, 0));
+	if (handle < 0) { return; }
 	
 	//file indexes
 	uint32_t indexF = 0;
@@ -146,6 +149,7 @@ void AyumuScriptCli(char* name, os::CommandLine* cli) {
 			cli->conditionLoop = true;
 			for (int i = 0; i < 10; i++) { cli->argTable[i] = 0; }
 			cli->scriptKillSwitch = false;
+			cli->filesystem->Close(handle);
 			return;	
 		}
 
@@ -153,8 +157,8 @@ void AyumuScriptCli(char* name, os::CommandLine* cli) {
 		if (indexF % OFS_BLOCK_SIZE == 0) {
 
 			indexLBA = 0;
-			cli->filesystem->ReadLBA(argparse(name, 0), file, LBA);
-			LBA++;
+			cli->filesystem->Seek(handle, indexF);
+			cli->filesystem->Read(handle, file, OFS_BLOCK_SIZE);
 		}
 
 		//parse and interpret
@@ -216,6 +220,8 @@ void AyumuScriptCli(char* name, os::CommandLine* cli) {
 		indexLBA++;
 		indexF++;
 	}
+	cli->filesystem->Close(handle);
+
 	//reset conditions and script arguments
 	cli->conditionIf = true;
 	cli->conditionLoop = true;
@@ -0,0 +1,195 @@
+//host side benchmark for the ofs block codec,
+//build with 'make lzbench' and run './lzbench [files...]'
+//
+//every input is cut into OFS_BLOCK_SIZE blocks and each block is
+//compressed on its own, same as WriteLBA does for compressed files
+
+#include <filesys/lz.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace os::common;
+using namespace os::filesystem;
+
+
+#define OFS_BLOCK_SIZE 2048
+#define BENCH_ROUNDS 200
+
+
+static double Now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+//320x200 mode 13h picture, flat fills with some dithering and noise
+static uint8_t* MakeImage(uint32_t* size) {
+
+	*size = 320*200;
+	uint8_t* data = (uint8_t*)malloc(*size);
+	uint32_t seed = 12345;
+
+	for (uint32_t y = 0; y < 200; y++) {
+		for (uint32_t x = 0; x < 320; x++) {
+
+			uint8_t c = 0x37;
+
+			if (y > 140) { c = ((x + y) & 1) ? 0x02 : 0x06; }
+			else if (x > 100 && x < 220 && y > 40 && y < 120) { c = 0x40 + ((x - 100) / 8); }
+
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) % 50 == 0) { c = (seed >> 8) & 0xff; }
+
+			data[y*320+x] = c;
+		}
+	}
+	return data;
+}
+
+
+//looks like the scripts people keep on disk
+static uint8_t* MakeScript(uint32_t* size) {
+
+	const char* lines[] = {
+		"// draw a box\n",
+		"int x 10\n",
+		"int y 20\n",
+		"loop x < 100\n",
+		"putpixel x y 4\n",
+		"+ x 1\n",
+		"pool\n",
+		"window test\n",
+		"drawpic home 0 0\n",
+	};
+	*size = 16*1024;
+	uint8_t* data = (uint8_t*)malloc(*size);
+	uint32_t n = 0;
+
+	for (uint32_t i = 0; n < *size; i++) {
+
+		const char* line = lines[(i * 7) % 9];
+		for (uint32_t j = 0; line[j] != '\0' && n < *size; j++) { data[n++] = line[j]; }
+	}
+	return data;
+}
+
+
+static uint8_t* LoadFile(const char* path, uint32_t* size) {
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) { return NULL; }
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t* data = (uint8_t*)malloc(*size ? *size : 1);
+	*size = fread(data, 1, *size, f);
+	fclose(f);
+
+	return data;
+}
+
+
+static void Bench(const char* name, uint8_t* data, uint32_t size) {
+
+	uint32_t blocks = (size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE;
+	uint8_t* padded = (uint8_t*)calloc(blocks, OFS_BLOCK_SIZE);
+	uint8_t* packed = (uint8_t*)malloc(blocks * OFS_BLOCK_SIZE);
+	uint8_t* unpacked = (uint8_t*)malloc(blocks * OFS_BLOCK_SIZE);
+	uint16_t* sizes = (uint16_t*)malloc(blocks * sizeof(uint16_t));
+	uint16_t table[LZ_HASH_SIZE];
+
+	memcpy(padded, data, size);
+
+
+	//compressed bytes, and sectors actually written
+	//after blocks that don't save a sector stay raw
+	uint32_t packedBytes = 0;
+	uint32_t sectors = 0;
+
+	double start = Now();
+	for (int r = 0; r < BENCH_ROUNDS; r++) {
+
+		packedBytes = 0;
+		sectors = 0;
+
+		for (uint32_t b = 0; b < blocks; b++) {
+
+			uint8_t* dst = packed + (b * OFS_BLOCK_SIZE);
+			sizes[b] = LZCompressBlock(padded + (b * OFS_BLOCK_SIZE), OFS_BLOCK_SIZE, dst, OFS_BLOCK_SIZE - 512, table);
+
+			packedBytes += sizes[b] ? sizes[b] : OFS_BLOCK_SIZE;
+			sectors += sizes[b] ? (sizes[b] + 511) / 512 : OFS_BLOCK_SIZE / 512;
+		}
+	}
+	double compressTime = (Now() - start) / BENCH_ROUNDS;
+
+
+	start = Now();
+	for (int r = 0; r < BENCH_ROUNDS; r++) {
+
+		for (uint32_t b = 0; b < blocks; b++) {
+
+			uint8_t* dst = unpacked + (b * OFS_BLOCK_SIZE);
+
+			if (sizes[b]) {
+				LZDecompressBlock(packed + (b * OFS_BLOCK_SIZE), sizes[b], dst, OFS_BLOCK_SIZE);
+			} else {
+				memcpy(dst, padded + (b * OFS_BLOCK_SIZE), OFS_BLOCK_SIZE);
+			}
+		}
+	}
+	double decompressTime = (Now() - start) / BENCH_ROUNDS;
+
+	bool ok = memcmp(padded, unpacked, blocks * OFS_BLOCK_SIZE) == 0;
+	double mb = (blocks * OFS_BLOCK_SIZE) / (1024.0 * 1024.0);
+
+	printf("%-20s %8u -> %8u bytes  ratio %5.2f  sectors %5u/%5u  comp %8.1f MB/s  decomp %8.1f MB/s  %s\n",
+		name, blocks * OFS_BLOCK_SIZE, packedBytes,
+		(double)(blocks * OFS_BLOCK_SIZE) / packedBytes,
+		sectors, blocks * (OFS_BLOCK_SIZE / 512),
+		mb / compressTime, mb / decompressTime,
+		ok ? "ok" : "MISMATCH");
+
+	free(padded);
+	free(packed);
+	free(unpacked);
+	free(sizes);
+}
+
+
+int main(int argc, char** argv) {
+
+	uint32_t size = 0;
+	uint8_t* data = NULL;
+
+	data = MakeImage(&size);
+	Bench("image 320x200", data, size);
+	free(data);
+
+	data = MakeScript(&size);
+	Bench("script", data, size);
+	free(data);
+
+
+	//anything else, like images and scripts pulled off a disk
+	for (int i = 1; i < argc; i++) {
+
+		data = LoadFile(argv[i], &size);
+
+		if (data == NULL) {
+
+			printf("%s: can't open\n", argv[i]);
+			continue;
+		}
+		if (size > 0) { Bench(argv[i], data, size); }
+		free(data);
+	}
+	return 0;
+}
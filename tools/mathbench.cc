@@ -0,0 +1,298 @@
+//host side accuracy and speed check for the math library,
+//build with 'make mathbench' and run './mathbench'
+//
+//every routine is swept against libm and its worst error
+//compared to the bound its header promises, then timed next
+//to the libm call and the series sin the kernel used to have
+
+#include <math.h>
+
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace os::common;
+using namespace os::math;
+
+
+#define BENCH_CALLS 2000000
+
+
+static volatile double sinkD;
+static volatile int32_t sinkI;
+
+
+static double Now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+//what sin was before, taylor with power and factorial
+static double SeriesPower(double x, double p) {
+
+	double n = x;
+	for (double i = 1.0; i < p; i += 1.0) { n *= x; }
+	return n;
+}
+
+static double SeriesFactorial(double x) {
+
+	if (x == 0) { return 1.0; }
+	return x * (SeriesFactorial(x - 1.0));
+}
+
+static double OldSin(double x) {
+
+	x = os::math::fmod(x, 2*pi);
+	if (x < 0) { x = (2 * pi) - x; }
+
+	int sign = 1;
+
+	if (x > pi) {
+
+		x -= pi;
+		sign = -1;
+	}
+	double result = x;
+	double coefficient = 3.0;
+
+	for (int i = 0; i < 10; i++) {
+
+		double pow = SeriesPower(x, coefficient);
+		double frac = SeriesFactorial(coefficient);
+
+		if (i % 2 == 0) { result -= (pow/frac); }
+		else { result += (pow/frac); }
+
+		coefficient += 2.0;
+	}
+	return ((double)sign)*result;
+}
+
+
+static double AngleRadians(uint32_t angle) { return angle * (2.0 * M_PI / ANGLE_TURN); }
+
+
+static bool Report(const char* name, double worst, double bound) {
+
+	bool ok = worst <= bound;
+	printf("%-30s worst %.3g, bound %.3g: %s\n", name, worst, bound, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+
+static bool CheckTable() {
+
+	double worst = 0;
+
+	for (uint32_t a = 0; a < ANGLE_TURN; a++) {
+
+		double want = std::sin(AngleRadians(a));
+		worst = std::fmax(worst, std::fabs(SinFixed(a) / (double)TRIG_ONE - want));
+		worst = std::fmax(worst, std::fabs(CosFixed(a) / (double)TRIG_ONE - std::cos(AngleRadians(a))));
+
+		//the table entries themselves are exact to rounding
+		if ((a & 63) == 0 && std::fabs(SinFixed(a) - want * TRIG_ONE) > 0.5) { worst = 1; }
+	}
+	return Report("SinFixed/CosFixed table", worst, 5e-6);
+}
+
+
+static bool CheckCordic() {
+
+	double worst = 0;
+
+	for (uint32_t a = 0; a < ANGLE_TURN; a++) {
+
+		int32_t s;
+		int32_t c;
+		SinCosCordic(a, &s, &c);
+
+		worst = std::fmax(worst, std::fabs(s / (double)TRIG_ONE - std::sin(AngleRadians(a))));
+		worst = std::fmax(worst, std::fabs(c / (double)TRIG_ONE - std::cos(AngleRadians(a))));
+	}
+	return Report("SinCosCordic", worst, 2e-8);
+}
+
+
+static bool CheckVector() {
+
+	double worstAngle = 0;
+	double worstLength = 0;
+	uint32_t seed = 1;
+
+	for (uint32_t i = 0; i < 200000; i++) {
+
+		seed = seed * 1103515245 + 12345;
+		int32_t x = (int32_t)seed >> (seed & 15);
+		seed = seed * 1103515245 + 12345;
+		int32_t y = (int32_t)seed >> (seed & 15);
+
+		if (x == 0 && y == 0) { continue; }
+
+		//whole angle steps, wrapped onto the nearest way round
+		double want = std::atan2((double)y, (double)x) / (2.0 * M_PI) * ANGLE_TURN;
+		double off = std::fmod(Atan2(y, x) - want + 1.5 * ANGLE_TURN, ANGLE_TURN) - ANGLE_TURN / 2;
+		worstAngle = std::fmax(worstAngle, std::fabs(off));
+
+		double length = std::hypot((double)x, (double)y);
+		//rounding to a whole length, then cordic's own error
+		worstLength = std::fmax(worstLength, std::fabs(Hypot(x, y) - length) / (1.0 + length * 1e-7));
+	}
+	bool ok = Report("Atan2 (angle steps)", worstAngle, 1.0);
+	return Report("Hypot (in 1 + 1e-7 length)", worstLength, 1.0) && ok;
+}
+
+
+static bool CheckRadians() {
+
+	double worst = 0;
+
+	//a double 2pi is off enough to matter at a billion radians,
+	//long double has 11 more bits which is plenty
+	long double turn = 6.283185307179586476925286766559L;
+
+	for (uint32_t i = 0; i < 100000; i++) {
+
+		uint32_t r = i * 42949u + (i & 7);
+		double turns = (double)(fmodl((long double)r, turn) / turn * ANGLE_TURN);
+		double off = std::fmod(AngleFromRadians(r) - turns + 1.5 * ANGLE_TURN, ANGLE_TURN) - ANGLE_TURN / 2;
+		worst = std::fmax(worst, std::fabs(off));
+	}
+	return Report("AngleFromRadians (steps)", worst, 0.5 + 1e-3);
+}
+
+
+static bool CheckSqrt() {
+
+	bool ok = true;
+
+	for (uint32_t x = 0; x < (1u << 24); x++) {
+
+		uint32_t r = isqrt(x);
+		if ((uint64_t)r * r > x || (uint64_t)(r + 1) * (r + 1) <= x) { ok = false; }
+	}
+
+	uint64_t seed = 7;
+
+	for (uint32_t i = 0; i < 1000000; i++) {
+
+		seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		uint32_t x32 = seed >> 32;
+		uint64_t x64 = seed >> (i & 31);
+
+		uint32_t r = isqrt(x32);
+		if ((uint64_t)r * r > x32 || (uint64_t)(r + 1) * (r + 1) <= x32) { ok = false; }
+
+		uint64_t r64 = isqrt64(x64);
+		if (r64 * r64 > x64 || (r64 + 1) * (r64 + 1) <= x64) { ok = false; }
+	}
+	if (isqrt(0xffffffff) != 0xffff) { ok = false; }
+
+	printf("%-30s %s\n", "isqrt/isqrt64 exact floor", ok ? "ok" : "FAIL");
+	return ok;
+}
+
+
+static bool CheckDouble() {
+
+	double worst = 0;
+
+	for (uint32_t i = 0; i < 1000000; i++) {
+
+		double x = (i - 500000.0) * 2.0971519;
+		worst = std::fmax(worst, std::fabs(os::math::sin(x) - std::sin(x)));
+		worst = std::fmax(worst, std::fabs(os::math::cos(x) - std::cos(x)));
+	}
+	return Report("sin/cos double |x| < 2^20", worst, 3e-16);
+}
+
+
+static bool CheckFixed() {
+
+	typedef Fixed<16> Q16;
+
+	bool ok = true;
+
+	ok &= (Q16::Real(1.5) * Q16::Real(-2.25)).raw == Q16::Real(-3.375).raw;
+	ok &= (Q16::Real(7.0) / Q16::Real(-0.5)).raw == Q16::Int(-14).raw;
+	ok &= (Q16::Int(1) / Q16()).raw == 0x7fffffff;
+	ok &= Q16::Sqrt(Q16::Int(2)).raw == 92681;
+	ok &= Q16::Sin(ANGLE_QUARTER).raw == 65536 && Q16::Cos(ANGLE_TURN / 2).raw == -65536;
+	ok &= Q16::Real(-2.5).Floor() == -3 && Q16::Real(2.5).Round() == 3;
+
+	for (int32_t a = -1000; a <= 1000; a += 7) {
+		for (int32_t b = -1000; b <= 1000; b += 13) {
+
+			if (b == 0) { continue; }
+			Q16 q = Q16::Int(a) / Q16::Int(b);
+			if (std::fabs(q.raw / 65536.0 - (double)a / b) > 1.0 / 65536) { ok = false; }
+		}
+	}
+
+	printf("%-30s %s\n", "Fixed<16> arithmetic", ok ? "ok" : "FAIL");
+	return ok;
+}
+
+
+static uint16_t angles[1024];
+static double radians[1024];
+
+static void CallTable(int r) { sinkI = SinFixed(angles[r & 1023]); }
+static void CallCordic(int r) { int32_t s, c; SinCosCordic(angles[r & 1023], &s, &c); sinkI = s; }
+static void CallDouble(int r) { sinkD = os::math::sin(radians[r & 1023]); }
+static void CallOld(int r) { sinkD = OldSin(radians[r & 1023]); }
+static void CallLibm(int r) { sinkD = std::sin(radians[r & 1023]); }
+static void CallAtan2(int r) { sinkI = Atan2(angles[r & 1023] - 30000, angles[(r + 1) & 1023]); }
+static void CallLibmAtan2(int r) { sinkD = std::atan2((double)angles[r & 1023] - 30000, (double)angles[(r + 1) & 1023]); }
+static void CallIsqrt(int r) { sinkI = isqrt(r * 2654435761u); }
+static void CallLibmSqrt(int r) { sinkD = std::sqrt((double)(r * 2654435761u)); }
+
+
+static void Bench(const char* name, void (*call)(int), uint32_t calls) {
+
+	for (uint32_t r = 0; r < calls / 10; r++) { call(r); }
+
+	double start = Now();
+	for (uint32_t r = 0; r < calls; r++) { call(r); }
+	double seconds = Now() - start;
+
+	printf("%-30s %10.1f ns/call\n", name, seconds / calls * 1e9);
+}
+
+
+int main(int argc, char** argv) {
+
+	bool ok = true;
+
+	ok &= CheckTable();
+	ok &= CheckCordic();
+	ok &= CheckVector();
+	ok &= CheckRadians();
+	ok &= CheckSqrt();
+	ok &= CheckDouble();
+	ok &= CheckFixed();
+	printf("\n");
+
+	for (uint32_t i = 0; i < 1024; i++) {
+
+		angles[i] = i * 40503u;
+		radians[i] = AngleRadians(angles[i]) * 3.0 - 10.0;
+	}
+
+	Bench("SinFixed table", CallTable, BENCH_CALLS);
+	Bench("SinCosCordic", CallCordic, BENCH_CALLS);
+	Bench("sin double", CallDouble, BENCH_CALLS);
+	Bench("sin series (old)", CallOld, BENCH_CALLS / 10);
+	Bench("sin libm", CallLibm, BENCH_CALLS);
+	Bench("Atan2 cordic", CallAtan2, BENCH_CALLS);
+	Bench("atan2 libm", CallLibmAtan2, BENCH_CALLS);
+	Bench("isqrt", CallIsqrt, BENCH_CALLS);
+	Bench("sqrt libm", CallLibmSqrt, BENCH_CALLS);
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,1410 @@
+//host side ofs tool, build with 'make ofstool'
+//
+//	./ofstool build disk.img dir [-s MB] [-c]	pack a directory into a new image
+//	./ofstool fsck disk.img				check an image, exits 1 on errors
+//	./ofstool ls disk.img				list files, flags and tags
+//	./ofstool get disk.img path out			copy a file out of an image
+//	./ofstool bench [-n files] [-b blocks] [-r seed]	ofs throughput and latency
+//	./ofstool test					crash, reuse and rewrite cases, exits 1 on a failure
+//
+//the kernel's ofs.cc is linked as is, only the ata driver, the heap
+//and a few kernel helpers are swapped for host versions. the whole
+//disk sits in memory and is written back to the image at the end
+//
+//build takes a directory tree, folders become ofs directories:
+//	name.13h		320x200 mode 13h image, stored with Write13H
+//	name.WxH.13h		image of any other size, like icon.20x20.13h
+//	anything else		stored as is, scripts included
+//	<file>.tags		tags for <file>, separated by spaces or newlines
+
+#include <filesys/ofs.h>
+#include <new>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace os;
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::filesystem;
+
+
+#define DEFAULT_DISK_MB 32
+#define MAX_INPUT_FILES 3072
+
+
+//the disk
+static uint8_t* disk = NULL;
+static uint32_t diskSectors = 0;
+
+//ata traffic, bench reports these per operation
+static uint64_t readCommands = 0;
+static uint64_t writeCommands = 0;
+static uint64_t sectorsRead = 0;
+static uint64_t sectorsWritten = 0;
+static uint32_t ioErrors = 0;
+
+//the filesystem prints its own errors through printf, only shown with -v
+static bool verbose = false;
+static uint32_t prngState = 1;
+
+
+
+//******************************************kernel helpers*********************************************
+
+void printf(char* str) {
+
+	if (verbose) { fputs(str, stdout); }
+}
+
+
+bool strcmp(char* one, char* two) {
+
+	uint16_t i = 0;
+
+	for (i; one[i] != '\0'; i++) {
+
+		if (one[i] != two[i]) { return false; }
+	}
+	return true;
+}
+
+
+uint16_t strlen(char* args) {
+
+	uint16_t length = 0;
+	for (length = 0; args[length] != '\0'; length++) {}
+	return length;
+}
+
+
+//fixed seed so images and bench runs come out the same every time
+uint16_t prng() {
+
+	prngState = prngState * 1103515245 + 12345;
+	return (prngState >> 16) & 0xffff;
+}
+
+
+
+MemoryManager::MemoryManager(common::size_t start, common::size_t size) {
+
+	this->first = 0;
+	this->size = size;
+}
+
+MemoryManager::~MemoryManager() {}
+
+void* MemoryManager::malloc(common::size_t size) { return ::calloc(1, size ? size : 1); }
+void MemoryManager::free(void* ptr) { ::free(ptr); }
+
+
+
+//******************************************memory backed ata*********************************************
+
+AdvancedTechnologyAttachment::AdvancedTechnologyAttachment(uint16_t portBase, bool master)
+: dataPort(portBase),
+  errorPort(portBase + 0x01),
+  sectorCountPort(portBase + 0x02),
+  lbaLowPort(portBase + 0x03),
+  lbaMidPort(portBase + 0x04),
+  lbaHiPort(portBase + 0x05),
+  devicePort(portBase + 0x06),
+  commandPort(portBase + 0x07),
+  controlPort(portBase + 0x206) {
+
+	this->bytesPerSector = 512;
+	this->master = master;
+}
+
+AdvancedTechnologyAttachment::~AdvancedTechnologyAttachment() {}
+
+bool AdvancedTechnologyAttachment::Identify() { return disk != NULL; }
+void AdvancedTechnologyAttachment::Flush() {}
+
+
+static bool InRange(uint32_t sector, uint32_t count) {
+
+	if ((sector & 0xf0000000) == 0 && sector + count <= diskSectors) { return true; }
+
+	fprintf(stderr, "sector %u is past the end of the image\n", sector);
+	ioErrors++;
+	return false;
+}
+
+
+//same partial sector rules as the real driver, bytes offset
+//to count are transferred and a write zeroes the rest
+void AdvancedTechnologyAttachment::Read28(uint32_t sector, uint8_t* data, int count, int offset) {
+
+	if (count > 512 || InRange(sector, 1) == false) { return; }
+
+	for (int i = offset; i < count; i++) { data[i] = disk[(sector*512)+i]; }
+
+	readCommands++;
+	sectorsRead++;
+}
+
+
+void AdvancedTechnologyAttachment::Write28(uint32_t sector, uint8_t* data, int count, int offset) {
+
+	if (count > 512 || InRange(sector, 1) == false) { return; }
+
+	for (int i = offset; i < count; i++) { disk[(sector*512)+i] = data[i]; }
+	for (int i = count; i < 512; i++) { disk[(sector*512)+i] = 0x00; }
+
+	writeCommands++;
+	sectorsWritten++;
+}
+
+
+void AdvancedTechnologyAttachment::Read28Multi(uint32_t sector, uint8_t* data, uint16_t sectorCount) {
+
+	if (sectorCount == 0 || sectorCount > 256 || InRange(sector, sectorCount) == false) { return; }
+
+	memcpy(data, disk + (sector*512), sectorCount*512);
+
+	readCommands++;
+	sectorsRead += sectorCount;
+}
+
+
+void AdvancedTechnologyAttachment::Write28Multi(uint32_t sector, uint8_t* data, uint16_t sectorCount) {
+
+	if (sectorCount == 0 || sectorCount > 256 || InRange(sector, sectorCount) == false) { return; }
+
+	memcpy(disk + (sector*512), data, sectorCount*512);
+
+	writeCommands++;
+	sectorsWritten += sectorCount;
+}
+
+
+
+//******************************************image files*********************************************
+
+static bool NewDisk(uint32_t megabytes) {
+
+	diskSectors = megabytes * 2048;
+	disk = (uint8_t*)calloc(diskSectors, 512);
+
+	return disk != NULL;
+}
+
+
+static bool LoadDisk(const char* path) {
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) { fprintf(stderr, "%s: can't open\n", path); return false; }
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (size < (tableStartSector + 512) * 512) {
+
+		fprintf(stderr, "%s: too small to hold an ofs disk\n", path);
+		fclose(f);
+		return false;
+	}
+
+	diskSectors = size / 512;
+	disk = (uint8_t*)calloc(diskSectors, 512);
+
+	bool ok = disk != NULL && fread(disk, 512, diskSectors, f) == diskSectors;
+	fclose(f);
+
+	if (!ok) { fprintf(stderr, "%s: read failed\n", path); }
+	return ok;
+}
+
+
+static bool SaveDisk(const char* path) {
+
+	FILE* f = fopen(path, "wb");
+	if (f == NULL) { fprintf(stderr, "%s: can't create\n", path); return false; }
+
+	bool ok = fwrite(disk, 512, diskSectors, f) == diskSectors;
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok) { fprintf(stderr, "%s: write failed\n", path); }
+	return ok;
+}
+
+
+static uint8_t* LoadFile(const char* path, uint32_t* size) {
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) { return NULL; }
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t* data = (uint8_t*)calloc(1, *size + 1);
+	*size = fread(data, 1, *size, f);
+	fclose(f);
+
+	return data;
+}
+
+
+static double Now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+
+//******************************************build*********************************************
+
+struct InputFile {
+
+	char path[4096];
+	char name[1024];
+	bool directory;
+	bool image;
+	uint16_t width;
+	uint16_t height;
+};
+
+static InputFile* inputs = NULL;
+static uint32_t inputCount = 0;
+
+
+//the kernel strcmp is a prefix match, this one is the real thing
+static bool Is(const char* one, const char* two) { return strcmp(one, two) == 0; }
+
+
+static bool EndsWith(const char* str, const char* suffix) {
+
+	uint32_t a = strlen(str);
+	uint32_t b = strlen(suffix);
+
+	return a >= b && strncmp(str + a - b, suffix, b) == 0;
+}
+
+
+//name.13h or name.WxH.13h, the name is what's left,
+//folders on the host become ofs directories
+static bool ParseName(const char* fileName, const char* prefix, InputFile* input) {
+
+	char base[4096];
+	snprintf(base, sizeof(base), "%s", fileName);
+
+	input->image = !input->directory && EndsWith(base, ".13h");
+	input->width = 320;
+	input->height = 200;
+
+	if (input->image) {
+
+		base[strlen(base) - 4] = '\0';
+
+		char* dot = strrchr(base, '.');
+		unsigned w = 0, h = 0;
+		char end = 0;
+
+		if (dot != NULL && sscanf(dot + 1, "%ux%u%c", &w, &h, &end) == 2 && w > 0 && h > 0) {
+
+			input->width = w;
+			input->height = h;
+			*dot = '\0';
+		}
+	}
+
+	if (strlen(base) > 32) {
+
+		fprintf(stderr, "%s: name is longer than 32 characters\n", input->path);
+		return false;
+	}
+	snprintf(input->name, sizeof(input->name), "%s%s", prefix, base);
+	return true;
+}
+
+
+static int CompareNames(const struct dirent** a, const struct dirent** b) {
+
+	return strcmp((*a)->d_name, (*b)->d_name) < 0 ? -1 : strcmp((*a)->d_name, (*b)->d_name) > 0;
+}
+
+
+//sorted walk so the same tree always gives the same image,
+//directories come before anything inside them
+static bool CollectFiles(const char* dir, const char* prefix) {
+
+	struct dirent** entries = NULL;
+	int count = scandir(dir, &entries, NULL, CompareNames);
+
+	if (count < 0) { fprintf(stderr, "%s: can't read directory\n", dir); return false; }
+
+	bool ok = true;
+
+	for (int i = 0; i < count && ok; i++) {
+
+		const char* fileName = entries[i]->d_name;
+		char path[4096];
+
+		if (fileName[0] == '.') { continue; }
+		snprintf(path, sizeof(path), "%s/%s", dir, fileName);
+
+		struct stat st;
+		if (stat(path, &st) != 0) { continue; }
+
+		if (!S_ISDIR(st.st_mode) && (!S_ISREG(st.st_mode) || EndsWith(fileName, ".tags"))) { continue; }
+
+
+		if (inputCount >= MAX_INPUT_FILES) {
+
+			fprintf(stderr, "too many files, an ofs directory table holds %d\n", MAX_INPUT_FILES);
+			ok = false;
+			break;
+		}
+
+		InputFile* input = &inputs[inputCount];
+		snprintf(input->path, sizeof(input->path), "%s", path);
+		input->directory = S_ISDIR(st.st_mode);
+
+		if (ParseName(fileName, prefix, input) == false) { ok = false; break; }
+
+		//name.13h and name would end up as the same file
+		for (uint32_t j = 0; j < inputCount; j++) {
+
+			if (Is(inputs[j].name, input->name)) {
+
+				fprintf(stderr, "%s: same name as %s\n", path, inputs[j].path);
+				ok = false;
+				break;
+			}
+		}
+		inputCount++;
+
+		if (ok && input->directory) {
+
+			char childPrefix[1024 + 1];
+			snprintf(childPrefix, sizeof(childPrefix), "%s/", input->name);
+			ok = CollectFiles(path, childPrefix);
+		}
+	}
+
+	for (int i = 0; i < count; i++) { free(entries[i]); }
+	free(entries);
+
+	return ok;
+}
+
+
+static bool AddTags(FileSystem* filesystem, InputFile* input) {
+
+	char path[4096 + 8];
+	snprintf(path, sizeof(path), "%s.tags", input->path);
+
+	uint32_t size = 0;
+	char* text = (char*)LoadFile(path, &size);
+	if (text == NULL) { return true; }
+
+	uint32_t location = filesystem->GetFileSector(input->name);
+	bool ok = true;
+
+	for (char* tag = strtok(text, " \t\r\n"); tag != NULL && ok; tag = strtok(NULL, " \t\r\n")) {
+
+		if (strlen(tag) > 32) { fprintf(stderr, "%s: tag %s is too long\n", path, tag); ok = false; }
+
+		//images are tagged by Write13H already
+		else if (filesystem->GetTagFile(tag, location, NULL)) { continue; }
+
+		else if (filesystem->NewTag(tag, location) == false) {
+
+			fprintf(stderr, "%s: can't add tag %s, a file holds 8\n", path, tag);
+			ok = false;
+		}
+	}
+	free(text);
+	return ok;
+}
+
+
+static bool AddFile(FileSystem* filesystem, InputFile* input, bool compress) {
+
+	if (input->directory) {
+
+		bool ok = filesystem->NewDirectory(input->name);
+		if (!ok) { fprintf(stderr, "%s: mkdir failed\n", input->path); }
+		return ok;
+	}
+
+
+	uint32_t size = 0;
+	uint8_t* data = LoadFile(input->path, &size);
+
+	if (data == NULL) { fprintf(stderr, "%s: can't open\n", input->path); return false; }
+
+	if (input->image) {
+
+		bool ok = size == (uint32_t)input->width * input->height;
+
+		if (!ok) { fprintf(stderr, "%s: %u bytes isn't a %ux%u image\n", input->path, size, input->width, input->height); }
+
+
+		//make room for every tile up front, a file that grows
+		//past the open sector pushes it a whole megabyte along
+		uint32_t rowsPerTile = OFS_BLOCK_SIZE / input->width;
+		if (rowsPerTile > 255) { rowsPerTile = 255; }
+
+		uint32_t tiles = rowsPerTile ? (input->height + rowsPerTile - 1) / rowsPerTile : 0;
+		uint8_t* zeros = (uint8_t*)calloc(1, OFS_BLOCK_SIZE);
+
+		if (ok && tiles > 0 && filesystem->NewFile(input->name, zeros, tiles * OFS_BLOCK_SIZE)) {
+
+			filesystem->NewTag("img", filesystem->GetFileSector(input->name));
+		}
+		free(zeros);
+
+		if (ok && filesystem->Write13H(input->name, data, input->width, input->height, compress) == false) {
+
+			fprintf(stderr, "%s: Write13H failed\n", input->path);
+			ok = false;
+		}
+		free(data);
+		return ok;
+	}
+
+
+	//files are whole blocks like the editor writes them
+	uint32_t blocks = size ? (size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE : 1;
+	uint8_t* padded = (uint8_t*)calloc(blocks, OFS_BLOCK_SIZE);
+	memcpy(padded, data, size);
+	free(data);
+
+	bool ok = filesystem->NewFile(input->name, padded, blocks * OFS_BLOCK_SIZE);
+
+	if (ok && compress) { ok = filesystem->SetCompression(input->name, true); }
+
+	for (uint32_t lba = 1; lba < blocks && ok; lba++) {
+
+		ok = filesystem->WriteLBA(input->name, padded + (lba * OFS_BLOCK_SIZE), lba);
+	}
+	free(padded);
+
+	if (!ok) { fprintf(stderr, "%s: couldn't be written\n", input->path); }
+	return ok;
+}
+
+
+static int Build(int argc, char** argv) {
+
+	if (argc < 2) { fprintf(stderr, "usage: ofstool build disk.img dir [-s MB] [-c]\n"); return 2; }
+
+	uint32_t megabytes = DEFAULT_DISK_MB;
+	bool compress = false;
+
+	for (int i = 2; i < argc; i++) {
+
+		if (Is(argv[i], "-s") && i + 1 < argc) { megabytes = atoi(argv[++i]); }
+		else if (Is(argv[i], "-c")) { compress = true; }
+		else if (Is(argv[i], "-v")) { verbose = true; }
+		else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+	}
+
+	//28 bit lba
+	if (megabytes < 1 || megabytes > 128*1024) { fprintf(stderr, "image size has to be 1 to 131072 MB\n"); return 2; }
+
+
+	inputs = (InputFile*)calloc(MAX_INPUT_FILES, sizeof(InputFile));
+	if (CollectFiles(argv[1], "") == false) { return 1; }
+	if (NewDisk(megabytes) == false) { fprintf(stderr, "out of memory\n"); return 1; }
+
+	double start = Now();
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+	OFS_Table table;
+	FileSystem filesystem(&ata0m, &memoryManager, &table);
+
+	for (uint32_t i = 0; i < inputCount; i++) {
+
+		if (AddFile(&filesystem, &inputs[i], compress) == false) { return 1; }
+		if (AddTags(&filesystem, &inputs[i]) == false) { return 1; }
+	}
+
+	if (ioErrors > 0) { fprintf(stderr, "image is too small, try a bigger -s\n"); return 1; }
+
+	//nothing left for the first boot to replay
+	filesystem.Checkpoint();
+	if (SaveDisk(argv[0]) == false) { return 1; }
+
+	printf("%s: %u files, %u tags, %u of %u sectors used, %.1f ms\n", argv[0],
+		table.fileCount, filesystem.tagCount, table.currentOpenSector, diskSectors, (Now() - start) * 1000.0);
+	return 0;
+}
+
+
+
+//******************************************fsck*********************************************
+
+static uint32_t errors = 0;
+static uint32_t warnings = 0;
+
+
+static void Problem(bool error, const char* format, ...) {
+
+	va_list args;
+	va_start(args, format);
+
+	fputs(error ? "error: " : "warning: ", stdout);
+	vfprintf(stdout, format, args);
+	fputs("\n", stdout);
+
+	va_end(args);
+
+	if (error) { errors++; }
+	else { warnings++; }
+}
+
+
+static uint8_t* Sector(uint32_t sector) { return disk + (sector * 512); }
+
+
+static uint32_t HeaderWord(uint8_t* header, uint32_t offset) {
+
+	return header[offset] | (header[offset+1] << 8) | (header[offset+2] << 16) | ((uint32_t)header[offset+3] << 24);
+}
+
+
+//marks every sector a file's header and blocks sit on
+static void CheckExtents(FileSystem* filesystem, File* file, uint32_t index, uint32_t* owner, uint32_t openSector) {
+
+	OFS_FileHandle handle;
+	handle.location = file->Location;
+	filesystem->LoadHandleExtents(&handle);
+
+	uint32_t blocks = file->Size ? (file->Size + OFS_BLOCK_SIZE - 1) / OFS_BLOCK_SIZE : 1;
+	bool overlapped = false;
+	bool pastOpen = false;
+
+	owner[file->Location] = index + 1;
+
+	//directories are a header and nothing else
+	if (file->Flags & OFS_FLAG_DIRECTORY) { return; }
+
+	for (uint32_t lba = 0; lba < blocks; lba++) {
+
+		uint32_t sector = filesystem->GetBlockSector(&handle, lba);
+
+		for (uint32_t k = 0; k < OFS_BLOCK_SIZE / 512; k++) {
+
+			uint32_t s = sector + k;
+
+			if (s >= diskSectors) {
+
+				Problem(true, "%s: block %u is past the end of the image", file->Name, lba);
+				return;
+			}
+			if (s < tableStartSector + 512) {
+
+				Problem(true, "%s: block %u is inside the metadata area", file->Name, lba);
+				return;
+			}
+			if (s >= openSector) { pastOpen = true; }
+
+			if (owner[s] != 0 && owner[s] != index + 1 && !overlapped) {
+
+				File* other = (File*)(filesystem->table->files->Read(owner[s] - 1));
+				Problem(true, "%s: block %u overlaps %s at sector %u", file->Name, lba, other->Name, s);
+				overlapped = true;
+			}
+			owner[s] = index + 1;
+		}
+
+
+		//blocks that don't decode are lost data
+		if ((file->Flags & OFS_FLAG_COMPRESSED) && lba < OFS_COMPRESSED_BLOCKS && handle.blockSizes[lba] > 0) {
+
+			uint16_t compressedSize = handle.blockSizes[lba];
+
+			if (compressedSize > OFS_BLOCK_SIZE - 512) {
+
+				Problem(true, "%s: block %u claims %u compressed bytes", file->Name, lba, compressedSize);
+				continue;
+			}
+
+			//encrypted blocks can't be checked without the key
+			if (file->Flags & OFS_FLAG_ENCRYPTED) { continue; }
+
+			uint8_t out[OFS_BLOCK_SIZE];
+			if (LZDecompressBlock(Sector(sector), compressedSize, out, OFS_BLOCK_SIZE) != OFS_BLOCK_SIZE) {
+
+				Problem(true, "%s: compressed block %u is corrupt", file->Name, lba);
+			}
+		}
+	}
+
+	if (pastOpen) { Problem(true, "%s: ends past the allocation pointer, new files will land on it", file->Name); }
+}
+
+
+static void CheckTags(FileSystem* filesystem, OFS_Superblock* superblock) {
+
+	uint32_t fileCount = filesystem->table->fileCount;
+	uint8_t* seen = (uint8_t*)calloc(fileCount ? fileCount : 1, 1);
+
+	if (superblock->tagCount > OFS_TAG_INDEX_MAX) {
+
+		Problem(true, "superblock has %u tags, the index holds %u", superblock->tagCount, OFS_TAG_INDEX_MAX);
+		superblock->tagCount = OFS_TAG_INDEX_MAX;
+	}
+
+	for (uint32_t i = 0; i < superblock->tagCount; i++) {
+
+		uint8_t* sector = Sector(tagIndexStartSector + (i / OFS_TAG_ENTRIES_PER_SECTOR));
+		OFS_TagEntry* entry = (OFS_TagEntry*)(sector + ((i % OFS_TAG_ENTRIES_PER_SECTOR) * OFS_TAG_ENTRY_SIZE));
+
+		char tag[33];
+		memcpy(tag, entry->tag, 32);
+		tag[32] = '\0';
+
+		int32_t index = filesystem->GetFileIndex(entry->location);
+
+		if (index < 0) {
+
+			Problem(true, "tag index: \"%s\" points at sector %u, there's no file there", tag, entry->location);
+			continue;
+		}
+		File* file = (File*)(filesystem->table->files->Read(index));
+
+		if (entry->slot >= 8 || memcmp(Sector(file->Location) + 256 + (entry->slot * 32), entry->tag, 32) != 0) {
+
+			Problem(true, "tag index: \"%s\" doesn't match slot %u of %s", tag, entry->slot, file->Name);
+			continue;
+		}
+		seen[index] |= 1 << entry->slot;
+	}
+
+
+	//and the other way around, every header tag is indexed
+	for (uint32_t i = 0; i < fileCount; i++) {
+
+		File* file = (File*)(filesystem->table->files->Read(i));
+		uint8_t* header = Sector(file->Location);
+
+		for (uint32_t slot = 0; slot < 8; slot++) {
+
+			if (header[256 + (slot * 32)] == 0x00 || (seen[i] & (1 << slot))) { continue; }
+
+			char tag[33];
+			memcpy(tag, header + 256 + (slot * 32), 32);
+			tag[32] = '\0';
+
+			Problem(true, "%s: tag \"%s\" is missing from the tag index", file->Name, tag);
+		}
+	}
+	free(seen);
+}
+
+
+static int Fsck(int argc, char** argv) {
+
+	if (argc < 1) { fprintf(stderr, "usage: ofstool fsck disk.img\n"); return 2; }
+	if (LoadDisk(argv[0]) == false) { return 2; }
+
+	for (int i = 1; i < argc; i++) { if (Is(argv[i], "-v")) { verbose = true; } }
+
+
+	//the image is only checked as the kernel would mount it,
+	//whatever the mount writes stays in memory
+	uint8_t* original = (uint8_t*)malloc(diskSectors * 512);
+	memcpy(original, disk, diskSectors * 512);
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+	OFS_Table table;
+	FileSystem filesystem(&ata0m, &memoryManager, &table);
+
+	uint32_t changed = 0;
+	for (uint32_t i = 0; i < diskSectors; i++) { changed += memcmp(original + (i*512), Sector(i), 512) != 0; }
+	free(original);
+
+	if (changed > 0) { Problem(false, "mounting rewrites %u sectors (journal replay, migration or directory repack)", changed); }
+
+
+	OFS_Superblock superblock;
+	memcpy(&superblock, Sector(superblockSector), 512);
+
+	if (filesystem.ReadSuperblock() == false) {
+
+		if (table.fileCount == 0) { printf("%s: empty, no ofs superblock\n", argv[0]); return 0; }
+		Problem(true, "no ofs superblock");
+	}
+
+	if (superblock.dirStart != dirStartSector || superblock.dirSectors != dirSectorCount
+		|| superblock.journalStart != journalStartSector || superblock.journalSectors != journalSectorCount
+		|| superblock.tagStart != tagIndexStartSector || superblock.tagSectors != tagIndexSectorCount) {
+
+		Problem(true, "superblock layout doesn't match this version of ofs");
+	}
+	if (superblock.fileCount != table.fileCount) {
+
+		Problem(true, "superblock counts %u files, the directory has %u", superblock.fileCount, table.fileCount);
+	}
+	if (superblock.currentOpenSector > diskSectors) {
+
+		Problem(true, "allocation pointer %u is past the end of the image", superblock.currentOpenSector);
+	}
+
+
+	uint32_t* owner = (uint32_t*)calloc(diskSectors, sizeof(uint32_t));
+	uint32_t openSector = table.currentOpenSector;
+
+	for (uint32_t i = 0; i < table.fileCount; i++) {
+
+		File* file = (File*)(table.files->Read(i));
+
+		if (file->Location < tableStartSector + 512 || file->Location >= diskSectors) {
+
+			Problem(true, "%s: header sector %u is outside the data area", file->Name, file->Location);
+			continue;
+		}
+
+		uint8_t* header = Sector(file->Location);
+
+		if (header[0] != 0xf1 || header[1] != 0x7e) {
+
+			Problem(true, "%s: no file header at sector %u", file->Name, file->Location);
+			continue;
+		}
+		if (strncmp((char*)header + 8, file->Name, 32) != 0) {
+
+			Problem(true, "%s: header at sector %u is named %.32s", file->Name, file->Location, (char*)header + 8);
+		}
+		if (HeaderWord(header, 4) != file->Size) {
+
+			Problem(true, "%s: directory says %u bytes, header says %u", file->Name, file->Size, HeaderWord(header, 4));
+		}
+		if ((uint32_t)(header[2] | (header[3] << 8)) != file->Flags) {
+
+			Problem(true, "%s: directory and header flags differ", file->Name);
+		}
+		if ((file->Flags & OFS_FLAG_ENCRYPTED) && HeaderWord(header, OFS_KEYCHECK_OFFSET) == 0 && HeaderWord(header, OFS_KEYCHECK_OFFSET + 4) == 0) {
+
+			Problem(false, "%s: encrypted but has no key check value", file->Name);
+		}
+
+		if (HeaderWord(header, OFS_PARENT_OFFSET) != file->Parent) {
+
+			Problem(true, "%s: parent directory %u is gone, it shows up in the root", file->Name, HeaderWord(header, OFS_PARENT_OFFSET));
+		}
+		if ((file->Flags & OFS_FLAG_DIRECTORY) && file->Size != 0) {
+
+			Problem(true, "%s: directory with %u bytes of data", file->Name, file->Size);
+		}
+
+		for (uint32_t j = 0; j < i; j++) {
+
+			File* other = (File*)(table.files->Read(j));
+			if (other->Parent == file->Parent && strncmp(other->Name, file->Name, 33) == 0) { Problem(true, "%s: name is used twice", file->Name); }
+		}
+
+		CheckExtents(&filesystem, file, i, owner, openSector);
+	}
+
+	CheckTags(&filesystem, &superblock);
+
+
+	uint32_t used = 0;
+	for (uint32_t i = 0; i < diskSectors; i++) { used += owner[i] != 0; }
+	free(owner);
+
+	printf("%s: %u files, %u tags, %u data sectors in use, %u errors, %u warnings\n",
+		argv[0], table.fileCount, superblock.tagCount, used, errors, warnings);
+
+	return errors > 0 || ioErrors > 0;
+}
+
+
+
+//******************************************ls and get*********************************************
+
+static int ListFiles(int argc, char** argv) {
+
+	if (argc < 1) { fprintf(stderr, "usage: ofstool ls disk.img\n"); return 2; }
+	if (LoadDisk(argv[0]) == false) { return 2; }
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+	OFS_Table table;
+	FileSystem filesystem(&ata0m, &memoryManager, &table);
+
+	for (uint32_t i = 0; i < table.fileCount; i++) {
+
+		File* file = (File*)(table.files->Read(i));
+		uint8_t* header = Sector(file->Location);
+
+		char path[1024];
+		filesystem.GetPath(file->Location, path, sizeof(path));
+		if (file->Flags & OFS_FLAG_DIRECTORY) { strcat(path, "/"); }
+
+		printf("%-32s %8u %10u %c%c ", path, file->Location, file->Size,
+			(file->Flags & OFS_FLAG_COMPRESSED) ? 'c' : '-',
+			(file->Flags & OFS_FLAG_ENCRYPTED) ? 'e' : '-');
+
+		for (uint32_t slot = 0; slot < 8; slot++) {
+
+			if (header[256 + (slot * 32)] != 0x00) { printf(" %.32s", (char*)header + 256 + (slot * 32)); }
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+
+static int Get(int argc, char** argv) {
+
+	if (argc < 3) { fprintf(stderr, "usage: ofstool get disk.img path out\n"); return 2; }
+	if (LoadDisk(argv[0]) == false) { return 2; }
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+	OFS_Table table;
+	FileSystem filesystem(&ata0m, &memoryManager, &table);
+
+	int32_t handle = filesystem.Open(argv[1]);
+	if (handle < 0) { fprintf(stderr, "%s: no such file, or it's locked\n", argv[1]); return 1; }
+
+	FILE* out = fopen(argv[2], "wb");
+	if (out == NULL) { fprintf(stderr, "%s: can't create\n", argv[2]); return 1; }
+
+	uint8_t data[OFS_BLOCK_SIZE];
+	uint32_t bytesRead = 0;
+
+	while ((bytesRead = filesystem.Read(handle, data, OFS_BLOCK_SIZE)) > 0) { fwrite(data, 1, bytesRead, out); }
+
+	filesystem.Close(handle);
+	fclose(out);
+	return 0;
+}
+
+
+
+//******************************************bench*********************************************
+
+struct BenchPhase {
+
+	const char* name;
+	uint32_t ops;
+	double total;
+	double worst;
+	double start;
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t sectorsIn;
+	uint64_t sectorsOut;
+};
+
+
+static void BeginPhase(BenchPhase* phase, const char* name) {
+
+	phase->name = name;
+	phase->ops = 0;
+	phase->total = 0;
+	phase->worst = 0;
+	phase->reads = readCommands;
+	phase->writes = writeCommands;
+	phase->sectorsIn = sectorsRead;
+	phase->sectorsOut = sectorsWritten;
+}
+
+
+static void BeginOp(BenchPhase* phase) { phase->start = Now(); }
+
+static void EndOp(BenchPhase* phase) {
+
+	double time = Now() - phase->start;
+
+	phase->ops++;
+	phase->total += time;
+	if (time > phase->worst) { phase->worst = time; }
+}
+
+
+//sector counts are exact for a given seed, times are whatever the host does
+static void EndPhase(BenchPhase* phase) {
+
+	uint32_t ops = phase->ops ? phase->ops : 1;
+
+	printf("%-10s %6u %10.2f %10.1f %10.1f %9.1f %9.1f %9.1f %9.1f\n", phase->name, phase->ops,
+		phase->total * 1000.0,
+		(phase->total / ops) * 1e6,
+		phase->worst * 1e6,
+		(double)(readCommands - phase->reads) / ops,
+		(double)(sectorsRead - phase->sectorsIn) / ops,
+		(double)(writeCommands - phase->writes) / ops,
+		(double)(sectorsWritten - phase->sectorsOut) / ops);
+}
+
+
+//same picture lzbench uses, flat fills, dithering and noise
+static void MakeImage(uint8_t* data) {
+
+	uint32_t seed = 12345;
+
+	for (uint32_t y = 0; y < 200; y++) {
+		for (uint32_t x = 0; x < 320; x++) {
+
+			uint8_t c = 0x37;
+
+			if (y > 140) { c = ((x + y) & 1) ? 0x02 : 0x06; }
+			else if (x > 100 && x < 220 && y > 40 && y < 120) { c = 0x40 + ((x - 100) / 8); }
+
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) % 50 == 0) { c = (seed >> 8) & 0xff; }
+
+			data[y*320+x] = c;
+		}
+	}
+}
+
+
+static int Bench(int argc, char** argv) {
+
+	uint32_t files = 64;
+	uint32_t blocks = 8;
+
+	for (int i = 0; i < argc; i++) {
+
+		if (Is(argv[i], "-n") && i + 1 < argc) { files = atoi(argv[++i]); }
+		else if (Is(argv[i], "-b") && i + 1 < argc) { blocks = atoi(argv[++i]); }
+		else if (Is(argv[i], "-r") && i + 1 < argc) { prngState = atoi(argv[++i]); }
+		else { fprintf(stderr, "usage: ofstool bench [-n files] [-b blocks] [-r seed]\n"); return 2; }
+	}
+
+	if (files < 1 || files > 1000 || blocks < 1 || blocks > OFS_COMPRESSED_BLOCKS) {
+
+		fprintf(stderr, "1 to 1000 files of 1 to %d blocks\n", OFS_COMPRESSED_BLOCKS);
+		return 2;
+	}
+
+	//room for every file plus fragments and the images
+	uint32_t megabytes = ((files * (blocks + 1) * OFS_BLOCK_SIZE) / (1024*1024)) * 2 + 8;
+	if (NewDisk(megabytes) == false) { fprintf(stderr, "out of memory\n"); return 1; }
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+	OFS_Table table;
+	FileSystem filesystem(&ata0m, &memoryManager, &table);
+
+	uint8_t* data = (uint8_t*)calloc(blocks, OFS_BLOCK_SIZE);
+	uint8_t* image = (uint8_t*)calloc(320, 200);
+	char name[33];
+	BenchPhase phase;
+
+	for (uint32_t i = 0; i < blocks * OFS_BLOCK_SIZE; i++) { data[i] = (i % 61 == 0) ? prng() : 'a' + (i % 26); }
+	MakeImage(image);
+
+	printf("%u files of %u blocks, %u MB disk\n\n", files, blocks, megabytes);
+	printf("%-10s %6s %10s %10s %10s %9s %9s %9s %9s\n", "phase", "ops", "total ms", "avg us", "max us", "rd cmds", "rd secs", "wr cmds", "wr secs");
+
+
+	BeginPhase(&phase, "create");
+	for (uint32_t f = 0; f < files; f++) {
+
+		snprintf(name, sizeof(name), "bench%u", f);
+		BeginOp(&phase);
+
+		filesystem.NewFile(name, data, blocks * OFS_BLOCK_SIZE);
+		for (uint32_t lba = 1; lba < blocks; lba++) { filesystem.WriteLBA(name, data + (lba * OFS_BLOCK_SIZE), lba); }
+
+		EndOp(&phase);
+	}
+	EndPhase(&phase);
+
+
+	BeginPhase(&phase, "tag");
+	for (uint32_t f = 0; f < files; f++) {
+
+		snprintf(name, sizeof(name), "bench%u", f);
+		BeginOp(&phase);
+
+		uint32_t location = filesystem.GetFileSector(name);
+		filesystem.NewTag("bench", location);
+		if (f & 1) { filesystem.NewTag("odd", location); }
+
+		EndOp(&phase);
+	}
+	EndPhase(&phase);
+
+
+	BeginPhase(&phase, "seqread");
+	for (uint32_t f = 0; f < files; f++) {
+
+		snprintf(name, sizeof(name), "bench%u", f);
+		BeginOp(&phase);
+
+		int32_t handle = filesystem.Open(name);
+		uint8_t block[OFS_BLOCK_SIZE];
+		while (filesystem.Read(handle, block, OFS_BLOCK_SIZE) > 0) {}
+		filesystem.Close(handle);
+
+		EndOp(&phase);
+	}
+	EndPhase(&phase);
+
+
+	BeginPhase(&phase, "randread");
+	for (uint32_t i = 0; i < files * 8; i++) {
+
+		snprintf(name, sizeof(name), "bench%u", prng() % files);
+		uint32_t position = (prng() % (blocks * 4)) * 512;
+		BeginOp(&phase);
+
+		int32_t handle = filesystem.Open(name);
+		uint8_t sector[512];
+		filesystem.Seek(handle, position);
+		filesystem.Read(handle, sector, 512);
+		filesystem.Close(handle);
+
+		EndOp(&phase);
+	}
+	EndPhase(&phase);
+
+
+	BeginPhase(&phase, "tagquery");
+	uint32_t* locations = (uint32_t*)calloc(files, sizeof(uint32_t));
+	for (uint32_t i = 0; i < files; i++) {
+
+		BeginOp(&phase);
+		filesystem.GetTagFiles("odd", locations, files);
+		EndOp(&phase);
+	}
+	free(locations);
+	EndPhase(&phase);
+
+
+	//same picture raw then compressed
+	for (int compress = 0; compress < 2; compress++) {
+
+		char* imageName = compress ? (char*)"benchlz" : (char*)"benchraw";
+		uint8_t* surface = (uint8_t*)calloc(320, 200);
+		uint16_t w = 0, h = 0;
+
+		BeginPhase(&phase, compress ? "imgwr lz" : "imgwr");
+		for (uint32_t i = 0; i < 8; i++) {
+
+			BeginOp(&phase);
+			filesystem.Write13H(imageName, image, 320, 200, compress);
+			EndOp(&phase);
+		}
+		EndPhase(&phase);
+
+		BeginPhase(&phase, compress ? "imgrd lz" : "imgrd");
+		for (uint32_t i = 0; i < 32; i++) {
+
+			BeginOp(&phase);
+			filesystem.ReadImage(imageName, surface, 320, 200, &w, &h);
+			EndOp(&phase);
+		}
+		EndPhase(&phase);
+
+		if (memcmp(surface, image, 320*200) != 0) { fprintf(stderr, "%s came back different\n", imageName); return 1; }
+		free(surface);
+	}
+
+
+	BeginPhase(&phase, "delete");
+	for (uint32_t f = 0; f < files; f++) {
+
+		snprintf(name, sizeof(name), "bench%u", f);
+		BeginOp(&phase);
+		filesystem.DeleteFile(name);
+		EndOp(&phase);
+	}
+	EndPhase(&phase);
+
+	free(data);
+	free(image);
+
+	return ioErrors > 0;
+}
+
+
+//******************************************tests*********************************************
+
+static uint32_t failures = 0;
+
+static void Expect(bool ok, const char* test, const char* what) {
+
+	printf("%-10s %-44s %s\n", test, what, ok ? "ok" : "FAILED");
+	if (!ok) { failures++; }
+}
+
+
+//a fresh mount of whatever is on the disk right now,
+//the journal gets replayed the same as after a crash
+static FileSystem* Mount(AdvancedTechnologyAttachment* ata0m, MemoryManager* memoryManager) {
+
+	OFS_Table* table = (OFS_Table*)calloc(1, sizeof(OFS_Table));
+	FileSystem* filesystem = (FileSystem*)calloc(1, sizeof(FileSystem));
+
+	new (filesystem) FileSystem(ata0m, memoryManager, table);
+	return filesystem;
+}
+
+
+static bool BlockIs(FileSystem* filesystem, char* name, uint32_t lba, uint8_t value) {
+
+	uint8_t block[OFS_BLOCK_SIZE];
+	if (filesystem->ReadLBA(name, block, lba) == false) { return false; }
+
+	for (uint32_t i = 0; i < OFS_BLOCK_SIZE; i++) { if (block[i] != value) { return false; } }
+	return true;
+}
+
+
+//a deleted file's zeroed header is still in the journal when
+//its sector comes back as data, neither a checkpoint nor a
+//replay after a crash may write it over the new data
+static void TestHeaderReuse(AdvancedTechnologyAttachment* ata0m, MemoryManager* memoryManager) {
+
+	FileSystem* filesystem = Mount(ata0m, memoryManager);
+	uint8_t data[OFS_BLOCK_SIZE];
+
+	memset(data, 0x11, OFS_BLOCK_SIZE);
+	filesystem->NewFile("b", data, OFS_BLOCK_SIZE);
+	filesystem->NewFile("a", data, OFS_BLOCK_SIZE);
+
+	uint32_t header = filesystem->GetFileSector("a");
+	filesystem->DeleteFile("a");
+	filesystem->DeleteFile("b");
+
+	filesystem->NewFile("c", data, OFS_BLOCK_SIZE);
+	memset(data, 0x22, OFS_BLOCK_SIZE);
+	filesystem->WriteLBA("c", data, 1);
+
+	Expect(filesystem->GetFileSector("c") + 1 + (OFS_BLOCK_SIZE / 512) == header, "reuse", "block 1 of c is a's old header");
+	Expect(BlockIs(filesystem, "c", 1, 0x22), "reuse", "block reads back before a checkpoint");
+
+	//crash here, nothing checkpointed yet
+	uint8_t* crashed = (uint8_t*)malloc(diskSectors * 512);
+	memcpy(crashed, disk, diskSectors * 512);
+
+	//enough metadata to force a checkpoint
+	char name[33];
+	memset(data, 0x33, OFS_BLOCK_SIZE);
+
+	for (uint32_t i = 0; i < OFS_JOURNAL_MAX_PENDING; i++) {
+
+		snprintf(name, sizeof(name), "pad%u", i);
+		filesystem->NewFile(name, data, OFS_BLOCK_SIZE);
+	}
+	Expect(BlockIs(filesystem, "c", 1, 0x22), "reuse", "block survives a checkpoint");
+
+	memcpy(disk, crashed, diskSectors * 512);
+	free(crashed);
+
+	filesystem = Mount(ata0m, memoryManager);
+	Expect(BlockIs(filesystem, "c", 1, 0x22), "reuse", "block survives a replay");
+}
+
+
+//nonce bytes as they are on disk, a mount puts the journal home first
+static uint64_t Nonce(AdvancedTechnologyAttachment* ata0m, MemoryManager* memoryManager, char* name) {
+
+	FileSystem* filesystem = Mount(ata0m, memoryManager);
+	uint8_t* header = disk + (filesystem->GetFileSector(name) * 512);
+
+	uint64_t nonce = 0;
+	for (int i = 0; i < 8; i++) { nonce = (nonce << 8) | header[OFS_NONCE_OFFSET + i]; }
+	return nonce;
+}
+
+
+//rewriting blocks of an unlocked file costs one block each,
+//the nonce stays and no block gets the same keystream twice
+static void TestRewrite(AdvancedTechnologyAttachment* ata0m, MemoryManager* memoryManager, bool compress) {
+
+	const char* test = compress ? "rewrite lz" : "rewrite";
+	const uint32_t blocks = 16;
+
+	uint8_t key[16];
+	for (int i = 0; i < 16; i++) { key[i] = i * 7; }
+
+	uint8_t* data = (uint8_t*)calloc(blocks, OFS_BLOCK_SIZE);
+	for (uint32_t i = 0; i < blocks * OFS_BLOCK_SIZE; i++) { data[i] = 'a' + ((i / 7) % 26); }
+
+	char* name = compress ? (char*)"secretlz" : (char*)"secret";
+	FileSystem* filesystem = Mount(ata0m, memoryManager);
+
+	filesystem->NewFile(name, data, blocks * OFS_BLOCK_SIZE);
+	for (uint32_t lba = 1; lba < blocks; lba++) { filesystem->WriteLBA(name, data + (lba * OFS_BLOCK_SIZE), lba); }
+	if (compress) { filesystem->SetCompression(name, true); }
+	filesystem->CryptFile(name, key, true);
+
+	uint64_t nonce = Nonce(ata0m, memoryManager, name);
+	filesystem = Mount(ata0m, memoryManager);
+	Expect(filesystem->UnlockFile(name, key), test, "unlocks");
+
+	uint32_t block0 = filesystem->GetFileSector(name) + 1;
+	uint8_t before[OFS_BLOCK_SIZE];
+	memcpy(before, disk + (block0 * 512), OFS_BLOCK_SIZE);
+
+
+	//save the whole file the way the editor does, with the first block changed
+	memset(data, 'z', 64);
+	uint64_t sectors = sectorsRead + sectorsWritten;
+
+	bool ok = true;
+	for (uint32_t lba = 0; lba < blocks; lba++) { ok = filesystem->WriteLBA(name, data + (lba * OFS_BLOCK_SIZE), lba) && ok; }
+
+	Expect(ok, test, "every block rewrites");
+	Expect(sectorsRead + sectorsWritten - sectors < blocks * (OFS_BLOCK_SIZE / 512) * 3, test, "a block costs about a block of io");
+
+	//same counters would make the ciphertexts xor to the plaintexts
+	bool reused = true;
+	uint8_t* after = disk + (block0 * 512);
+	uint8_t plain[OFS_BLOCK_SIZE];
+	memset(plain, 0, OFS_BLOCK_SIZE);
+
+	for (uint32_t i = 0; i < 64; i++) { plain[i] = ('a' + ((i / 7) % 26)) ^ 'z'; }
+	for (uint32_t i = 0; i < 64 && !compress; i++) { reused = reused && (before[i] ^ after[i]) == plain[i]; }
+
+	Expect(compress || !reused, test, "rewritten block gets new keystream");
+	Expect(Nonce(ata0m, memoryManager, name) == nonce, test, "nonce stays");
+
+
+	filesystem = Mount(ata0m, memoryManager);
+	filesystem->UnlockFile(name, key);
+
+	ok = true;
+	uint8_t block[OFS_BLOCK_SIZE];
+	for (uint32_t lba = 0; lba < blocks; lba++) {
+
+		filesystem->ReadLBA(name, block, lba);
+		ok = ok && memcmp(block, data + (lba * OFS_BLOCK_SIZE), OFS_BLOCK_SIZE) == 0;
+	}
+	Expect(ok, test, "reads back after a remount");
+
+	int32_t handle = filesystem->Open(name);
+	uint8_t* all = (uint8_t*)calloc(blocks, OFS_BLOCK_SIZE);
+	filesystem->Read(handle, all, blocks * OFS_BLOCK_SIZE);
+	filesystem->Close(handle);
+
+	Expect(memcmp(all, data, blocks * OFS_BLOCK_SIZE) == 0, test, "reads back through a handle");
+	free(all);
+
+
+	filesystem->CryptFile(name, key, false);
+	filesystem->CryptFile(name, key, true);
+	Expect(Nonce(ata0m, memoryManager, name) == nonce + 1, test, "encrypting again moves the nonce on");
+
+	filesystem = Mount(ata0m, memoryManager);
+	filesystem->CryptFile(name, key, false);
+
+	ok = true;
+	for (uint32_t lba = 0; lba < blocks; lba++) {
+
+		filesystem->ReadLBA(name, block, lba);
+		ok = ok && memcmp(block, data + (lba * OFS_BLOCK_SIZE), OFS_BLOCK_SIZE) == 0;
+	}
+	Expect(ok, test, "reads back after decrypt");
+	free(data);
+}
+
+
+//drawpic reads into a screen sized buffer, an image bigger
+//than that comes back cut down instead of running past it
+static void TestImageClip(AdvancedTechnologyAttachment* ata0m, MemoryManager* memoryManager, bool compress) {
+
+	const char* test = compress ? "clip lz" : "clip";
+	FileSystem* filesystem = Mount(ata0m, memoryManager);
+
+	char name[] = "big";
+	uint16_t width = 400;
+	uint16_t height = 250;
+	uint8_t* image = (uint8_t*)malloc(width * height);
+
+	for (uint32_t i = 0; i < (uint32_t)(width * height); i++) { image[i] = (i % width) ^ (i / width); }
+	filesystem->Write13H(name, image, width, height, compress);
+
+	//13h sized, guard bytes after it catch an overrun
+	uint16_t screenWidth = 320;
+	uint16_t screenHeight = 200;
+	uint32_t size = screenWidth * screenHeight;
+	uint8_t* buf = (uint8_t*)malloc(size + OFS_BLOCK_SIZE);
+	memset(buf, 0xee, size + OFS_BLOCK_SIZE);
+
+	uint16_t w = 0;
+	uint16_t h = 0;
+	Expect(filesystem->Read13H(name, buf, screenWidth, screenHeight, &w, &h, compress), test, "reads");
+	Expect(w == screenWidth && h == screenHeight, test, "size is cut down to the buffer");
+
+	bool ok = true;
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) { ok = ok && buf[(w * y) + x] == image[(width * y) + x]; }
+	}
+	Expect(ok, test, "rows are packed at the returned width");
+
+	ok = true;
+	for (uint32_t i = size; i < size + OFS_BLOCK_SIZE; i++) { ok = ok && buf[i] == 0xee; }
+	Expect(ok, test, "nothing past the buffer is written");
+
+	free(buf);
+	free(image);
+}
+
+
+static int Test(int argc, char** argv) {
+
+	for (int i = 0; i < argc; i++) {
+
+		if (Is(argv[i], "-v")) { verbose = true; }
+		else { fprintf(stderr, "usage: ofstool test [-v]\n"); return 2; }
+	}
+
+	AdvancedTechnologyAttachment ata0m(0x1F0, true);
+	MemoryManager memoryManager(0, 0);
+
+	if (NewDisk(8) == false) { fprintf(stderr, "out of memory\n"); return 1; }
+	TestHeaderReuse(&ata0m, &memoryManager);
+	free(disk);
+
+	if (NewDisk(8) == false) { fprintf(stderr, "out of memory\n"); return 1; }
+	TestRewrite(&ata0m, &memoryManager, false);
+	TestRewrite(&ata0m, &memoryManager, true);
+	free(disk);
+
+	if (NewDisk(8) == false) { fprintf(stderr, "out of memory\n"); return 1; }
+	TestImageClip(&ata0m, &memoryManager, false);
+	TestImageClip(&ata0m, &memoryManager, true);
+	free(disk);
+
+	printf("\n%u failed\n", failures);
+	return (failures > 0 || ioErrors > 0) ? 1 : 0;
+}
+
+
+
+int main(int argc, char** argv) {
+
+	if (argc >= 2) {
+
+		if (Is(argv[1], "build")) { return Build(argc - 2, argv + 2); }
+		if (Is(argv[1], "fsck")) { return Fsck(argc - 2, argv + 2); }
+		if (Is(argv[1], "ls")) { return ListFiles(argc - 2, argv + 2); }
+		if (Is(argv[1], "get")) { return Get(argc - 2, argv + 2); }
+		if (Is(argv[1], "bench")) { return Bench(argc - 2, argv + 2); }
+		if (Is(argv[1], "test")) { return Test(argc - 2, argv + 2); }
+	}
+
+	fprintf(stderr, "usage: ofstool build disk.img dir [-s MB] [-c]\n"
+			"       ofstool fsck disk.img\n"
+			"       ofstool ls disk.img\n"
+			"       ofstool get disk.img name out\n"
+			"       ofstool bench [-n files] [-b blocks] [-r seed]\n"
+			"       ofstool test [-v]\n");
+	return 2;
+}
@@ -0,0 +1,418 @@
+//host side benchmark for the 13h drawing primitives,
+//build with 'make vgabench' and run './vgabench'
+//
+//the real driver is linked in with the frame buffer pointed
+//at a plain array, every primitive is also checked against
+//a per pixel PutPixel version of itself, clipping included
+
+#include <drivers/vga.h>
+#include <gui/raycasting.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace os::common;
+using namespace os::drivers;
+using namespace os::gui;
+
+
+#define BENCH_ROUNDS 2000
+
+
+//the kernel has these in kernel.cc
+uint16_t strlen(char* str) {
+
+	uint16_t i = 0;
+	while (str[i] != '\0') { i++; }
+	return i;
+}
+
+uint8_t Web2EGA(uint32_t webColor) {
+
+	return webColor & 0xff;
+}
+
+
+static VideoGraphicsArray vga;
+static VideoGraphicsArray reference;
+static uint8_t vram[64000];
+
+static uint8_t picture[64000];
+static uint8_t sprite[32*32];
+static Sprite* encoded;
+static uint32_t photo[64000];
+static uint32_t dithered[64000];
+static RaycastSpace* space;
+static RaycastSpace* layered;
+static Layer* layer;
+
+
+static double Now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+static void MakeData() {
+
+	uint32_t seed = 12345;
+
+	for (uint32_t i = 0; i < 64000; i++) {
+
+		seed = seed * 1103515245 + 12345;
+		picture[i] = (seed >> 16) & 0xff;
+	}
+
+	//ball with a clear border, like the game sprites
+	for (int32_t y = 0; y < 32; y++) {
+		for (int32_t x = 0; x < 32; x++) {
+
+			int32_t dx = x - 16;
+			int32_t dy = y - 16;
+			sprite[y*32+x] = (dx*dx + dy*dy < 14*14) ? 0x38 + (x & 7) : 0;
+		}
+	}
+}
+
+
+//what every primitive did before it had spans
+static void SlowFillBuffer(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t* buf, bool mirror) {
+
+	for (int32_t Y = y; Y < y+h; Y++) {
+		for (int32_t X = x; X < x+w; X++) {
+
+			uint8_t c = mirror ? buf[w*(Y-y)+(x+w-X-1)] : buf[w*(Y-y)+(X-x)];
+			if (c) { reference.PutPixel(X, Y, c); }
+		}
+	}
+}
+
+
+static void SlowFillRectangle(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t color) {
+
+	for (int32_t Y = y; Y < y+h; Y++) {
+		for (int32_t X = x; X < x+w; X++) {
+
+			reference.PutPixel(X, Y, color);
+		}
+	}
+}
+
+
+//the old text loop, minus the column it read past each glyph
+static void SlowPutText(char* str, int32_t x, int32_t y, uint8_t color) {
+
+	for (int i = 0; str[i] != '\0'; i++, x += font_width) {
+
+		uint8_t* charArr = charset[(uint8_t)(str[i])-32];
+
+		for (uint8_t w = 0; w < 5; w++) {
+			for (uint8_t h = 0; h < font_height; h++) {
+
+				if ((charArr[w] >> h) & 1) { reference.PutPixel(x+w, y+h, color); }
+			}
+		}
+	}
+}
+
+
+//pixel at a time even-odd with exact crossings, a pixel is
+//filled when an odd number of edges cross the row at or left
+//of it, rounding each crossing up like the fill does
+static void SlowFillPolygon(uint16_t x[], uint16_t y[], uint8_t count, uint8_t color) {
+
+	for (int32_t Y = 0; Y < 200; Y++) {
+		for (int32_t X = 0; X < 320; X++) {
+
+			uint8_t crossings = 0;
+
+			for (uint8_t i = 0; i < count; i++) {
+
+				int32_t x0 = (int16_t)x[i], y0 = (int16_t)y[i];
+				int32_t x1 = (int16_t)x[(i + 1) % count], y1 = (int16_t)y[(i + 1) % count];
+
+				if (y0 > y1) { int32_t t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; }
+				if (Y < y0 || Y >= y1) { continue; }
+
+				long long num = (long long)(Y - y0) * (x1 - x0);
+				long long den = y1 - y0;
+				long long up = num >= 0 ? (num + den - 1) / den : -((-num) / den);
+
+				if (x0 + up <= X) { crossings++; }
+			}
+			if (crossings & 1) { reference.PutPixel(X, Y, color); }
+		}
+	}
+}
+
+
+//the room in the simulator, walls aren't convex
+static uint16_t roomX[][6] = { {0, 160, 320}, {90, 160, 230, 160}, {105, 160, 215, 160},
+			       {0, 160, 320, 320, 160, 0}, {0, 160, 320, 320, 160, 0}, {0, 160, 320, 320, 160, 0} };
+static uint16_t roomY[][6] = { {95, 65, 95}, {120, 100, 120, 140}, {120, 105, 120, 135},
+			       {95, 65, 95, 80, 50, 80}, {80, 50, 80, 70, 40, 70}, {70, 40, 70, 20, 0, 20} };
+static uint8_t roomCount[] = {3, 4, 4, 6, 6, 6};
+static uint8_t roomColor[] = {0x14, 0x3f, 0x23, 0x20, 0x2a, 0x37};
+
+
+static bool CheckPolygon() {
+
+	memset(vga.pixels, 0, 64000);
+	memset(reference.pixels, 0, 64000);
+
+	for (uint8_t i = 0; i < 6; i++) {
+
+		vga.FillPolygon(roomX[i], roomY[i], roomCount[i], roomColor[i]);
+		SlowFillPolygon(roomX[i], roomY[i], roomCount[i], roomColor[i]);
+	}
+	if (memcmp(vga.pixels, reference.pixels, 64000) != 0) { return false; }
+
+
+	//random ones, some hanging off the screen and some tangled
+	uint32_t seed = 99;
+	uint16_t x[12];
+	uint16_t y[12];
+
+	for (uint32_t round = 0; round < 300; round++) {
+
+		uint8_t count = 3 + (round % 10);
+
+		for (uint8_t i = 0; i < count; i++) {
+
+			seed = seed * 1103515245 + 12345;
+			x[i] = (int16_t)((seed >> 8) % 400) - 40;
+			seed = seed * 1103515245 + 12345;
+			y[i] = (int16_t)((seed >> 8) % 260) - 30;
+		}
+
+		memset(vga.pixels, 0, 64000);
+		memset(reference.pixels, 0, 64000);
+
+		vga.FillPolygon(x, y, count, 1 + round % 200);
+		SlowFillPolygon(x, y, count, 1 + round % 200);
+
+		if (memcmp(vga.pixels, reference.pixels, 64000) != 0) { return false; }
+	}
+	return true;
+}
+
+
+static bool Check() {
+
+	int32_t spots[][2] = { {0, 0}, {-5, -7}, {300, 180}, {-31, 100}, {150, -31}, {319, 199}, {3, 5} };
+
+	memset(vga.pixels, 0, 64000);
+	memset(reference.pixels, 0, 64000);
+
+	for (uint32_t i = 0; i < sizeof(spots) / sizeof(spots[0]); i++) {
+
+		int32_t x = spots[i][0];
+		int32_t y = spots[i][1];
+
+		vga.FillBuffer(x, y, 32, 32, sprite, false);
+		SlowFillBuffer(x, y, 32, 32, sprite, false);
+
+		vga.FillBuffer(x + 40, y + 9, 32, 32, sprite, true);
+		SlowFillBuffer(x + 40, y + 9, 32, 32, sprite, true);
+
+		vga.DrawSprite(x + 80, y + 30, encoded, false);
+		SlowFillBuffer(x + 80, y + 30, 32, 32, sprite, false);
+
+		vga.DrawSprite(x + 120, y + 3, encoded, true);
+		SlowFillBuffer(x + 120, y + 3, 32, 32, sprite, true);
+
+		vga.FillRectangle(x + 1, y + 2, 37, 11, i + 1);
+		SlowFillRectangle(x + 1, y + 2, 37, 11, i + 1);
+
+		vga.PutText("osakaOS ~$ ls", x + 7, y + 60, i + 17);
+		SlowPutText("osakaOS ~$ ls", x + 7, y + 60, i + 17);
+
+		vga.DrawRectangle(x + 5, y + 20, 50, 30, i + 9);
+		SlowFillRectangle(x + 5, y + 20, 50, 1, i + 9);
+		SlowFillRectangle(x + 5, y + 49, 50, 1, i + 9);
+		SlowFillRectangle(x + 5, y + 20, 1, 30, i + 9);
+		SlowFillRectangle(x + 54, y + 20, 1, 30, i + 9);
+	}
+
+	vga.FillBufferFull(-10, 150, 320, 200, picture);
+	for (int32_t Y = 150; Y < 200; Y++) {
+		for (int32_t X = 0; X < 310; X++) {
+
+			reference.PutPixel(X, Y, picture[320*(Y-150)+(X+10)]);
+		}
+	}
+	return memcmp(vga.pixels, reference.pixels, 64000) == 0;
+}
+
+
+//frames built on the kept floor should be the frames drawn from
+//scratch, both while standing still and right after turning
+static bool CheckLayer() {
+
+	RaycastSpace* plain = new RaycastSpace();
+	bool ok = true;
+
+	//still, still, turn, still, walk, still
+	int32_t mouse[] = {160, 160, 200, 160, 160, 160};
+	bool walk[] = {false, false, false, false, true, false};
+
+	for (uint8_t f = 0; f < 6; f++) {
+
+		//whatever was on screen before shouldn't leak through
+		memset(vga.pixels, f * 17, 64000);
+		plain->keyDown = walk[f];
+		plain->DrawSpace(&vga);
+		plain->MoveCamera((char*)"w", 1, mouse[f]);
+		memcpy(reference.pixels, vga.pixels, 64000);
+
+		memset(vga.pixels, f * 29 + 1, 64000);
+		layered->keyDown = walk[f];
+		layered->DrawSpace(&vga);
+		layered->MoveCamera((char*)"w", 1, mouse[f]);
+
+		if (memcmp(vga.pixels, reference.pixels, 64000) != 0) { ok = false; }
+	}
+
+	delete plain;
+	return ok;
+}
+
+
+//a smooth gradient should come out of the dither with the same
+//average color over any small block, which a wrapping error can't
+static bool CheckDither() {
+
+	//just the ega part of LoadPalette, it would write the dac
+	for (uint16_t c = 0; c < QUANT_COLORS; c++) {
+
+		vga.colors[c][0] = (c & 0x20 ? 0x15 : 0) | (c & 0x04 ? 0x2a : 0);
+		vga.colors[c][1] = (c & 0x10 ? 0x15 : 0) | (c & 0x02 ? 0x2a : 0);
+		vga.colors[c][2] = (c & 0x08 ? 0x15 : 0) | (c & 0x01 ? 0x2a : 0);
+	}
+	ColorTable::stale = true;
+
+	for (uint32_t y = 0; y < 200; y++) {
+		for (uint32_t x = 0; x < 320; x++) {
+
+			photo[320*y+x] = ((x * 255 / 319) << 16) | ((y * 255 / 199) << 8) | (((x + y) * 255 / 518));
+		}
+	}
+	memcpy(dithered, photo, sizeof(photo));
+	vga.FSdither(dithered, 320, 200);
+
+	for (uint32_t by = 0; by < 200; by += 20) {
+		for (uint32_t bx = 0; bx < 320; bx += 20) {
+
+			int32_t want[3] = {0, 0, 0};
+			int32_t got[3] = {0, 0, 0};
+
+			for (uint32_t y = by; y < by + 20; y++) {
+				for (uint32_t x = bx; x < bx + 20; x++) {
+
+					for (uint8_t i = 0; i < 3; i++) {
+
+						want[i] += (photo[320*y+x] >> (16 - (i * 8))) & 0xff;
+						got[i] += ColorTable::rgb[dithered[320*y+x]][i];
+					}
+				}
+			}
+			for (uint8_t i = 0; i < 3; i++) {
+
+				if (abs(want[i] - got[i]) / 400 > 12) { return false; }
+			}
+		}
+	}
+	return true;
+}
+
+
+//one call draws one primitive, r varies the position and color
+static void PutPixelLoop(int r) { SlowFillRectangle(0, 0, 320, 200, r); }
+static void FillScreen(int r) { vga.FillRectangle(0, 0, 320, 200, r); }
+static void FillSmall(int r) { vga.FillRectangle((r * 7) % 320 - 8, (r * 3) % 200, 37, 23, r); }
+static void CopyScreen(int r) { vga.FillBufferFull(0, 0, 320, 200, picture); }
+static void SpriteRaw(int r) { vga.FillBuffer((r * 7) % 320, (r * 3) % 200, 32, 32, sprite, false); }
+static void SpriteEncoded(int r) { vga.DrawSprite((r * 7) % 320, (r * 3) % 200, encoded, r & 1); }
+static void SpriteMirrored(int r) { vga.FillBuffer((r * 7) % 320, (r * 3) % 200, 32, 32, sprite, true); }
+static void Outline(int r) { vga.DrawRectangle((r * 7) % 280, (r * 3) % 160, 40, 40, r); }
+static void LineHorizontal(int r) { vga.DrawLineFlat(0, r % 200, 320, r % 200, r, true); }
+static void Text(int r) { vga.PutText("the quick brown fox jumps over", (r * 7) % 100, (r * 3) % 190, r); }
+static void LineVertical(int r) { vga.DrawLineFlat(r % 320, 0, r % 320, 200, r, false); }
+static void Room(int r) { for (uint8_t i = 0; i < 6; i++) { vga.FillPolygon(roomX[i], roomY[i], roomCount[i], roomColor[i]); } }
+static void Raycast(int r) { space->DrawSpace(&vga); space->MoveCamera((char*)"w", 0, 200); }
+static void RaycastTurning(int r) { layered->DrawSpace(&vga); layered->MoveCamera((char*)"w", 0, 200); }
+static void RaycastStill(int r) { layered->DrawSpace(&vga); layered->MoveCamera((char*)"w", 0, 160); }
+static void Dither(int r) { memcpy(dithered, photo, sizeof(photo)); vga.FSdither(dithered, 320, 200); }
+
+//a frame where only a cursor sized area changed, and one where everything did
+static void PresentSmall(int r) { vga.FillBuffer(150, 90, 32, 32, sprite, r & 1); vga.DrawToScreen(); }
+static void PresentFull(int r) { vga.FillRectangle(0, 0, 320, 200, r); vga.DrawToScreen(); }
+
+
+//pixels is how many a single call covers
+static void Bench(const char* name, void (*draw)(int), uint32_t rounds, double pixels) {
+
+	//warm up first so the timing doesn't depend on what ran before
+	for (uint32_t r = 0; r < rounds / 10; r++) { draw(r); }
+
+	double start = Now();
+	for (uint32_t r = 0; r < rounds; r++) { draw(r); }
+	double seconds = Now() - start;
+
+	printf("%-28s %10.1f Mpixel/s\n", name, pixels * rounds / seconds / 1e6);
+}
+
+
+int main(int argc, char** argv) {
+
+	MakeData();
+	Glyphs::Build();
+	encoded = new Sprite(sprite, 32, 32);
+	space = new RaycastSpace();
+	layered = new RaycastSpace();
+	layer = new Layer();
+	layered->background = layer;
+	vga.FrameBufferSegment = vram;
+
+	printf("primitives match per pixel drawing: %s\n", Check() ? "ok" : "MISMATCH");
+	printf("dither keeps block averages: %s\n", CheckDither() ? "ok" : "MISMATCH");
+	printf("polygons match per pixel even-odd: %s\n", CheckPolygon() ? "ok" : "MISMATCH");
+	printf("layered raycast matches full redraw: %s\n\n", CheckLayer() ? "ok" : "MISMATCH");
+
+	//pixels the room covers, counting overlaps
+	uint32_t roomPixels = 0;
+
+	for (uint8_t i = 0; i < 6; i++) {
+
+		memset(vga.pixels, 0, 64000);
+		vga.FillPolygon(roomX[i], roomY[i], roomCount[i], 1);
+		for (uint32_t p = 0; p < 64000; p++) { roomPixels += vga.pixels[p]; }
+	}
+
+	Bench("PutPixel loop 320x200", PutPixelLoop, BENCH_ROUNDS, 64000);
+	Bench("FillRectangle 320x200", FillScreen, BENCH_ROUNDS, 64000);
+	Bench("FillRectangle 37x23", FillSmall, BENCH_ROUNDS * 50, 37 * 23);
+	Bench("FillBufferFull 320x200", CopyScreen, BENCH_ROUNDS, 64000);
+	Bench("FillBuffer 32x32", SpriteRaw, BENCH_ROUNDS * 50, 32 * 32);
+	Bench("FillBuffer 32x32 mirrored", SpriteMirrored, BENCH_ROUNDS * 50, 32 * 32);
+	Bench("DrawSprite 32x32", SpriteEncoded, BENCH_ROUNDS * 50, 32 * 32);
+	Bench("DrawRectangle 40x40", Outline, BENCH_ROUNDS * 50, 4 * 40);
+	Bench("DrawLineFlat horizontal", LineHorizontal, BENCH_ROUNDS * 50, 320);
+	Bench("DrawLineFlat vertical", LineVertical, BENCH_ROUNDS * 50, 200);
+	Bench("PutText 30 chars", Text, BENCH_ROUNDS * 50, 30 * font_width * font_height);
+	Bench("FillPolygon room", Room, BENCH_ROUNDS * 10, roomPixels);
+	Bench("FSdither 320x200", Dither, BENCH_ROUNDS / 10, 64000);
+	Bench("RaycastSpace frame", Raycast, BENCH_ROUNDS, 64000);
+	Bench("RaycastSpace turning, layer", RaycastTurning, BENCH_ROUNDS, 64000);
+	Bench("RaycastSpace still, layer", RaycastStill, BENCH_ROUNDS, 64000);
+
+	//screen pixels per second, not just the changed ones
+	Bench("DrawToScreen small change", PresentSmall, BENCH_ROUNDS, 64000);
+	Bench("DrawToScreen full change", PresentFull, BENCH_ROUNDS, 64000);
+
+	return 0;
+}